@@ -93,6 +93,14 @@ SOURCE=.\src\als2mp4.cpp
 # End Source File
 # Begin Source File
 
+SOURCE=.\src\alsbuffer.cpp
+# End Source File
+# Begin Source File
+
+SOURCE=.\src\libmp4als.cpp
+# End Source File
+# Begin Source File
+
 SOURCE=.\src\audiorw.cpp
 # End Source File
 # Begin Source File
@@ -149,10 +157,22 @@ SOURCE=.\src\rn_bitio.cpp
 # End Source File
 # Begin Source File
 
+SOURCE=.\src\scratch.cpp
+# End Source File
+# Begin Source File
+
+SOURCE=.\src\stats.cpp
+# End Source File
+# Begin Source File
+
 SOURCE=.\src\stream.cpp
 # End Source File
 # Begin Source File
 
+SOURCE=.\src\trace.cpp
+# End Source File
+# Begin Source File
+
 SOURCE=.\src\wave.cpp
 # End Source File
 # End Group
@@ -165,6 +185,14 @@ SOURCE=.\src\als2mp4.h
 # End Source File
 # Begin Source File
 
+SOURCE=.\src\alsbuffer.h
+# End Source File
+# Begin Source File
+
+SOURCE=.\src\libmp4als.h
+# End Source File
+# Begin Source File
+
 SOURCE=.\src\audiorw.h
 # End Source File
 # Begin Source File
@@ -225,10 +253,22 @@ SOURCE=.\src\rn_bitio.h
 # End Source File
 # Begin Source File
 
+SOURCE=.\src\scratch.h
+# End Source File
+# Begin Source File
+
+SOURCE=.\src\stats.h
+# End Source File
+# Begin Source File
+
 SOURCE=.\src\stream.h
 # End Source File
 # Begin Source File
 
+SOURCE=.\src\trace.h
+# End Source File
+# Begin Source File
+
 SOURCE=.\src\wave.h
 # End Source File
 # End Group
@@ -261,10 +301,18 @@ SOURCE=.\src\AlsImf\ImfBox.cpp
 # End Source File
 # Begin Source File
 
+SOURCE=.\src\AlsImf\ImfBufferedStream.cpp
+# End Source File
+# Begin Source File
+
 SOURCE=.\src\AlsImf\ImfBox.h
 # End Source File
 # Begin Source File
 
+SOURCE=.\src\AlsImf\ImfBufferedStream.h
+# End Source File
+# Begin Source File
+
 SOURCE=.\src\AlsImf\ImfDescriptor.cpp
 # End Source File
 # Begin Source File
@@ -281,6 +329,14 @@ SOURCE=.\src\AlsImf\ImfFileStream.h
 # End Source File
 # Begin Source File
 
+SOURCE=.\src\AlsImf\ImfMemoryStream.cpp
+# End Source File
+# Begin Source File
+
+SOURCE=.\src\AlsImf\ImfMemoryStream.h
+# End Source File
+# Begin Source File
+
 SOURCE=.\src\AlsImf\ImfPrintStream.cpp
 # End Source File
 # Begin Source File
@@ -234,13 +234,13 @@ CBox*	CBoxReader::CreateBox( IMF_UINT32 Type )
 	case	IMF_FOURCC_UDTA:	p = new CUserDataBox();								break;
 //	case	IMF_FOURCC_CPRT:	p = new CCopyrightBox();							break;
 	case	IMF_FOURCC_MVEX:	p = new CMovieExtendsBox();							break;
-//	case	IMF_FOURCC_MEHD:	p = new CMovieExtendsHeaderBox();					break;
-//	case	IMF_FOURCC_TREX:	p = new CTrackExtendsBox();							break;
+	case	IMF_FOURCC_MEHD:	p = new CMovieExtendsHeaderBox();					break;
+	case	IMF_FOURCC_TREX:	p = new CTrackExtendsBox();							break;
 	case	IMF_FOURCC_MOOF:	p = new CMovieFragmentBox();						break;
-//	case	IMF_FOURCC_MFHD:	p = new CMovieFragmentHeaderBox();					break;
+	case	IMF_FOURCC_MFHD:	p = new CMovieFragmentHeaderBox();					break;
 	case	IMF_FOURCC_TRAF:	p = new CTrackFragmentBox();						break;
-//	case	IMF_FOURCC_TFHD:	p = new CTrackFragmentHeaderBox();					break;
-//	case	IMF_FOURCC_TRUN:	p = new CTrackRunBox();								break;
+	case	IMF_FOURCC_TFHD:	p = new CTrackFragmentHeaderBox();					break;
+	case	IMF_FOURCC_TRUN:	p = new CTrackRunBox();								break;
 	case	IMF_FOURCC_MFRA:	p = new CMovieFragmentRandomAccessBox();			break;
 //	case	IMF_FOURCC_TFRA:	p = new CTrackFragmentRandomAccessBox();			break;
 //	case	IMF_FOURCC_MFRO:	p = new CMovieFragmentRandomAccessOffsetBox();		break;
@@ -2417,6 +2417,311 @@ bool	CChunkLargeOffsetBox::Write( CBaseStream& Stream ) const
 	return true;
 }
 
+//////////////////////////////////////////////////////////////////////
+//                                                                  //
+//               CMovieExtendsHeaderBox class (mehd)                //
+//                                                                  //
+//////////////////////////////////////////////////////////////////////
+
+////////////////////////////////////////
+//                                    //
+//                Read                //
+//                                    //
+////////////////////////////////////////
+// Stream = Input stream
+// Return value = true:Success / false:Error
+bool	CMovieExtendsHeaderBox::Read( CBaseStream& Stream )
+{
+	IMF_UINT32	Value32;
+
+	// Read basic fields.
+	if ( !CFullBox::Read( Stream ) ) return false;
+
+	try {
+		if ( m_version == 0 ) {
+			if ( !Stream.Read32( Value32 ) ) throw E_READ_STREAM;
+			m_fragment_duration = Value32;
+		} else {
+			if ( !Stream.Read64( m_fragment_duration ) ) throw E_READ_STREAM;
+		}
+		if ( CheckReadSize( Stream ) != 0 ) throw E_BOX_SIZE;
+	}
+	catch( IMF_UINT32 e ) {
+		SetLastError( e );
+		return false;
+	}
+	return true;
+}
+
+////////////////////////////////////////
+//                                    //
+//               Write                //
+//                                    //
+////////////////////////////////////////
+// Stream = Output stream
+// Return value = true:Success / false:Error
+bool	CMovieExtendsHeaderBox::Write( CBaseStream& Stream ) const
+{
+	// Write basic fields.
+	if ( !CFullBox::Write( Stream ) ) return false;
+
+	if ( m_version == 0 ) return Stream.Write32( static_cast<IMF_UINT32>( m_fragment_duration ) );
+	return Stream.Write64( m_fragment_duration );
+}
+
+//////////////////////////////////////////////////////////////////////
+//                                                                  //
+//                  CTrackExtendsBox class (trex)                   //
+//                                                                  //
+//////////////////////////////////////////////////////////////////////
+
+////////////////////////////////////////
+//                                    //
+//                Read                //
+//                                    //
+////////////////////////////////////////
+// Stream = Input stream
+// Return value = true:Success / false:Error
+bool	CTrackExtendsBox::Read( CBaseStream& Stream )
+{
+	// Read basic fields.
+	if ( !CFullBox::Read( Stream ) ) return false;
+
+	try {
+		if ( !Stream.Read32( m_track_ID ) || !Stream.Read32( m_default_sample_description_index ) ) throw E_READ_STREAM;
+		if ( !Stream.Read32( m_default_sample_duration ) || !Stream.Read32( m_default_sample_size ) || !Stream.Read32( m_default_sample_flags ) ) throw E_READ_STREAM;
+		if ( CheckReadSize( Stream ) != 0 ) throw E_BOX_SIZE;
+	}
+	catch( IMF_UINT32 e ) {
+		SetLastError( e );
+		return false;
+	}
+	return true;
+}
+
+////////////////////////////////////////
+//                                    //
+//               Write                //
+//                                    //
+////////////////////////////////////////
+// Stream = Output stream
+// Return value = true:Success / false:Error
+bool	CTrackExtendsBox::Write( CBaseStream& Stream ) const
+{
+	// Write basic fields.
+	if ( !CFullBox::Write( Stream ) ) return false;
+
+	if ( !Stream.Write32( m_track_ID ) || !Stream.Write32( m_default_sample_description_index ) ) return false;
+	return Stream.Write32( m_default_sample_duration ) && Stream.Write32( m_default_sample_size ) && Stream.Write32( m_default_sample_flags );
+}
+
+//////////////////////////////////////////////////////////////////////
+//                                                                  //
+//               CMovieFragmentHeaderBox class (mfhd)               //
+//                                                                  //
+//////////////////////////////////////////////////////////////////////
+
+////////////////////////////////////////
+//                                    //
+//                Read                //
+//                                    //
+////////////////////////////////////////
+// Stream = Input stream
+// Return value = true:Success / false:Error
+bool	CMovieFragmentHeaderBox::Read( CBaseStream& Stream )
+{
+	// Read basic fields.
+	if ( !CFullBox::Read( Stream ) ) return false;
+
+	try {
+		if ( !Stream.Read32( m_sequence_number ) ) throw E_READ_STREAM;
+		if ( CheckReadSize( Stream ) != 0 ) throw E_BOX_SIZE;
+	}
+	catch( IMF_UINT32 e ) {
+		SetLastError( e );
+		return false;
+	}
+	return true;
+}
+
+////////////////////////////////////////
+//                                    //
+//               Write                //
+//                                    //
+////////////////////////////////////////
+// Stream = Output stream
+// Return value = true:Success / false:Error
+bool	CMovieFragmentHeaderBox::Write( CBaseStream& Stream ) const
+{
+	// Write basic fields.
+	if ( !CFullBox::Write( Stream ) ) return false;
+
+	return Stream.Write32( m_sequence_number );
+}
+
+//////////////////////////////////////////////////////////////////////
+//                                                                  //
+//               CTrackFragmentHeaderBox class (tfhd)               //
+//                                                                  //
+//////////////////////////////////////////////////////////////////////
+
+////////////////////////////////////////
+//                                    //
+//                Read                //
+//                                    //
+////////////////////////////////////////
+// Stream = Input stream
+// Return value = true:Success / false:Error
+bool	CTrackFragmentHeaderBox::Read( CBaseStream& Stream )
+{
+	// Read basic fields.
+	if ( !CFullBox::Read( Stream ) ) return false;
+
+	try {
+		if ( !Stream.Read32( m_track_ID ) ) throw E_READ_STREAM;
+		if ( HasField( BASE_DATA_OFFSET_PRESENT ) && !Stream.Read64( m_base_data_offset ) ) throw E_READ_STREAM;
+		if ( HasField( SAMPLE_DESCRIPTION_INDEX_PRESENT ) && !Stream.Read32( m_sample_description_index ) ) throw E_READ_STREAM;
+		if ( HasField( DEFAULT_SAMPLE_DURATION_PRESENT ) && !Stream.Read32( m_default_sample_duration ) ) throw E_READ_STREAM;
+		if ( HasField( DEFAULT_SAMPLE_SIZE_PRESENT ) && !Stream.Read32( m_default_sample_size ) ) throw E_READ_STREAM;
+		if ( HasField( DEFAULT_SAMPLE_FLAGS_PRESENT ) && !Stream.Read32( m_default_sample_flags ) ) throw E_READ_STREAM;
+		if ( CheckReadSize( Stream ) != 0 ) throw E_BOX_SIZE;
+	}
+	catch( IMF_UINT32 e ) {
+		SetLastError( e );
+		return false;
+	}
+	return true;
+}
+
+////////////////////////////////////////
+//                                    //
+//               Write                //
+//                                    //
+////////////////////////////////////////
+// Stream = Output stream
+// Return value = true:Success / false:Error
+bool	CTrackFragmentHeaderBox::Write( CBaseStream& Stream ) const
+{
+	// Write basic fields.
+	if ( !CFullBox::Write( Stream ) ) return false;
+
+	if ( !Stream.Write32( m_track_ID ) ) return false;
+	if ( HasField( BASE_DATA_OFFSET_PRESENT ) && !Stream.Write64( m_base_data_offset ) ) return false;
+	if ( HasField( SAMPLE_DESCRIPTION_INDEX_PRESENT ) && !Stream.Write32( m_sample_description_index ) ) return false;
+	if ( HasField( DEFAULT_SAMPLE_DURATION_PRESENT ) && !Stream.Write32( m_default_sample_duration ) ) return false;
+	if ( HasField( DEFAULT_SAMPLE_SIZE_PRESENT ) && !Stream.Write32( m_default_sample_size ) ) return false;
+	if ( HasField( DEFAULT_SAMPLE_FLAGS_PRESENT ) && !Stream.Write32( m_default_sample_flags ) ) return false;
+	return true;
+}
+
+////////////////////////////////////////
+//                                    //
+//         Calculate box size         //
+//                                    //
+////////////////////////////////////////
+// Return value = Whole box size in bytes (-1 means error)
+IMF_INT64	CTrackFragmentHeaderBox::CalcSize( void )
+{
+	IMF_INT64	Size = 4;
+	if ( HasField( BASE_DATA_OFFSET_PRESENT ) ) Size += 8;
+	if ( HasField( SAMPLE_DESCRIPTION_INDEX_PRESENT ) ) Size += 4;
+	if ( HasField( DEFAULT_SAMPLE_DURATION_PRESENT ) ) Size += 4;
+	if ( HasField( DEFAULT_SAMPLE_SIZE_PRESENT ) ) Size += 4;
+	if ( HasField( DEFAULT_SAMPLE_FLAGS_PRESENT ) ) Size += 4;
+	return SetDataSize( Size );
+}
+
+//////////////////////////////////////////////////////////////////////
+//                                                                  //
+//                    CTrackRunBox class (trun)                     //
+//                                                                  //
+//////////////////////////////////////////////////////////////////////
+
+////////////////////////////////////////
+//                                    //
+//                Read                //
+//                                    //
+////////////////////////////////////////
+// Stream = Input stream
+// Return value = true:Success / false:Error
+bool	CTrackRunBox::Read( CBaseStream& Stream )
+{
+	TRUN_ENTRY	Entry;
+	IMF_UINT32	sample_count;
+	IMF_UINT32	i;
+
+	// Clear entries.
+	m_Entries.clear();
+
+	// Read basic fields.
+	if ( !CFullBox::Read( Stream ) ) return false;
+
+	try {
+		if ( !Stream.Read32( sample_count ) ) throw E_READ_STREAM;
+		if ( HasField( DATA_OFFSET_PRESENT ) && !Stream.Read32( m_data_offset ) ) throw E_READ_STREAM;
+		if ( HasField( FIRST_SAMPLE_FLAGS_PRESENT ) && !Stream.Read32( m_first_sample_flags ) ) throw E_READ_STREAM;
+		memset( &Entry, 0, sizeof(Entry) );
+		for( i=0; i<sample_count; i++ ) {
+			if ( HasField( SAMPLE_DURATION_PRESENT ) && !Stream.Read32( Entry.m_sample_duration ) ) throw E_READ_STREAM;
+			if ( HasField( SAMPLE_SIZE_PRESENT ) && !Stream.Read32( Entry.m_sample_size ) ) throw E_READ_STREAM;
+			if ( HasField( SAMPLE_FLAGS_PRESENT ) && !Stream.Read32( Entry.m_sample_flags ) ) throw E_READ_STREAM;
+			if ( HasField( SAMPLE_COMPOSITION_TIME_OFFSETS_PRESENT ) && !Stream.Read32( Entry.m_sample_composition_time_offset ) ) throw E_READ_STREAM;
+			m_Entries.push_back( Entry );
+		}
+		if ( CheckReadSize( Stream ) != 0 ) throw E_BOX_SIZE;
+	}
+	catch( IMF_UINT32 e ) {
+		SetLastError( e );
+		return false;
+	}
+	return true;
+}
+
+////////////////////////////////////////
+//                                    //
+//               Write                //
+//                                    //
+////////////////////////////////////////
+// Stream = Output stream
+// Return value = true:Success / false:Error
+bool	CTrackRunBox::Write( CBaseStream& Stream ) const
+{
+	vector<TRUN_ENTRY>::const_iterator	i;
+
+	// Write basic fields.
+	if ( !CFullBox::Write( Stream ) ) return false;
+
+	if ( !Stream.Write32( static_cast<IMF_UINT32>( m_Entries.size() ) ) ) return false;
+	if ( HasField( DATA_OFFSET_PRESENT ) && !Stream.Write32( static_cast<IMF_UINT32>( m_data_offset ) ) ) return false;
+	if ( HasField( FIRST_SAMPLE_FLAGS_PRESENT ) && !Stream.Write32( m_first_sample_flags ) ) return false;
+	for( i=m_Entries.begin(); i!=m_Entries.end(); i++ ) {
+		if ( HasField( SAMPLE_DURATION_PRESENT ) && !Stream.Write32( i->m_sample_duration ) ) return false;
+		if ( HasField( SAMPLE_SIZE_PRESENT ) && !Stream.Write32( i->m_sample_size ) ) return false;
+		if ( HasField( SAMPLE_FLAGS_PRESENT ) && !Stream.Write32( i->m_sample_flags ) ) return false;
+		if ( HasField( SAMPLE_COMPOSITION_TIME_OFFSETS_PRESENT ) && !Stream.Write32( i->m_sample_composition_time_offset ) ) return false;
+	}
+	return true;
+}
+
+////////////////////////////////////////
+//                                    //
+//         Calculate box size         //
+//                                    //
+////////////////////////////////////////
+// Return value = Whole box size in bytes (-1 means error)
+IMF_INT64	CTrackRunBox::CalcSize( void )
+{
+	IMF_INT64	EntrySize = 0;
+	IMF_INT64	Size = 4;
+	if ( HasField( DATA_OFFSET_PRESENT ) ) Size += 4;
+	if ( HasField( FIRST_SAMPLE_FLAGS_PRESENT ) ) Size += 4;
+	if ( HasField( SAMPLE_DURATION_PRESENT ) ) EntrySize += 4;
+	if ( HasField( SAMPLE_SIZE_PRESENT ) ) EntrySize += 4;
+	if ( HasField( SAMPLE_FLAGS_PRESENT ) ) EntrySize += 4;
+	if ( HasField( SAMPLE_COMPOSITION_TIME_OFFSETS_PRESENT ) ) EntrySize += 4;
+	return SetDataSize( Size + EntrySize * m_Entries.size() );
+}
+
 //////////////////////////////////////////////////////////////////////
 //                                                                  //
 //                  CItemLocationBox class (iloc)                   //
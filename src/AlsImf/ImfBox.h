@@ -126,13 +126,13 @@ Contents : Box classes defined in ISO/IEC 14496-12
 #define	IMF_FOURCC_UDTA		IMF_FOURCC( 'u','d','t','a' )	// implemented
 #define	IMF_FOURCC_CPRT		IMF_FOURCC( 'c','p','r','t' )	// to be implemented
 #define	IMF_FOURCC_MVEX		IMF_FOURCC( 'm','v','e','x' )	// implemented
-#define	IMF_FOURCC_MEHD		IMF_FOURCC( 'm','e','h','d' )	// to be implemented
-#define	IMF_FOURCC_TREX		IMF_FOURCC( 't','r','e','x' )	// to be implemented
+#define	IMF_FOURCC_MEHD		IMF_FOURCC( 'm','e','h','d' )	// implemented
+#define	IMF_FOURCC_TREX		IMF_FOURCC( 't','r','e','x' )	// implemented
 #define	IMF_FOURCC_MOOF		IMF_FOURCC( 'm','o','o','f' )	// implemented
-#define	IMF_FOURCC_MFHD		IMF_FOURCC( 'm','f','h','d' )	// to be implemented
+#define	IMF_FOURCC_MFHD		IMF_FOURCC( 'm','f','h','d' )	// implemented
 #define	IMF_FOURCC_TRAF		IMF_FOURCC( 't','r','a','f' )	// implemented
-#define	IMF_FOURCC_TFHD		IMF_FOURCC( 't','f','h','d' )	// to be implemented
-#define	IMF_FOURCC_TRUN		IMF_FOURCC( 't','r','u','n' )	// to be implemented
+#define	IMF_FOURCC_TFHD		IMF_FOURCC( 't','f','h','d' )	// implemented
+#define	IMF_FOURCC_TRUN		IMF_FOURCC( 't','r','u','n' )	// implemented
 #define	IMF_FOURCC_MFRA		IMF_FOURCC( 'm','f','r','a' )	// implemented
 #define	IMF_FOURCC_TFRA		IMF_FOURCC( 't','f','r','a' )	// to be implemented
 #define	IMF_FOURCC_MFRO		IMF_FOURCC( 'm','f','r','o' )	// to be implemented
@@ -897,12 +897,40 @@ namespace NAlsImf {
 	//////////////////////////////////////////////////////////////////////
 	//               CMovieExtendsHeaderBox class (mehd)                //
 	//////////////////////////////////////////////////////////////////////
-	// ***** to be implemented *****
+	struct	CMovieExtendsHeaderBox : public CFullBox {
+		CMovieExtendsHeaderBox( IMF_UINT8 version = 0 ) : CFullBox( IMF_FOURCC_MEHD, NULL, version, 0 ), m_fragment_duration( 0 ) {}
+		bool		Read( CBaseStream& Stream );
+		bool		Write( CBaseStream& Stream ) const;
+		IMF_INT64	CalcSize( void ) { return SetDataSize( ( m_version == 0 ) ? 4 : 8 ); }
+		void		Print( CPrintStream& Stream ) const {
+			CFullBox::Print( Stream );
+			IMF_PRINT( fragment_duration );
+		}
+		IMF_UINT64	m_fragment_duration;
+	};
 
 	//////////////////////////////////////////////////////////////////////
 	//                  CTrackExtendsBox class (trex)                   //
 	//////////////////////////////////////////////////////////////////////
-	// ***** to be implemented *****
+	struct	CTrackExtendsBox : public CFullBox {
+		CTrackExtendsBox( void ) : CFullBox( IMF_FOURCC_TREX ), m_track_ID( 0 ), m_default_sample_description_index( 1 ), m_default_sample_duration( 0 ), m_default_sample_size( 0 ), m_default_sample_flags( 0 ) {}
+		bool		Read( CBaseStream& Stream );
+		bool		Write( CBaseStream& Stream ) const;
+		IMF_INT64	CalcSize( void ) { return SetDataSize( 20 ); }
+		void		Print( CPrintStream& Stream ) const {
+			CFullBox::Print( Stream );
+			IMF_PRINT( track_ID );
+			IMF_PRINT( default_sample_description_index );
+			IMF_PRINT( default_sample_duration );
+			IMF_PRINT( default_sample_size );
+			IMF_PRINT( default_sample_flags );
+		}
+		IMF_UINT32	m_track_ID;
+		IMF_UINT32	m_default_sample_description_index;
+		IMF_UINT32	m_default_sample_duration;
+		IMF_UINT32	m_default_sample_size;
+		IMF_UINT32	m_default_sample_flags;
+	};
 
 	//////////////////////////////////////////////////////////////////////
 	//                  CMovieFragmentBox class (moof)                  //
@@ -912,7 +940,17 @@ namespace NAlsImf {
 	//////////////////////////////////////////////////////////////////////
 	//               CMovieFragmentHeaderBox class (mfhd)               //
 	//////////////////////////////////////////////////////////////////////
-	// ***** to be implemented *****
+	struct	CMovieFragmentHeaderBox : public CFullBox {
+		CMovieFragmentHeaderBox( void ) : CFullBox( IMF_FOURCC_MFHD ), m_sequence_number( 0 ) {}
+		bool		Read( CBaseStream& Stream );
+		bool		Write( CBaseStream& Stream ) const;
+		IMF_INT64	CalcSize( void ) { return SetDataSize( 4 ); }
+		void		Print( CPrintStream& Stream ) const {
+			CFullBox::Print( Stream );
+			IMF_PRINT( sequence_number );
+		}
+		IMF_UINT32	m_sequence_number;
+	};
 
 	//////////////////////////////////////////////////////////////////////
 	//                  CTrackFragmentBox class (traf)                  //
@@ -922,12 +960,77 @@ namespace NAlsImf {
 	//////////////////////////////////////////////////////////////////////
 	//               CTrackFragmentHeaderBox class (tfhd)               //
 	//////////////////////////////////////////////////////////////////////
-	// ***** to be implemented *****
+	struct	CTrackFragmentHeaderBox : public CFullBox {
+		enum {
+			BASE_DATA_OFFSET_PRESENT         = 0x000001,
+			SAMPLE_DESCRIPTION_INDEX_PRESENT = 0x000002,
+			DEFAULT_SAMPLE_DURATION_PRESENT  = 0x000008,
+			DEFAULT_SAMPLE_SIZE_PRESENT      = 0x000010,
+			DEFAULT_SAMPLE_FLAGS_PRESENT     = 0x000020,
+			DURATION_IS_EMPTY                = 0x010000,
+			DEFAULT_BASE_IS_MOOF             = 0x020000
+		};
+		CTrackFragmentHeaderBox( IMF_UINT32 flags = 0 ) : CFullBox( IMF_FOURCC_TFHD, NULL, 0, flags ), m_track_ID( 0 ), m_base_data_offset( 0 ), m_sample_description_index( 0 ), m_default_sample_duration( 0 ), m_default_sample_size( 0 ), m_default_sample_flags( 0 ) {}
+		bool		Read( CBaseStream& Stream );
+		bool		Write( CBaseStream& Stream ) const;
+		IMF_INT64	CalcSize( void );
+		bool		HasField( IMF_UINT32 Flag ) const { return ( m_flags & Flag ) != 0; }
+		void		Print( CPrintStream& Stream ) const {
+			CFullBox::Print( Stream );
+			IMF_PRINT( track_ID );
+			if ( HasField( BASE_DATA_OFFSET_PRESENT ) ) IMF_PRINT( base_data_offset );
+			if ( HasField( SAMPLE_DESCRIPTION_INDEX_PRESENT ) ) IMF_PRINT( sample_description_index );
+			if ( HasField( DEFAULT_SAMPLE_DURATION_PRESENT ) ) IMF_PRINT( default_sample_duration );
+			if ( HasField( DEFAULT_SAMPLE_SIZE_PRESENT ) ) IMF_PRINT( default_sample_size );
+			if ( HasField( DEFAULT_SAMPLE_FLAGS_PRESENT ) ) IMF_PRINT( default_sample_flags );
+		}
+		IMF_UINT32	m_track_ID;
+		IMF_UINT64	m_base_data_offset;
+		IMF_UINT32	m_sample_description_index;
+		IMF_UINT32	m_default_sample_duration;
+		IMF_UINT32	m_default_sample_size;
+		IMF_UINT32	m_default_sample_flags;
+	};
 
 	//////////////////////////////////////////////////////////////////////
 	//                    CTrackRunBox class (trun)                     //
 	//////////////////////////////////////////////////////////////////////
-	// ***** to be implemented *****
+	struct	CTrackRunBox : public CFullBox {
+		enum {
+			DATA_OFFSET_PRESENT                     = 0x000001,
+			FIRST_SAMPLE_FLAGS_PRESENT              = 0x000004,
+			SAMPLE_DURATION_PRESENT                 = 0x000100,
+			SAMPLE_SIZE_PRESENT                     = 0x000200,
+			SAMPLE_FLAGS_PRESENT                    = 0x000400,
+			SAMPLE_COMPOSITION_TIME_OFFSETS_PRESENT = 0x000800
+		};
+		typedef	struct tagTRUN_ENTRY {
+			IMF_UINT32	m_sample_duration;
+			IMF_UINT32	m_sample_size;
+			IMF_UINT32	m_sample_flags;
+			IMF_UINT32	m_sample_composition_time_offset;
+		} TRUN_ENTRY;
+		CTrackRunBox( IMF_UINT32 flags = 0 ) : CFullBox( IMF_FOURCC_TRUN, NULL, 0, flags ), m_data_offset( 0 ), m_first_sample_flags( 0 ) {}
+		bool		Read( CBaseStream& Stream );
+		bool		Write( CBaseStream& Stream ) const;
+		IMF_INT64	CalcSize( void );
+		bool		HasField( IMF_UINT32 Flag ) const { return ( m_flags & Flag ) != 0; }
+		void		Print( CPrintStream& Stream ) const {
+			IMF_UINT32	n = 0;
+			CFullBox::Print( Stream );
+			if ( HasField( DATA_OFFSET_PRESENT ) ) IMF_PRINT( data_offset );
+			if ( HasField( FIRST_SAMPLE_FLAGS_PRESENT ) ) IMF_PRINT( first_sample_flags );
+			for( std::vector<TRUN_ENTRY>::const_iterator i=m_Entries.begin(); i!=m_Entries.end(); i++, n++ ) {
+				if ( HasField( SAMPLE_DURATION_PRESENT ) ) Stream << "sample_duration[" << n << "] = " << i->m_sample_duration << std::endl;
+				if ( HasField( SAMPLE_SIZE_PRESENT ) ) Stream << "sample_size[" << n << "] = " << i->m_sample_size << std::endl;
+				if ( HasField( SAMPLE_FLAGS_PRESENT ) ) Stream << "sample_flags[" << n << "] = " << i->m_sample_flags << std::endl;
+				if ( HasField( SAMPLE_COMPOSITION_TIME_OFFSETS_PRESENT ) ) Stream << "sample_composition_time_offset[" << n << "] = " << i->m_sample_composition_time_offset << std::endl;
+			}
+		}
+		IMF_INT32				m_data_offset;
+		IMF_UINT32				m_first_sample_flags;
+		std::vector<TRUN_ENTRY>	m_Entries;
+	};
 
 	//////////////////////////////////////////////////////////////////////
 	//            CMovieFragmentRandomAccessBox class (mfra)            //
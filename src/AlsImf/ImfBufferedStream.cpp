@@ -0,0 +1,295 @@
+/***************** MPEG-4 Audio Lossless Coding *********************
+
+This software module was originally developed by
+
+NTT (Nippon Telegraph and Telephone Corporation), Japan
+
+in the course of development of the MPEG-4 Audio standard ISO/IEC 14496-3
+and associated amendments. This software module is an implementation of
+a part of one or more MPEG-4 Audio lossless coding tools as specified
+by the MPEG-4 Audio standard. ISO/IEC gives users of the MPEG-4 Audio
+standards free license to this software module or modifications
+thereof for use in hardware or software products claiming conformance
+to the MPEG-4 Audio standards. Those intending to use this software
+module in hardware or software products are advised that this use may
+infringe existing patents. The original developer of this software
+module, the subsequent editors and their companies, and ISO/IEC have
+no liability for use of this software module or modifications thereof
+in an implementation. Copyright is not released for non MPEG-4 Audio
+conforming products. The original developer retains full right to use
+the code for the developer's own purpose, assign or donate the code to
+a third party and to inhibit third party from using the code for non
+MPEG-4 Audio conforming products. This copyright notice must be included
+in all copies or derivative works.
+
+Copyright (c) 2006.
+
+Filename : ImfBufferedStream.cpp
+Project  : MPEG-4 Audio Lossless Coding
+Contents : Buffered reader class
+
+*******************************************************************/
+
+#include	"ImfBufferedStream.h"
+
+using namespace NAlsImf;
+
+//////////////////////////////////////////////////////////////////////
+//                                                                  //
+//                      CBufferedReader class                       //
+//                                                                  //
+//////////////////////////////////////////////////////////////////////
+
+////////////////////////////////////////
+//                                    //
+//                Open                //
+//                                    //
+////////////////////////////////////////
+// pSource = Source stream, positioned where reading starts
+// BufferSize = Initial window size in bytes
+// Return value = true:Success / false:Error
+// * pSource is not closed by Close(). It must outlive this object.
+bool	CBufferedReader::Open( CBaseStream* pSource, IMF_UINT32 BufferSize )
+{
+	// Check double open.
+	if ( m_pSource != NULL ) {
+		SetLastError( E_ALREADY_OPENED );
+		return false;
+	}
+	if ( pSource == NULL ) {
+		SetLastError( E_OPEN_STREAM );
+		return false;
+	}
+
+	if ( BufferSize < 4096 ) BufferSize = 4096;
+	m_pBuffer = new IMF_UINT8 [ BufferSize ];
+	if ( m_pBuffer == NULL ) {
+		SetLastError( E_MEMORY );
+		return false;
+	}
+	m_Capacity = BufferSize;
+	m_Begin = m_End = 0;
+	m_Eof = false;
+
+	// Pipes cannot tell their position, so count from where we start.
+	m_BasePos = pSource->Tell();
+	if ( m_BasePos < 0 ) m_BasePos = 0;
+	m_pSource = pSource;
+	return true;
+}
+
+////////////////////////////////////////
+//                                    //
+//               Close                //
+//                                    //
+////////////////////////////////////////
+// Return value = true:Success / false:Error
+bool	CBufferedReader::Close( void )
+{
+	if ( m_pBuffer ) delete[] m_pBuffer;
+	m_pBuffer = NULL;
+	m_pSource = NULL;
+	m_Capacity = m_Begin = m_End = 0;
+	m_BasePos = 0;
+	m_Eof = false;
+	return true;
+}
+
+////////////////////////////////////////
+//                                    //
+//                Read                //
+//                                    //
+////////////////////////////////////////
+// pBuffer = Buffer to store read data
+// Size = Number of bytes to read
+// Return value = Actual read byte count
+IMF_UINT32	CBufferedReader::Read( void* pBuffer, IMF_UINT32 Size )
+{
+	IMF_UINT8*	pDst = reinterpret_cast<IMF_UINT8*>( pBuffer );
+	IMF_UINT32	Total = 0;
+	IMF_UINT32	Copy;
+
+	// Make sure that the stream is opened.
+	if ( m_pSource == NULL ) {
+		SetLastError( E_NOT_OPENED );
+		return 0;
+	}
+
+	while( Size > 0 ) {
+		if ( m_Begin == m_End ) {
+			// Large reads bypass the window.
+			if ( Size >= m_Capacity ) {
+				m_BasePos += m_End;
+				m_Begin = m_End = 0;
+				Copy = m_Eof ? 0 : m_pSource->Read( pDst, Size );
+				if ( Copy < Size ) m_Eof = true;
+				m_BasePos += Copy;
+				return Total + Copy;
+			}
+			if ( !Fill( 1 ) ) break;
+		}
+		Copy = m_End - m_Begin;
+		if ( Copy > Size ) Copy = Size;
+		memcpy( pDst, m_pBuffer + m_Begin, Copy );
+		m_Begin += Copy;
+		pDst += Copy;
+		Total += Copy;
+		Size -= Copy;
+	}
+	return Total;
+}
+
+////////////////////////////////////////
+//                                    //
+//                Tell                //
+//                                    //
+////////////////////////////////////////
+// Return value = Current position
+IMF_INT64	CBufferedReader::Tell( void )
+{
+	// Make sure that the stream is opened.
+	if ( m_pSource == NULL ) {
+		SetLastError( E_NOT_OPENED );
+		return -1;
+	}
+	return m_BasePos + m_Begin;
+}
+
+////////////////////////////////////////
+//                                    //
+//                Seek                //
+//                                    //
+////////////////////////////////////////
+// Offset = Offset
+// Origin = Starting point
+// Return value = true:Success / false:Error
+bool	CBufferedReader::Seek( IMF_INT64 Offset, SEEK_ORIGIN Origin )
+{
+	IMF_INT64	Skip;
+
+	// Make sure that the stream is opened.
+	if ( m_pSource == NULL ) {
+		SetLastError( E_NOT_OPENED );
+		return false;
+	}
+
+	if ( Origin == S_END ) {
+		// Only the source knows where the end is.
+		if ( !m_pSource->Seek( Offset, S_END ) || ( ( m_BasePos = m_pSource->Tell() ) < 0 ) ) {
+			SetLastError( E_SEEK_STREAM );
+			return false;
+		}
+		m_Begin = m_End = 0;
+		m_Eof = false;
+		return true;
+	}
+	if ( Origin == S_CURRENT ) Offset += m_BasePos + m_Begin;
+	if ( Offset < 0 ) {
+		SetLastError( E_SEEK_STREAM );
+		return false;
+	}
+
+	// Inside the window.
+	if ( ( Offset >= m_BasePos ) && ( Offset <= m_BasePos + m_End ) ) {
+		m_Begin = static_cast<IMF_UINT32>( Offset - m_BasePos );
+		return true;
+	}
+
+	// Reposition the source if it can do so.
+	if ( m_pSource->Seek( Offset, S_BEGIN ) ) {
+		m_BasePos = Offset;
+		m_Begin = m_End = 0;
+		m_Eof = false;
+		return true;
+	}
+
+	// Otherwise only forward skips are possible, by reading.
+	if ( Offset < m_BasePos ) {
+		SetLastError( E_SEEK_STREAM );
+		return false;
+	}
+	Skip = Offset - m_BasePos - m_End;
+	m_BasePos += m_End;
+	m_Begin = m_End = 0;
+	while( Skip > 0 ) {
+		if ( !Fill( 1 ) ) {
+			SetLastError( E_SEEK_STREAM );
+			return false;
+		}
+		if ( Skip < m_End ) {
+			m_Begin = static_cast<IMF_UINT32>( Skip );
+			break;
+		}
+		Skip -= m_End;
+		m_BasePos += m_End;
+		m_Begin = m_End = 0;
+	}
+	return true;
+}
+
+////////////////////////////////////////
+//                                    //
+//                Peek                //
+//                                    //
+////////////////////////////////////////
+// Request = Number of bytes the caller wants to look at
+// Size = Returns the number of bytes available at the returned pointer
+// Return value = Pointer to the data at the current position / NULL:Error or end of stream
+// * Size is less than Request only at the end of the stream.
+// * The pointer is valid until the next Read(), Seek() or Peek().
+const IMF_UINT8*	CBufferedReader::Peek( IMF_UINT32 Request, IMF_UINT32& Size )
+{
+	Size = 0;
+	if ( m_pSource == NULL ) {
+		SetLastError( E_NOT_OPENED );
+		return NULL;
+	}
+	if ( ( m_End - m_Begin < Request ) && !Fill( Request ) && ( m_Begin == m_End ) ) return NULL;
+	Size = m_End - m_Begin;
+	return m_pBuffer + m_Begin;
+}
+
+////////////////////////////////////////
+//                                    //
+//          Refill the window         //
+//                                    //
+////////////////////////////////////////
+// Request = Number of bytes wanted from the current position
+// Return value = true:Some data is available / false:End of stream or error
+bool	CBufferedReader::Fill( IMF_UINT32 Request )
+{
+	IMF_UINT8*	pNew;
+	IMF_UINT32	Rest, Size;
+
+	// Slide the unread data to the front.
+	Rest = m_End - m_Begin;
+	if ( m_Begin > 0 ) {
+		memmove( m_pBuffer, m_pBuffer + m_Begin, Rest );
+		m_BasePos += m_Begin;
+		m_Begin = 0;
+		m_End = Rest;
+	}
+
+	// Grow the window for a lookahead larger than it.
+	if ( Request > m_Capacity ) {
+		pNew = new IMF_UINT8 [ Request ];
+		if ( pNew == NULL ) {
+			SetLastError( E_MEMORY );
+			return ( m_End > 0 );
+		}
+		memcpy( pNew, m_pBuffer, m_End );
+		delete[] m_pBuffer;
+		m_pBuffer = pNew;
+		m_Capacity = Request;
+	}
+
+	// Top up the whole window, so that small requests do not hit the source each time.
+	while( !m_Eof && ( m_End < Request ) ) {
+		Size = m_pSource->Read( m_pBuffer + m_End, m_Capacity - m_End );
+		if ( Size == 0 ) m_Eof = true;
+		m_End += Size;
+	}
+	return ( m_End > 0 );
+}
+
+// End of ImfBufferedStream.cpp
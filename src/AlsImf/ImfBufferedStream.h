@@ -0,0 +1,77 @@
+/***************** MPEG-4 Audio Lossless Coding *********************
+
+This software module was originally developed by
+
+NTT (Nippon Telegraph and Telephone Corporation), Japan
+
+in the course of development of the MPEG-4 Audio standard ISO/IEC 14496-3
+and associated amendments. This software module is an implementation of
+a part of one or more MPEG-4 Audio lossless coding tools as specified
+by the MPEG-4 Audio standard. ISO/IEC gives users of the MPEG-4 Audio
+standards free license to this software module or modifications
+thereof for use in hardware or software products claiming conformance
+to the MPEG-4 Audio standards. Those intending to use this software
+module in hardware or software products are advised that this use may
+infringe existing patents. The original developer of this software
+module, the subsequent editors and their companies, and ISO/IEC have
+no liability for use of this software module or modifications thereof
+in an implementation. Copyright is not released for non MPEG-4 Audio
+conforming products. The original developer retains full right to use
+the code for the developer's own purpose, assign or donate the code to
+a third party and to inhibit third party from using the code for non
+MPEG-4 Audio conforming products. This copyright notice must be included
+in all copies or derivative works.
+
+Copyright (c) 2006.
+
+Filename : ImfBufferedStream.h
+Project  : MPEG-4 Audio Lossless Coding
+Contents : Buffered reader class
+
+*******************************************************************/
+
+#if !defined( IMFBUFFEREDSTREAM_INCLUDED )
+#define	IMFBUFFEREDSTREAM_INCLUDED
+
+#include	<cstring>
+#include	"ImfType.h"
+#include	"ImfStream.h"
+
+namespace NAlsImf {
+
+	//////////////////////////////////////////////////////////////////////
+	//                                                                  //
+	//                      CBufferedReader class                       //
+	//                                                                  //
+	//////////////////////////////////////////////////////////////////////
+	// Keeps a sliding window of the source stream in memory. Peek() refills the
+	// window to the requested lookahead, and seeks within the window never touch
+	// the source. Forward seeks beyond the window fall back to reading, so a
+	// non-seekable source such as a pipe can be parsed without backward seeks.
+	class	CBufferedReader : public CBaseStream {
+	public:
+		CBufferedReader( void ) : m_pSource( NULL ), m_pBuffer( NULL ), m_Capacity( 0 ), m_Begin( 0 ), m_End( 0 ), m_BasePos( 0 ), m_Eof( false ) {}
+		virtual	~CBufferedReader( void ) { Close(); }
+		IMF_UINT32	Read( void* pBuffer, IMF_UINT32 Size );
+		IMF_UINT32	Write( const void* pBuffer, IMF_UINT32 Size ) { SetLastError( E_READONLY ); return 0; }
+		IMF_INT64	Tell( void );
+		bool		Seek( IMF_INT64 Offset, SEEK_ORIGIN Origin );
+		const IMF_UINT8*	Peek( IMF_UINT32 Request, IMF_UINT32& Size );
+		bool		Open( CBaseStream* pSource, IMF_UINT32 BufferSize = 0x100000 );
+		bool		Close( void );
+	protected:
+		bool		Fill( IMF_UINT32 Request );
+	protected:
+		CBaseStream*	m_pSource;		// Source stream (not owned)
+		IMF_UINT8*	m_pBuffer;		// Window buffer
+		IMF_UINT32	m_Capacity;		// Allocated size of m_pBuffer in bytes
+		IMF_UINT32	m_Begin;		// Current position in m_pBuffer
+		IMF_UINT32	m_End;			// Number of valid bytes in m_pBuffer
+		IMF_INT64	m_BasePos;		// Source position of m_pBuffer[0]
+		bool		m_Eof;			// true:Source is exhausted
+	};
+}
+
+#endif	// IMFBUFFEREDSTREAM_INCLUDED
+
+// End of ImfBufferedStream.h
@@ -63,6 +63,7 @@ using namespace NAlsImf;
 //----------------------------------------
 #include	<windows.h>
 #include	<io.h>
+#include	<fcntl.h>
 
 // 64-bit functions
 #define	FOPEN64( a, b )		fopen( a, b )
@@ -103,13 +104,19 @@ int	fseek64_win( FILE* fp, __int64 offset, int origin )
 // For Linux / g++
 //----------------------------------------
 #include	<unistd.h>
+#include	<fcntl.h>
 #include	<sys/types.h>
+#include	<sys/stat.h>
+#include	<sys/mman.h>
 
 // 64-bit functions
 #define	FOPEN64( a, b )		fopen64( a, b )
 #define	FSEEK64( a, b, c )	fseeko64( a, b, c )
 #define	FTELL64( a )		ftello64( a )
 #define	FTRUNCATE64( a )	ftruncate64( fileno( a ), ftello64( a ) )
+#define	OPEN64( a, b, c )	open64( a, b, c )
+#define	PREAD64( a, b, c, d )	pread64( a, b, c, d )
+#define	PWRITE64( a, b, c, d )	pwrite64( a, b, c, d )
 
 #elif (defined( __APPLE__ ) || defined( __FreeBSD__ )) && defined( __GNUG__ )
 
@@ -117,17 +124,120 @@ int	fseek64_win( FILE* fp, __int64 offset, int origin )
 // For Mac OS X / g++
 //----------------------------------------
 #include	<unistd.h>
+#include	<fcntl.h>
+#include	<sys/types.h>
+#include	<sys/stat.h>
+#include	<sys/mman.h>
 
 // 64-bit functions
 #define	FOPEN64( a, b )		fopen( a, b )
 #define	FSEEK64( a, b, c )	fseeko( a, b, c )
 #define	FTELL64( a )		ftello( a )
 #define	FTRUNCATE64( a )	ftruncate( fileno( a ), ftello( a ) )
+#define	OPEN64( a, b, c )	open( a, b, c )
+#define	PREAD64( a, b, c, d )	pread( a, b, c, d )
+#define	PWRITE64( a, b, c, d )	pwrite( a, b, c, d )
 
 #else
 #error Unknown compiler.
 #endif
 
+//----------------------------------------
+// Positioned I/O for CFileWriter window
+//----------------------------------------
+#if defined( _MSC_VER )
+
+// Open a file for window I/O. Windows has no direct I/O through FILE*, so Direct is ignored.
+static FILE*	OpenWindowFile( const char* pFilename, bool Existing, bool Direct )
+{
+	FILE*	fp = FOPEN64( pFilename, Existing ? "r+b" : "w+b" );
+	if ( fp != NULL ) setvbuf( fp, NULL, _IONBF, 0 );
+	return fp;
+}
+
+// The stream is unbuffered, so seeking before each transfer costs nothing extra.
+static bool	WriteAt( FILE* fp, const void* pData, IMF_UINT32 Size, IMF_INT64 Pos )
+{
+	return ( FSEEK64( fp, Pos, SEEK_SET ) == 0 ) && ( fwrite( pData, 1, Size, fp ) == Size );
+}
+
+static IMF_UINT32	ReadAt( FILE* fp, void* pData, IMF_UINT32 Size, IMF_INT64 Pos )
+{
+	if ( FSEEK64( fp, Pos, SEEK_SET ) != 0 ) return 0;
+	return static_cast<IMF_UINT32>( fread( pData, 1, Size, fp ) );
+}
+
+// Drop written data from the page cache (no equivalent here).
+static void	DropCache( FILE* fp, IMF_INT64 Pos, IMF_UINT32 Size )
+{
+}
+
+#else
+
+// Open a file for window I/O. Direct = true:Bypass the page cache where supported.
+static FILE*	OpenWindowFile( const char* pFilename, bool Existing, bool Direct )
+{
+	int		Flags = Existing ? O_RDWR : ( O_RDWR | O_CREAT | O_TRUNC );
+	int		fd = -1;
+	FILE*	fp;
+
+#if defined( O_DIRECT )
+	// Some file systems refuse O_DIRECT. Use the page cache for them.
+	if ( Direct ) fd = OPEN64( pFilename, Flags | O_DIRECT, 0666 );
+#endif
+	if ( fd < 0 ) fd = OPEN64( pFilename, Flags, 0666 );
+	if ( fd < 0 ) return NULL;
+#if defined( F_NOCACHE )
+	if ( Direct ) fcntl( fd, F_NOCACHE, 1 );
+#endif
+	fp = fdopen( fd, "r+b" );
+	if ( fp == NULL ) {
+		close( fd );
+		return NULL;
+	}
+	setvbuf( fp, NULL, _IONBF, 0 );
+	return fp;
+}
+
+static bool	WriteAt( FILE* fp, const void* pData, IMF_UINT32 Size, IMF_INT64 Pos )
+{
+	const char*	p = reinterpret_cast<const char*>( pData );
+	ssize_t		Done;
+
+	while( Size > 0 ) {
+		Done = PWRITE64( fileno( fp ), p, Size, Pos );
+		if ( Done <= 0 ) return false;
+		p += Done;
+		Pos += Done;
+		Size -= static_cast<IMF_UINT32>( Done );
+	}
+	return true;
+}
+
+static IMF_UINT32	ReadAt( FILE* fp, void* pData, IMF_UINT32 Size, IMF_INT64 Pos )
+{
+	char*		p = reinterpret_cast<char*>( pData );
+	IMF_UINT32	Total = 0;
+	ssize_t		Done;
+
+	while( Total < Size ) {
+		Done = PREAD64( fileno( fp ), p + Total, Size - Total, Pos + Total );
+		if ( Done <= 0 ) break;
+		Total += static_cast<IMF_UINT32>( Done );
+	}
+	return Total;
+}
+
+// Written data will not be read again soon, so do not let it crowd out the page cache.
+static void	DropCache( FILE* fp, IMF_INT64 Pos, IMF_UINT32 Size )
+{
+#if defined( POSIX_FADV_DONTNEED )
+	posix_fadvise( fileno( fp ), Pos, Size, POSIX_FADV_DONTNEED );
+#endif
+}
+
+#endif
+
 //////////////////////////////////////////////////////////////////////
 //                                                                  //
 //                        CFileReader class                         //
@@ -141,8 +251,9 @@ int	fseek64_win( FILE* fp, __int64 offset, int origin )
 ////////////////////////////////////////
 // pFilename = File name to open.
 // Offset = Offset position
+// BufferSize = stdio buffer size in bytes (0:stdio default)
 // Return value = true:Success / false:Error
-bool	CFileReader::Open( const char* pFilename, IMF_INT64 Offset )
+bool	CFileReader::Open( const char* pFilename, IMF_INT64 Offset, IMF_UINT32 BufferSize )
 {
 	bool	Result = true;
 
@@ -157,6 +268,16 @@ bool	CFileReader::Open( const char* pFilename, IMF_INT64 Offset )
 		m_fp = FOPEN64( pFilename, "rb" );
 		if ( m_fp == NULL ) throw E_OPEN_STREAM;
 
+		// Large buffers cut the number of read calls on fast storage.
+		if ( BufferSize > 0 ) {
+			m_pBuffer = new char [ BufferSize ];
+			if ( m_pBuffer == NULL ) throw E_MEMORY;
+			if ( setvbuf( m_fp, m_pBuffer, _IOFBF, BufferSize ) != 0 ) throw E_MEMORY;
+		}
+#if defined( POSIX_FADV_SEQUENTIAL )
+		posix_fadvise( fileno( m_fp ), 0, 0, POSIX_FADV_SEQUENTIAL );
+#endif
+
 		// Seek to Offset.
 		if ( Offset != 0 ) {
 			if ( FSEEK64( m_fp, Offset, S_BEGIN ) != 0 ) throw E_SEEK_STREAM;
@@ -170,6 +291,10 @@ bool	CFileReader::Open( const char* pFilename, IMF_INT64 Offset )
 			fclose( m_fp );
 			m_fp = NULL;
 		}
+		if ( m_pBuffer ) {
+			delete[] m_pBuffer;
+			m_pBuffer = NULL;
+		}
 		m_Offset = 0;
 		SetLastError( ErrCode );
 		Result = false;
@@ -177,6 +302,35 @@ bool	CFileReader::Open( const char* pFilename, IMF_INT64 Offset )
 	return Result;
 }
 
+////////////////////////////////////////
+//                                    //
+//        Attach an open file         //
+//                                    //
+////////////////////////////////////////
+// fp = Opened file such as stdin. Close() does not close it.
+// Return value = true:Success / false:Error
+bool	CFileReader::Attach( FILE* fp )
+{
+	// Check double open.
+	if ( m_fp != NULL ) {
+		SetLastError( E_ALREADY_OPENED );
+		return false;
+	}
+	if ( fp == NULL ) {
+		SetLastError( E_OPEN_STREAM );
+		return false;
+	}
+
+#if defined( _MSC_VER )
+	// stdin is opened in text mode on Windows.
+	_setmode( _fileno( fp ), _O_BINARY );
+#endif
+	m_fp = fp;
+	m_Offset = 0;
+	m_Attached = true;
+	return true;
+}
+
 ////////////////////////////////////////
 //                                    //
 //               Close                //
@@ -189,13 +343,18 @@ bool	CFileReader::Close( void )
 
 	if ( m_fp != NULL ) {
 		// Close a stream.
-		if ( fclose( m_fp ) != 0 ) {
+		if ( !m_Attached && ( fclose( m_fp ) != 0 ) ) {
 			SetLastError( E_CLOSE_STREAM );
 			Result = false;
 		}
 		m_fp = NULL;
 	}
+	if ( m_pBuffer ) {
+		delete[] m_pBuffer;
+		m_pBuffer = NULL;
+	}
 	m_Offset = 0;
+	m_Attached = false;
 	return Result;
 }
 
@@ -273,6 +432,210 @@ bool	CFileReader::Seek( IMF_INT64 Offset, SEEK_ORIGIN Origin )
 	return true;
 }
 
+//////////////////////////////////////////////////////////////////////
+//                                                                  //
+//                     CMappedFileReader class                      //
+//                                                                  //
+//////////////////////////////////////////////////////////////////////
+
+////////////////////////////////////////
+//                                    //
+//                Open                //
+//                                    //
+////////////////////////////////////////
+// pFilename = File name to open.
+// Offset = Offset position
+// Return value = true:Success / false:Error
+// * Fails for files which cannot be mapped (empty files, pipes, or files
+//   too large for the address space). Use CFileReader for them.
+bool	CMappedFileReader::Open( const char* pFilename, IMF_INT64 Offset )
+{
+	// Check double open.
+	if ( m_pData != NULL ) {
+		SetLastError( E_ALREADY_OPENED );
+		return false;
+	}
+	if ( Offset < 0 ) {
+		SetLastError( E_SEEK_STREAM );
+		return false;
+	}
+
+#if defined( _MSC_VER )
+	HANDLE			hFile;
+	LARGE_INTEGER	FileSize;
+	void*			pView = NULL;
+
+	hFile = CreateFileA( pFilename, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, NULL );
+	if ( hFile == INVALID_HANDLE_VALUE ) {
+		SetLastError( E_OPEN_STREAM );
+		return false;
+	}
+	if ( GetFileSizeEx( hFile, &FileSize ) && ( FileSize.QuadPart > 0 ) && ( static_cast<IMF_UINT64>( FileSize.QuadPart ) <= static_cast<size_t>( -1 ) ) ) {
+		m_hMapping = CreateFileMappingA( hFile, NULL, PAGE_READONLY, 0, 0, NULL );
+		if ( m_hMapping != NULL ) {
+			pView = MapViewOfFile( m_hMapping, FILE_MAP_READ, 0, 0, 0 );
+			if ( pView == NULL ) {
+				CloseHandle( m_hMapping );
+				m_hMapping = NULL;
+			}
+		}
+	}
+	CloseHandle( hFile );
+	if ( pView == NULL ) {
+		SetLastError( E_OPEN_STREAM );
+		return false;
+	}
+	m_Size = static_cast<IMF_UINT64>( FileSize.QuadPart );
+#else
+	struct stat	FileStat;
+	void*		pView;
+	int			fd;
+
+	fd = open( pFilename, O_RDONLY );
+	if ( fd < 0 ) {
+		SetLastError( E_OPEN_STREAM );
+		return false;
+	}
+	if ( ( fstat( fd, &FileStat ) != 0 ) || !S_ISREG( FileStat.st_mode ) || ( FileStat.st_size <= 0 ) ||
+		 ( static_cast<IMF_UINT64>( FileStat.st_size ) > static_cast<size_t>( -1 ) ) ) {
+		close( fd );
+		SetLastError( E_OPEN_STREAM );
+		return false;
+	}
+	pView = mmap( NULL, static_cast<size_t>( FileStat.st_size ), PROT_READ, MAP_SHARED, fd, 0 );
+	close( fd );
+	if ( pView == MAP_FAILED ) {
+		SetLastError( E_OPEN_STREAM );
+		return false;
+	}
+	// Frames are parsed front to back, so let the kernel read ahead aggressively.
+	madvise( pView, static_cast<size_t>( FileStat.st_size ), MADV_SEQUENTIAL );
+	m_Size = static_cast<IMF_UINT64>( FileStat.st_size );
+#endif
+
+	m_pData = reinterpret_cast<const IMF_UINT8*>( pView );
+	m_Offset = Offset;
+	m_Pos = static_cast<IMF_UINT64>( Offset );
+	return true;
+}
+
+////////////////////////////////////////
+//                                    //
+//               Close                //
+//                                    //
+////////////////////////////////////////
+// Return value = true:Success / false:Error
+bool	CMappedFileReader::Close( void )
+{
+	bool	Result = true;
+
+	if ( m_pData != NULL ) {
+#if defined( _MSC_VER )
+		if ( !UnmapViewOfFile( m_pData ) ) Result = false;
+		CloseHandle( m_hMapping );
+		m_hMapping = NULL;
+#else
+		if ( munmap( const_cast<IMF_UINT8*>( m_pData ), static_cast<size_t>( m_Size ) ) != 0 ) Result = false;
+#endif
+		if ( !Result ) SetLastError( E_CLOSE_STREAM );
+		m_pData = NULL;
+	}
+	m_Size = m_Pos = 0;
+	m_Offset = 0;
+	return Result;
+}
+
+////////////////////////////////////////
+//                                    //
+//                Read                //
+//                                    //
+////////////////////////////////////////
+// pBuffer = Buffer to store read data
+// Size = Number of bytes to read
+// Return value = Actual read byte count
+IMF_UINT32	CMappedFileReader::Read( void* pBuffer, IMF_UINT32 Size )
+{
+	// Make sure that the stream is opened.
+	if ( m_pData == NULL ) {
+		SetLastError( E_NOT_OPENED );
+		return 0;
+	}
+
+	if ( m_Pos >= m_Size ) return 0;
+	if ( Size > m_Size - m_Pos ) Size = static_cast<IMF_UINT32>( m_Size - m_Pos );
+	memcpy( pBuffer, m_pData + m_Pos, Size );
+	m_Pos += Size;
+	return Size;
+}
+
+////////////////////////////////////////
+//                                    //
+//                Tell                //
+//                                    //
+////////////////////////////////////////
+// Return value = Current file position
+IMF_INT64	CMappedFileReader::Tell( void )
+{
+	// Make sure that the stream is opened.
+	if ( m_pData == NULL ) {
+		SetLastError( E_NOT_OPENED );
+		return -1;
+	}
+
+	// Return adjusted offset.
+	return static_cast<IMF_INT64>( m_Pos ) - m_Offset;
+}
+
+////////////////////////////////////////
+//                                    //
+//                Seek                //
+//                                    //
+////////////////////////////////////////
+// Offset = Offset
+// Origin = Starting point
+// Return value = true:Success / false:Error
+bool	CMappedFileReader::Seek( IMF_INT64 Offset, SEEK_ORIGIN Origin )
+{
+	// Make sure that the stream is opened.
+	if ( m_pData == NULL ) {
+		SetLastError( E_NOT_OPENED );
+		return false;
+	}
+
+	// Adjust offset position.
+	if ( Origin == S_BEGIN ) Offset += m_Offset;
+	else if ( Origin == S_CURRENT ) Offset += static_cast<IMF_INT64>( m_Pos );
+	else Offset += static_cast<IMF_INT64>( m_Size );
+
+	// Like fseek(), positions beyond the end are allowed.
+	if ( Offset < 0 ) {
+		SetLastError( E_SEEK_STREAM );
+		return false;
+	}
+	m_Pos = static_cast<IMF_UINT64>( Offset );
+	return true;
+}
+
+////////////////////////////////////////
+//                                    //
+//                Peek                //
+//                                    //
+////////////////////////////////////////
+// Request = Number of bytes the caller wants to look at (the whole file is mapped anyway)
+// Size = Returns the number of bytes from the current position to the end
+// Return value = Pointer into the mapping at the current position / NULL:Error
+const IMF_UINT8*	CMappedFileReader::Peek( IMF_UINT32 Request, IMF_UINT32& Size )
+{
+	Size = 0;
+	if ( m_pData == NULL ) {
+		SetLastError( E_NOT_OPENED );
+		return NULL;
+	}
+	if ( m_Pos >= m_Size ) return NULL;
+	Size = ( m_Size - m_Pos > 0xffffffff ) ? 0xffffffff : static_cast<IMF_UINT32>( m_Size - m_Pos );
+	return m_pData + m_Pos;
+}
+
 //////////////////////////////////////////////////////////////////////
 //                                                                  //
 //                        CFileWriter class                         //
@@ -287,8 +650,10 @@ bool	CFileReader::Seek( IMF_INT64 Offset, SEEK_ORIGIN Origin )
 // pFilename = File name to open.
 // Offset = Offset position
 // Mode = Stream mode
+// BufferSize = Write-back window size in bytes (0:stdio buffering, rounded up to FW_ALIGN)
 // Return value = true:Success / false:Error
-bool	CFileWriter::Open( const char* pFilename, IMF_INT64 Offset, IMF_UINT32 Mode )
+// * FW_DIRECT needs a window. FW_DEFAULT_BUFFER is used if BufferSize is 0.
+bool	CFileWriter::Open( const char* pFilename, IMF_INT64 Offset, IMF_UINT32 Mode, IMF_UINT32 BufferSize )
 {
 	bool	Result = true;
 
@@ -299,21 +664,43 @@ bool	CFileWriter::Open( const char* pFilename, IMF_INT64 Offset, IMF_UINT32 Mode
 	}
 
 	try {
+		if ( ( Mode & FW_DIRECT ) && ( BufferSize == 0 ) ) BufferSize = FW_DEFAULT_BUFFER;
+
 		// Open a file.
-		if ( Mode & FW_OPEN_EXISTING ) {
-			// Try to open an existing file.
-			m_fp = FOPEN64( pFilename, "r+b" );
-		}
-		if ( m_fp == NULL ) {
-			// Create a new file.
-			m_fp = FOPEN64( pFilename, "wb" );
-			if ( m_fp == NULL ) throw E_OPEN_STREAM;
-		}
+		if ( BufferSize > 0 ) {
+			// The window is read back around seek targets, so open read/write.
+			if ( Mode & FW_OPEN_EXISTING ) m_fp = OpenWindowFile( pFilename, true, ( Mode & FW_DIRECT ) != 0 );
+			if ( m_fp == NULL ) {
+				m_fp = OpenWindowFile( pFilename, false, ( Mode & FW_DIRECT ) != 0 );
+				if ( m_fp == NULL ) throw E_OPEN_STREAM;
+			}
+			if ( ( FSEEK64( m_fp, 0, SEEK_END ) != 0 ) || ( ( m_FileSize = FTELL64( m_fp ) ) < 0 ) ) throw E_SEEK_STREAM;
+
+			// Allocate an aligned window.
+			if ( BufferSize > 0xffffffff - 2 * FW_ALIGN ) throw E_MEMORY;
+			m_BufSize = ( BufferSize + FW_ALIGN - 1 ) & ~static_cast<IMF_UINT32>( FW_ALIGN - 1 );
+			m_pAlloc = new IMF_UINT8 [ m_BufSize + FW_ALIGN ];
+			if ( m_pAlloc == NULL ) throw E_MEMORY;
+			m_pBuffer = m_pAlloc + ( FW_ALIGN - reinterpret_cast<size_t>( m_pAlloc ) % FW_ALIGN ) % FW_ALIGN;
+			m_Mode = Mode;
+			if ( !Load( Offset & ~static_cast<IMF_INT64>( FW_ALIGN - 1 ) ) ) throw E_READ_STREAM;
+			m_Cur = static_cast<IMF_UINT32>( Offset - m_BufPos );
+		} else {
+			if ( Mode & FW_OPEN_EXISTING ) {
+				// Try to open an existing file.
+				m_fp = FOPEN64( pFilename, "r+b" );
+			}
+			if ( m_fp == NULL ) {
+				// Create a new file.
+				m_fp = FOPEN64( pFilename, "wb" );
+				if ( m_fp == NULL ) throw E_OPEN_STREAM;
+			}
 
-		// Seek to Offset.
-		if ( Offset != 0 ) {
-			if ( FSEEK64( m_fp, Offset, S_BEGIN ) != 0 ) throw E_SEEK_STREAM;
-			if ( FTELL64( m_fp ) != Offset ) throw E_SEEK_STREAM;
+			// Seek to Offset.
+			if ( Offset != 0 ) {
+				if ( FSEEK64( m_fp, Offset, S_BEGIN ) != 0 ) throw E_SEEK_STREAM;
+				if ( FTELL64( m_fp ) != Offset ) throw E_SEEK_STREAM;
+			}
 		}
 		m_Offset = Offset;
 		m_Mode = Mode;
@@ -324,6 +711,9 @@ bool	CFileWriter::Open( const char* pFilename, IMF_INT64 Offset, IMF_UINT32 Mode
 			fclose( m_fp );
 			m_fp = NULL;
 		}
+		if ( m_pAlloc ) delete[] m_pAlloc;
+		m_pAlloc = m_pBuffer = NULL;
+		m_BufSize = m_BufLen = m_Cur = 0;
 		m_Offset = 0;
 		m_Mode = 0;
 		SetLastError( ErrCode );
@@ -340,10 +730,24 @@ bool	CFileWriter::Open( const char* pFilename, IMF_INT64 Offset, IMF_UINT32 Mode
 // Return value = true:Success / false:Error
 bool	CFileWriter::Close( void )
 {
-	bool	Result = true;
+	bool		Result = true;
+	IMF_INT64	Size;
 
 	if ( m_fp != NULL ) {
-		if ( ( m_Mode & FW_NO_TRUNCATE ) == 0 ) {
+		if ( m_pBuffer != NULL ) {
+			if ( !Flush() ) {
+				SetLastError( E_CLOSE_STREAM );
+				Result = false;
+			}
+
+			// Direct writes are padded to FW_ALIGN, so always cut the file to its real size.
+			Size = ( m_Mode & FW_NO_TRUNCATE ) ? m_FileSize : m_BufPos + m_Cur;
+			if ( FSEEK64( m_fp, Size, SEEK_SET ) != 0 ) {
+				SetLastError( E_CLOSE_STREAM );
+				Result = false;
+			}
+			else FTRUNCATE64( m_fp );
+		} else if ( ( m_Mode & FW_NO_TRUNCATE ) == 0 ) {
 			// Cut off data after the current write position.
 			if ( fflush( m_fp ) != 0 ) {
 				SetLastError( E_CLOSE_STREAM );
@@ -359,6 +763,10 @@ bool	CFileWriter::Close( void )
 		}
 		m_fp = NULL;
 	}
+	if ( m_pAlloc ) delete[] m_pAlloc;
+	m_pAlloc = m_pBuffer = NULL;
+	m_BufSize = m_BufLen = m_Cur = m_DirtyBegin = m_DirtyEnd = 0;
+	m_BufPos = m_FileSize = 0;
 	m_Offset = 0;
 	m_Mode = 0;
 	return Result;
@@ -366,7 +774,7 @@ bool	CFileWriter::Close( void )
 
 ////////////////////////////////////////
 //                                    //
-//                Read                //
+//               Write                //
 //                                    //
 ////////////////////////////////////////
 // pData = Data to write
@@ -374,6 +782,10 @@ bool	CFileWriter::Close( void )
 // Return value = Actual written byte count
 IMF_UINT32	CFileWriter::Write( const void* pData, IMF_UINT32 Size )
 {
+	const IMF_UINT8*	p = reinterpret_cast<const IMF_UINT8*>( pData );
+	IMF_UINT32			Total = 0;
+	IMF_UINT32			Copy;
+
 	// Make sure that the stream is opened.
 	if ( m_fp == NULL ) {
 		SetLastError( E_NOT_OPENED );
@@ -381,7 +793,37 @@ IMF_UINT32	CFileWriter::Write( const void* pData, IMF_UINT32 Size )
 	}
 
 	// Write data.
-	return static_cast<IMF_UINT32>( fwrite( pData, 1, Size, m_fp ) );
+	if ( m_pBuffer == NULL ) return static_cast<IMF_UINT32>( fwrite( pData, 1, Size, m_fp ) );
+
+	while( Size > 0 ) {
+		// Move on to the next window when this one is full.
+		if ( m_Cur == m_BufSize ) {
+			if ( !Flush() ) break;
+			// The window before this one has been written back by now.
+			if ( m_BufPos >= m_BufSize ) DropCache( m_fp, m_BufPos - m_BufSize, m_BufSize );
+			if ( !Load( m_BufPos + m_BufSize ) ) break;
+		}
+
+		// Zero-fill the gap left by a seek beyond the end.
+		if ( m_Cur > m_BufLen ) {
+			memset( m_pBuffer + m_BufLen, 0, m_Cur - m_BufLen );
+			if ( m_DirtyBegin >= m_DirtyEnd ) m_DirtyBegin = m_BufLen;
+			else if ( m_BufLen < m_DirtyBegin ) m_DirtyBegin = m_BufLen;
+			m_DirtyEnd = m_Cur;
+		}
+
+		Copy = m_BufSize - m_Cur;
+		if ( Copy > Size ) Copy = Size;
+		memcpy( m_pBuffer + m_Cur, p, Copy );
+		if ( ( m_DirtyBegin >= m_DirtyEnd ) || ( m_Cur < m_DirtyBegin ) ) m_DirtyBegin = m_Cur;
+		m_Cur += Copy;
+		if ( m_Cur > m_DirtyEnd ) m_DirtyEnd = m_Cur;
+		if ( m_Cur > m_BufLen ) m_BufLen = m_Cur;
+		p += Copy;
+		Total += Copy;
+		Size -= Copy;
+	}
+	return Total;
 }
 
 ////////////////////////////////////////
@@ -401,7 +843,8 @@ IMF_INT64	CFileWriter::Tell( void )
 	}
 
 	// Get file position.
-	Result = static_cast<IMF_INT64>( FTELL64( m_fp ) );
+	if ( m_pBuffer != NULL ) Result = m_BufPos + m_Cur;
+	else Result = static_cast<IMF_INT64>( FTELL64( m_fp ) );
 	if ( Result == -1 ) {
 		SetLastError( E_TELL_STREAM );
 		return -1;
@@ -421,6 +864,8 @@ IMF_INT64	CFileWriter::Tell( void )
 // Return value = true:Success / false:Error
 bool	CFileWriter::Seek( IMF_INT64 Offset, SEEK_ORIGIN Origin )
 {
+	IMF_INT64	End;
+
 	// Make sure that the stream is opened.
 	if ( m_fp == NULL ) {
 		SetLastError( E_NOT_OPENED );
@@ -430,6 +875,31 @@ bool	CFileWriter::Seek( IMF_INT64 Offset, SEEK_ORIGIN Origin )
 	// Adjust offset position.
 	if ( Origin == S_BEGIN ) Offset += m_Offset;
 
+	if ( m_pBuffer != NULL ) {
+		// Resolve the target in the window's terms.
+		if ( Origin == S_CURRENT ) Offset += m_BufPos + m_Cur;
+		else if ( Origin == S_END ) {
+			End = ( m_BufLen > 0 ) ? m_BufPos + m_BufLen : 0;
+			Offset += ( m_FileSize > End ) ? m_FileSize : End;
+		}
+		if ( Offset < 0 ) {
+			SetLastError( E_SEEK_STREAM );
+			return false;
+		}
+
+		// Inside the window, only the cursor moves.
+		if ( ( Offset >= m_BufPos ) && ( Offset <= m_BufPos + m_BufSize ) ) {
+			m_Cur = static_cast<IMF_UINT32>( Offset - m_BufPos );
+			return true;
+		}
+		if ( !Flush() || !Load( Offset & ~static_cast<IMF_INT64>( FW_ALIGN - 1 ) ) ) {
+			SetLastError( E_SEEK_STREAM );
+			return false;
+		}
+		m_Cur = static_cast<IMF_UINT32>( Offset - m_BufPos );
+		return true;
+	}
+
 	// Set file position.
 	if ( FSEEK64( m_fp, Offset, static_cast<int>( Origin ) ) != 0 ) {
 		SetLastError( E_SEEK_STREAM );
@@ -438,4 +908,60 @@ bool	CFileWriter::Seek( IMF_INT64 Offset, SEEK_ORIGIN Origin )
 	return true;
 }
 
+////////////////////////////////////////
+//                                    //
+//        Write back the window       //
+//                                    //
+////////////////////////////////////////
+// Return value = true:Success / false:Error
+bool	CFileWriter::Flush( void )
+{
+	IMF_UINT32	Begin, End;
+
+	if ( m_DirtyBegin < m_DirtyEnd ) {
+		Begin = m_DirtyBegin;
+		End = m_DirtyEnd;
+		if ( m_Mode & FW_DIRECT ) {
+			// Direct I/O transfers whole aligned blocks. The padding is cut off in Close().
+			Begin &= ~static_cast<IMF_UINT32>( FW_ALIGN - 1 );
+			End = ( End + FW_ALIGN - 1 ) & ~static_cast<IMF_UINT32>( FW_ALIGN - 1 );
+			if ( End > m_BufLen ) memset( m_pBuffer + m_BufLen, 0, End - m_BufLen );
+		}
+		if ( !WriteAt( m_fp, m_pBuffer + Begin, End - Begin, m_BufPos + Begin ) ) {
+			SetLastError( E_WRITE_STREAM );
+			return false;
+		}
+	}
+	if ( ( m_BufLen > 0 ) && ( m_BufPos + m_BufLen > m_FileSize ) ) m_FileSize = m_BufPos + m_BufLen;
+	m_DirtyBegin = m_DirtyEnd = 0;
+	return true;
+}
+
+////////////////////////////////////////
+//                                    //
+//          Move the window           //
+//                                    //
+////////////////////////////////////////
+// Pos = New file position of the window, a multiple of FW_ALIGN
+// Return value = true:Success / false:Error
+// * The window must have been flushed.
+bool	CFileWriter::Load( IMF_INT64 Pos )
+{
+	IMF_UINT32	Size = 0;
+
+	// Existing data is read in, so that a partly rewritten block keeps the rest.
+	if ( Pos < m_FileSize ) {
+		Size = ( m_FileSize - Pos > m_BufSize ) ? m_BufSize : static_cast<IMF_UINT32>( m_FileSize - Pos );
+		if ( ReadAt( m_fp, m_pBuffer, ( Size + FW_ALIGN - 1 ) & ~static_cast<IMF_UINT32>( FW_ALIGN - 1 ), Pos ) < Size ) {
+			SetLastError( E_READ_STREAM );
+			return false;
+		}
+	}
+	m_BufPos = Pos;
+	m_BufLen = Size;
+	m_Cur = 0;
+	m_DirtyBegin = m_DirtyEnd = 0;
+	return true;
+}
+
 // End of ImfFileStream.cpp
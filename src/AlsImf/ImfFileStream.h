@@ -60,17 +60,46 @@ namespace NAlsImf {
 	//////////////////////////////////////////////////////////////////////
 	class	CFileReader : public CBaseStream {
 	public:
-		CFileReader( void ) : m_fp( NULL ), m_Offset( 0 ) {}
+		CFileReader( void ) : m_fp( NULL ), m_Offset( 0 ), m_Attached( false ), m_pBuffer( NULL ) {}
 		virtual	~CFileReader( void ) { Close(); }
 		IMF_UINT32	Read( void* pBuffer, IMF_UINT32 Size );
 		IMF_UINT32	Write( const void* pBuffer, IMF_UINT32 Size ) { SetLastError( E_READONLY ); return 0; }
 		IMF_INT64	Tell( void );
 		bool		Seek( IMF_INT64 Offset, SEEK_ORIGIN Origin );
-		bool		Open( const char* pFilename, IMF_INT64 Offset = 0 );
+		bool		Open( const char* pFilename, IMF_INT64 Offset = 0, IMF_UINT32 BufferSize = 0 );
+		bool		Attach( FILE* fp );
 		bool		Close( void );
 	protected:
 		FILE*		m_fp;			// File pointer
 		IMF_INT64	m_Offset;		// Offset position
+		bool		m_Attached;		// true:m_fp is not closed by Close()
+		char*		m_pBuffer;		// stdio buffer of BufferSize bytes (NULL:stdio default)
+	};
+
+	//////////////////////////////////////////////////////////////////////
+	//                                                                  //
+	//                     CMappedFileReader class                      //
+	//                                                                  //
+	//////////////////////////////////////////////////////////////////////
+	// Reads a file through a read-only memory mapping. Peek() returns pointers
+	// straight into the mapping, so parsers can work without copying.
+	class	CMappedFileReader : public CBaseStream {
+	public:
+		CMappedFileReader( void ) : m_pData( NULL ), m_Size( 0 ), m_Pos( 0 ), m_Offset( 0 ), m_hMapping( NULL ) {}
+		virtual	~CMappedFileReader( void ) { Close(); }
+		IMF_UINT32	Read( void* pBuffer, IMF_UINT32 Size );
+		IMF_UINT32	Write( const void* pBuffer, IMF_UINT32 Size ) { SetLastError( E_READONLY ); return 0; }
+		IMF_INT64	Tell( void );
+		bool		Seek( IMF_INT64 Offset, SEEK_ORIGIN Origin );
+		const IMF_UINT8*	Peek( IMF_UINT32 Request, IMF_UINT32& Size );
+		bool		Open( const char* pFilename, IMF_INT64 Offset = 0 );
+		bool		Close( void );
+	protected:
+		const IMF_UINT8*	m_pData;	// Mapped file image
+		IMF_UINT64	m_Size;			// File size in bytes
+		IMF_UINT64	m_Pos;			// Current position in the file
+		IMF_INT64	m_Offset;		// Offset position
+		void*		m_hMapping;		// File mapping object (Windows only)
 	};
 
 	//////////////////////////////////////////////////////////////////////
@@ -78,21 +107,38 @@ namespace NAlsImf {
 	//                        CFileWriter class                         //
 	//                                                                  //
 	//////////////////////////////////////////////////////////////////////
+	// With a BufferSize, writes go through an aligned write-back window of that
+	// size. Seeks inside the window (e.g. patching a size field a little way
+	// back) only move the cursor, and the window reaches the file in large
+	// aligned writes. FW_DIRECT additionally bypasses the OS page cache.
 	class	CFileWriter : public CBaseStream {
 	public:
-		enum { FW_OPEN_EXISTING = 1, FW_NO_TRUNCATE = 2 };
-		CFileWriter( void ) : m_fp( NULL ), m_Offset( 0 ), m_Mode( 0 ) {}
+		enum { FW_OPEN_EXISTING = 1, FW_NO_TRUNCATE = 2, FW_DIRECT = 4 };
+		enum { FW_ALIGN = 4096, FW_DEFAULT_BUFFER = 0x400000 };
+		CFileWriter( void ) : m_fp( NULL ), m_Offset( 0 ), m_Mode( 0 ), m_pAlloc( NULL ), m_pBuffer( NULL ), m_BufSize( 0 ), m_BufPos( 0 ), m_BufLen( 0 ), m_Cur( 0 ), m_DirtyBegin( 0 ), m_DirtyEnd( 0 ), m_FileSize( 0 ) {}
 		virtual	~CFileWriter( void ) { Close(); }
 		IMF_UINT32	Read( void* pBuffer, IMF_UINT32 Size ) { SetLastError( E_WRITEONLY ); return 0; }
 		IMF_UINT32	Write( const void* pBuffer, IMF_UINT32 Size );
 		IMF_INT64	Tell( void );
 		bool		Seek( IMF_INT64 Offset, SEEK_ORIGIN Origin );
-		bool		Open( const char* pFilename, IMF_INT64 Offset = 0, IMF_UINT32 Mode = 0 );
+		bool		Open( const char* pFilename, IMF_INT64 Offset = 0, IMF_UINT32 Mode = 0, IMF_UINT32 BufferSize = 0 );
 		bool		Close( void );
+	protected:
+		bool		Flush( void );
+		bool		Load( IMF_INT64 Pos );
 	protected:
 		FILE*		m_fp;			// File pointer
 		IMF_INT64	m_Offset;		// Offset position
 		IMF_UINT32	m_Mode;			// Stream mode
+		IMF_UINT8*	m_pAlloc;		// Allocated memory holding m_pBuffer
+		IMF_UINT8*	m_pBuffer;		// Write-back window aligned to FW_ALIGN (NULL:stdio buffering)
+		IMF_UINT32	m_BufSize;		// Window size, a multiple of FW_ALIGN
+		IMF_INT64	m_BufPos;		// File position of m_pBuffer[0], a multiple of FW_ALIGN
+		IMF_UINT32	m_BufLen;		// Number of valid bytes in the window
+		IMF_UINT32	m_Cur;			// Current position in the window
+		IMF_UINT32	m_DirtyBegin;	// Start of the modified range in the window
+		IMF_UINT32	m_DirtyEnd;		// End of the modified range in the window
+		IMF_INT64	m_FileSize;		// File size as seen by the caller
 	};
 }
 
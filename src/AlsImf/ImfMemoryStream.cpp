@@ -0,0 +1,312 @@
+/***************** MPEG-4 Audio Lossless Coding *********************
+
+This software module was originally developed by
+
+NTT (Nippon Telegraph and Telephone Corporation), Japan
+
+in the course of development of the MPEG-4 Audio standard ISO/IEC 14496-3
+and associated amendments. This software module is an implementation of
+a part of one or more MPEG-4 Audio lossless coding tools as specified
+by the MPEG-4 Audio standard. ISO/IEC gives users of the MPEG-4 Audio
+standards free license to this software module or modifications
+thereof for use in hardware or software products claiming conformance
+to the MPEG-4 Audio standards. Those intending to use this software
+module in hardware or software products are advised that this use may
+infringe existing patents. The original developer of this software
+module, the subsequent editors and their companies, and ISO/IEC have
+no liability for use of this software module or modifications thereof
+in an implementation. Copyright is not released for non MPEG-4 Audio
+conforming products. The original developer retains full right to use
+the code for the developer's own purpose, assign or donate the code to
+a third party and to inhibit third party from using the code for non
+MPEG-4 Audio conforming products. This copyright notice must be included
+in all copies or derivative works.
+
+Copyright (c) 2006.
+
+Filename : ImfMemoryStream.cpp
+Project  : MPEG-4 Audio Lossless Coding
+Contents : Memory stream class
+
+*******************************************************************/
+
+#include	"ImfMemoryStream.h"
+
+using namespace NAlsImf;
+
+//////////////////////////////////////////////////////////////////////
+//                                                                  //
+//                       CMemoryStream class                        //
+//                                                                  //
+//////////////////////////////////////////////////////////////////////
+
+////////////////////////////////////////
+//                                    //
+//      Open growable data buffer     //
+//                                    //
+////////////////////////////////////////
+// Capacity = Initial buffer size in bytes
+// Return value = true:Success / false:Error
+bool	CMemoryStream::Open( IMF_UINT32 Capacity )
+{
+	// Check double open.
+	if ( m_Opened ) {
+		SetLastError( E_ALREADY_OPENED );
+		return false;
+	}
+
+	m_Owned = true;
+	m_Size = m_Pos = 0;
+	if ( ( Capacity > 0 ) && !Reserve( Capacity ) ) {
+		m_Owned = false;
+		return false;
+	}
+	m_Opened = true;
+	return true;
+}
+
+////////////////////////////////////////
+//                                    //
+//       Open read-only data          //
+//                                    //
+////////////////////////////////////////
+// pData = Pointer to data
+// Size = Number of bytes in pData
+// Return value = true:Success / false:Error
+// * pData must be kept valid while the stream is opened.
+bool	CMemoryStream::Open( const void* pData, IMF_UINT32 Size )
+{
+	// Check double open.
+	if ( m_Opened ) {
+		SetLastError( E_ALREADY_OPENED );
+		return false;
+	}
+
+	m_pBuffer = const_cast<IMF_UINT8*>( reinterpret_cast<const IMF_UINT8*>( pData ) );
+	m_Size = m_Capacity = Size;
+	m_Pos = 0;
+	m_Owned = false;
+	m_Opened = true;
+	return true;
+}
+
+////////////////////////////////////////
+//                                    //
+//      Open fixed-size data span     //
+//                                    //
+////////////////////////////////////////
+// pData = Pointer to buffer
+// Capacity = Size of pData in bytes
+// Size = Number of valid bytes already in pData
+// Return value = true:Success / false:Error
+// * The stream can be written up to Capacity bytes. It never reallocates pData.
+// * pData must be kept valid while the stream is opened.
+bool	CMemoryStream::Open( void* pData, IMF_UINT32 Capacity, IMF_UINT32 Size )
+{
+	// Check double open.
+	if ( m_Opened ) {
+		SetLastError( E_ALREADY_OPENED );
+		return false;
+	}
+	if ( ( pData == NULL ) || ( Size > Capacity ) ) {
+		SetLastError( E_WRITE_STREAM );
+		return false;
+	}
+
+	m_pBuffer = reinterpret_cast<IMF_UINT8*>( pData );
+	m_Capacity = Capacity;
+	m_Size = Size;
+	m_Pos = 0;
+	m_Owned = false;
+	m_Fixed = true;
+	m_Opened = true;
+	return true;
+}
+
+////////////////////////////////////////
+//                                    //
+//               Close                //
+//                                    //
+////////////////////////////////////////
+// Return value = true:Success / false:Error
+bool	CMemoryStream::Close( void )
+{
+	if ( m_Owned && m_pBuffer ) delete[] m_pBuffer;
+	m_pBuffer = NULL;
+	m_Size = m_Capacity = m_Pos = 0;
+	m_Owned = m_Fixed = false;
+	m_Opened = false;
+	return true;
+}
+
+////////////////////////////////////////
+//                                    //
+//                Read                //
+//                                    //
+////////////////////////////////////////
+// pBuffer = Buffer to store read data
+// Size = Number of bytes to read
+// Return value = Actual read byte count
+IMF_UINT32	CMemoryStream::Read( void* pBuffer, IMF_UINT32 Size )
+{
+	// Make sure that the stream is opened.
+	if ( !m_Opened ) {
+		SetLastError( E_NOT_OPENED );
+		return 0;
+	}
+
+	if ( m_Pos >= m_Size ) return 0;
+	if ( Size > m_Size - m_Pos ) Size = m_Size - m_Pos;
+	memcpy( pBuffer, m_pBuffer + m_Pos, Size );
+	m_Pos += Size;
+	return Size;
+}
+
+////////////////////////////////////////
+//                                    //
+//               Write                //
+//                                    //
+////////////////////////////////////////
+// pBuffer = Data to write
+// Size = Number of bytes to write
+// Return value = Actual written byte count
+IMF_UINT32	CMemoryStream::Write( const void* pBuffer, IMF_UINT32 Size )
+{
+	// Make sure that the stream is opened and writable.
+	if ( !m_Opened ) {
+		SetLastError( E_NOT_OPENED );
+		return 0;
+	}
+	if ( !m_Owned && !m_Fixed ) {
+		SetLastError( E_READONLY );
+		return 0;
+	}
+
+	if ( Size > 0xffffffff - m_Pos ) { SetLastError( E_WRITE_STREAM ); return 0; }
+	if ( ( m_Pos + Size > m_Capacity ) && !Reserve( m_Pos + Size ) ) return 0;
+
+	// Zero-fill the gap left by a seek beyond the end.
+	if ( m_Pos > m_Size ) memset( m_pBuffer + m_Size, 0, m_Pos - m_Size );
+
+	memcpy( m_pBuffer + m_Pos, pBuffer, Size );
+	m_Pos += Size;
+	if ( m_Pos > m_Size ) m_Size = m_Pos;
+	return Size;
+}
+
+////////////////////////////////////////
+//                                    //
+//                Tell                //
+//                                    //
+////////////////////////////////////////
+// Return value = Current position
+IMF_INT64	CMemoryStream::Tell( void )
+{
+	// Make sure that the stream is opened.
+	if ( !m_Opened ) {
+		SetLastError( E_NOT_OPENED );
+		return -1;
+	}
+	return m_Pos;
+}
+
+////////////////////////////////////////
+//                                    //
+//                Seek                //
+//                                    //
+////////////////////////////////////////
+// Offset = Offset
+// Origin = Starting point
+// Return value = true:Success / false:Error
+bool	CMemoryStream::Seek( IMF_INT64 Offset, SEEK_ORIGIN Origin )
+{
+	// Make sure that the stream is opened.
+	if ( !m_Opened ) {
+		SetLastError( E_NOT_OPENED );
+		return false;
+	}
+
+	if ( Origin == S_CURRENT ) Offset += m_Pos;
+	else if ( Origin == S_END ) Offset += m_Size;
+
+	// External data cannot be extended beyond its capacity, read-only data not at all.
+	if ( ( Offset < 0 ) || ( Offset > 0xffffffff ) || ( !m_Owned && ( Offset > ( m_Fixed ? m_Capacity : m_Size ) ) ) ) {
+		SetLastError( E_SEEK_STREAM );
+		return false;
+	}
+	m_Pos = static_cast<IMF_UINT32>( Offset );
+	return true;
+}
+
+////////////////////////////////////////
+//                                    //
+//                Peek                //
+//                                    //
+////////////////////////////////////////
+// Request = Number of bytes the caller wants to look at (all data is in memory anyway)
+// Size = Returns the number of bytes from the current position to the end
+// Return value = Pointer to the data at the current position / NULL:Error
+const IMF_UINT8*	CMemoryStream::Peek( IMF_UINT32 Request, IMF_UINT32& Size )
+{
+	Size = 0;
+	if ( !m_Opened ) {
+		SetLastError( E_NOT_OPENED );
+		return NULL;
+	}
+	if ( m_Pos >= m_Size ) return NULL;
+	Size = m_Size - m_Pos;
+	return m_pBuffer + m_Pos;
+}
+
+////////////////////////////////////////
+//                                    //
+//          Truncate the data         //
+//                                    //
+////////////////////////////////////////
+// Size = New data size in bytes (must not exceed the current size)
+// Return value = true:Success / false:Error
+// * The allocated buffer is kept for reuse.
+bool	CMemoryStream::Truncate( IMF_UINT32 Size )
+{
+	if ( !m_Opened ) { SetLastError( E_NOT_OPENED ); return false; }
+	if ( !m_Owned && !m_Fixed ) { SetLastError( E_READONLY ); return false; }
+	if ( Size > m_Size ) { SetLastError( E_WRITE_STREAM ); return false; }
+	m_Size = Size;
+	if ( m_Pos > m_Size ) m_Pos = m_Size;
+	return true;
+}
+
+////////////////////////////////////////
+//                                    //
+//          Grow data buffer          //
+//                                    //
+////////////////////////////////////////
+// Capacity = Required buffer size in bytes
+// Return value = true:Success / false:Error
+bool	CMemoryStream::Reserve( IMF_UINT32 Capacity )
+{
+	IMF_UINT8*	pNew;
+	IMF_UINT32	NewCapacity;
+
+	if ( Capacity <= m_Capacity ) return true;
+	if ( !m_Owned ) { SetLastError( E_WRITE_STREAM ); return false; }
+
+	// Grow geometrically so that appending stays amortized O(1).
+	NewCapacity = ( m_Capacity < 4096 ) ? 4096 : m_Capacity;
+	while( NewCapacity < Capacity ) {
+		if ( NewCapacity > 0x7fffffff ) { NewCapacity = Capacity; break; }
+		NewCapacity *= 2;
+	}
+
+	pNew = new IMF_UINT8 [ NewCapacity ];
+	if ( pNew == NULL ) { SetLastError( E_MEMORY ); return false; }
+	if ( m_pBuffer ) {
+		memcpy( pNew, m_pBuffer, m_Size );
+		delete[] m_pBuffer;
+	}
+	m_pBuffer = pNew;
+	m_Capacity = NewCapacity;
+	return true;
+}
+
+// End of ImfMemoryStream.cpp
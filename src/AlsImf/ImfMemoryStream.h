@@ -0,0 +1,78 @@
+/***************** MPEG-4 Audio Lossless Coding *********************
+
+This software module was originally developed by
+
+NTT (Nippon Telegraph and Telephone Corporation), Japan
+
+in the course of development of the MPEG-4 Audio standard ISO/IEC 14496-3
+and associated amendments. This software module is an implementation of
+a part of one or more MPEG-4 Audio lossless coding tools as specified
+by the MPEG-4 Audio standard. ISO/IEC gives users of the MPEG-4 Audio
+standards free license to this software module or modifications
+thereof for use in hardware or software products claiming conformance
+to the MPEG-4 Audio standards. Those intending to use this software
+module in hardware or software products are advised that this use may
+infringe existing patents. The original developer of this software
+module, the subsequent editors and their companies, and ISO/IEC have
+no liability for use of this software module or modifications thereof
+in an implementation. Copyright is not released for non MPEG-4 Audio
+conforming products. The original developer retains full right to use
+the code for the developer's own purpose, assign or donate the code to
+a third party and to inhibit third party from using the code for non
+MPEG-4 Audio conforming products. This copyright notice must be included
+in all copies or derivative works.
+
+Copyright (c) 2006.
+
+Filename : ImfMemoryStream.h
+Project  : MPEG-4 Audio Lossless Coding
+Contents : Memory stream class
+
+*******************************************************************/
+
+#if !defined( IMFMEMORYSTREAM_INCLUDED )
+#define	IMFMEMORYSTREAM_INCLUDED
+
+#include	<cstring>
+#include	"ImfType.h"
+#include	"ImfStream.h"
+
+namespace NAlsImf {
+
+	//////////////////////////////////////////////////////////////////////
+	//                                                                  //
+	//                       CMemoryStream class                        //
+	//                                                                  //
+	//////////////////////////////////////////////////////////////////////
+	class	CMemoryStream : public CBaseStream {
+	public:
+		CMemoryStream( void ) : m_pBuffer( NULL ), m_Size( 0 ), m_Capacity( 0 ), m_Pos( 0 ), m_Owned( false ), m_Fixed( false ), m_Opened( false ) {}
+		virtual	~CMemoryStream( void ) { Close(); }
+		IMF_UINT32	Read( void* pBuffer, IMF_UINT32 Size );
+		IMF_UINT32	Write( const void* pBuffer, IMF_UINT32 Size );
+		IMF_INT64	Tell( void );
+		bool		Seek( IMF_INT64 Offset, SEEK_ORIGIN Origin );
+		const IMF_UINT8*	Peek( IMF_UINT32 Request, IMF_UINT32& Size );
+		bool		Open( IMF_UINT32 Capacity = 0 );
+		bool		Open( const void* pData, IMF_UINT32 Size );
+		bool		Open( void* pData, IMF_UINT32 Capacity, IMF_UINT32 Size );
+		bool		Close( void );
+		bool		Truncate( IMF_UINT32 Size );
+		const IMF_UINT8*	GetBuffer( void ) const { return m_pBuffer; }
+		IMF_UINT32			GetSize( void ) const { return m_Size; }
+	protected:
+		bool		Reserve( IMF_UINT32 Capacity );
+	protected:
+		IMF_UINT8*	m_pBuffer;		// Data buffer
+		IMF_UINT32	m_Size;			// Number of valid bytes in m_pBuffer
+		IMF_UINT32	m_Capacity;		// Allocated size of m_pBuffer in bytes
+		IMF_UINT32	m_Pos;			// Current position
+		bool		m_Owned;		// true:Writable buffer owned by this object / false:External data
+		bool		m_Fixed;		// true:External data is writable within its capacity
+		bool		m_Opened;		// true:Stream is opened
+	};
+}
+
+#endif	// IMFMEMORYSTREAM_INCLUDED
+
+// End of ImfMemoryStream.h
@@ -36,6 +36,7 @@ Contents : General stream interface
 #if !defined( IMFSTREAM_INCLUDED )
 #define	IMFSTREAM_INCLUDED
 
+#include	<cstddef>
 #include	"ImfType.h"
 
 namespace NAlsImf {
@@ -77,6 +78,11 @@ namespace NAlsImf {
 		virtual	IMF_INT64	Tell( void ) = 0;
 		virtual	bool		Seek( IMF_INT64 Offset, SEEK_ORIGIN Origin ) = 0;
 
+		// Get the data at the current position without copying it. Request is the number
+		// of bytes the caller wants to look at, and Size receives the readable byte count.
+		// Streams which do not hold their data in memory return NULL.
+		virtual	const IMF_UINT8*	Peek( IMF_UINT32 Request, IMF_UINT32& Size ) { Size = 0; return NULL; }
+
 		// Read 8-bit value.
 		bool	Read8( IMF_INT8& Value ) { return Read8( reinterpret_cast<IMF_UINT8&>( Value ) ); }
 		bool	Read8( IMF_UINT8& Value ) { return ( Read( &Value, sizeof(Value) ) == sizeof(Value) ); }
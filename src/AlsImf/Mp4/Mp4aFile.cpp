@@ -77,6 +77,66 @@ Contents : MPEG-4 Audio reader and writer
 using namespace std;
 using namespace NAlsImf;
 
+//////////////////////////////////////////////////////////////////////
+//                                                                  //
+//                      CMp4aBoxReader class                        //
+//                                                                  //
+//////////////////////////////////////////////////////////////////////
+// Box reader for CMp4aReader::Open(). Boxes which are not needed to decode the audio
+// track are skipped without reading their contents: user data, free space, edit lists,
+// unknown boxes and the media information (with the sample tables) of non-audio tracks.
+class	CMp4aBoxReader : public CMp4BoxReader {
+public:
+	CMp4aBoxReader( void ) : m_pHandler( NULL ) {}
+	CBox*	CreateBox( IMF_UINT32 Type );
+protected:
+	const CHandlerBox*	m_pHandler;		// hdlr box of the current track (NULL:Not read yet)
+};
+
+// Box whose contents are skipped.
+class	CSkippedBox : public CBox {
+public:
+	CSkippedBox( void ) : CBox( 0 ) {}
+	IMF_UINT32	GetType( void ) const { return 0; }
+	bool		Read( CBaseStream& Stream ) {
+		IMF_INT64	Size;
+		if ( !CBox::Read( Stream ) ) return false;
+		if ( ( Size = GetDataSize() ) < 0 ) { SetLastError( E_BOX_SIZE ); return false; }
+		if ( !Stream.Seek( Size, CBaseStream::S_CURRENT ) ) { SetLastError( E_SEEK_STREAM ); return false; }
+		return true;
+	}
+};
+
+////////////////////////////////////////
+//                                    //
+//            Create a box            //
+//                                    //
+////////////////////////////////////////
+// Type = Box type
+// Return value = Pointer to newly created box object
+CBox*	CMp4aBoxReader::CreateBox( IMF_UINT32 Type )
+{
+	CBox*	pBox;
+
+	switch( Type ) {
+	case	IMF_FOURCC_UDTA:
+	case	IMF_FOURCC_FREE:
+	case	IMF_FOURCC_SKIP:
+	case	IMF_FOURCC_EDTS:
+		return new CSkippedBox();
+	case	IMF_FOURCC_TRAK:
+		m_pHandler = NULL;
+		break;
+	case	IMF_FOURCC_MINF:
+		// hdlr precedes minf in mdia.
+		if ( ( m_pHandler != NULL ) && ( m_pHandler->m_handler_type != IMF_FOURCC_SOUN ) ) return new CSkippedBox();
+		break;
+	}
+	if ( ( pBox = CMp4BoxReader::CreateBox( Type ) ) == NULL ) return new CSkippedBox();
+	if ( Type == IMF_FOURCC_HDLR ) m_pHandler = reinterpret_cast<CHandlerBox*>( pBox );
+	return pBox;
+}
+
 //////////////////////////////////////////////////////////////////////
 //                                                                  //
 //                        CMp4aReader class                         //
@@ -94,9 +154,12 @@ CMp4aReader::CMp4aReader( void )
 	m_pDecSpecInfo = NULL;
 	m_DecSpecInfoSize = 0;
 	m_MaxFrameSize = 0;
+	m_TotalSamples = 0;
 	m_HeaderOffset = m_TrailerOffset = m_AuxDataOffset = 0;
 	m_HeaderSize = m_TrailerSize = m_AuxDataSize = 0;
 	m_OrgFileType = 0;
+	m_ScanOffset = -1;
+	m_TrackID = m_DefaultDuration = m_DefaultSize = m_DefaultFlags = 0;
 	m_LastError = E_NONE;
 	m_audioProfileLevelIndication = 0xfe; // No OD profile specified
 }
@@ -111,34 +174,33 @@ CMp4aReader::CMp4aReader( void )
 bool	CMp4aReader::Open( CBaseStream& Stream )
 {
 	bool					Result = false;
-	CMp4BoxReader			Reader;
+	CMp4aBoxReader			Reader;
 	CBox*					pBox;
 	IMF_UINT32				Type;
 	IMF_INT64				Size;
+	IMF_INT64				MoovEnd = 0;
 	CMovieBox*				pMoov = NULL;
 	CMetaBox*				pMeta = NULL;
 	CSampleDescriptionBox*	pStsd;
 	CMP4AudioSampleEntry*	pMp4a;
-	CChunkInfo				ChunkInfo;
-	CFrameInfo				FrameInfo;
-	IMF_UINT64				NumFrames;
-	IMF_UINT32				i;
-	vector<IMF_UINT64>		ChunkOffsets;
-	vector<IMF_UINT32>		FramesPerChunk;
-	vector<IMF_UINT32>		SamplesPerFrame;
+	CChunkOffsetBox*		pStco = NULL;
+	CChunkLargeOffsetBox*	pCo64 = NULL;
+	CSampleToChunkBox*		pStsc;
+	CTimeToSampleBox*		pStts;
+	CSampleSizeBox*			pStsz = NULL;
+	IMF_UINT64				NumFrames, NumChunks;
+	IMF_UINT64				Offset;
+	IMF_UINT32				Chunk, Frame, Frames, i;
 	vector<IMF_UINT32>		SizesPerFrame;
-	vector<IMF_UINT64>::const_iterator	iOffset;
-	vector<IMF_UINT32>::const_iterator	iFrame;
-	vector<IMF_UINT32>::const_iterator	iSample;
-	vector<IMF_UINT32>::const_iterator	iSize;
+	vector<CSampleToChunkBox::STSC_ENTRY>::const_iterator	iStsc;
+	vector<CTimeToSampleBox::STTS_ENTRY>::const_iterator	iStts;
 	vector<CSampleEntry*>::const_iterator	iSampleEntry;
 
 	if ( m_pStream != NULL ) { SetLastError( E_MP4A_ALREADY_OPENED ); return false; }
 
 	// Set member variables.
 	m_pStream = &Stream;
-	m_ChunkInfo.clear();
-	m_FrameInfo.clear();
+	ClearIndex();
 	if ( m_pDecSpecInfo ) { delete[] m_pDecSpecInfo; m_pDecSpecInfo = NULL; }
 	m_DecSpecInfoSize = 0;
 	m_MaxFrameSize = 0;
@@ -146,6 +208,7 @@ bool	CMp4aReader::Open( CBaseStream& Stream )
 	m_HeaderSize = m_TrailerSize = m_AuxDataSize = 0;
 	m_OrgFileType = 0xff;	// 0xff means 'no file type detected'.
 	m_OrgMimeType.erase();
+	m_ScanOffset = -1;
 
 	try {
 		// Read moov and meta boxes.
@@ -154,6 +217,7 @@ bool	CMp4aReader::Open( CBaseStream& Stream )
 				if ( pMoov != NULL ) throw E_MP4A_MOOV;	// Too many moov boxes.
 				pMoov = reinterpret_cast<CMovieBox*>( Reader.Read( Stream ) );
 				if ( pMoov == NULL ) throw E_MP4A_MOOV;	// Failed to read moov box.
+				if ( ( MoovEnd = Stream.Tell() ) < 0 ) throw E_TELL_STREAM;
 
 			} else if ( Type == IMF_FOURCC_META ) {
 				if ( pMeta != NULL ) throw E_MP4A_META;	// Too many meta boxes.
@@ -171,6 +235,17 @@ bool	CMp4aReader::Open( CBaseStream& Stream )
 		}
 		if ( pMoov == NULL ) throw E_MP4A_MOOV;
 
+		// Search trex box. Movie fragments follow moov box when it is present.
+		pBox = NULL;
+		if ( pMoov->FindBox( IMF_FOURCC_TREX, pBox ) ) {
+			CTrackExtendsBox*	pTrex = reinterpret_cast<CTrackExtendsBox*>( pBox );
+			m_TrackID = pTrex->m_track_ID;
+			m_DefaultDuration = pTrex->m_default_sample_duration;
+			m_DefaultSize = pTrex->m_default_sample_size;
+			m_DefaultFlags = pTrex->m_default_sample_flags;
+			m_ScanOffset = MoovEnd;
+		}
+
 		// Search stsd box.
 		pBox = NULL;
 		if ( !pMoov->FindBox( IMF_FOURCC_STSD, pBox ) ) throw E_MP4A_STSD;
@@ -207,14 +282,14 @@ bool	CMp4aReader::Open( CBaseStream& Stream )
 		// Search stco box.
 		pBox = NULL;
 		if ( pMoov->FindBox( IMF_FOURCC_STCO, pBox ) ) {
-			CChunkOffsetBox*	pStco = reinterpret_cast<CChunkOffsetBox*>( pBox );
-			pStco->GetVector( ChunkOffsets );	// Offsets of each chunk
+			pStco = reinterpret_cast<CChunkOffsetBox*>( pBox );
+			NumChunks = pStco->m_chunk_offsets.size();
 		} else {
 			// Search co64 box.
 			pBox = NULL;
 			if ( pMoov->FindBox( IMF_FOURCC_CO64, pBox ) ) {
-				CChunkLargeOffsetBox*	pCo64 = reinterpret_cast<CChunkLargeOffsetBox*>( pBox );
-				pCo64->GetVector( ChunkOffsets );
+				pCo64 = reinterpret_cast<CChunkLargeOffsetBox*>( pBox );
+				NumChunks = pCo64->m_chunk_offsets.size();
 			} else {
 				// No stco/co64 found.
 				throw E_MP4A_STCO_CO64;
@@ -224,8 +299,7 @@ bool	CMp4aReader::Open( CBaseStream& Stream )
 		// Search stsc box.
 		pBox = NULL;
 		if ( pMoov->FindBox( IMF_FOURCC_STSC, pBox ) ) {
-			CSampleToChunkBox*	pStsc = reinterpret_cast<CSampleToChunkBox*>( pBox );
-			pStsc->GetVector( FramesPerChunk );	// Number of frames per chunk
+			pStsc = reinterpret_cast<CSampleToChunkBox*>( pBox );
 		} else {
 			// No stsc found.
 			throw E_MP4A_STSC;
@@ -234,8 +308,7 @@ bool	CMp4aReader::Open( CBaseStream& Stream )
 		// Search stts box.
 		pBox = NULL;
 		if ( pMoov->FindBox( IMF_FOURCC_STTS, pBox ) ) {
-			CTimeToSampleBox*	pStts = reinterpret_cast<CTimeToSampleBox*>( pBox );
-			pStts->GetVector( SamplesPerFrame );	// Number of samples per frame
+			pStts = reinterpret_cast<CTimeToSampleBox*>( pBox );
 		} else {
 			// No stts found.
 			throw E_MP4A_STTS;
@@ -244,8 +317,7 @@ bool	CMp4aReader::Open( CBaseStream& Stream )
 		// Search stsz box.
 		pBox = NULL;
 		if ( pMoov->FindBox( IMF_FOURCC_STSZ, pBox ) ) {
-			CSampleSizeBox*	pStsz = reinterpret_cast<CSampleSizeBox*>( pBox );
-			pStsz->GetVector( SizesPerFrame );	// Number of bytes per frame
+			pStsz = reinterpret_cast<CSampleSizeBox*>( pBox );
 		} else {
 			// Search stz2 box.
 			pBox = NULL;
@@ -330,52 +402,56 @@ bool	CMp4aReader::Open( CBaseStream& Stream )
 			}
 		}
 
-		// Generate m_ChunkInfo and m_FrameInfo from ChunkFrames, ChunkOffsets and FrameSamples.
-		if ( ChunkOffsets.empty() || FramesPerChunk.empty() ) throw E_MP4A_NO_CHUNK;
+		// Build the frame index from stco/co64, stsc, stts and stsz/stz2.
+		// * A fragmented file may have no chunk in moov box.
+		if ( ( ( NumChunks == 0 ) || pStsc->m_Entries.empty() ) && ( m_ScanOffset < 0 ) ) throw E_MP4A_NO_CHUNK;
+		if ( pStsc->m_Entries.empty() ) NumChunks = 0;
 
-		// Count number of frames.
+		// Count number of frames. The last stsc entry applies to the rest of chunks.
 		NumFrames = 0;
-		for( iOffset=ChunkOffsets.begin(), iFrame=FramesPerChunk.begin(); iOffset!=ChunkOffsets.end(); iOffset++ ) {
-			NumFrames += *iFrame;
-			iFrame++;
-			if ( iFrame == FramesPerChunk.end() ) iFrame--;
+		for( iStsc=pStsc->m_Entries.begin(); ( iStsc != pStsc->m_Entries.end() ) && ( NumChunks > 0 ); iStsc++ ) {
+			if ( ( iStsc->m_first_chunk == 0 ) || ( iStsc->m_first_chunk > NumChunks ) ) break;
+			Chunk = ( ( iStsc + 1 ) == pStsc->m_Entries.end() ) ? static_cast<IMF_UINT32>( NumChunks + 1 ) : ( iStsc + 1 )->m_first_chunk;
+			if ( Chunk < iStsc->m_first_chunk ) throw E_MP4A_STSC;
+			NumFrames += static_cast<IMF_UINT64>( Chunk - iStsc->m_first_chunk ) * iStsc->m_samples_per_chunk;
 		}
 		if ( NumFrames >> 32 ) throw E_MP4A_FRAME_COUNT;
 
-		// SamplesPerFrame and SizesPerFrame should be of the same size and equal to NumFrames.
-		if ( ( static_cast<IMF_UINT64>( SamplesPerFrame.size() ) != NumFrames ) || 
-			 ( static_cast<IMF_UINT64>( SizesPerFrame.size() ) != NumFrames ) ) throw E_MP4A_FRAME_COUNT;
-
-		// Chunk loop.
-		iOffset = ChunkOffsets.begin();
-		iFrame = FramesPerChunk.begin();
-		iSample = SamplesPerFrame.begin();
-		iSize = SizesPerFrame.begin();
-
-		while( iOffset != ChunkOffsets.end() ) {
-			ChunkInfo.m_Offset = *iOffset;
-			ChunkInfo.m_FrameInfo.clear();
-
-			// Frame loop.
-			FrameInfo.m_Offset = *iOffset;
-			for( i=0; i<*iFrame; i++ ) {
-				// Update m_MaxFrameSize.
-				if ( *iSize > m_MaxFrameSize ) m_MaxFrameSize = *iSize;
-				// Set FrameInfo.
-				FrameInfo.m_NumSamples = *iSample++;
-				FrameInfo.m_EncSize = *iSize++;
-				// Register FrameInfo to m_FrameInfo and ChunkInfo.m_FrameInfo.
-				m_FrameInfo.push_back( FrameInfo );
-				ChunkInfo.m_FrameInfo.push_back( FrameInfo );
-				// Shift offset to next frame.
-				FrameInfo.m_Offset += FrameInfo.m_EncSize;
+		// stts and stsz should describe the same number of frames.
+		Offset = 0;
+		for( iStts=pStts->m_Entries.begin(); iStts!=pStts->m_Entries.end(); iStts++ ) Offset += iStts->m_sample_count;
+		if ( Offset != NumFrames ) throw E_MP4A_FRAME_COUNT;
+		if ( static_cast<IMF_UINT64>( pStsz ? pStsz->m_sample_count : SizesPerFrame.size() ) != NumFrames ) throw E_MP4A_FRAME_COUNT;
+		if ( pStsz && ( pStsz->m_sample_size == 0 ) && ( pStsz->m_entry_sizes.size() != NumFrames ) ) throw E_MP4A_FRAME_COUNT;
+
+		// Frame offsets and sizes.
+		m_FrameOffset.reserve( static_cast<IMF_UINT32>( NumFrames ) );
+		m_FrameSize.reserve( static_cast<IMF_UINT32>( NumFrames ) );
+		Frame = 0;
+		iStsc = pStsc->m_Entries.begin();
+		for( Chunk=0; Chunk<NumChunks; Chunk++ ) {
+			if ( ( ( iStsc + 1 ) != pStsc->m_Entries.end() ) && ( ( iStsc + 1 )->m_first_chunk <= Chunk + 1 ) ) iStsc++;
+			Frames = iStsc->m_samples_per_chunk;
+			if ( Frames == 0 ) continue;
+			Offset = pStco ? pStco->m_chunk_offsets[Chunk] : pCo64->m_chunk_offsets[Chunk];
+			m_ChunkFrame.push_back( Frame );
+			for( i=0; i<Frames; i++, Frame++ ) {
+				m_FrameOffset.push_back( Offset );
+				m_FrameSize.push_back( pStsz ? ( pStsz->m_sample_size ? pStsz->m_sample_size : pStsz->m_entry_sizes[Frame] ) : SizesPerFrame[Frame] );
+				if ( m_FrameSize.back() > m_MaxFrameSize ) m_MaxFrameSize = m_FrameSize.back();
+				Offset += m_FrameSize.back();
 			}
-			m_ChunkInfo.push_back( ChunkInfo );
+		}
 
-			iOffset++;
-			iFrame++;
-			if ( iFrame == FramesPerChunk.end() ) iFrame--;
+		// Number of samples per frame is kept in runs as in stts.
+		Frame = 0;
+		for( iStts=pStts->m_Entries.begin(); iStts!=pStts->m_Entries.end(); iStts++ ) {
+			AddSampleRun( Frame, iStts->m_sample_count, iStts->m_sample_delta );
+			Frame += iStts->m_sample_count;
 		}
+
+		// Append frames in movie fragments.
+		if ( !Update() ) throw GetLastError();
 		Result = true;
 	}
 	catch( IMF_UINT32 e ) {
@@ -383,8 +459,8 @@ bool	CMp4aReader::Open( CBaseStream& Stream )
 		m_pStream = NULL;
 		if ( m_pDecSpecInfo ) { delete[] m_pDecSpecInfo; m_pDecSpecInfo = NULL; }
 		m_DecSpecInfoSize = 0;
-		m_FrameInfo.clear();
-		m_ChunkInfo.clear();
+		ClearIndex();
+		m_ScanOffset = -1;
 	}
 
 	if ( pMoov ) delete pMoov;
@@ -392,6 +468,168 @@ bool	CMp4aReader::Open( CBaseStream& Stream )
 	return Result;
 }
 
+////////////////////////////////////////
+//                                    //
+//      Read new movie fragments      //
+//                                    //
+////////////////////////////////////////
+// Return value = true:Success / false:Error
+// * Movie fragments appended to the stream after the last call are added to the frame list,
+//   so that a file being written can be followed. Incomplete fragments are left for the next call.
+bool	CMp4aReader::Update( void )
+{
+	CMp4BoxReader			Reader;
+	CBox*					pMoof;
+	IMF_UINT32				Type;
+	IMF_INT64				Size;
+	IMF_INT64				EndPos;
+	IMF_UINT32				Base, i;
+	vector<CFrameInfo>		Frames;
+	vector<IMF_UINT32>		Chunks;
+
+	if ( m_pStream == NULL ) { SetLastError( E_MP4A_NOT_OPENED ); return false; }
+
+	// Nothing to do for a non-fragmented file.
+	if ( m_ScanOffset < 0 ) return true;
+
+	// Get the current end of stream.
+	if ( !m_pStream->Seek( 0, CBaseStream::S_END ) ) { SetLastError( E_SEEK_STREAM ); return false; }
+	if ( ( EndPos = m_pStream->Tell() ) < 0 ) { SetLastError( E_TELL_STREAM ); return false; }
+	if ( !m_pStream->Seek( m_ScanOffset, CBaseStream::S_BEGIN ) ) { SetLastError( E_SEEK_STREAM ); return false; }
+
+	while( Reader.Peek( *m_pStream, Type, Size ) ) {
+		// Stop at a box which has not been completely written yet.
+		if ( ( Size < 8 ) || ( m_ScanOffset + Size > EndPos ) ) break;
+
+		if ( Type == IMF_FOURCC_MOOF ) {
+			pMoof = Reader.Read( *m_pStream );
+			if ( pMoof == NULL ) { SetLastError( E_MP4A_MOOF ); return false; }
+			Frames.clear();
+			Chunks.clear();
+			if ( !ReadFragment( pMoof, m_ScanOffset, Frames, Chunks ) ) { delete pMoof; return false; }
+			delete pMoof;
+
+			// Stop if the frame data has not been completely written yet.
+			if ( !Frames.empty() && ( Frames.back().m_Offset + Frames.back().m_EncSize > EndPos ) ) break;
+
+			// Register frames.
+			Base = static_cast<IMF_UINT32>( m_FrameSize.size() );
+			for( i=0; i<Chunks.size(); i++ ) m_ChunkFrame.push_back( Base + Chunks[i] );
+			for( i=0; i<Frames.size(); i++ ) {
+				if ( Frames[i].m_EncSize > m_MaxFrameSize ) m_MaxFrameSize = Frames[i].m_EncSize;
+				m_FrameOffset.push_back( Frames[i].m_Offset );
+				m_FrameSize.push_back( Frames[i].m_EncSize );
+				AddSampleRun( Base + i, 1, Frames[i].m_NumSamples );
+			}
+		}
+		m_ScanOffset += Size;
+		if ( !m_pStream->Seek( m_ScanOffset, CBaseStream::S_BEGIN ) ) { SetLastError( E_SEEK_STREAM ); return false; }
+	}
+	return true;
+}
+
+////////////////////////////////////////
+//                                    //
+//      Read a movie fragment         //
+//                                    //
+////////////////////////////////////////
+// pMoof = Pointer to moof box
+// MoofOffset = Offset position of moof box
+// Frames = Vector to receive frame information
+// Chunks = Vector to receive the first index in Frames of each chunk (a chunk starts at each sync frame)
+// Return value = true:Success / false:Error
+bool	CMp4aReader::ReadFragment( CBox* pMoof, IMF_INT64 MoofOffset, vector<CFrameInfo>& Frames, vector<IMF_UINT32>& Chunks )
+{
+	CBox*						pTraf = NULL;
+	CBox*						pBox;
+	CTrackFragmentHeaderBox*	pTfhd;
+	CTrackRunBox*				pTrun;
+	IMF_INT64					DataEnd = MoofOffset;
+	IMF_INT64					Offset;
+	IMF_UINT32					Duration, Size, Flags, SampleFlags;
+	IMF_UINT32					n;
+	CFrameInfo					FrameInfo;
+	vector<CTrackRunBox::TRUN_ENTRY>::const_iterator	i;
+
+	while( pMoof->FindBox( IMF_FOURCC_TRAF, pTraf ) ) {
+		pBox = NULL;
+		if ( !pTraf->FindBox( IMF_FOURCC_TFHD, pBox ) ) { SetLastError( E_MP4A_MOOF ); return false; }
+		pTfhd = reinterpret_cast<CTrackFragmentHeaderBox*>( pBox );
+		if ( pTfhd->m_track_ID != m_TrackID ) continue;
+
+		// Get base data offset.
+		if ( pTfhd->HasField( CTrackFragmentHeaderBox::BASE_DATA_OFFSET_PRESENT ) ) Offset = static_cast<IMF_INT64>( pTfhd->m_base_data_offset );
+		else if ( pTfhd->HasField( CTrackFragmentHeaderBox::DEFAULT_BASE_IS_MOOF ) ) Offset = MoofOffset;
+		else Offset = DataEnd;
+
+		// Get default values.
+		Duration = pTfhd->HasField( CTrackFragmentHeaderBox::DEFAULT_SAMPLE_DURATION_PRESENT ) ? pTfhd->m_default_sample_duration : m_DefaultDuration;
+		Size = pTfhd->HasField( CTrackFragmentHeaderBox::DEFAULT_SAMPLE_SIZE_PRESENT ) ? pTfhd->m_default_sample_size : m_DefaultSize;
+		Flags = pTfhd->HasField( CTrackFragmentHeaderBox::DEFAULT_SAMPLE_FLAGS_PRESENT ) ? pTfhd->m_default_sample_flags : m_DefaultFlags;
+
+		// Track run loop.
+		pBox = NULL;
+		DataEnd = Offset;
+		while( pTraf->FindBox( IMF_FOURCC_TRUN, pBox ) ) {
+			pTrun = reinterpret_cast<CTrackRunBox*>( pBox );
+			FrameInfo.m_Offset = pTrun->HasField( CTrackRunBox::DATA_OFFSET_PRESENT ) ? Offset + pTrun->m_data_offset : DataEnd;
+			for( i=pTrun->m_Entries.begin(), n=0; i!=pTrun->m_Entries.end(); i++, n++ ) {
+				FrameInfo.m_NumSamples = pTrun->HasField( CTrackRunBox::SAMPLE_DURATION_PRESENT ) ? i->m_sample_duration : Duration;
+				FrameInfo.m_EncSize = pTrun->HasField( CTrackRunBox::SAMPLE_SIZE_PRESENT ) ? i->m_sample_size : Size;
+
+				// A chunk starts at each sync frame. (0x10000 = sample_is_non_sync_sample)
+				if ( ( n == 0 ) && pTrun->HasField( CTrackRunBox::FIRST_SAMPLE_FLAGS_PRESENT ) ) SampleFlags = pTrun->m_first_sample_flags;
+				else if ( pTrun->HasField( CTrackRunBox::SAMPLE_FLAGS_PRESENT ) ) SampleFlags = i->m_sample_flags;
+				else SampleFlags = Flags;
+				if ( Frames.empty() || !( SampleFlags & 0x10000 ) ) Chunks.push_back( static_cast<IMF_UINT32>( Frames.size() ) );
+				Frames.push_back( FrameInfo );
+				FrameInfo.m_Offset += FrameInfo.m_EncSize;
+			}
+			DataEnd = FrameInfo.m_Offset;
+		}
+	}
+	return true;
+}
+
+////////////////////////////////////////
+//                                    //
+//        Add a run of frames         //
+//                                    //
+////////////////////////////////////////
+// FirstFrame = First frame index
+// NumFrames = Number of frames
+// NumSamples = Number of samples per frame
+// * Consecutive runs with the same number of samples are merged, so that a constant frame length
+//   needs only one entry whatever the file size is.
+void	CMp4aReader::AddSampleRun( IMF_UINT32 FirstFrame, IMF_UINT32 NumFrames, IMF_UINT32 NumSamples )
+{
+	CSampleRun	Run;
+
+	if ( NumFrames == 0 ) return;
+	if ( m_SampleRuns.empty() || ( m_SampleRuns.back().m_NumSamples != NumSamples ) ) {
+		Run.m_FirstFrame = FirstFrame;
+		Run.m_NumSamples = NumSamples;
+		Run.m_FirstSample = m_TotalSamples;
+		m_SampleRuns.push_back( Run );
+	}
+	m_TotalSamples += static_cast<IMF_UINT64>( NumFrames ) * NumSamples;
+}
+
+////////////////////////////////////////
+//                                    //
+//          Clear frame index         //
+//                                    //
+////////////////////////////////////////
+void	CMp4aReader::ClearIndex( void )
+{
+	m_FrameOffset.clear();
+	m_FrameSize.clear();
+	m_ChunkFrame.clear();
+	m_SampleRuns.clear();
+	m_TotalSamples = 0;
+	m_MaxFrameSize = 0;
+}
+
 ////////////////////////////////////////
 //                                    //
 //            Read a frame            //
@@ -404,18 +642,17 @@ bool	CMp4aReader::Open( CBaseStream& Stream )
 IMF_UINT32	CMp4aReader::ReadFrame( IMF_UINT32 Index, void* pBuffer, IMF_UINT32 BufSize )
 {
 	if ( m_pStream == NULL ) { SetLastError( E_MP4A_NOT_OPENED ); return 0; }
-	if ( ( Index < 0 ) || ( Index >= m_FrameInfo.size() ) ) { SetLastError( E_MP4A_FRAME_INDEX ); return 0; }
-	const CFrameInfo&	Info = m_FrameInfo[Index];
+	if ( Index >= m_FrameSize.size() ) { SetLastError( E_MP4A_FRAME_INDEX ); return 0; }
 
 	// Check buffer size.
-	if ( BufSize < Info.m_EncSize ) { SetLastError( E_MP4A_BUFFER_SIZE ); return 0; }
+	if ( BufSize < m_FrameSize[Index] ) { SetLastError( E_MP4A_BUFFER_SIZE ); return 0; }
 
 	// Seek.
-	if ( !m_pStream->Seek( Info.m_Offset, CBaseStream::S_BEGIN ) ) { SetLastError( E_SEEK_STREAM ); return 0; }
+	if ( !m_pStream->Seek( m_FrameOffset[Index], CBaseStream::S_BEGIN ) ) { SetLastError( E_SEEK_STREAM ); return 0; }
 
 	// Read a frame.
-	if ( m_pStream->Read( pBuffer, Info.m_EncSize ) != Info.m_EncSize ) { SetLastError( E_READ_STREAM ); return 0; }
-	return Info.m_EncSize;
+	if ( m_pStream->Read( pBuffer, m_FrameSize[Index] ) != m_FrameSize[Index] ) { SetLastError( E_READ_STREAM ); return 0; }
+	return m_FrameSize[Index];
 }
 
 ////////////////////////////////////////
@@ -428,8 +665,17 @@ IMF_UINT32	CMp4aReader::ReadFrame( IMF_UINT32 Index, void* pBuffer, IMF_UINT32 B
 // Return value = true:Success / false:Error
 bool	CMp4aReader::GetChunkInfo( IMF_UINT32 Index, CChunkInfo& Info ) const
 {
-	if ( ( Index < 0 ) || ( Index >= m_ChunkInfo.size() ) ) return false;
-	Info = m_ChunkInfo[Index];
+	CFrameInfo	FrameInfo;
+	IMF_UINT32	Frame, End;
+
+	if ( Index >= m_ChunkFrame.size() ) return false;
+	End = ( Index + 1 < m_ChunkFrame.size() ) ? m_ChunkFrame[Index+1] : static_cast<IMF_UINT32>( m_FrameSize.size() );
+	Info.m_Offset = m_FrameOffset[m_ChunkFrame[Index]];
+	Info.m_FrameInfo.clear();
+	for( Frame=m_ChunkFrame[Index]; Frame<End; Frame++ ) {
+		GetFrameInfo( Frame, FrameInfo );
+		Info.m_FrameInfo.push_back( FrameInfo );
+	}
 	return true;
 }
 
@@ -443,8 +689,21 @@ bool	CMp4aReader::GetChunkInfo( IMF_UINT32 Index, CChunkInfo& Info ) const
 // Return value = true:Success / false:Error
 bool	CMp4aReader::GetFrameInfo( IMF_UINT32 Index, CFrameInfo& Info ) const
 {
-	if ( ( Index < 0 ) || ( Index >= m_FrameInfo.size() ) ) return false;
-	Info = m_FrameInfo[Index];
+	IMF_UINT32	Low, High, Mid;
+
+	if ( Index >= m_FrameSize.size() ) return false;
+
+	// Binary search for the run which contains the frame.
+	Low = 0;
+	High = static_cast<IMF_UINT32>( m_SampleRuns.size() );
+	while( High - Low > 1 ) {
+		Mid = ( Low + High ) / 2;
+		if ( m_SampleRuns[Mid].m_FirstFrame <= Index ) Low = Mid;
+		else High = Mid;
+	}
+	Info.m_Offset = m_FrameOffset[Index];
+	Info.m_EncSize = m_FrameSize[Index];
+	Info.m_NumSamples = m_SampleRuns[Low].m_NumSamples;
 	return true;
 }
 
@@ -462,11 +721,12 @@ bool	CMp4aReader::Close( void )
 	m_pStream = NULL;
 	if ( m_pDecSpecInfo ) { delete[] m_pDecSpecInfo; m_pDecSpecInfo = NULL; }
 	m_DecSpecInfoSize = 0;
-	m_FrameInfo.clear();
+	ClearIndex();
 	m_HeaderOffset = m_TrailerOffset = m_AuxDataOffset = 0;
 	m_HeaderSize = m_TrailerSize = m_AuxDataSize = 0;
 	m_OrgFileType = 0;
 	m_OrgMimeType.erase();
+	m_ScanOffset = -1;
 	return true;
 }
 
@@ -493,10 +753,19 @@ CMp4aWriter::CMp4aWriter( void )
 	memset( m_Language, '\0', sizeof(m_Language) );
 	m_pDecSpecInfo = NULL;
 	m_DecSpecInfoSize = 0;
+	m_PartSize = 0;
 	m_Use64bit = false;
 	m_UseMeta = false;
 	m_MdatOffset = 0;
 	m_MdatHeaderSize = 0;
+	m_ReserveFrames = 0;
+	m_MoovOffset = 0;
+	m_MoovSpace = 0;
+	m_FragmentFrames = 0;
+	m_SequenceNumber = 0;
+	m_TotalFrames = m_TotalSamples = 0;
+	m_MaxEncSize = 0;
+	m_MaxBitrate = m_SumBitrate = 0;
 	m_FileType = 0;
 	m_HeaderSize = m_TrailerSize = m_AuxDataSize = 0;
 	m_HeaderOffset = m_TrailerOffset = m_AuxDataOffset = 0;
@@ -548,10 +817,15 @@ bool	CMp4aWriter::Open( CBaseStream& Stream, IMF_UINT32 Frequency, IMF_UINT16 Ch
 	m_Language[3] = '\0';
 	if ( !SetDecSpecInfo( pDecSpecInfo, DecSpecInfoSize ) ) return false;
 	m_FrameInfo.clear();
+	m_PartSize = 0;
 	m_Use64bit = Use64bit;
 	m_FileType = FileType;
 	m_HeaderSize = m_TrailerSize = m_AuxDataSize = 0;
 	m_HeaderOffset = m_TrailerOffset = m_AuxDataOffset = 0;
+	m_SequenceNumber = 0;
+	m_TotalFrames = m_TotalSamples = 0;
+	m_MaxEncSize = 0;
+	m_MaxBitrate = m_SumBitrate = 0;
 
 	try {
 		// Write ftyp box.
@@ -561,6 +835,32 @@ bool	CMp4aWriter::Open( CBaseStream& Stream, IMF_UINT32 Frequency, IMF_UINT16 Ch
 		delete pBox;
 		pBox = NULL;
 
+		if ( m_FragmentFrames > 0 ) {
+			// Write moov box without samples. Frames are written in movie fragments, and
+			// mdat box is created only for original header, trailer and auxiliary data.
+			if ( ( m_MoovOffset = m_pStream->Tell() ) < 0 ) throw E_TELL_STREAM;
+			pBox = CreateBox( IMF_FOURCC_MOOV );
+			if ( pBox == NULL ) throw GetLastError();
+			if ( ( pBox->CalcSize() < 0 ) || !pBox->Write( *m_pStream ) ) throw pBox->GetLastError();
+			m_MoovSpace = static_cast<IMF_UINT32>( pBox->m_size );
+			delete pBox;
+			pBox = NULL;
+			if ( !m_FragmentData.Close() || !m_FragmentData.Open() ) throw m_FragmentData.GetLastError();
+			m_MdatOffset = -1;
+			m_MdatHeaderSize = m_Use64bit ? 16 : 8;
+			return true;
+		}
+
+		// Reserve space for moov box in front of mdat (fast start).
+		m_MoovSpace = 0;
+		if ( m_ReserveFrames > 0 ) {
+			m_MoovOffset = m_pStream->Tell();
+			if ( m_MoovOffset < 0 ) throw E_TELL_STREAM;
+			m_MoovSpace = EstimateMoovSize( m_ReserveFrames );
+			if ( m_MoovSpace == 0 ) throw GetLastError();
+			if ( !WriteFree( m_MoovSpace ) ) throw E_WRITE_STREAM;
+		}
+
 		// Write empty mdat box.
 		m_MdatOffset = m_pStream->Tell();
 		if ( m_MdatOffset < 0 ) throw E_TELL_STREAM;
@@ -604,6 +904,7 @@ bool	CMp4aWriter::Open( CBaseStream& Stream, IMF_UINT32 Frequency, IMF_UINT16 Ch
 bool	CMp4aWriter::WriteHeader( const void* pHeader, IMF_UINT32 HeaderSize )
 {
 	if ( m_pStream == NULL ) { SetLastError( E_MP4A_NOT_OPENED ); return false; }
+	if ( ( m_FragmentFrames > 0 ) && !BeginDataBox() ) return false;
 
 	if ( m_HeaderSize == 0 ) m_HeaderOffset = m_pStream->Tell();
 	if ( m_pStream->Write( pHeader, HeaderSize ) != HeaderSize ) { SetLastError( E_WRITE_STREAM ); return false; }
@@ -626,6 +927,7 @@ bool	CMp4aWriter::WriteHeader( const void* pHeader, IMF_UINT32 HeaderSize )
 bool	CMp4aWriter::WriteTrailer( const void* pTrailer, IMF_UINT32 TrailerSize )
 {
 	if ( m_pStream == NULL ) { SetLastError( E_MP4A_NOT_OPENED ); return false; }
+	if ( ( m_FragmentFrames > 0 ) && !BeginDataBox() ) return false;
 
 	if ( m_TrailerSize == 0 ) m_TrailerOffset = m_pStream->Tell();
 	if ( m_pStream->Write( pTrailer, TrailerSize ) != TrailerSize ) { SetLastError( E_WRITE_STREAM ); return false; }
@@ -648,6 +950,7 @@ bool	CMp4aWriter::WriteTrailer( const void* pTrailer, IMF_UINT32 TrailerSize )
 bool	CMp4aWriter::WriteAuxData( const void* pAuxData, IMF_UINT32 AuxDataSize )
 {
 	if ( m_pStream == NULL ) { SetLastError( E_MP4A_NOT_OPENED ); return false; }
+	if ( ( m_FragmentFrames > 0 ) && !BeginDataBox() ) return false;
 
 	if ( m_AuxDataSize == 0 ) m_AuxDataOffset = m_pStream->Tell();
 	if ( m_pStream->Write( pAuxData, AuxDataSize ) != AuxDataSize ) { SetLastError( E_WRITE_STREAM ); return false; }
@@ -673,16 +976,207 @@ bool	CMp4aWriter::WriteFrame( const void* pFrame, IMF_UINT32 EncSize, IMF_UINT32
 {
 	if ( m_pStream == NULL ) { SetLastError( E_MP4A_NOT_OPENED ); return false; }
 
-	if ( m_pStream->Write( pFrame, EncSize ) != EncSize ) { SetLastError( E_WRITE_STREAM ); return false; }
+	// A frame written by WriteFramePart() must be completed first.
+	if ( m_PartSize > 0 ) { SetLastError( E_MP4A_FRAME_PART ); return false; }
+
+	if ( m_FragmentFrames > 0 ) {
+		// Frame data is kept until the movie fragment is written.
+		if ( !EndDataBox() ) return false;
+		if ( m_FragmentData.Write( pFrame, EncSize ) != EncSize ) { SetLastError( E_WRITE_STREAM ); return false; }
+	} else {
+		if ( m_pStream->Write( pFrame, EncSize ) != EncSize ) { SetLastError( E_WRITE_STREAM ); return false; }
+	}
+
+	return AddFrameInfo( EncSize, NumSamples, SyncFlag );
+}
+
+////////////////////////////////////////
+//                                    //
+//       Write a part of a frame      //
+//                                    //
+////////////////////////////////////////
+// pData = Pointer to a part of frame data
+// Size = Size of pData in bytes
+// Return value = true:Success / false:Error
+// * Large frames can be written piece by piece, and then completed by EndFrame().
+bool	CMp4aWriter::WriteFramePart( const void* pData, IMF_UINT32 Size )
+{
+	if ( m_pStream == NULL ) { SetLastError( E_MP4A_NOT_OPENED ); return false; }
+
+	if ( m_FragmentFrames > 0 ) {
+		// Frame data is kept until the movie fragment is written.
+		if ( !EndDataBox() ) return false;
+		if ( m_FragmentData.Write( pData, Size ) != Size ) { SetLastError( E_WRITE_STREAM ); return false; }
+	} else {
+		if ( m_pStream->Write( pData, Size ) != Size ) { SetLastError( E_WRITE_STREAM ); return false; }
+	}
+	m_PartSize += Size;
+	return true;
+}
+
+////////////////////////////////////////
+//                                    //
+//          Complete a frame          //
+//                                    //
+////////////////////////////////////////
+// NumSamples = Number of samples
+// SyncFlag = true:Sync frame / false:Non-sync frame
+// Return value = true:Success / false:Error
+bool	CMp4aWriter::EndFrame( IMF_UINT32 NumSamples, bool SyncFlag )
+{
+	if ( m_pStream == NULL ) { SetLastError( E_MP4A_NOT_OPENED ); return false; }
+
+	// Sample size is limited to 32-bit in stsz.
+	if ( m_PartSize >> 32 ) { SetLastError( E_MP4A_FRAME_PART ); return false; }
+
+	IMF_UINT32	EncSize = static_cast<IMF_UINT32>( m_PartSize );
+	m_PartSize = 0;
+	return AddFrameInfo( EncSize, NumSamples, SyncFlag );
+}
+
+////////////////////////////////////////
+//                                    //
+//       Register a frame             //
+//                                    //
+////////////////////////////////////////
+// EncSize = Size of encoded data in bytes
+// NumSamples = Number of samples
+// SyncFlag = true:Sync frame / false:Non-sync frame
+// Return value = true:Success / false:Error
+bool	CMp4aWriter::AddFrameInfo( IMF_UINT32 EncSize, IMF_UINT32 NumSamples, bool SyncFlag )
+{
+	IMF_UINT64	BitsPerSecond;
 
 	// In the first frame, SyncFlag must be true.
-	if ( m_FrameInfo.empty() && !SyncFlag ) { SetLastError( E_MP4A_SYNC_FRAME ); return false; }
+	if ( m_FrameInfo.empty() && ( m_TotalFrames == 0 ) && !SyncFlag ) { SetLastError( E_MP4A_SYNC_FRAME ); return false; }
 
 	CFrameInfo	Info;
 	Info.m_EncSize = EncSize;
 	Info.m_NumSamples = NumSamples;
 	Info.m_SyncFlag = SyncFlag;
 	m_FrameInfo.push_back( Info );
+	if ( m_FragmentFrames == 0 ) return true;
+
+	// Update statistics for stsd box, since m_FrameInfo only holds the current fragment.
+	if ( NumSamples == 0 ) { SetLastError( E_MP4A_STSD_NUM_SAMPLES ); return false; }
+	BitsPerSecond = static_cast<IMF_UINT64>( EncSize ) * 8 * m_SamplingFrequency / NumSamples;
+	if ( m_MaxEncSize < EncSize ) m_MaxEncSize = EncSize;
+	if ( m_MaxBitrate < BitsPerSecond ) m_MaxBitrate = BitsPerSecond;
+	m_SumBitrate += BitsPerSecond;
+	m_TotalFrames++;
+	m_TotalSamples += NumSamples;
+
+	// Write a movie fragment every m_FragmentFrames frames.
+	return ( m_FrameInfo.size() < m_FragmentFrames ) || FlushFragment();
+}
+
+////////////////////////////////////////
+//                                    //
+//      Write a movie fragment        //
+//                                    //
+////////////////////////////////////////
+// Return value = true:Success / false:Error
+// * moof box is followed by mdat box which contains frames in m_FragmentData.
+bool	CMp4aWriter::FlushFragment( void )
+{
+	CBox*		pMoof = NULL;
+	CBox*		pTrun = NULL;
+	CBox*		pMdat = NULL;
+	IMF_INT64	MoofSize;
+	IMF_UINT64	DataSize = m_FragmentData.GetSize();
+	IMF_UINT32	MdatHeaderSize = ( DataSize + 8 > 0xffffffff ) ? 16 : 8;
+	bool		Result = false;
+
+	if ( m_FrameInfo.empty() ) return true;
+
+	try {
+		// Create moof box, and then point trun at the top of mdat data.
+		pMoof = CreateBox( IMF_FOURCC_MOOF );
+		if ( pMoof == NULL ) throw GetLastError();
+		if ( ( MoofSize = pMoof->CalcSize() ) < 0 ) throw pMoof->GetLastError();
+		if ( !pMoof->FindBox( IMF_FOURCC_TRUN, pTrun ) ) throw E_MP4A_MOOF;
+		reinterpret_cast<CTrackRunBox*>( pTrun )->m_data_offset = static_cast<IMF_INT32>( MoofSize + MdatHeaderSize );
+		if ( !pMoof->Write( *m_pStream ) ) throw pMoof->GetLastError();
+
+		// Write mdat box.
+		pMdat = CreateBox( IMF_FOURCC_MDAT );
+		if ( pMdat == NULL ) throw GetLastError();
+		if ( MdatHeaderSize == 16 ) {
+			pMdat->m_size = 1;
+			pMdat->m_largesize = DataSize + 16;
+		} else {
+			pMdat->m_size = static_cast<IMF_UINT32>( DataSize + 8 );
+			pMdat->m_largesize = 0;
+		}
+		if ( !pMdat->CBox::Write( *m_pStream ) ) throw pMdat->GetLastError();	// Invoke CBox::Write in order to write the header only.
+		if ( m_pStream->Write( m_FragmentData.GetBuffer(), m_FragmentData.GetSize() ) != m_FragmentData.GetSize() ) throw E_WRITE_STREAM;
+
+		// Start the next fragment.
+		if ( !m_FragmentData.Truncate( 0 ) ) throw m_FragmentData.GetLastError();
+		m_FrameInfo.clear();
+		m_SequenceNumber++;
+		Result = true;
+	}
+	catch( IMF_UINT32 e ) {
+		SetLastError( e );
+	}
+	if ( pMoof ) delete pMoof;
+	if ( pMdat ) delete pMdat;
+	return Result;
+}
+
+////////////////////////////////////////
+//                                    //
+//     Begin mdat box for data        //
+//                                    //
+////////////////////////////////////////
+// Return value = true:Success / false:Error
+// * In fragmented mode, original header, trailer and auxiliary data are stored in
+//   their own mdat box between movie fragments.
+bool	CMp4aWriter::BeginDataBox( void )
+{
+	CMediaDataBox	Mdat;
+
+	if ( m_MdatOffset >= 0 ) return true;	// Already begun.
+
+	// Pending frames go first.
+	if ( !FlushFragment() ) return false;
+
+	// Write empty mdat box.
+	if ( ( m_MdatOffset = m_pStream->Tell() ) < 0 ) { SetLastError( E_TELL_STREAM ); return false; }
+	Mdat.m_size = m_Use64bit ? 1 : 8;
+	Mdat.m_largesize = m_Use64bit ? 16 : 0;
+	if ( !Mdat.CBox::Write( *m_pStream ) ) { SetLastError( Mdat.GetLastError() ); return false; }	// Invoke CBox::Write in order to skip size check.
+	return true;
+}
+
+////////////////////////////////////////
+//                                    //
+//      End mdat box for data         //
+//                                    //
+////////////////////////////////////////
+// Return value = true:Success / false:Error
+bool	CMp4aWriter::EndDataBox( void )
+{
+	CMediaDataBox	Mdat;
+	IMF_INT64		CurPos;
+
+	if ( m_MdatOffset < 0 ) return true;	// Not begun.
+
+	// Re-write mdat box size.
+	if ( ( CurPos = m_pStream->Tell() ) < 0 ) { SetLastError( E_TELL_STREAM ); return false; }
+	if ( m_Use64bit ) {
+		Mdat.m_size = 1;
+		Mdat.m_largesize = CurPos - m_MdatOffset;
+	} else {
+		if ( CurPos - m_MdatOffset > 0xffffffff ) { SetLastError( E_MP4A_MDAT_SIZE ); return false; }
+		Mdat.m_size = static_cast<IMF_UINT32>( CurPos - m_MdatOffset );
+		Mdat.m_largesize = 0;
+	}
+	if ( !m_pStream->Seek( m_MdatOffset, CBaseStream::S_BEGIN ) ) { SetLastError( E_SEEK_STREAM ); return false; }
+	if ( !Mdat.CBox::Write( *m_pStream ) ) { SetLastError( Mdat.GetLastError() ); return false; }	// Invoke CBox::Write in order to skip size check.
+	if ( !m_pStream->Seek( CurPos, CBaseStream::S_BEGIN ) ) { SetLastError( E_SEEK_STREAM ); return false; }
+	m_MdatOffset = -1;
 	return true;
 }
 
@@ -722,61 +1216,89 @@ bool	CMp4aWriter::Close( void )
 {
 	bool		Result = false;
 	CBox*		pBox = NULL;
+	CBox*		pMeta = NULL;
 	IMF_INT64	TotalSize;
 	IMF_INT64	CurPos;
+	IMF_INT64	MoovSize, MetaSize;
+	bool		FastStart;
 	vector<CFrameInfo>::const_iterator	i;
 
 	if ( m_pStream == NULL ) { SetLastError( E_MP4A_NOT_OPENED ); return false; }
 
 	try {
-		// Calculate total size of mdat.
-		TotalSize = 0;
-		for( i=m_FrameInfo.begin(); i!=m_FrameInfo.end(); i++ ) {
-			TotalSize += i->m_EncSize;
-			if ( TotalSize < 0 ) throw E_MP4A_MDAT_SIZE;
-		}
-		TotalSize += m_HeaderSize;
-		if ( TotalSize < 0 ) throw E_MP4A_MDAT_SIZE;
-		TotalSize += m_TrailerSize;
-		if ( TotalSize < 0 ) throw E_MP4A_MDAT_SIZE;
-		TotalSize += m_AuxDataSize;
-		if ( TotalSize < 0 ) throw E_MP4A_MDAT_SIZE;
-
-		// Re-write mdat box size.
-		pBox = CreateBox( IMF_FOURCC_MDAT );
-		if ( pBox == NULL ) throw false;
-		if ( m_Use64bit ) {
-			if ( TotalSize + 16 < 0 ) throw E_MP4A_MDAT_SIZE;	// Overflow.
-			pBox->m_size = 1;
-			pBox->m_largesize = TotalSize + 16;
+		// Frame written by WriteFramePart() must have been completed.
+		if ( m_PartSize > 0 ) throw E_MP4A_FRAME_PART;
+
+		if ( m_FragmentFrames > 0 ) {
+			// Complete fragmented file.
+			if ( !CompleteFragments() ) throw false;
 		} else {
-			if ( TotalSize + 8 > 0xffffffff ) throw E_MP4A_MDAT_SIZE;	// Overflow.
-			pBox->m_size = static_cast<IMF_UINT32>( TotalSize + 8 );
-			pBox->m_largesize = 0;
-		}
-		if ( ( CurPos = m_pStream->Tell() ) < 0 ) throw E_TELL_STREAM;
-		if ( !m_pStream->Seek( m_MdatOffset, CBaseStream::S_BEGIN ) ) throw E_SEEK_STREAM;
-		if ( !pBox->CBox::Write( *m_pStream ) ) throw pBox->GetLastError();	// Invoke CBox::Write in order to skip size check.
-		if ( !m_pStream->Seek( CurPos, CBaseStream::S_BEGIN ) ) throw E_SEEK_STREAM;
-		delete pBox;
-		pBox = NULL;
+			// Calculate total size of mdat.
+			TotalSize = 0;
+			for( i=m_FrameInfo.begin(); i!=m_FrameInfo.end(); i++ ) {
+				TotalSize += i->m_EncSize;
+				if ( TotalSize < 0 ) throw E_MP4A_MDAT_SIZE;
+			}
+			TotalSize += m_HeaderSize;
+			if ( TotalSize < 0 ) throw E_MP4A_MDAT_SIZE;
+			TotalSize += m_TrailerSize;
+			if ( TotalSize < 0 ) throw E_MP4A_MDAT_SIZE;
+			TotalSize += m_AuxDataSize;
+			if ( TotalSize < 0 ) throw E_MP4A_MDAT_SIZE;
 
-		// Write moov box.
-		pBox = CreateBox( IMF_FOURCC_MOOV );
-		if ( pBox == NULL ) throw false;
-		if ( ( pBox->CalcSize() < 0 ) || !pBox->Write( *m_pStream ) ) throw pBox->GetLastError();
-		delete pBox;
-		pBox = NULL;
+			// Re-write mdat box size.
+			pBox = CreateBox( IMF_FOURCC_MDAT );
+			if ( pBox == NULL ) throw false;
+			if ( m_Use64bit ) {
+				if ( TotalSize + 16 < 0 ) throw E_MP4A_MDAT_SIZE;	// Overflow.
+				pBox->m_size = 1;
+				pBox->m_largesize = TotalSize + 16;
+			} else {
+				if ( TotalSize + 8 > 0xffffffff ) throw E_MP4A_MDAT_SIZE;	// Overflow.
+				pBox->m_size = static_cast<IMF_UINT32>( TotalSize + 8 );
+				pBox->m_largesize = 0;
+			}
+			if ( ( CurPos = m_pStream->Tell() ) < 0 ) throw E_TELL_STREAM;
+			if ( !m_pStream->Seek( m_MdatOffset, CBaseStream::S_BEGIN ) ) throw E_SEEK_STREAM;
+			if ( !pBox->CBox::Write( *m_pStream ) ) throw pBox->GetLastError();	// Invoke CBox::Write in order to skip size check.
+			if ( !m_pStream->Seek( CurPos, CBaseStream::S_BEGIN ) ) throw E_SEEK_STREAM;
+			delete pBox;
+			pBox = NULL;
 
-		if ( m_UseMeta ) {
-			// Write meta box.
-			pBox = CreateBox( IMF_FOURCC_META );
+			// Create moov and meta boxes.
+			pBox = CreateBox( IMF_FOURCC_MOOV );
 			if ( pBox == NULL ) throw false;
-			if ( ( pBox->CalcSize() < 0 ) || !pBox->Write( *m_pStream ) ) throw pBox->GetLastError();
+			if ( ( MoovSize = pBox->CalcSize() ) < 0 ) throw pBox->GetLastError();
+			MetaSize = 0;
+			if ( m_UseMeta ) {
+				pMeta = CreateBox( IMF_FOURCC_META );
+				if ( pMeta == NULL ) throw false;
+				if ( ( MetaSize = pMeta->CalcSize() ) < 0 ) throw pMeta->GetLastError();
+			}
+
+			// Place them in the reserved space if they fit, otherwise after mdat.
+			// * A remaining space must be large enough for a free box.
+			FastStart = ( m_MoovSpace > 0 ) && ( ( MoovSize + MetaSize == m_MoovSpace ) || ( MoovSize + MetaSize + 8 <= m_MoovSpace ) );
+			if ( FastStart && !m_pStream->Seek( m_MoovOffset, CBaseStream::S_BEGIN ) ) throw E_SEEK_STREAM;
+
+			// Write moov box.
+			if ( !pBox->Write( *m_pStream ) ) throw pBox->GetLastError();
 			delete pBox;
 			pBox = NULL;
-		}
 
+			if ( pMeta ) {
+				// Write meta box.
+				if ( !pMeta->Write( *m_pStream ) ) throw pMeta->GetLastError();
+				delete pMeta;
+				pMeta = NULL;
+			}
+
+			if ( FastStart ) {
+				// Fill the rest of reserved space.
+				if ( ( MoovSize + MetaSize < m_MoovSpace ) && !WriteFree( static_cast<IMF_UINT32>( m_MoovSpace - MoovSize - MetaSize ) ) ) throw E_WRITE_STREAM;
+				if ( !m_pStream->Seek( CurPos, CBaseStream::S_BEGIN ) ) throw E_SEEK_STREAM;
+			}
+		}
 		Result = true;
 	}
 	catch( IMF_UINT32 e ) {
@@ -784,13 +1306,61 @@ bool	CMp4aWriter::Close( void )
 	}
 	catch( bool ) {}
 	if ( pBox ) delete pBox;
+	if ( pMeta ) delete pMeta;
 
 	// Clean up.
 	m_pStream = NULL;
 	if ( m_pDecSpecInfo ) { delete[] m_pDecSpecInfo; m_pDecSpecInfo = NULL; }
 	m_DecSpecInfoSize = 0;
 	m_FrameInfo.clear();
+	m_PartSize = 0;
+	m_FragmentData.Close();
+
+	return Result;
+}
+
+////////////////////////////////////////
+//                                    //
+//     Complete fragmented file       //
+//                                    //
+////////////////////////////////////////
+// Return value = true:Success / false:Error
+bool	CMp4aWriter::CompleteFragments( void )
+{
+	bool		Result = false;
+	CBox*		pBox = NULL;
+	IMF_INT64	CurPos;
+
+	try {
+		// Write the last movie fragment and complete mdat box for data.
+		if ( !FlushFragment() || !EndDataBox() ) throw GetLastError();
+		if ( m_TotalFrames == 0 ) throw E_MP4A_EMPTY;
+
+		// Write meta box at the end.
+		if ( m_UseMeta ) {
+			pBox = CreateBox( IMF_FOURCC_META );
+			if ( pBox == NULL ) throw GetLastError();
+			if ( ( pBox->CalcSize() < 0 ) || !pBox->Write( *m_pStream ) ) throw pBox->GetLastError();
+			delete pBox;
+			pBox = NULL;
+		}
 
+		// Update moov box with the final decoder specific info, bitrates and duration.
+		// * moov box keeps the initial values if the stream is not seekable.
+		pBox = CreateBox( IMF_FOURCC_MOOV );
+		if ( pBox == NULL ) throw GetLastError();
+		if ( pBox->CalcSize() != m_MoovSpace ) throw E_MP4A_MOOV;
+		if ( ( CurPos = m_pStream->Tell() ) < 0 ) throw E_TELL_STREAM;
+		if ( m_pStream->Seek( m_MoovOffset, CBaseStream::S_BEGIN ) ) {
+			if ( !pBox->Write( *m_pStream ) ) throw pBox->GetLastError();
+			if ( !m_pStream->Seek( CurPos, CBaseStream::S_BEGIN ) ) throw E_SEEK_STREAM;
+		}
+		Result = true;
+	}
+	catch( IMF_UINT32 e ) {
+		SetLastError( e );
+	}
+	if ( pBox ) delete pBox;
 	return Result;
 }
 
@@ -824,6 +1394,66 @@ bool	CMp4aWriter::AddBoxes( CBoxVector& Boxes, const IMF_UINT32* pTypes, CBox* p
 	return true;
 }
 
+////////////////////////////////////////
+//                                    //
+//        Estimate moov box size      //
+//                                    //
+////////////////////////////////////////
+// NumFrames = Number of frames
+// Return value = Space to reserve for moov and meta boxes in bytes (0:Error)
+IMF_UINT32	CMp4aWriter::EstimateMoovSize( IMF_UINT32 NumFrames )
+{
+	const IMF_UINT32	Margin = 1024;	// Room for meta box and changes in decoder specific info
+	CFrameInfo	Info;
+	CBox*		pBox;
+	IMF_INT64	Size;
+
+	// Build moov box from dummy frames. Sizes and durations are made irregular
+	// so that stsz and stts take their largest form.
+	Info.m_EncSize = 1;
+	Info.m_NumSamples = 1;
+	Info.m_SyncFlag = true;
+	m_FrameInfo.assign( NumFrames, Info );
+	m_FrameInfo.front().m_EncSize = 2;
+	m_FrameInfo.back().m_NumSamples = 2;
+	pBox = CreateBox( IMF_FOURCC_MOOV );
+	Size = pBox ? pBox->CalcSize() : -1;
+	if ( ( Size < 0 ) && pBox ) SetLastError( pBox->GetLastError() );
+	if ( pBox ) delete pBox;
+	m_FrameInfo.clear();
+
+	if ( Size < 0 ) return 0;
+	Size += Margin;
+	if ( Size >> 32 ) { SetLastError( E_MP4A_MOOV ); return 0; }
+	return static_cast<IMF_UINT32>( Size );
+}
+
+////////////////////////////////////////
+//                                    //
+//          Write free box            //
+//                                    //
+////////////////////////////////////////
+// Size = Box size in bytes (8 or more)
+// Return value = true:Success / false:Error
+bool	CMp4aWriter::WriteFree( IMF_UINT32 Size )
+{
+	CFreeSpaceBox	Free( IMF_FOURCC_FREE );
+	IMF_UINT8		Zero[256];
+	IMF_UINT32		WriteSize;
+
+	if ( Size < 8 ) return false;
+	Free.m_size = Size;
+	Free.m_largesize = 0;
+	if ( !Free.CBox::Write( *m_pStream ) ) return false;	// Invoke CBox::Write in order to write the header only.
+
+	memset( Zero, 0, sizeof(Zero) );
+	for( Size-=8; Size>0; Size-=WriteSize ) {
+		WriteSize = ( Size < sizeof(Zero) ) ? Size : sizeof(Zero);
+		if ( m_pStream->Write( Zero, WriteSize ) != WriteSize ) return false;
+	}
+	return true;
+}
+
 ////////////////////////////////////////
 //                                    //
 //            Create a box            //
@@ -860,6 +1490,14 @@ CBox*	CMp4aWriter::CreateBox( IMF_UINT32 Type, IMF_UINT32 HandlerType )
 	case	IMF_FOURCC_META:	p = CreateMeta();				break;
 	case	IMF_FOURCC_DATA:	p = CreateData();				break;
 	case	IMF_FOURCC_ILOC:	p = CreateIloc();				break;
+	case	IMF_FOURCC_MVEX:	p = CreateMvex();				break;
+	case	IMF_FOURCC_MEHD:	p = CreateMehd();				break;
+	case	IMF_FOURCC_TREX:	p = CreateTrex();				break;
+	case	IMF_FOURCC_MOOF:	p = CreateMoof();				break;
+	case	IMF_FOURCC_MFHD:	p = CreateMfhd();				break;
+	case	IMF_FOURCC_TRAF:	p = CreateTraf();				break;
+	case	IMF_FOURCC_TFHD:	p = CreateTfhd();				break;
+	case	IMF_FOURCC_TRUN:	p = CreateTrun();				break;
 	}
 	return p;
 }
@@ -889,7 +1527,8 @@ CBox*	CMp4aWriter::CreateFtyp( void )
 ////////////////////////////////////////
 CBox*	CMp4aWriter::CreateMoov( void )
 {
-	static	const	IMF_UINT32	BoxTypes[] = { IMF_FOURCC_MVHD, IMF_FOURCC_IODS, IMF_FOURCC_TRAK, 0 };
+	IMF_UINT32	BoxTypes[] = { IMF_FOURCC_MVHD, IMF_FOURCC_IODS, IMF_FOURCC_TRAK, 0, 0 };
+	if ( m_FragmentFrames > 0 ) BoxTypes[3] = IMF_FOURCC_MVEX;
 	CMovieBox*	p = new CMovieBox();
 	if ( p ) {
 		if ( !AddBoxes( p->m_Boxes, BoxTypes, p ) ) { delete p; return NULL; }
@@ -1144,6 +1783,7 @@ CBox*	CMp4aWriter::CreateStts( void )
 
 	CTimeToSampleBox*	p = new CTimeToSampleBox();
 	if ( p ) {
+		if ( m_FragmentFrames > 0 ) return p;	// Samples are described in movie fragments.
 		if ( m_FrameInfo.empty() ) { SetLastError( E_MP4A_EMPTY ); delete p; return NULL; }
 		NumSamples = m_FrameInfo.front().m_NumSamples;
 		Count = 1;
@@ -1211,24 +1851,31 @@ CBox*	CMp4aWriter::CreateStsd( void )
 		Dec.m_streamType = 0x05;					// 0x05 = Audio stream
 		Dec.m_upStream = false;
 
-		// Calculate values from m_FrameInfo.
-		if ( m_FrameInfo.empty() ) { SetLastError( E_MP4A_EMPTY ); delete p; return NULL; }
-		Dec.m_bufferSizeDB = m_FrameInfo.front().m_EncSize;
-		MaxBitsPerSecond = 0;
-		TotalBitsPerSecond = 0;
-		for( i=m_FrameInfo.begin(); i!=m_FrameInfo.end(); i++ ) {
-			// bufferSizeDB is a maximum value of m_EncSize.
-			if ( Dec.m_bufferSizeDB < i->m_EncSize ) Dec.m_bufferSizeDB = i->m_EncSize;
-			// maxBitrate is a maximum number of bits per second.
-			// BitsPerSecond = (Encoded size per frame) / (Frame time in seconds)
-			//               = (Encoded size per frame) / ( (Number of samples per frame) / (Sampling frequency) )
-			if ( i->m_NumSamples == 0 ) { SetLastError( E_MP4A_STSD_NUM_SAMPLES ); delete p; return NULL; }
-			BitsPerSecond = static_cast<IMF_UINT64>( i->m_EncSize ) * 8 * m_SamplingFrequency / i->m_NumSamples;
-			if ( MaxBitsPerSecond < BitsPerSecond ) MaxBitsPerSecond = BitsPerSecond;
-			// avgBitrate is an average of number of bits per second.
-			TotalBitsPerSecond += BitsPerSecond;
+		if ( m_FragmentFrames > 0 ) {
+			// Use statistics of movie fragments written so far. (All 0 before the first fragment.)
+			Dec.m_bufferSizeDB = m_MaxEncSize;
+			MaxBitsPerSecond = m_MaxBitrate;
+			TotalBitsPerSecond = ( m_TotalFrames > 0 ) ? m_SumBitrate / m_TotalFrames : 0;
+		} else {
+			// Calculate values from m_FrameInfo.
+			if ( m_FrameInfo.empty() ) { SetLastError( E_MP4A_EMPTY ); delete p; return NULL; }
+			Dec.m_bufferSizeDB = m_FrameInfo.front().m_EncSize;
+			MaxBitsPerSecond = 0;
+			TotalBitsPerSecond = 0;
+			for( i=m_FrameInfo.begin(); i!=m_FrameInfo.end(); i++ ) {
+				// bufferSizeDB is a maximum value of m_EncSize.
+				if ( Dec.m_bufferSizeDB < i->m_EncSize ) Dec.m_bufferSizeDB = i->m_EncSize;
+				// maxBitrate is a maximum number of bits per second.
+				// BitsPerSecond = (Encoded size per frame) / (Frame time in seconds)
+				//               = (Encoded size per frame) / ( (Number of samples per frame) / (Sampling frequency) )
+				if ( i->m_NumSamples == 0 ) { SetLastError( E_MP4A_STSD_NUM_SAMPLES ); delete p; return NULL; }
+				BitsPerSecond = static_cast<IMF_UINT64>( i->m_EncSize ) * 8 * m_SamplingFrequency / i->m_NumSamples;
+				if ( MaxBitsPerSecond < BitsPerSecond ) MaxBitsPerSecond = BitsPerSecond;
+				// avgBitrate is an average of number of bits per second.
+				TotalBitsPerSecond += BitsPerSecond;
+			}
+			TotalBitsPerSecond /= m_FrameInfo.size();
 		}
-		TotalBitsPerSecond /= m_FrameInfo.size();
 #if defined( PERMIT_BUFFERSIZEDB_OVER_24BIT )
 		// Ignore highest 8 bits of m_bufferSizeDB without warning.
 		if ( Dec.m_bufferSizeDB > 0xffffff ) Dec.m_bufferSizeDB &= 0xffffff;
@@ -1240,7 +1887,7 @@ CBox*	CMp4aWriter::CreateStsd( void )
 		}
 #endif
 		if ( Dec.m_bufferSizeDB >> 24 ) { SetLastError( E_MP4A_STSD_BUFFERSIZEDB ); delete p; return NULL; }
-		if ( ( MaxBitsPerSecond >> 32 ) || ( MaxBitsPerSecond == 0 ) ) { SetLastError( E_MP4A_STSD_MAXBITRATE ); delete p; return NULL; }
+		if ( ( MaxBitsPerSecond >> 32 ) || ( ( MaxBitsPerSecond == 0 ) && ( m_FragmentFrames == 0 ) ) ) { SetLastError( E_MP4A_STSD_MAXBITRATE ); delete p; return NULL; }
 		Dec.m_maxBitrate = static_cast<IMF_UINT32>( MaxBitsPerSecond );
 		if ( TotalBitsPerSecond >> 32 ) { SetLastError( E_MP4A_STSD_AVGBITRATE ); delete p; return NULL; }
 		Dec.m_avgBitrate = static_cast<IMF_UINT32>( TotalBitsPerSecond );
@@ -1269,6 +1916,8 @@ CBox*	CMp4aWriter::CreateStsz( void )
 	IMF_UINT32		EncSize;
 	CSampleSizeBox*	p = new CSampleSizeBox();
 	if ( p ) {
+		if ( m_FragmentFrames > 0 ) return p;	// Samples are described in movie fragments.
+
 		// Check if all frames are of the same size.
 		if ( m_FrameInfo.empty() ) { SetLastError( E_MP4A_EMPTY ); delete p; return NULL; }
 		EncSize = m_FrameInfo.front().m_EncSize;
@@ -1306,6 +1955,7 @@ CBox*	CMp4aWriter::CreateStsc( void )
 
 	CSampleToChunkBox*	p = new CSampleToChunkBox();
 	if ( p ) {
+		if ( m_FragmentFrames > 0 ) return p;	// Samples are described in movie fragments.
 		if ( m_FrameInfo.empty() ) { SetLastError( E_MP4A_EMPTY ); delete p; return NULL; }
 
 		// Make frames per chunk array.
@@ -1352,7 +2002,7 @@ CBox*	CMp4aWriter::CreateStsc( void )
 CBox*	CMp4aWriter::CreateStco( void )
 {
 	vector<CFrameInfo>::const_iterator	i;
-	IMF_INT64	Offset = m_MdatOffset;
+	IMF_INT64	Offset = ( m_FragmentFrames > 0 ) ? 0 : m_MdatOffset;	// Samples are described in movie fragments.
 
 	if ( Offset < 0 ) return NULL;
 
@@ -1383,7 +2033,7 @@ CBox*	CMp4aWriter::CreateStco( void )
 CBox*	CMp4aWriter::CreateCo64( void )
 {
 	vector<CFrameInfo>::const_iterator	i;
-	IMF_INT64	Offset = m_MdatOffset;
+	IMF_INT64	Offset = ( m_FragmentFrames > 0 ) ? 0 : m_MdatOffset;	// Samples are described in movie fragments.
 
 	if ( Offset < 0 ) return NULL;
 
@@ -1521,6 +2171,155 @@ CBox*	CMp4aWriter::CreateIloc( void )
 	return p;
 }
 
+////////////////////////////////////////
+//                                    //
+//          Create mvex box           //
+//                                    //
+////////////////////////////////////////
+CBox*	CMp4aWriter::CreateMvex( void )
+{
+	static	const	IMF_UINT32	BoxTypes[] = { IMF_FOURCC_MEHD, IMF_FOURCC_TREX, 0 };
+	CMovieExtendsBox*	p = new CMovieExtendsBox();
+	if ( p ) {
+		if ( !AddBoxes( p->m_Boxes, BoxTypes, p ) ) { delete p; return NULL; }
+	} else {
+		SetLastError( E_MEMORY );
+	}
+	return p;
+}
+
+////////////////////////////////////////
+//                                    //
+//          Create mehd box           //
+//                                    //
+////////////////////////////////////////
+CBox*	CMp4aWriter::CreateMehd( void )
+{
+	// Always 64-bit, so that moov box size does not change when it is updated.
+	CMovieExtendsHeaderBox*	p = new CMovieExtendsHeaderBox( 1 );
+	if ( p ) {
+		p->m_fragment_duration = m_TotalSamples;
+	} else {
+		SetLastError( E_MEMORY );
+	}
+	return p;
+}
+
+////////////////////////////////////////
+//                                    //
+//          Create trex box           //
+//                                    //
+////////////////////////////////////////
+CBox*	CMp4aWriter::CreateTrex( void )
+{
+	CTrackExtendsBox*	p = new CTrackExtendsBox();
+	if ( p ) {
+		p->m_track_ID = m_TrackID;
+		p->m_default_sample_description_index = 1;	// stsd has only 1 entry.
+		p->m_default_sample_flags = 0;				// Sync frame
+	} else {
+		SetLastError( E_MEMORY );
+	}
+	return p;
+}
+
+////////////////////////////////////////
+//                                    //
+//          Create moof box           //
+//                                    //
+////////////////////////////////////////
+CBox*	CMp4aWriter::CreateMoof( void )
+{
+	static	const	IMF_UINT32	BoxTypes[] = { IMF_FOURCC_MFHD, IMF_FOURCC_TRAF, 0 };
+	CMovieFragmentBox*	p = new CMovieFragmentBox();
+	if ( p ) {
+		if ( !AddBoxes( p->m_Boxes, BoxTypes, p ) ) { delete p; return NULL; }
+	} else {
+		SetLastError( E_MEMORY );
+	}
+	return p;
+}
+
+////////////////////////////////////////
+//                                    //
+//          Create mfhd box           //
+//                                    //
+////////////////////////////////////////
+CBox*	CMp4aWriter::CreateMfhd( void )
+{
+	CMovieFragmentHeaderBox*	p = new CMovieFragmentHeaderBox();
+	if ( p ) {
+		p->m_sequence_number = m_SequenceNumber + 1;
+	} else {
+		SetLastError( E_MEMORY );
+	}
+	return p;
+}
+
+////////////////////////////////////////
+//                                    //
+//          Create traf box           //
+//                                    //
+////////////////////////////////////////
+CBox*	CMp4aWriter::CreateTraf( void )
+{
+	static	const	IMF_UINT32	BoxTypes[] = { IMF_FOURCC_TFHD, IMF_FOURCC_TRUN, 0 };
+	CTrackFragmentBox*	p = new CTrackFragmentBox();
+	if ( p ) {
+		if ( !AddBoxes( p->m_Boxes, BoxTypes, p ) ) { delete p; return NULL; }
+	} else {
+		SetLastError( E_MEMORY );
+	}
+	return p;
+}
+
+////////////////////////////////////////
+//                                    //
+//          Create tfhd box           //
+//                                    //
+////////////////////////////////////////
+CBox*	CMp4aWriter::CreateTfhd( void )
+{
+	CTrackFragmentHeaderBox*	p = new CTrackFragmentHeaderBox( CTrackFragmentHeaderBox::DEFAULT_BASE_IS_MOOF );
+	if ( p ) {
+		p->m_track_ID = m_TrackID;
+	} else {
+		SetLastError( E_MEMORY );
+	}
+	return p;
+}
+
+////////////////////////////////////////
+//                                    //
+//          Create trun box           //
+//                                    //
+////////////////////////////////////////
+// * data_offset is set after the size of moof box is known.
+CBox*	CMp4aWriter::CreateTrun( void )
+{
+	vector<CFrameInfo>::const_iterator	i;
+	CTrackRunBox::TRUN_ENTRY			Entry;
+	IMF_UINT32	Flags = CTrackRunBox::DATA_OFFSET_PRESENT | CTrackRunBox::SAMPLE_DURATION_PRESENT | CTrackRunBox::SAMPLE_SIZE_PRESENT;
+
+	// Sample flags are needed only when there are non-sync frames.
+	for( i=m_FrameInfo.begin(); ( i != m_FrameInfo.end() ) && i->m_SyncFlag; i++ );
+	if ( i != m_FrameInfo.end() ) Flags |= CTrackRunBox::SAMPLE_FLAGS_PRESENT;
+
+	CTrackRunBox*	p = new CTrackRunBox( Flags );
+	if ( p ) {
+		Entry.m_sample_composition_time_offset = 0;
+		for( i=m_FrameInfo.begin(); i!=m_FrameInfo.end(); i++ ) {
+			Entry.m_sample_duration = i->m_NumSamples;
+			Entry.m_sample_size = i->m_EncSize;
+			Entry.m_sample_flags = i->m_SyncFlag ? 0 : 0x10000;	// 0x10000 = sample_is_non_sync_sample
+			p->m_Entries.push_back( Entry );
+		}
+	} else {
+		SetLastError( E_MEMORY );
+	}
+	return p;
+}
+
 ////////////////////////////////////////
 //                                    //
 //    Get total number of samples     //
@@ -80,6 +80,7 @@ Contents : MPEG-4 Audio reader and writer
 
 #include	"ImfType.h"
 #include	"ImfStream.h"
+#include	"ImfMemoryStream.h"
 #include	"ImfBox.h"
 #include	"Mp4Box.h"
 
@@ -133,6 +134,8 @@ namespace NAlsImf {
 	const IMF_UINT32	E_MP4A_ILOC_EXTENT_DATA  = 1031;
 	const IMF_UINT32	E_MP4A_ILOC_EXTENT_SIZE  = 1032;
 	const IMF_UINT32	E_MP4A_OAFI              = 1033;
+	const IMF_UINT32	E_MP4A_FRAME_PART        = 1034;
+	const IMF_UINT32	E_MP4A_MOOF              = 1035;
 
 	//////////////////////////////////////////////////////////////////////
 	//                                                                  //
@@ -157,11 +160,13 @@ namespace NAlsImf {
 		CMp4aReader( void );
 		virtual	~CMp4aReader( void ) { if ( m_pDecSpecInfo ) delete[] m_pDecSpecInfo; }
 		virtual	bool		Open( CBaseStream& Stream );
+		virtual	bool		Update( void );
 		virtual	IMF_UINT32	ReadFrame( IMF_UINT32 Index, void* pBuffer, IMF_UINT32 BufSize );
-		virtual	IMF_UINT32	GetChunkCount( void ) const { return static_cast<IMF_UINT32>( m_ChunkInfo.size() ); }
+		virtual	IMF_UINT32	GetChunkCount( void ) const { return static_cast<IMF_UINT32>( m_ChunkFrame.size() ); }
 		virtual	bool		GetChunkInfo( IMF_UINT32 Index, CChunkInfo& Info ) const;
-		virtual	IMF_UINT32	GetFrameCount( void ) const { return static_cast<IMF_UINT32>( m_FrameInfo.size() ); }
+		virtual	IMF_UINT32	GetFrameCount( void ) const { return static_cast<IMF_UINT32>( m_FrameSize.size() ); }
 		virtual	bool		GetFrameInfo( IMF_UINT32 Index, CFrameInfo& Info ) const;
+		virtual	IMF_UINT64	GetNumSamples( void ) const { return m_TotalSamples; }
 		virtual	IMF_UINT32	GetMaxFrameSize( void ) const { return m_MaxFrameSize; }
 		virtual	IMF_UINT8*	GetDecSpecInfo( IMF_UINT32& Size ) const { Size = m_DecSpecInfoSize; return m_pDecSpecInfo; }
 		virtual	void		GetHeader( IMF_UINT64& Offset, IMF_UINT64& Size ) const { Offset = m_HeaderOffset; Size = m_HeaderSize; }
@@ -173,11 +178,22 @@ namespace NAlsImf {
 		IMF_UINT8			GetAudioProfileLevelIndication() const { return m_audioProfileLevelIndication; }
 	protected:
 		void				SetLastError( IMF_UINT32 ErrCode ) { m_LastError = ErrCode; }
+		struct CSampleRun {
+			IMF_UINT32	m_FirstFrame;	// First frame index of the run
+			IMF_UINT32	m_NumSamples;	// Number of samples per frame in the run
+			IMF_UINT64	m_FirstSample;	// Sample position of the first frame
+		};
+		bool				ReadFragment( CBox* pMoof, IMF_INT64 MoofOffset, std::vector<CFrameInfo>& Frames, std::vector<IMF_UINT32>& Chunks );
+		void				AddSampleRun( IMF_UINT32 FirstFrame, IMF_UINT32 NumFrames, IMF_UINT32 NumSamples );
+		void				ClearIndex( void );
 		CBaseStream*			m_pStream;					// Pointer to input stream
 		IMF_UINT8*				m_pDecSpecInfo;				// Decoder specific info
 		IMF_UINT32				m_DecSpecInfoSize;			// Number of bytes in decoder specific info
-		std::vector<CChunkInfo>	m_ChunkInfo;				// Chunk information
-		std::vector<CFrameInfo>	m_FrameInfo;				// Frame information
+		std::vector<IMF_UINT64>	m_FrameOffset;				// File offset of each frame
+		std::vector<IMF_UINT32>	m_FrameSize;				// Encoded size of each frame in bytes
+		std::vector<IMF_UINT32>	m_ChunkFrame;				// First frame index of each chunk
+		std::vector<CSampleRun>	m_SampleRuns;				// Runs of frames with the same number of samples
+		IMF_UINT64				m_TotalSamples;				// Total number of samples
 		IMF_UINT32				m_MaxFrameSize;				// Required frame buffer size in bytes
 		IMF_UINT8				m_OrgFileType;				// Original file type
 		std::string				m_OrgMimeType;				// Original file type (MIME type)
@@ -187,6 +203,11 @@ namespace NAlsImf {
 		IMF_UINT64				m_TrailerSize;				// Trailer size in bytes
 		IMF_UINT64				m_AuxDataOffset;			// Auxiliary data offset
 		IMF_UINT64				m_AuxDataSize;				// Auxiliary data size in bytes
+		IMF_INT64				m_ScanOffset;				// Offset to look for movie fragments (-1:Not fragmented)
+		IMF_UINT32				m_TrackID;					// Track ID in movie fragments
+		IMF_UINT32				m_DefaultDuration;			// Default number of samples per frame in movie fragments
+		IMF_UINT32				m_DefaultSize;				// Default frame size in movie fragments
+		IMF_UINT32				m_DefaultFlags;				// Default sample flags in movie fragments
 		IMF_UINT32				m_LastError;				// Last error code
 		IMF_UINT8				m_audioProfileLevelIndication;
 	};
@@ -210,6 +231,8 @@ namespace NAlsImf {
 		virtual	bool		WriteTrailer( const void* pTrailer, IMF_UINT32 TrailerSize );
 		virtual	bool		WriteAuxData( const void* pAuxData, IMF_UINT32 AuxDataSize );
 		virtual	bool		WriteFrame( const void* pFrame, IMF_UINT32 EncSize, IMF_UINT32 NumSamples, bool SyncFlag = true );
+		virtual	bool		WriteFramePart( const void* pData, IMF_UINT32 Size );
+		virtual	bool		EndFrame( IMF_UINT32 NumSamples, bool SyncFlag = true );
 		virtual	const void*	GetDecSpecInfo( void ) const { return m_pDecSpecInfo; }
 		virtual	IMF_UINT32	GetDecSpecInfoSize( void ) const { return m_DecSpecInfoSize; }
 		virtual	bool		SetDecSpecInfo( const void* pDecSpecInfo, IMF_UINT32 DecSpecInfoSize );
@@ -217,6 +240,8 @@ namespace NAlsImf {
 		virtual	CBox*		CreateBox( IMF_UINT32 Type, IMF_UINT32 HandlerType = 0 );
 		IMF_UINT32			GetLastError( void ) const { return m_LastError; }
 		void				SetAudioProfileLevelIndication( IMF_UINT8 AudioProfileLevelIndication ) { m_audioProfileLevelIndication = AudioProfileLevelIndication; }
+		void				ReserveMoov( IMF_UINT32 NumFrames ) { m_ReserveFrames = NumFrames; }
+		void				SetFragment( IMF_UINT32 FramesPerFragment ) { m_FragmentFrames = FramesPerFragment; }
 	protected:
 		virtual	CBox*		CreateFtyp( void );
 		virtual	CBox*		CreateMoov( void );
@@ -242,7 +267,22 @@ namespace NAlsImf {
 		virtual	CBox*		CreateMeta( void );
 		virtual	CBox*		CreateData( void );
 		virtual	CBox*		CreateIloc( void );
+		virtual	CBox*		CreateMvex( void );
+		virtual	CBox*		CreateMehd( void );
+		virtual	CBox*		CreateTrex( void );
+		virtual	CBox*		CreateMoof( void );
+		virtual	CBox*		CreateMfhd( void );
+		virtual	CBox*		CreateTraf( void );
+		virtual	CBox*		CreateTfhd( void );
+		virtual	CBox*		CreateTrun( void );
+		bool				AddFrameInfo( IMF_UINT32 EncSize, IMF_UINT32 NumSamples, bool SyncFlag );
+		bool				FlushFragment( void );
+		bool				BeginDataBox( void );
+		bool				EndDataBox( void );
+		bool				CompleteFragments( void );
 		bool				AddBoxes( CBoxVector& Boxes, const IMF_UINT32* pTypes, CBox* pParent = NULL );
+		IMF_UINT32			EstimateMoovSize( IMF_UINT32 NumFrames );
+		bool				WriteFree( IMF_UINT32 Size );
 		IMF_UINT64			GetNumSamples( void ) const;
 		static	IMF_UINT64	MakeTime( time_t Time );
 		void				SetLastError( IMF_UINT32 ErrCode ) { m_LastError = ErrCode; }
@@ -259,10 +299,22 @@ namespace NAlsImf {
 		char*					m_pDecSpecInfo;				// Decoder specific info
 		IMF_UINT32				m_DecSpecInfoSize;			// Number of bytes in decoder specific info
 		std::vector<CFrameInfo>	m_FrameInfo;				// Frame information
+		IMF_UINT64				m_PartSize;					// Bytes written so far by WriteFramePart()
 		bool					m_Use64bit;					// true:Use 64-bit / false:Use 32-bit
 		bool					m_UseMeta;					// true:Create meta box
 		IMF_INT64				m_MdatOffset;				// Offset position of mdat box
 		IMF_UINT32				m_MdatHeaderSize;			// Header size of mdat box
+		IMF_UINT32				m_ReserveFrames;			// Number of frames to reserve moov space for (0:moov after mdat)
+		IMF_INT64				m_MoovOffset;				// Offset position of reserved moov space
+		IMF_UINT32				m_MoovSpace;				// Size of reserved moov space in bytes
+		IMF_UINT32				m_FragmentFrames;			// Number of frames per movie fragment (0:Not fragmented)
+		IMF_UINT32				m_SequenceNumber;			// Sequence number of the last movie fragment
+		CMemoryStream			m_FragmentData;				// Frame data of the current movie fragment
+		IMF_UINT64				m_TotalFrames;				// Number of frames in movie fragments
+		IMF_UINT64				m_TotalSamples;				// Number of samples in movie fragments
+		IMF_UINT32				m_MaxEncSize;				// Maximum frame size in movie fragments
+		IMF_UINT64				m_MaxBitrate;				// Maximum bitrate in movie fragments
+		IMF_UINT64				m_SumBitrate;				// Sum of frame bitrates in movie fragments
 		IMF_UINT8				m_FileType;					// Original file type
 		IMF_INT64				m_HeaderSize;				// Original header size in bytes
 		IMF_INT64				m_HeaderOffset;				// Original header offset
@@ -121,6 +121,7 @@ contents : Conversion of plain ALS files to MP4 files
  *
  ************************************************************************/
 
+#include <algorithm>
 #include "ImfFileStream.h"
 #include "Mp4aFile.h"
 #include "als2mp4.h"
@@ -137,6 +138,7 @@ contents : Conversion of plain ALS files to MP4 files
 #define	READ_UINT( x )		( ( (unsigned int)(x)[0] << 24 ) | ( (unsigned int)(x)[1] << 16 ) | ( (unsigned int)(x)[2] << 8 ) | ( (unsigned int)(x)[3] ) )
 #define	READ_USHORT( x )	( ( (unsigned short)(x)[0] << 8 ) | ( (unsigned short)(x)[1] ) )
 #define	PROCEED( x )		{ if ( (x) > DataSize ) throw A2MERR_INVALID_CONFIG; pData += (x); DataSize -= (x); }
+#define	RAUCOPY_BUFFER_SIZE	1048576		// Maximum buffer size to copy RAUs
 
 using namespace NAlsImf;
 
@@ -154,6 +156,8 @@ int main(int argc, char **argv)
 		printf("  -u#   RAU size location (-x only): 0 = frames (default), 1 = header, 2 = none\n");
 		printf("  -x    convert MP4 into ALS file (options -u# only)\n");
 		printf("  -OAFI force to create meta box with oafi record\n");
+		printf("  -FS   fast start: place moov box before mdat box\n");
+		printf("  -FR#  fragmented MP4: write a movie fragment every # random access units\n");
 		printf("\n");
 		printf("The ALS file to be converted must be encoded in random access mode. There\n");
 		printf("are several options to deal with the random access information.\n");
@@ -182,6 +186,8 @@ int main(int argc, char **argv)
 	Mp4Info.m_FileType = 0xff;				// File type is determined by ALS header.
 	Mp4Info.m_RMflag = false;
 	Mp4Info.m_UseMeta = ( CheckOption( argc, argv, "-OAFI" ) != 0 );
+	Mp4Info.m_FastStart = ( CheckOption( argc, argv, "-FS" ) != 0 );
+	Mp4Info.m_FragmentRaus = static_cast<NAlsImf::IMF_UINT32>( GetOptionValue( argc, argv, "-FR" ) );
 	Mp4Info.m_audioProfileLevelIndication = MP4_AUDIO_PROFILE_UNSPECIFIED;
 
 	ErrCode = CheckOption( argc, argv, "-x" ) ? Mp4ToAls( Mp4Info ) : AlsToMp4( Mp4Info );
@@ -194,6 +200,39 @@ int main(int argc, char **argv)
 }
 #endif	// ALS2MP4_MAIN
 
+////////////////////////////////////////
+//                                    //
+//       Copy an RAU to MP4 file      //
+//                                    //
+////////////////////////////////////////
+// InFile = ALS file positioned at the RAU
+// Writer = MP4 writer
+// pBuf = Copy buffer
+// BufSize = Size of pBuf in bytes
+// RauSize = RAU size in bytes
+// Samples = Number of samples in the RAU
+// * Throws A2MERR on error.
+static	void	CopyRau( CBaseStream& InFile, CMp4aWriter& Writer, IMF_UINT8* pBuf, IMF_UINT32 BufSize, IMF_UINT32 RauSize, IMF_UINT32 Samples )
+{
+	IMF_UINT32	Size;
+
+	if ( RauSize <= BufSize ) {
+		// Whole RAU fits in the buffer.
+		if ( InFile.Read( pBuf, RauSize ) != RauSize ) throw A2MERR_READ_FRAME;
+		if ( !Writer.WriteFrame( pBuf, RauSize, Samples, true ) ) throw A2MERR_WRITE_FRAME;
+		return;
+	}
+
+	// Stream the RAU into mdat piece by piece.
+	while( RauSize > 0 ) {
+		Size = ( RauSize < BufSize ) ? RauSize : BufSize;
+		if ( InFile.Read( pBuf, Size ) != Size ) throw A2MERR_READ_FRAME;
+		if ( !Writer.WriteFramePart( pBuf, Size ) ) throw A2MERR_WRITE_FRAME;
+		RauSize -= Size;
+	}
+	if ( !Writer.EndFrame( Samples, true ) ) throw A2MERR_WRITE_FRAME;
+}
+
 ////////////////////////////////////////
 //                                    //
 //         Convert ALS to MP4         //
@@ -210,7 +249,7 @@ A2MERR	AlsToMp4( MP4INFO& Mp4Info )
 	ALS_HEADER	AlsHeader;
 	IMF_UINT64	RauBufSize;
 	IMF_UINT8*	pRauBuf = NULL;
-	IMF_UINT32	RauSize;
+	IMF_UINT32	RauSize = 0;
 	IMF_UINT64	SampleDuration, LastSampleDuration;
 	IMF_UINT32	i;
 	IMF_UINT32	CopySize;
@@ -234,6 +273,8 @@ A2MERR	AlsToMp4( MP4INFO& Mp4Info )
 		// Open MP4 writer.
 		Writer.SetAudioProfileLevelIndication( Mp4Info.m_audioProfileLevelIndication );
 		Use64bit = ( Mp4Info.m_HeaderSize + Mp4Info.m_TrailerSize + AlsHeader.m_FileSize > 0xffffffff );
+		if ( Mp4Info.m_FastStart ) Writer.ReserveMoov( AlsHeader.m_RAUnits );
+		if ( Mp4Info.m_FragmentRaus > 0 ) Writer.SetFragment( Mp4Info.m_FragmentRaus );
 		if ( !Writer.Open( OutFile, AlsHeader.m_Freq, AlsHeader.m_Chan, AlsHeader.m_Res, Mp4Info.m_FileType, AlsHeader.m_pALSSpecificConfig, AlsHeader.m_ALSSpecificConfigSize, Use64bit, Mp4Info.m_UseMeta ) ) throw A2MERR_INIT_MP4WRITER;
 
 		// Calculate sample duration and last sample duration.
@@ -244,6 +285,8 @@ A2MERR	AlsToMp4( MP4INFO& Mp4Info )
 		if ( AlsHeader.m_RA == 0 ) {
 			// The whole audio data is regarded as one RA unit.
 			RauBufSize = AlsHeader.m_FileSize - InFile.Tell();
+			if ( RauBufSize >> 32 ) throw A2MERR_RAU_TOO_BIG;
+			RauSize = static_cast<IMF_UINT32>( RauBufSize );
 		} else if ( AlsHeader.m_RAflag == 1 ) {
 			// Assumes uncompressed size.
 			RauBufSize = AlsHeader.m_N * AlsHeader.m_RA * AlsHeader.m_Chan * ( AlsHeader.m_Res / 8 ) + sizeof(IMF_UINT32);
@@ -255,9 +298,11 @@ A2MERR	AlsToMp4( MP4INFO& Mp4Info )
 			// RA is enabled, but no RAU size information found.
 			throw A2MERR_NO_RAU_SIZE;
 		}
-		if ( RauBufSize >> 32 ) throw A2MERR_RAU_TOO_BIG;
 
 		// Allocate buffer for RAU.
+		// * Larger RAUs are copied in pieces, so that memory usage does not depend on the input size.
+		if ( RauBufSize > RAUCOPY_BUFFER_SIZE ) RauBufSize = RAUCOPY_BUFFER_SIZE;
+		if ( RauBufSize == 0 ) RauBufSize = 1;
 		pRauBuf = new IMF_UINT8 [ static_cast<IMF_UINT32>( RauBufSize ) ];
 		if ( pRauBuf == NULL ) throw A2MERR_NO_MEMORY;
 
@@ -271,8 +316,7 @@ A2MERR	AlsToMp4( MP4INFO& Mp4Info )
 		if ( AlsHeader.m_RA == 0 ) {
 			// Write all audio data as a single RAU.
 			if ( AlsHeader.m_Samples >> 32 ) throw A2MERR_RAU_TOO_BIG;
-			InFile.Read( pRauBuf, static_cast<IMF_UINT32>( RauBufSize ) );
-			if ( !Writer.WriteFrame( pRauBuf, static_cast<IMF_UINT32>( RauBufSize ), static_cast<IMF_UINT32>( AlsHeader.m_Samples ), true ) ) throw A2MERR_WRITE_FRAME;
+			CopyRau( InFile, Writer, pRauBuf, static_cast<IMF_UINT32>( RauBufSize ), RauSize, static_cast<IMF_UINT32>( AlsHeader.m_Samples ) );
 
 		} else {
 			// RAU loop
@@ -281,13 +325,6 @@ A2MERR	AlsToMp4( MP4INFO& Mp4Info )
 				// Get RAU size.
 				if ( AlsHeader.m_RAflag == 1 ) {
 					InFile.Read32( RauSize );
-					if ( RauSize > RauBufSize ) {
-						// Extend pRauBuf size.
-						delete[] pRauBuf;
-						RauBufSize = RauSize;
-						pRauBuf = new IMF_UINT8 [ static_cast<IMF_UINT32>( RauBufSize ) ];
-						if ( pRauBuf == NULL ) throw A2MERR_NO_MEMORY;
-					}
 					if ( !Mp4Info.m_StripRaInfo ) {
 						// Regard RAU size as a part of a frame.
 						RauSize += 4;
@@ -297,15 +334,12 @@ A2MERR	AlsToMp4( MP4INFO& Mp4Info )
 					RauSize = AlsHeader.m_RAUsize[i];
 				}
 
-				// Read RAU from ALS file.
-				InFile.Read( pRauBuf, RauSize );
-
 				// Adjust sample duration.
 				if ( i == AlsHeader.m_RAUnits - 1 ) SampleDuration = LastSampleDuration;
 
-				// Write RAU to MP4 file.
+				// Copy RAU from ALS file to MP4 file.
 				if ( SampleDuration >> 32 ) throw A2MERR_RAU_TOO_BIG;
-				if ( !Writer.WriteFrame( pRauBuf, RauSize, static_cast<IMF_UINT32>( SampleDuration ), true ) ) throw A2MERR_WRITE_FRAME;
+				CopyRau( InFile, Writer, pRauBuf, static_cast<IMF_UINT32>( RauBufSize ), RauSize, static_cast<IMF_UINT32>( SampleDuration ) );
 			}
 		}
 
@@ -571,6 +605,185 @@ void	ReadAlsHeaderFromStream( CBaseStream& Stream, ALS_HEADER* pHeader, MP4INFO&
 	}
 }
 
+////////////////////////////////////////
+//                                    //
+//    Read ALS config from MP4 file   //
+//                                    //
+////////////////////////////////////////
+// Reader = Opened MP4 reader
+// pAlsHeader = ALS_HEADER structure to receive the result
+// Mp4Info = Reference to MP4 information
+// Return value = Pointer to AudioSpecificConfig data owned by Reader
+// * This function may throw A2MERR.
+static	IMF_UINT8*	ReadMp4aConfig( CMp4aReader& Reader, ALS_HEADER* pAlsHeader, MP4INFO& Mp4Info )
+{
+	IMF_UINT8*	pConfigData;
+	IMF_UINT32	ConfigSize;
+	IMF_UINT8	Aot;
+
+	// Get decoder specific config.
+	pConfigData = Reader.GetDecSpecInfo( ConfigSize );
+	if ( ( pConfigData == NULL ) || ( ConfigSize < 6 ) ) throw A2MERR_INVALID_CONFIG;
+
+	// Analyse AudioSpecificConfig information.
+	Aot = pConfigData[0] >> 3;																	// XXXX Xxxx
+	if ( Aot == 0x1F ) Aot = 32 + ( ( pConfigData[0] & 0x07 ) << 3 ) | ( pConfigData[1] >> 5 );	// xxx- ----
+	if ( Aot != 36 ) throw A2MERR_NOT_ALS;
+
+	Mp4Info.m_audioProfileLevelIndication = Reader.GetAudioProfileLevelIndication();
+
+	// Fill in MP4INFO structure.
+	Mp4Info.m_Samples = Reader.GetNumSamples();
+	Reader.GetHeader( Mp4Info.m_HeaderOffset, Mp4Info.m_HeaderSize );
+	Reader.GetTrailer( Mp4Info.m_TrailerOffset, Mp4Info.m_TrailerSize );
+	Reader.GetAuxData( Mp4Info.m_AuxDataOffset, Mp4Info.m_AuxDataSize );
+	Mp4Info.m_pOriginalFile = Mp4Info.m_pInFile;
+	Reader.GetFileType( Mp4Info.m_FileType, Mp4Info.m_FileTypeName );
+
+	// Read ALS header information.
+	ReadAlsHeaderFromMemory( pConfigData + 6, ConfigSize - 6, pAlsHeader, Mp4Info );
+
+	// When CMp4aReader cannot detect the file type, take it from ALS header.
+	if ( Mp4Info.m_FileType == 0xff ) {
+		Mp4Info.m_FileType = pAlsHeader->m_FileType;
+		Mp4Info.m_FileTypeName.erase();
+	}
+
+	return pConfigData;
+}
+
+////////////////////////////////////////
+//                                    //
+//  Write ALS header of an MP4 file   //
+//                                    //
+////////////////////////////////////////
+// Reader = Opened MP4 reader
+// pConfigData = AudioSpecificConfig data returned by ReadMp4aConfig()
+// pAlsHeader = ALS header information
+// Mp4Info = Reference to MP4 information
+// OutFile = Output stream
+// * This function may throw A2MERR.
+static	void	WriteAlsHeader( CMp4aReader& Reader, IMF_UINT8* pConfigData, const ALS_HEADER* pAlsHeader, const MP4INFO& Mp4Info, CBaseStream& OutFile )
+{
+	IMF_UINT32	i;
+	CMp4aReader::CFrameInfo	FrameInfo;
+	bool		AddFrameInfo = false;
+	IMF_UINT32	CopySize;
+
+	// Set samples.
+	if ( pAlsHeader->m_Samples == 0xffffffff ) {
+		if ( !Mp4Info.m_RMflag ) {
+			if ( Mp4Info.m_Samples >> 32 ) throw A2MERR_INVALID_SAMPLES;
+			Set32( pConfigData + 6 + 8, static_cast<IMF_UINT32>( Mp4Info.m_Samples ) );
+		}
+	}
+
+	// Write ALS header.
+	if ( ( pAlsHeader->m_RA != 0 ) && ( pAlsHeader->m_RAflag == 0 ) ) {
+		// RAU size has been stripped in encoding.
+		if ( Mp4Info.m_RaLocation == 0 ) {
+			pConfigData[18+6] |= 0x40;	// 01xx xxxx: set RAflag to 01 in bitstream (RAU size in frame)
+			if ( OutFile.Write( pConfigData + 6, pAlsHeader->m_AlsHeaderSize ) != pAlsHeader->m_AlsHeaderSize ) throw A2MERR_WRITE_ALSHEADER;
+
+		} else if ( Mp4Info.m_RaLocation == 1 ) {
+			pConfigData[18+6] |= 0x80;	// 10xx xxxx: set RAflag to 10 in bitstream (RAU size in header)
+			// Write ALS header, inserting RAU size information.
+			if ( OutFile.Write( pConfigData + 6, pAlsHeader->m_AlsHeaderSize ) != pAlsHeader->m_AlsHeaderSize ) throw A2MERR_WRITE_ALSHEADER;
+			AddFrameInfo = true;
+
+		} else if ( Mp4Info.m_RaLocation == 2 ) {
+			// RA is enabled, but RAU size location has not been specified.
+			printf( "***** WARNING: Random access is enabled, but RAU size information has been stripped. *****\n" );
+			if ( OutFile.Write( pConfigData + 6, pAlsHeader->m_AlsHeaderSize ) != pAlsHeader->m_AlsHeaderSize ) throw A2MERR_WRITE_ALSHEADER;
+
+		} else {
+			// Invalid Mp4Info.m_RaLocation value.
+			throw A2MERR_INVALID_OPTION;
+		}
+	} else {	// ( RA == 0 ) || ( RAflag != 0 )
+		// Just copy ALS header as is.
+		if ( OutFile.Write( pConfigData + 6, pAlsHeader->m_AlsHeaderSize ) != pAlsHeader->m_AlsHeaderSize ) throw A2MERR_WRITE_ALSHEADER;
+	}
+
+	// Write header size.
+	if ( pAlsHeader->m_HeaderSize == 0xffffffff ) {
+		if ( Mp4Info.m_RMflag ) {
+			// Keep 0xffffffff for header size.
+			if ( !OutFile.Write32( pAlsHeader->m_HeaderSize ) ) throw A2MERR_WRITE_HEADER;
+		} else {
+			// Embed header size.
+			if ( Mp4Info.m_HeaderSize >> 32 ) throw A2MERR_HEADER_TOO_BIG;
+			if ( !OutFile.Write32( static_cast<IMF_UINT32>( Mp4Info.m_HeaderSize ) ) ) throw A2MERR_WRITE_HEADER;
+		}
+	} else {
+		if ( !OutFile.Write32( pAlsHeader->m_HeaderSize ) ) throw A2MERR_WRITE_HEADER;
+	}
+
+	// Write trailer size.
+	if ( pAlsHeader->m_TrailerSize == 0xffffffff ) {
+		if ( Mp4Info.m_RMflag ) {
+			// Keep 0xffffffff for trailer size.
+			if ( !OutFile.Write32( pAlsHeader->m_TrailerSize ) ) throw A2MERR_WRITE_TRAILER;
+		} else {
+			// Embed trailer size.
+			if ( Mp4Info.m_TrailerSize >> 32 ) throw A2MERR_TRAILER_TOO_BIG;
+			if ( !OutFile.Write32( static_cast<IMF_UINT32>( Mp4Info.m_TrailerSize ) ) ) throw A2MERR_WRITE_TRAILER;
+		}
+	} else {
+		if ( !OutFile.Write32( pAlsHeader->m_TrailerSize ) ) throw A2MERR_WRITE_TRAILER;
+	}
+
+	// Write header data.
+	if ( pAlsHeader->m_HeaderSize == 0xffffffff ) {
+		if ( !Mp4Info.m_RMflag ) {
+			// Embed header data.
+			CCopyData	CopyData( Mp4Info.m_pOriginalFile, Mp4Info.m_HeaderOffset, Mp4Info.m_HeaderSize );
+			while( CopyData.Read( CopySize ) ) if ( OutFile.Write( CopyData, CopySize ) != CopySize ) throw A2MERR_WRITE_HEADER;
+		}
+	} else {
+		if ( OutFile.Write( pAlsHeader->m_pHeaderData, pAlsHeader->m_HeaderSize ) != pAlsHeader->m_HeaderSize ) throw A2MERR_WRITE_HEADER;
+	}
+
+	// Write trailer data.
+	if ( pAlsHeader->m_TrailerSize == 0xffffffff ) {
+		if ( !Mp4Info.m_RMflag ) {
+			// Embed trailer data.
+			CCopyData	CopyData( Mp4Info.m_pOriginalFile, Mp4Info.m_TrailerOffset, Mp4Info.m_TrailerSize );
+			while( CopyData.Read( CopySize ) ) if ( OutFile.Write( CopyData, CopySize ) != CopySize ) throw A2MERR_WRITE_TRAILER;
+		}
+	} else {
+		if ( OutFile.Write( pAlsHeader->m_pTrailerData, pAlsHeader->m_TrailerSize ) != pAlsHeader->m_TrailerSize ) throw A2MERR_WRITE_TRAILER;
+	}
+
+	// CRC
+	if ( pAlsHeader->m_CRCenabled ) {
+		if ( !OutFile.Write32( pAlsHeader->m_CRCorg ) ) throw A2MERR_WRITE_ALSHEADER;
+	}
+
+	// ra_unit_size
+	if ( ( pAlsHeader->m_RA != 0 ) && ( pAlsHeader->m_RAflag == 2 ) ) {
+		if ( OutFile.Write( pAlsHeader->m_RAUsize, pAlsHeader->m_RAUnits * sizeof(IMF_UINT32) ) != pAlsHeader->m_RAUnits * sizeof(IMF_UINT32) ) throw A2MERR_WRITE_ALSHEADER;
+	} else if ( AddFrameInfo ) {
+		for( i=0; i<pAlsHeader->m_RAUnits; i++ ) {
+			if ( !Reader.GetFrameInfo( i, FrameInfo ) ) throw A2MERR_NO_FRAMEINFO;
+			if ( !OutFile.Write32( FrameInfo.m_EncSize ) ) throw A2MERR_WRITE_ALSHEADER;
+		}
+	}
+
+	// Write auxiliary data.
+	if ( pAlsHeader->m_AUXenabled ) {
+		if ( pAlsHeader->m_AuxSize == 0xffffffff ) {
+			if ( Mp4Info.m_AuxDataSize >> 32 ) throw A2MERR_AUXDATA_TOO_BIG;
+			if ( !OutFile.Write32( static_cast<IMF_UINT32>( Mp4Info.m_AuxDataSize ) ) ) throw A2MERR_WRITE_AUXDATA;
+			CCopyData	CopyData( Mp4Info.m_pOriginalFile, Mp4Info.m_AuxDataOffset, Mp4Info.m_AuxDataSize );
+			while( CopyData.Read( CopySize ) ) if ( OutFile.Write( CopyData, CopySize ) != CopySize ) throw A2MERR_WRITE_AUXDATA;
+		} else {
+			if ( !OutFile.Write32( pAlsHeader->m_AuxSize ) ) throw A2MERR_WRITE_AUXDATA;
+			if ( OutFile.Write( pAlsHeader->m_pAuxData, pAlsHeader->m_AuxSize ) != pAlsHeader->m_AuxSize ) throw A2MERR_WRITE_AUXDATA;
+		}
+	}
+}
+
 ////////////////////////////////////////
 //                                    //
 //         Convert MP4 to ALS         //
@@ -586,17 +799,10 @@ A2MERR	Mp4ToAls( MP4INFO& Mp4Info )
 	CMp4aReader	Reader;
 	ALS_HEADER	AlsHeader;
 	IMF_UINT8*	pConfigData = NULL;
-	IMF_UINT32	ConfigSize;
 	IMF_UINT8*	pRauBuf = NULL;
 	IMF_UINT32	MaxRauSize;
 	IMF_UINT32	RauSize;
-	IMF_UINT8	Aot;
 	IMF_UINT32	i;
-	IMF_UINT32	NumFrames;
-	IMF_UINT64	TotalSamples;
-	CMp4aReader::CFrameInfo	FrameInfo;
-	bool		AddFrameInfo = false;
-	IMF_UINT32	CopySize;
 
 	// Initialize ALS_HEADER structure.
 	memset( &AlsHeader, 0, sizeof(AlsHeader) );
@@ -610,158 +816,16 @@ A2MERR	Mp4ToAls( MP4INFO& Mp4Info )
 		// Open MP4A reader.
 		if ( !Reader.Open( InFile ) ) throw A2MERR_INIT_MP4READER;
 
-		// Get decoder specific config.
-		pConfigData = Reader.GetDecSpecInfo( ConfigSize );
-		if ( ( pConfigData == NULL ) || ( ConfigSize < 6 ) ) throw A2MERR_INVALID_CONFIG;
-
-		// Analyse AudioSpecificConfig information.
-		Aot = pConfigData[0] >> 3;																	// XXXX Xxxx
-		if ( Aot == 0x1F ) Aot = 32 + ( ( pConfigData[0] & 0x07 ) << 3 ) | ( pConfigData[1] >> 5 );	// xxx- ----
-		if ( Aot != 36 ) throw A2MERR_NOT_ALS;
-
-		Mp4Info.m_audioProfileLevelIndication = Reader.GetAudioProfileLevelIndication();
-
-		// Calculate total number of samples.
-		TotalSamples = 0;
-		NumFrames = Reader.GetFrameCount();
-		for( i=0; i<NumFrames; i++ ) {
-			if ( Reader.GetFrameInfo( i, FrameInfo ) ) TotalSamples += FrameInfo.m_NumSamples;
-		}
-
-		// Fill in MP4INFO structure.
-		Mp4Info.m_Samples = TotalSamples;
-		Reader.GetHeader( Mp4Info.m_HeaderOffset, Mp4Info.m_HeaderSize );
-		Reader.GetTrailer( Mp4Info.m_TrailerOffset, Mp4Info.m_TrailerSize );
-		Reader.GetAuxData( Mp4Info.m_AuxDataOffset, Mp4Info.m_AuxDataSize );
-		Mp4Info.m_pOriginalFile = Mp4Info.m_pInFile;
-		Reader.GetFileType( Mp4Info.m_FileType, Mp4Info.m_FileTypeName );
-
-		// Read ALS header information.
-		ReadAlsHeaderFromMemory( pConfigData + 6, ConfigSize - 6, &AlsHeader, Mp4Info );
-
-		// When CMp4aReader cannot detect the file type, take it from ALS header.
-		if ( Mp4Info.m_FileType == 0xff ) {
-			Mp4Info.m_FileType = AlsHeader.m_FileType;
-			Mp4Info.m_FileTypeName.erase();
-		}
+		// Get ALS header information from decoder specific config.
+		pConfigData = ReadMp4aConfig( Reader, &AlsHeader, Mp4Info );
 
 		// open output (ALS) file /////////////////////////////////////////////////////////////////
 
 		// Create ALS file.
 		if ( !OutFile.Open( Mp4Info.m_pOutFile ) ) throw A2MERR_CREATE_FILE;
 
-		// Set samples.
-		if ( AlsHeader.m_Samples == 0xffffffff ) {
-			if ( !Mp4Info.m_RMflag ) {
-				if ( Mp4Info.m_Samples >> 32 ) throw A2MERR_INVALID_SAMPLES;
-				Set32( pConfigData + 6 + 8, static_cast<IMF_UINT32>( Mp4Info.m_Samples ) );
-			}
-		}
-
 		// Write ALS header.
-		if ( ( AlsHeader.m_RA != 0 ) && ( AlsHeader.m_RAflag == 0 ) ) {
-			// RAU size has been stripped in encoding.
-			if ( Mp4Info.m_RaLocation == 0 ) {
-				pConfigData[18+6] |= 0x40;	// 01xx xxxx: set RAflag to 01 in bitstream (RAU size in frame)
-				if ( OutFile.Write( pConfigData + 6, AlsHeader.m_AlsHeaderSize ) != AlsHeader.m_AlsHeaderSize ) throw A2MERR_WRITE_ALSHEADER;
-
-			} else if ( Mp4Info.m_RaLocation == 1 ) {
-				pConfigData[18+6] |= 0x80;	// 10xx xxxx: set RAflag to 10 in bitstream (RAU size in header)
-				// Write ALS header, inserting RAU size information.
-				if ( OutFile.Write( pConfigData + 6, AlsHeader.m_AlsHeaderSize ) != AlsHeader.m_AlsHeaderSize ) throw A2MERR_WRITE_ALSHEADER;
-				AddFrameInfo = true;
-
-			} else if ( Mp4Info.m_RaLocation == 2 ) {
-				// RA is enabled, but RAU size location has not been specified.
-				printf( "***** WARNING: Random access is enabled, but RAU size information has been stripped. *****\n" );
-				if ( OutFile.Write( pConfigData + 6, AlsHeader.m_AlsHeaderSize ) != AlsHeader.m_AlsHeaderSize ) throw A2MERR_WRITE_ALSHEADER;
-
-			} else {
-				// Invalid Mp4Info.m_RaLocation value.
-				throw A2MERR_INVALID_OPTION;
-			}
-		} else {	// ( RA == 0 ) || ( AlsHeader.m_RAflag != 0 )
-			// Just copy ALS header as is.
-			if ( OutFile.Write( pConfigData + 6, AlsHeader.m_AlsHeaderSize ) != AlsHeader.m_AlsHeaderSize ) throw A2MERR_WRITE_ALSHEADER;
-		}
-
-		// Write header size.
-		if ( AlsHeader.m_HeaderSize == 0xffffffff ) {
-			if ( Mp4Info.m_RMflag ) {
-				// Keep 0xffffffff for header size.
-				if ( !OutFile.Write32( AlsHeader.m_HeaderSize ) ) throw A2MERR_WRITE_HEADER;
-			} else {
-				// Embed header size.
-				if ( Mp4Info.m_HeaderSize >> 32 ) throw A2MERR_HEADER_TOO_BIG;
-				if ( !OutFile.Write32( static_cast<IMF_UINT32>( Mp4Info.m_HeaderSize ) ) ) throw A2MERR_WRITE_HEADER;
-			}
-		} else {
-			if ( !OutFile.Write32( AlsHeader.m_HeaderSize ) ) throw A2MERR_WRITE_HEADER;
-		}
-
-		// Write trailer size.
-		if ( AlsHeader.m_TrailerSize == 0xffffffff ) {
-			if ( Mp4Info.m_RMflag ) {
-				// Keep 0xffffffff for trailer size.
-				if ( !OutFile.Write32( AlsHeader.m_TrailerSize ) ) throw A2MERR_WRITE_TRAILER;
-			} else {
-				// Embed trailer size.
-				if ( Mp4Info.m_TrailerSize >> 32 ) throw A2MERR_TRAILER_TOO_BIG;
-				if ( !OutFile.Write32( static_cast<IMF_UINT32>( Mp4Info.m_TrailerSize ) ) ) throw A2MERR_WRITE_TRAILER;
-			}
-		} else {
-			if ( !OutFile.Write32( AlsHeader.m_TrailerSize ) ) throw A2MERR_WRITE_TRAILER;
-		}
-
-		// Write header data.
-		if ( AlsHeader.m_HeaderSize == 0xffffffff ) {
-			if ( !Mp4Info.m_RMflag ) {
-				// Embed header data.
-				CCopyData	CopyData( Mp4Info.m_pOriginalFile, Mp4Info.m_HeaderOffset, Mp4Info.m_HeaderSize );
-				while( CopyData.Read( CopySize ) ) if ( OutFile.Write( CopyData, CopySize ) != CopySize ) throw A2MERR_WRITE_HEADER;
-			}
-		} else {
-			if ( OutFile.Write( AlsHeader.m_pHeaderData, AlsHeader.m_HeaderSize ) != AlsHeader.m_HeaderSize ) throw A2MERR_WRITE_HEADER;
-		}
-
-		// Write trailer data.
-		if ( AlsHeader.m_TrailerSize == 0xffffffff ) {
-			if ( !Mp4Info.m_RMflag ) {
-				// Embed trailer data.
-				CCopyData	CopyData( Mp4Info.m_pOriginalFile, Mp4Info.m_TrailerOffset, Mp4Info.m_TrailerSize );
-				while( CopyData.Read( CopySize ) ) if ( OutFile.Write( CopyData, CopySize ) != CopySize ) throw A2MERR_WRITE_TRAILER;
-			}
-		} else {
-			if ( OutFile.Write( AlsHeader.m_pTrailerData, AlsHeader.m_TrailerSize ) != AlsHeader.m_TrailerSize ) throw A2MERR_WRITE_TRAILER;
-		}
-
-		// CRC
-		if ( AlsHeader.m_CRCenabled ) {
-			if ( !OutFile.Write32( AlsHeader.m_CRCorg ) ) throw A2MERR_WRITE_ALSHEADER;
-		}
-
-		// ra_unit_size
-		if ( ( AlsHeader.m_RA != 0 ) && ( AlsHeader.m_RAflag == 2 ) ) {
-			if ( OutFile.Write( AlsHeader.m_RAUsize, AlsHeader.m_RAUnits * sizeof(IMF_UINT32) ) != AlsHeader.m_RAUnits * sizeof(IMF_UINT32) ) throw A2MERR_WRITE_ALSHEADER;
-		} else if ( AddFrameInfo ) {
-			for( i=0; i<AlsHeader.m_RAUnits; i++ ) {
-				if ( !Reader.GetFrameInfo( i, FrameInfo ) ) throw A2MERR_NO_FRAMEINFO;
-				if ( !OutFile.Write32( FrameInfo.m_EncSize ) ) throw A2MERR_WRITE_ALSHEADER;
-			}
-		}
-
-		// Write auxiliary data.
-		if ( AlsHeader.m_AUXenabled ) {
-			if ( AlsHeader.m_AuxSize == 0xffffffff ) {
-				if ( Mp4Info.m_AuxDataSize >> 32 ) throw A2MERR_AUXDATA_TOO_BIG;
-				if ( !OutFile.Write32( static_cast<IMF_UINT32>( Mp4Info.m_AuxDataSize ) ) ) throw A2MERR_WRITE_AUXDATA;
-				CCopyData	CopyData( Mp4Info.m_pOriginalFile, Mp4Info.m_AuxDataOffset, Mp4Info.m_AuxDataSize );
-				while( CopyData.Read( CopySize ) ) if ( OutFile.Write( CopyData, CopySize ) != CopySize ) throw A2MERR_WRITE_AUXDATA;
-			} else {
-				if ( !OutFile.Write32( AlsHeader.m_AuxSize ) ) throw A2MERR_WRITE_AUXDATA;
-				if ( OutFile.Write( AlsHeader.m_pAuxData, AlsHeader.m_AuxSize ) != AlsHeader.m_AuxSize ) throw A2MERR_WRITE_AUXDATA;
-			}
-		}
+		WriteAlsHeader( Reader, pConfigData, &AlsHeader, Mp4Info, OutFile );
 
 		// Allocate buffer for RAU.
 		MaxRauSize = Reader.GetMaxFrameSize();
@@ -1092,4 +1156,362 @@ bool	CCopyData::Read( IMF_UINT32& Size )
 	return ( Size > 0 );
 }
 
+//////////////////////////////////////////////////////////////////////
+//                                                                  //
+//                         CMp4aMuxer class                         //
+//                                                                  //
+//////////////////////////////////////////////////////////////////////
+
+////////////////////////////////////////
+//                                    //
+//            Constructor             //
+//                                    //
+////////////////////////////////////////
+// Mp4Info = Reference to MP4 information (must outlive the object)
+CMp4aMuxer::CMp4aMuxer( MP4INFO& Mp4Info ) : m_Mp4Info( Mp4Info ), m_Opened( false ), m_LastError( A2MERR_NONE )
+{
+	memset( &m_AlsHeader, 0, sizeof(m_AlsHeader) );
+}
+
+////////////////////////////////////////
+//                                    //
+//        Create MP4 file             //
+//                                    //
+////////////////////////////////////////
+// pHeader = ALS header image (CRC and RAU sizes may not be final yet)
+// HeaderSize = Number of bytes in pHeader
+// Return value = true:Success / false:Error
+bool	CMp4aMuxer::BeginStream( const void* pHeader, ALS_UINT32 HeaderSize )
+{
+	CMemoryStream	Header;
+	IMF_UINT64		MaxDataSize;
+	bool			Use64bit;
+	IMF_UINT32		CopySize;
+
+	try {
+		// Read ALS header information.
+		if ( !Header.Open( pHeader, HeaderSize ) ) throw A2MERR_NO_MEMORY;
+		ReadAlsHeaderFromStream( Header, &m_AlsHeader, m_Mp4Info );
+
+		// Create MP4 file.
+		if ( !m_OutFile.Open( m_Mp4Info.m_pOutFile ) ) throw A2MERR_CREATE_FILE;
+
+		// Open MP4 writer. The encoded size is not known yet, so the PCM size with some headroom
+		// for incompressible frames decides whether 64-bit offsets are needed.
+		MaxDataSize = m_AlsHeader.m_Samples * m_AlsHeader.m_Chan * ( m_AlsHeader.m_Res / 8 );
+		MaxDataSize += ( m_AlsHeader.m_SampleType ? MaxDataSize : ( MaxDataSize >> 3 ) ) + HeaderSize;
+		Use64bit = ( m_Mp4Info.m_HeaderSize + m_Mp4Info.m_TrailerSize + MaxDataSize > 0xffffffff );
+		m_Writer.SetAudioProfileLevelIndication( m_Mp4Info.m_audioProfileLevelIndication );
+		if ( m_Mp4Info.m_FastStart ) m_Writer.ReserveMoov( m_AlsHeader.m_RAUnits );
+		if ( m_Mp4Info.m_FragmentRaus > 0 ) m_Writer.SetFragment( m_Mp4Info.m_FragmentRaus );
+		if ( !m_Writer.Open( m_OutFile, m_AlsHeader.m_Freq, m_AlsHeader.m_Chan, m_AlsHeader.m_Res, m_Mp4Info.m_FileType, m_AlsHeader.m_pALSSpecificConfig, m_AlsHeader.m_ALSSpecificConfigSize, Use64bit, m_Mp4Info.m_UseMeta ) ) throw A2MERR_INIT_MP4WRITER;
+		m_Opened = true;
+
+		// Write header data.
+		if ( m_Mp4Info.m_HeaderSize > 0 ) {
+			CCopyData	CopyData( m_Mp4Info.m_pOriginalFile, 0, m_Mp4Info.m_HeaderSize );
+			while( CopyData.Read( CopySize ) ) if ( !m_Writer.WriteHeader( CopyData, CopySize ) ) throw A2MERR_WRITE_HEADER;
+		}
+	}
+	catch( A2MERR e ) {
+		m_LastError = e;
+		return false;
+	}
+	return true;
+}
+
+////////////////////////////////////////
+//                                    //
+//      Write a part of an RAU        //
+//                                    //
+////////////////////////////////////////
+// pData = Leading frames of the RAU
+// Size = Number of bytes in pData
+// Return value = true:Success / false:Error
+bool	CMp4aMuxer::WriteRauPart( const void* pData, ALS_UINT32 Size )
+{
+	if ( !m_Writer.WriteFramePart( pData, Size ) ) {
+		m_LastError = A2MERR_WRITE_FRAME;
+		return false;
+	}
+	return true;
+}
+
+////////////////////////////////////////
+//                                    //
+//           Write an RAU             //
+//                                    //
+////////////////////////////////////////
+// pRau = (Rest of) frames of the RAU
+// RauSize = Number of bytes in pRau
+// Samples = Number of samples in the RAU
+// Return value = true:Success / false:Error
+bool	CMp4aMuxer::WriteRau( const void* pRau, ALS_UINT32 RauSize, ALS_UINT32 Samples )
+{
+	if ( !m_Writer.WriteFramePart( pRau, RauSize ) || !m_Writer.EndFrame( Samples, true ) ) {
+		m_LastError = ( m_Writer.GetLastError() == E_MP4A_FRAME_PART ) ? A2MERR_RAU_TOO_BIG : A2MERR_WRITE_FRAME;
+		return false;
+	}
+	return true;
+}
+
+////////////////////////////////////////
+//                                    //
+//    Complete ALSSpecificConfig      //
+//                                    //
+////////////////////////////////////////
+// pHeader = Final ALS header image
+// HeaderSize = Number of bytes in pHeader
+// Return value = true:Success / false:Error
+bool	CMp4aMuxer::EndStream( const void* pHeader, ALS_UINT32 HeaderSize )
+{
+	CMemoryStream	Header;
+	IMF_UINT32		CopySize;
+
+	try {
+		// Rebuild ALSSpecificConfig with the final CRC and trailer.
+		if ( !Header.Open( pHeader, HeaderSize ) ) throw A2MERR_NO_MEMORY;
+		ClearAlsHeader( &m_AlsHeader );
+		ReadAlsHeaderFromStream( Header, &m_AlsHeader, m_Mp4Info );
+		if ( !m_Writer.SetDecSpecInfo( m_AlsHeader.m_pALSSpecificConfig, m_AlsHeader.m_ALSSpecificConfigSize ) ) throw A2MERR_NO_MEMORY;
+
+		// Write trailer data.
+		if ( m_Mp4Info.m_TrailerSize > 0 ) {
+			CCopyData	CopyData( m_Mp4Info.m_pOriginalFile, -static_cast<IMF_INT64>( m_Mp4Info.m_TrailerSize ), m_Mp4Info.m_TrailerSize );
+			while( CopyData.Read( CopySize ) ) if ( !m_Writer.WriteTrailer( CopyData, CopySize ) ) throw A2MERR_WRITE_TRAILER;
+		}
+
+		// Write auxiliary data.
+		if ( m_AlsHeader.m_AuxSize > 0 ) {
+			if ( !m_Writer.WriteAuxData( m_AlsHeader.m_pAuxData, m_AlsHeader.m_AuxSize ) ) throw A2MERR_WRITE_AUXDATA;
+		}
+	}
+	catch( A2MERR e ) {
+		m_LastError = e;
+		return false;
+	}
+	return true;
+}
+
+////////////////////////////////////////
+//                                    //
+//         Complete MP4 file          //
+//                                    //
+////////////////////////////////////////
+// Return value = Error code
+// * m_Mp4Info.m_audioProfileLevelIndication may be updated until this call.
+A2MERR	CMp4aMuxer::Close( void )
+{
+	if ( m_Opened ) {
+		m_Writer.SetAudioProfileLevelIndication( m_Mp4Info.m_audioProfileLevelIndication );
+		if ( !m_Writer.Close() && ( m_LastError == A2MERR_NONE ) ) m_LastError = A2MERR_WRITE_MOOV;
+		m_Opened = false;
+	}
+	m_OutFile.Close();
+	ClearAlsHeader( &m_AlsHeader );
+	return m_LastError;
+}
+
+//////////////////////////////////////////////////////////////////////
+//                                                                  //
+//                       CMp4aAlsStream class                       //
+//                                                                  //
+//////////////////////////////////////////////////////////////////////
+
+////////////////////////////////////////
+//                                    //
+//            Constructor             //
+//                                    //
+////////////////////////////////////////
+CMp4aAlsStream::CMp4aAlsStream( void )
+{
+	m_InsertRauSize = false;
+	m_pRauBuf = NULL;
+	m_RauBufSize = 0;
+	m_RauIndex = 0xffffffff;
+	m_Pos = 0;
+}
+
+////////////////////////////////////////
+//                                    //
+//           Open MP4 file            //
+//                                    //
+////////////////////////////////////////
+// Mp4Info = Reference to MP4 information (m_pInFile, m_RMflag and m_RaLocation are used)
+// Return value = Error code
+A2MERR	CMp4aAlsStream::Open( MP4INFO& Mp4Info )
+{
+	A2MERR		ErrCode = A2MERR_NONE;
+	ALS_HEADER	AlsHeader;
+	IMF_UINT8*	pConfigData;
+	IMF_INT64	Offset;
+	IMF_UINT32	i;
+	CMp4aReader::CFrameInfo	FrameInfo;
+
+	// Initialize ALS_HEADER structure.
+	memset( &AlsHeader, 0, sizeof(AlsHeader) );
+
+	Mp4Info.m_audioProfileLevelIndication = MP4_AUDIO_PROFILE_UNSPECIFIED;
+
+	try {
+		// Open MP4 file and MP4A reader.
+		if ( !m_InFile.Open( Mp4Info.m_pInFile ) ) throw A2MERR_OPEN_FILE;
+		if ( !m_Reader.Open( m_InFile ) ) throw A2MERR_INIT_MP4READER;
+
+		// Build ALS header image.
+		pConfigData = ReadMp4aConfig( m_Reader, &AlsHeader, Mp4Info );
+		if ( !m_Header.Open() ) throw A2MERR_NO_MEMORY;
+		WriteAlsHeader( m_Reader, pConfigData, &AlsHeader, Mp4Info, m_Header );
+		m_InsertRauSize = ( AlsHeader.m_RA != 0 ) && ( AlsHeader.m_RAflag == 0 ) && ( Mp4Info.m_RaLocation == 0 );
+
+		// Lay out the RAUs behind the header.
+		m_RauOffset.resize( m_Reader.GetFrameCount() + 1 );
+		Offset = m_Header.GetSize();
+		for( i=0; i<m_Reader.GetFrameCount(); i++ ) {
+			if ( !m_Reader.GetFrameInfo( i, FrameInfo ) ) throw A2MERR_NO_FRAMEINFO;
+			m_RauOffset[i] = Offset;
+			Offset += FrameInfo.m_EncSize + ( m_InsertRauSize ? sizeof(IMF_UINT32) : 0 );
+		}
+		m_RauOffset[i] = Offset;
+
+		// Allocate buffer for RAU.
+		m_RauBufSize = m_Reader.GetMaxFrameSize();
+		if ( m_RauBufSize == 0 ) throw A2MERR_MAX_SIZE;
+		if ( m_InsertRauSize ) m_RauBufSize += sizeof(IMF_UINT32);
+		m_pRauBuf = new IMF_UINT8 [ m_RauBufSize ];
+		if ( m_pRauBuf == NULL ) throw A2MERR_NO_MEMORY;
+
+		m_RauIndex = 0xffffffff;
+		m_Pos = 0;
+	}
+	catch( A2MERR e ) {
+		ErrCode = e;
+		Close();
+	}
+
+	ClearAlsHeader( &AlsHeader );
+	return ErrCode;
+}
+
+////////////////////////////////////////
+//                                    //
+//               Close                //
+//                                    //
+////////////////////////////////////////
+// Return value = true:Success / false:Error
+bool	CMp4aAlsStream::Close( void )
+{
+	m_Reader.Close();
+	m_InFile.Close();
+	m_Header.Close();
+	m_RauOffset.clear();
+	if ( m_pRauBuf ) delete[] m_pRauBuf;
+	m_pRauBuf = NULL;
+	m_RauBufSize = 0;
+	m_RauIndex = 0xffffffff;
+	m_Pos = 0;
+	return true;
+}
+
+////////////////////////////////////////
+//                                    //
+//                Read                //
+//                                    //
+////////////////////////////////////////
+// pBuffer = Buffer to store read data
+// Size = Number of bytes to read
+// Return value = Actual read byte count
+IMF_UINT32	CMp4aAlsStream::Read( void* pBuffer, IMF_UINT32 Size )
+{
+	IMF_UINT8*	pDst = static_cast<IMF_UINT8*>( pBuffer );
+	IMF_INT64	HeaderSize = m_Header.GetSize();
+	IMF_UINT32	Total = 0;
+	IMF_UINT32	Count;
+	IMF_UINT32	Index;
+	IMF_INT64	Avail;
+
+	// Make sure that the stream is opened.
+	if ( m_pRauBuf == NULL ) {
+		SetLastError( E_NOT_OPENED );
+		return 0;
+	}
+
+	while( ( Size > 0 ) && ( m_Pos < m_RauOffset.back() ) ) {
+		if ( m_Pos < HeaderSize ) {
+			// Inside ALS header.
+			Avail = HeaderSize - m_Pos;
+			Count = ( Size < Avail ) ? Size : static_cast<IMF_UINT32>( Avail );
+			memcpy( pDst, m_Header.GetBuffer() + m_Pos, Count );
+		} else {
+			// Load the RAU which contains m_Pos, unless it is the current one.
+			Index = m_RauIndex;
+			if ( ( Index == 0xffffffff ) || ( m_Pos < m_RauOffset[Index] ) || ( m_Pos >= m_RauOffset[Index+1] ) ) {
+				Index = static_cast<IMF_UINT32>( upper_bound( m_RauOffset.begin(), m_RauOffset.end(), m_Pos ) - m_RauOffset.begin() ) - 1;
+				if ( !LoadRau( Index ) ) break;
+			}
+			Avail = m_RauOffset[Index+1] - m_Pos;
+			Count = ( Size < Avail ) ? Size : static_cast<IMF_UINT32>( Avail );
+			memcpy( pDst, m_pRauBuf + ( m_Pos - m_RauOffset[Index] ), Count );
+		}
+		pDst += Count;
+		m_Pos += Count;
+		Size -= Count;
+		Total += Count;
+	}
+	return Total;
+}
+
+////////////////////////////////////////
+//                                    //
+//                Seek                //
+//                                    //
+////////////////////////////////////////
+// Offset = Offset
+// Origin = Starting point
+// Return value = true:Success / false:Error
+bool	CMp4aAlsStream::Seek( IMF_INT64 Offset, SEEK_ORIGIN Origin )
+{
+	// Make sure that the stream is opened.
+	if ( m_pRauBuf == NULL ) {
+		SetLastError( E_NOT_OPENED );
+		return false;
+	}
+
+	if ( Origin == S_CURRENT ) Offset += m_Pos;
+	else if ( Origin == S_END ) Offset += m_RauOffset.back();
+	if ( Offset < 0 ) {
+		SetLastError( E_SEEK_STREAM );
+		return false;
+	}
+	m_Pos = Offset;
+	return true;
+}
+
+////////////////////////////////////////
+//                                    //
+//            Load an RAU             //
+//                                    //
+////////////////////////////////////////
+// Index = RAU index
+// Return value = true:Success / false:Error
+bool	CMp4aAlsStream::LoadRau( IMF_UINT32 Index )
+{
+	IMF_UINT8*	p = m_pRauBuf;
+	IMF_UINT32	Size = static_cast<IMF_UINT32>( m_RauOffset[Index+1] - m_RauOffset[Index] );
+
+	m_RauIndex = 0xffffffff;
+	if ( m_InsertRauSize ) {
+		// RAU size should be inserted here.
+		Size -= sizeof(IMF_UINT32);
+		Set32( p, Size );
+		p += sizeof(IMF_UINT32);
+	}
+	if ( m_Reader.ReadFrame( Index, p, Size ) != Size ) {
+		SetLastError( E_READ_STREAM );
+		return false;
+	}
+	m_RauIndex = Index;
+	return true;
+}
+
 // End of als2mp4.cpp
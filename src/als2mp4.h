@@ -47,8 +47,13 @@
 #if !defined( ALS2MP4_INCLUDED )
 #define	ALS2MP4_INCLUDED
 
+#include	<vector>
 #include	"ImfType.h"
 #include	"ImfStream.h"
+#include	"ImfFileStream.h"
+#include	"ImfMemoryStream.h"
+#include	"Mp4aFile.h"
+#include	"stream.h"
 
 //////////////////////////////////////////////////////////////////////
 //                       ALS_HEADER structure                       //
@@ -150,6 +155,8 @@ typedef	struct tagMP4INFO {
 	std::string			m_FileTypeName;		// MIME type
 	bool				m_RMflag;			// true:Used in mp4alsRM / false:Used in als2mp4
 	bool				m_UseMeta;			// true:Use meta box / false:Do not use meta box
+	bool				m_FastStart;		// true:Place moov box before mdat box / false:Place moov box after mdat box
+	NAlsImf::IMF_UINT32	m_FragmentRaus;		// Number of RAUs per movie fragment (0:Not fragmented)
 	NAlsImf::IMF_UINT8	m_audioProfileLevelIndication;
 } MP4INFO;
 
@@ -184,6 +191,60 @@ protected:
 	static	const NAlsImf::IMF_UINT32	FILECOPY_BUFFER_SIZE;
 };
 
+//////////////////////////////////////////////////////////////////////
+//                         CMp4aMuxer class                         //
+//////////////////////////////////////////////////////////////////////
+// Writes the RAUs of an encoder straight into an MP4 file.
+class	CMp4aMuxer : public CAlsRauSink {
+public:
+	CMp4aMuxer( MP4INFO& Mp4Info );
+	virtual	~CMp4aMuxer( void ) { Close(); }
+	bool	BeginStream( const void* pHeader, ALS_UINT32 HeaderSize );
+	bool	WriteRauPart( const void* pData, ALS_UINT32 Size );
+	bool	WriteRau( const void* pRau, ALS_UINT32 RauSize, ALS_UINT32 Samples );
+	bool	EndStream( const void* pHeader, ALS_UINT32 HeaderSize );
+	A2MERR	Close( void );
+	A2MERR	GetLastError( void ) const { return m_LastError; }
+protected:
+	MP4INFO&				m_Mp4Info;
+	NAlsImf::CFileWriter	m_OutFile;
+	NAlsImf::CMp4aWriter	m_Writer;
+	ALS_HEADER				m_AlsHeader;
+	bool					m_Opened;
+	A2MERR					m_LastError;
+};
+
+//////////////////////////////////////////////////////////////////////
+//                       CMp4aAlsStream class                       //
+//////////////////////////////////////////////////////////////////////
+// Read-only ALS bitstream view of an MP4 file. The ALS header is built
+// in memory and the RAUs are read from the MP4 file when they are
+// accessed, so that the decoder needs no intermediate ALS file.
+class	CMp4aAlsStream : public NAlsImf::CBaseStream {
+public:
+	CMp4aAlsStream( void );
+	virtual	~CMp4aAlsStream( void ) { Close(); }
+	NAlsImf::IMF_UINT32	Read( void* pBuffer, NAlsImf::IMF_UINT32 Size );
+	NAlsImf::IMF_UINT32	Write( const void* pBuffer, NAlsImf::IMF_UINT32 Size ) { SetLastError( NAlsImf::E_READONLY ); return 0; }
+	NAlsImf::IMF_INT64	Tell( void ) { return m_Pos; }
+	bool				Seek( NAlsImf::IMF_INT64 Offset, SEEK_ORIGIN Origin );
+	A2MERR				Open( MP4INFO& Mp4Info );
+	bool				Close( void );
+	const std::vector<NAlsImf::IMF_INT64>&	GetRauOffsets( void ) const { return m_RauOffset; }
+protected:
+	bool				LoadRau( NAlsImf::IMF_UINT32 Index );
+protected:
+	NAlsImf::CFileReader		m_InFile;
+	NAlsImf::CMp4aReader		m_Reader;
+	NAlsImf::CMemoryStream		m_Header;			// ALS header image
+	std::vector<NAlsImf::IMF_INT64>	m_RauOffset;	// Position of each RAU in the ALS bitstream (RAU count + 1 entries)
+	bool						m_InsertRauSize;	// true:RAU size is put in front of each RAU
+	NAlsImf::IMF_UINT8*			m_pRauBuf;			// Current RAU (with RAU size, if inserted)
+	NAlsImf::IMF_UINT32			m_RauBufSize;		// Size of m_pRauBuf in bytes
+	NAlsImf::IMF_UINT32			m_RauIndex;			// Index of the RAU in m_pRauBuf (0xffffffff: none)
+	NAlsImf::IMF_INT64			m_Pos;				// Current position
+};
+
 #endif	// ALS2MP4_INCLUDED
 
 // End of als2mp4.h
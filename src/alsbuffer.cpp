@@ -0,0 +1,247 @@
+/***************** MPEG-4 Audio Lossless Coding **************************
+
+This software module was originally developed by
+
+NTT (Nippon Telegraph and Telephone Corporation), Japan
+
+in the course of development of the MPEG-4 Audio standard ISO/IEC 14496-3
+and associated amendments. This software module is an implementation of
+a part of one or more MPEG-4 Audio lossless coding tools as specified
+by the MPEG-4 Audio standard. ISO/IEC gives users of the MPEG-4 Audio
+standards free license to this software module or modifications
+thereof for use in hardware or software products claiming conformance
+to the MPEG-4 Audio standards. Those intending to use this software
+module in hardware or software products are advised that this use may
+infringe existing patents. The original developer of this software
+module, the subsequent editors and their companies, and ISO/IEC have
+no liability for use of this software module or modifications thereof
+in an implementation. Copyright is not released for non MPEG-4 Audio
+conforming products. The original developer retains full right to use
+the code for the developer's own purpose, assign or donate the code to
+a third party and to inhibit third party from using the code for non
+MPEG-4 Audio conforming products. This copyright notice must be included
+in all copies or derivative works.
+
+Copyright (c) 2007.
+
+filename : alsbuffer.cpp
+project  : MPEG-4 Audio Lossless Coding
+contents : Encoding and decoding of data in memory
+
+*************************************************************************/
+
+#include	"alsbuffer.h"
+#include	"encoder.h"
+#include	"decoder.h"
+
+////////////////////////////////////////
+//                                    //
+//   Initialize ALS_ENCODEOPTIONS     //
+//                                    //
+////////////////////////////////////////
+// pOptions = Pointer to structure which receives the default options
+// * The defaults are the same as those of the command line without options.
+void	InitEncodeOptions( ALS_ENCODEOPTIONS* pOptions )
+{
+	pOptions->FrameLength = 0;
+	pOptions->Order = -1;
+	pOptions->Adapt = 0;
+	pOptions->Joint = 0;
+	pOptions->LSBcheck = 0;
+	pOptions->RA = 0;
+	pOptions->RAmode = 0;
+	pOptions->BGMC = 0;
+	pOptions->MCC = 0;
+	pOptions->PITCH = 0;
+	pOptions->Sub = 0;
+	pOptions->CRC = 1;
+	pOptions->HEMode = 0;
+	pOptions->AcfMode = 1;
+	pOptions->AcfGain = 0.f;
+	pOptions->MlzMode = 1;
+}
+
+////////////////////////////////////////
+//                                    //
+//        Set encoder options         //
+//                                    //
+////////////////////////////////////////
+// Encoder = Encoder to set up
+// pOptions = Encoder options
+// Return value = true:Success / false:Invalid combination of options
+bool	SetEncodeOptions( CLpacEncoder& Encoder, const ALS_ENCODEOPTIONS* pOptions )
+{
+	long	Mcc;
+
+	Encoder.SetAdapt( pOptions->Adapt );
+	Encoder.SetJoint( pOptions->Joint );
+	Encoder.SetLSBcheck( pOptions->LSBcheck );
+	Encoder.SetFrameLength( pOptions->FrameLength );
+	Encoder.SetOrder( pOptions->Order );
+	if ( pOptions->Order == 0 ) Encoder.SetAdapt( 0 );	// force fixed order
+	Encoder.SetRA( pOptions->RA );
+	Encoder.SetRAmode( pOptions->RAmode );
+	Encoder.SetBGMC( pOptions->BGMC );
+	Mcc = Encoder.SetMCC( pOptions->MCC );
+	Encoder.SetPITCH( pOptions->PITCH );
+	Encoder.SetSub( pOptions->Sub );
+	Encoder.SetCRC( pOptions->CRC );
+	Encoder.SetAcf( pOptions->AcfMode, pOptions->AcfGain );
+	Encoder.SetMlz( pOptions->MlzMode );
+
+	// RLS-LMS cannot be used together with MCC or block switching.
+	return !Encoder.SetHEMode( pOptions->HEMode ) || ( ( Mcc == 0 ) && ( pOptions->Sub == 0 ) );
+}
+
+////////////////////////////////////////
+//                                    //
+//     Clear MP4INFO for ALS streams  //
+//                                    //
+////////////////////////////////////////
+// Mp4Info = Structure to clear
+void	ClearMp4Info( MP4INFO& Mp4Info )
+{
+	Mp4Info.m_StripRaInfo = false;
+	Mp4Info.m_RaLocation = 0;
+	Mp4Info.m_pInFile = Mp4Info.m_pOutFile = Mp4Info.m_pOriginalFile = NULL;
+	Mp4Info.m_Samples = 0;
+	Mp4Info.m_HeaderSize = Mp4Info.m_TrailerSize = Mp4Info.m_AuxDataSize = 0;
+	Mp4Info.m_HeaderOffset = Mp4Info.m_TrailerOffset = Mp4Info.m_AuxDataOffset = 0;
+	Mp4Info.m_FileType = 0;
+	Mp4Info.m_FileTypeName.erase();
+	Mp4Info.m_RMflag = false;
+	Mp4Info.m_UseMeta = false;
+	Mp4Info.m_FastStart = false;
+	Mp4Info.m_FragmentRaus = 0;
+	Mp4Info.m_audioProfileLevelIndication = 0;
+}
+
+////////////////////////////////////////
+//                                    //
+//        Encode data in memory       //
+//                                    //
+////////////////////////////////////////
+// pInput = Audio data to encode
+// InputSize = Number of bytes in pInput
+// pFormat = Format of raw PCM data in pInput (NULL:pInput is an audio file image, e.g. WAVE or AIFF)
+// pOptions = Encoder options (NULL:Default options)
+// Output = Vector which receives the ALS bitstream
+// Return value = 0:Success / -1:Unsupported format or options / -2:Encoding error / other negative values:Encoder errors
+short	EncodeBuffer( const void* pInput, ALS_UINT32 InputSize, const ALS_PCMFORMAT* pFormat, const ALS_ENCODEOPTIONS* pOptions, std::vector<unsigned char>& Output )
+{
+	CLpacEncoder		Encoder;
+	ALS_ENCODEOPTIONS	Default;
+	AUDIOINFO			Info;
+	HALSSTREAM			hInput = NULL;
+	HALSSTREAM			hOutput = NULL;
+	const unsigned char*	pData;
+	ALS_UINT32			Size;
+	short				Result = 0;
+
+	Output.clear();
+	if ( pOptions == NULL ) {
+		InitEncodeOptions( &Default );
+		pOptions = &Default;
+	}
+
+	try {
+		// Open memory streams. The output buffer starts at half of the input size.
+		if ( OpenMemoryReader( pInput, InputSize, &hInput ) ) throw -1;
+		if ( OpenMemoryWriter( &hOutput, NULL, InputSize / 2 ) ) throw -7;
+		Encoder.SetInputFile( hInput );
+
+		// Raw PCM data
+		if ( pFormat != NULL ) {
+			Encoder.SetRawAudio( 1 );
+			Encoder.SetChannels( pFormat->Channels );
+			Encoder.SetSampleType( pFormat->SampleType );
+			Encoder.SetWordlength( pFormat->Wordlength );
+			Encoder.SetFrequency( pFormat->Frequency );
+			Encoder.SetMSBfirst( pFormat->MSBfirst ? 1 : 0 );
+			Encoder.SetHeaderSize( 0 );
+			Encoder.SetTrailerSize( 0 );
+		}
+		if ( Encoder.AnalyseInputFile( &Info ) ) throw -1;
+
+		if ( !SetEncodeOptions( Encoder, pOptions ) ) throw -1;
+
+		// Encode.
+		Encoder.SetOutputFile( hOutput, false, false );
+		if ( ( Result = Encoder.EncodeAll() ) != 0 ) throw static_cast<int>( Result );
+		Encoder.CloseFiles();
+
+		// Hand over the bitstream.
+		pData = reinterpret_cast<const unsigned char*>( GetMemoryData( hOutput, &Size ) );
+		if ( pData == NULL ) throw -2;
+		Output.assign( pData, pData + Size );
+	}
+	catch( int e ) {
+		Encoder.CloseFiles();
+		Output.clear();
+		Result = static_cast<short>( e );
+	}
+	if ( hOutput != NULL ) fclose( hOutput );
+	if ( hInput != NULL ) fclose( hInput );
+	return Result;
+}
+
+////////////////////////////////////////
+//                                    //
+//        Decode data in memory       //
+//                                    //
+////////////////////////////////////////
+// pInput = ALS bitstream
+// InputSize = Number of bytes in pInput
+// Output = Vector which receives the decoded data
+// pInfo = Pointer to structure which receives the audio format (NULL:Not required)
+// Return value = 0:Success / 1:CRC error / -1:Unsupported bitstream / -2:Decoding error
+// * Output is the original input of the encoder, i.e. raw PCM data for bitstreams
+//   made from raw PCM, or the complete file image (with header and trailer) otherwise.
+short	DecodeBuffer( const void* pInput, ALS_UINT32 InputSize, std::vector<unsigned char>& Output, AUDIOINFO* pInfo )
+{
+	CLpacDecoder	Decoder;
+	AUDIOINFO		Info;
+	ENCINFO			EncInfo;
+	MP4INFO			Mp4Info;
+	HALSSTREAM		hInput = NULL;
+	HALSSTREAM		hOutput = NULL;
+	ALS_INT64		Bytes;
+	ALS_UINT32		Size;
+	short			Result = 0;
+
+	Output.clear();
+
+	ClearMp4Info( Mp4Info );		// Not used for ALS bitstreams
+
+	try {
+		if ( OpenMemoryReader( pInput, InputSize, &hInput ) ) throw -1;
+		Decoder.SetInputStream( hInput, false );
+		if ( Decoder.AnalyseInputFile( &Info, &EncInfo, Mp4Info ) ) throw -1;
+		if ( pInfo != NULL ) *pInfo = Info;
+
+		// The decoded size is known from the header, so decode straight into Output.
+		Bytes = Info.HeaderSize + Info.Samples * Info.Chan * ( Info.Res / 8 ) + Info.TrailerSize;
+		if ( ( Info.Samples <= 0 ) || ( Bytes > 0xffffffff ) ) throw -1;
+		Output.resize( static_cast<size_t>( Bytes ) );
+		if ( OpenMemoryWriter( &hOutput, &Output[0], static_cast<ALS_UINT32>( Bytes ) ) ) throw -2;
+		Decoder.SetOutputStream( hOutput );
+
+		Result = Decoder.DecodeAll( Mp4Info );
+		if ( Result < 0 ) throw -2;
+		Decoder.CloseFiles();
+
+		// Drop what has not been written.
+		if ( GetMemoryData( hOutput, &Size ) == NULL ) throw -2;
+		Output.resize( Size );
+	}
+	catch( int e ) {
+		Decoder.CloseFiles();
+		Output.clear();
+		Result = static_cast<short>( e );
+	}
+	if ( hOutput != NULL ) fclose( hOutput );
+	if ( hInput != NULL ) fclose( hInput );
+	return Result;
+}
+
+// End of alsbuffer.cpp
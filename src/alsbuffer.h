@@ -0,0 +1,56 @@
+/***************** MPEG-4 Audio Lossless Coding **************************
+
+This software module was originally developed by
+
+NTT (Nippon Telegraph and Telephone Corporation), Japan
+
+in the course of development of the MPEG-4 Audio standard ISO/IEC 14496-3
+and associated amendments. This software module is an implementation of
+a part of one or more MPEG-4 Audio lossless coding tools as specified
+by the MPEG-4 Audio standard. ISO/IEC gives users of the MPEG-4 Audio
+standards free license to this software module or modifications
+thereof for use in hardware or software products claiming conformance
+to the MPEG-4 Audio standards. Those intending to use this software
+module in hardware or software products are advised that this use may
+infringe existing patents. The original developer of this software
+module, the subsequent editors and their companies, and ISO/IEC have
+no liability for use of this software module or modifications thereof
+in an implementation. Copyright is not released for non MPEG-4 Audio
+conforming products. The original developer retains full right to use
+the code for the developer's own purpose, assign or donate the code to
+a third party and to inhibit third party from using the code for non
+MPEG-4 Audio conforming products. This copyright notice must be included
+in all copies or derivative works.
+
+Copyright (c) 2007.
+
+filename : alsbuffer.h
+project  : MPEG-4 Audio Lossless Coding
+contents : Header file for alsbuffer.cpp
+
+*************************************************************************/
+
+#if !defined( ALSBUFFER_INCLUDED )
+#define	ALSBUFFER_INCLUDED
+
+#include	<vector>
+#include	"wave.h"
+#include	"libmp4als.h"
+#include	"als2mp4.h"
+
+class	CLpacEncoder;
+
+//////////////////////////////////////////////////////////////////////
+//                                                                  //
+//                      Prototype declaration                       //
+//                                                                  //
+//////////////////////////////////////////////////////////////////////
+void	InitEncodeOptions( ALS_ENCODEOPTIONS* pOptions );
+bool	SetEncodeOptions( CLpacEncoder& Encoder, const ALS_ENCODEOPTIONS* pOptions );
+void	ClearMp4Info( MP4INFO& Mp4Info );
+short	EncodeBuffer( const void* pInput, ALS_UINT32 InputSize, const ALS_PCMFORMAT* pFormat, const ALS_ENCODEOPTIONS* pOptions, std::vector<unsigned char>& Output );
+short	DecodeBuffer( const void* pInput, ALS_UINT32 InputSize, std::vector<unsigned char>& Output, AUDIOINFO* pInfo = NULL );
+
+#endif	// ALSBUFFER_INCLUDED
+
+// End of alsbuffer.h
@@ -79,9 +79,205 @@ contents : Audio data I/O
 //   added after reading.
 
 #include <stdio.h>
+#include <string.h>
 #include <math.h>
 #include "floating.h"
 #include "stream.h"
+#include "audiorw.h"
+
+// SIMD kernels for 1, 2, 6 and 8 channels (SSSE3 on x86 with GCC/clang)
+// - Groups of 4 samples per channel are converted with one byte shuffle per
+//   vector, which also takes care of the byte order, and transposed in registers.
+// - They return the number of samples per channel done, the generic loops
+//   below do the rest.
+// - Define ALS_NO_SSSE3 to use the generic loops only.
+#if defined(__GNUC__) && (defined(__i386__) || defined(__x86_64__)) && !defined(ALS_NO_SSSE3)
+#define AUDIORW_SSSE3
+#include <cpuid.h>
+#include <tmmintrin.h>
+
+// Check for SSSE3 support
+static bool DetectSSSE3()
+{
+	unsigned int eax, ebx, ecx, edx;
+
+	if (!__get_cpuid(1, &eax, &ebx, &ecx, &edx))
+		return(false);
+	return((ecx & bit_SSSE3) && (edx & bit_SSE2));
+}
+
+static const bool SSSE3available = DetectSSSE3();
+
+// Shuffle mask between 4 samples of "bytes" bytes each and 4 ints
+// read = true : sample bytes go to the upper bytes of the ints (sign extension by shifting)
+// read = false: the lower bytes of the ints go to the samples
+__attribute__((target("ssse3")))
+static __m128i PcmShuffleMask(short bytes, short msbfirst, bool read)
+{
+	char mask[16];
+	short i, s;
+
+	memset(mask, 0x80, sizeof(mask));
+	for (i = 0; i < 4; i++)
+	{
+		for (s = 0; s < bytes; s++)		// s = significance of the byte (0 = LSByte)
+		{
+			short pcm = i * bytes + (msbfirst ? bytes - 1 - s : s);
+			if (read)
+				mask[4 * i + 4 - bytes + s] = static_cast<char>(pcm);
+			else
+				mask[pcm] = static_cast<char>(4 * i + s);
+		}
+	}
+	return(_mm_loadu_si128((const __m128i *)mask));
+}
+
+// Transpose 4x4 ints
+__attribute__((target("ssse3")))
+static inline void Transpose4(__m128i &a, __m128i &b, __m128i &c, __m128i &d)
+{
+	__m128i t0 = _mm_unpacklo_epi32(a, b), t1 = _mm_unpacklo_epi32(c, d);
+	__m128i t2 = _mm_unpackhi_epi32(a, b), t3 = _mm_unpackhi_epi32(c, d);
+
+	a = _mm_unpacklo_epi64(t0, t1);
+	b = _mm_unpackhi_epi64(t0, t1);
+	c = _mm_unpacklo_epi64(t2, t3);
+	d = _mm_unpackhi_epi64(t2, t3);
+}
+
+// [a0 b0 a1 b1] [a2 b2 a3 b3] -> [a0 a1 a2 a3] [b0 b1 b2 b3]
+__attribute__((target("ssse3")))
+static inline void Deinterleave2(__m128i &v0, __m128i &v1)
+{
+	__m128i s0 = _mm_shuffle_epi32(v0, _MM_SHUFFLE(3, 1, 2, 0));
+	__m128i s1 = _mm_shuffle_epi32(v1, _MM_SHUFFLE(3, 1, 2, 0));
+
+	v0 = _mm_unpacklo_epi64(s0, s1);
+	v1 = _mm_unpackhi_epi64(s0, s1);
+}
+
+// Interleaved bytes -> x[m][n] (v[k] = interleaved samples 4k...4k+3 of a group)
+__attribute__((target("ssse3")))
+static long ReadPcmSSSE3(int **x, long M, long N, short bytes, short msbfirst, const unsigned char *b)
+{
+	const __m128i mask = PcmShuffleMask(bytes, msbfirst, true);
+	const __m128i shift = _mm_cvtsi32_si128(32 - 8 * bytes);
+	const __m128i offset = _mm_set1_epi32((bytes == 1) ? 0x80000000 : 0);	// 8-bit: [0;255] -> [-128;127]
+	const long total = N * M * bytes;
+	__m128i v[8];
+	long n, k;
+
+	// The last load of a group reads 16 bytes, which must be inside b.
+	for (n = 0; (n * M + 4 * (M - 1)) * bytes + 16 <= total; n += 4)
+	{
+		const unsigned char *p = b + n * M * bytes;
+
+		for (k = 0; k < M; k++)
+		{
+			v[k] = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i *)(p + 4 * k * bytes)), mask);
+			v[k] = _mm_sra_epi32(_mm_xor_si128(v[k], offset), shift);
+		}
+
+		if (M == 2)
+			Deinterleave2(v[0], v[1]);
+		else if (M == 6)
+		{
+			// Frames 1 and 3 start in the middle of a vector.
+			__m128i c4 = _mm_unpacklo_epi64(v[1], _mm_srli_si128(v[2], 8));
+			__m128i c5 = _mm_unpacklo_epi64(v[4], _mm_srli_si128(v[5], 8));
+			v[1] = _mm_alignr_epi8(v[2], v[1], 8);
+			v[2] = v[3];
+			v[3] = _mm_alignr_epi8(v[5], v[4], 8);
+			Transpose4(v[0], v[1], v[2], v[3]);
+			Deinterleave2(c4, c5);
+			v[4] = c4;
+			v[5] = c5;
+		}
+		else if (M == 8)
+		{
+			__m128i t;
+			Transpose4(v[0], v[2], v[4], v[6]);
+			Transpose4(v[1], v[3], v[5], v[7]);
+			t = v[1]; v[1] = v[2]; v[2] = v[4]; v[4] = t;		// 0 2 4 6 1 3 5 7 -> 0 1 2 3 4 5 6 7
+			t = v[3]; v[3] = v[6]; v[6] = v[5]; v[5] = t;
+		}
+
+		for (k = 0; k < M; k++)
+			_mm_storeu_si128((__m128i *)(x[k] + n), v[k]);
+	}
+	return(n);
+}
+
+// x[m][n] -> interleaved bytes
+__attribute__((target("ssse3")))
+static long WritePcmSSSE3(int **x, long M, long N, short bytes, short msbfirst, unsigned char *b)
+{
+	const __m128i mask = PcmShuffleMask(bytes, msbfirst, false);
+	const __m128i offset = _mm_set1_epi32((bytes == 1) ? 128 : 0);
+	const long total = N * M * bytes;
+	__m128i v[8];
+	long n, k;
+
+	// Each store writes 16 bytes. The bytes after the samples are overwritten
+	// by the next store, and the last store of a group must be inside b.
+	for (n = 0; (n * M + 4 * (M - 1)) * bytes + 16 <= total; n += 4)
+	{
+		unsigned char *p = b + n * M * bytes;
+
+		for (k = 0; k < M; k++)
+			v[k] = _mm_loadu_si128((const __m128i *)(x[k] + n));
+
+		if (M == 2)
+		{
+			__m128i t = _mm_unpacklo_epi32(v[0], v[1]);
+			v[1] = _mm_unpackhi_epi32(v[0], v[1]);
+			v[0] = t;
+		}
+		else if (M == 6)
+		{
+			__m128i c4 = _mm_unpacklo_epi32(v[4], v[5]), c5 = _mm_unpackhi_epi32(v[4], v[5]);
+			Transpose4(v[0], v[1], v[2], v[3]);
+			v[5] = _mm_unpackhi_epi64(v[3], c5);
+			v[4] = _mm_unpacklo_epi64(c5, v[3]);
+			v[3] = v[2];
+			v[2] = _mm_unpackhi_epi64(v[1], c4);
+			v[1] = _mm_unpacklo_epi64(c4, v[1]);
+		}
+		else if (M == 8)
+		{
+			__m128i t;
+			t = v[4]; v[4] = v[2]; v[2] = v[1]; v[1] = t;		// 0 1 2 3 4 5 6 7 -> 0 2 4 6 1 3 5 7
+			t = v[5]; v[5] = v[6]; v[6] = v[3]; v[3] = t;
+			Transpose4(v[0], v[2], v[4], v[6]);
+			Transpose4(v[1], v[3], v[5], v[7]);
+		}
+
+		for (k = 0; k < M; k++)
+			_mm_storeu_si128((__m128i *)(p + 4 * k * bytes), _mm_shuffle_epi8(_mm_add_epi32(v[k], offset), mask));
+	}
+	return(n);
+}
+#endif
+
+// Convert with a SIMD kernel, if there is one for M channels
+// Return value = number of samples per channel converted
+static long ReadPcmFast(int **x, long M, long N, short bytes, short msbfirst, const unsigned char *b)
+{
+#if defined(AUDIORW_SSSE3)
+	if (SSSE3available && ((M == 1) || (M == 2) || (M == 6) || (M == 8)))
+		return(ReadPcmSSSE3(x, M, N, bytes, msbfirst, b));
+#endif
+	return(0);
+}
+
+static long WritePcmFast(int **x, long M, long N, short bytes, short msbfirst, unsigned char *b)
+{
+#if defined(AUDIORW_SSSE3)
+	if (SSSE3available && ((M == 1) || (M == 2) || (M == 6) || (M == 8)))
+		return(WritePcmSSSE3(x, M, N, bytes, msbfirst, b));
+#endif
+	return(0);
+}
 
 long Read8BitOffsetNM(int **x, long M, long N, unsigned char *b, HALSSTREAM fp)
 {
@@ -92,7 +288,9 @@ long Read8BitOffsetNM(int **x, long M, long N, unsigned char *b, HALSSTREAM fp)
 
 	fread(b, 1, N * M, fp);
 
-	for (n = 0; n < N; n++)
+	n = ReadPcmFast(x, M, N, 1, 0, b);
+	bt += n * M;
+	for (; n < N; n++)
 	{
 		for (m = 0; m < M; m++)
 			x[m][n] = int(bt[m]) - 128;
@@ -110,7 +308,9 @@ long Write8BitOffsetNM(int **x, long M, long N, unsigned char *b, HALSSTREAM fp)
 
 	bt = b;
 
-	for (n = 0; n < N; n++)
+	n = WritePcmFast(x, M, N, 1, 0, b);
+	bt += n * M;
+	for (; n < N; n++)
 	{
 		for (m = 0; m < M; m++)
 			bt[m] = (unsigned char)(x[m][n] + 128);
@@ -142,7 +342,9 @@ long Read16BitNM(int **x, long M, long N, short msbfirst, unsigned char *b, HALS
 
 	r = fread(b, 1, 2 * N * M, fp);
 
-	for (n = 0; n < N; n++)
+	n = ReadPcmFast(x, M, N, 2, msbfirst, b);
+	b += 2 * M * n;
+	for (; n < N; n++)
 	{
 		for (m = 0; m < M; m++)
 			x[m][n] = short(b[2*m+c0] | (static_cast<unsigned short>(b[2*m+c1]) << 8));
@@ -172,7 +374,9 @@ long Write16BitNM(int **x, long M, long N, short msbfirst, unsigned char *b, HAL
 		c1 = 1;
 	}
 
-	for (n = 0; n < N; n++)
+	n = WritePcmFast(x, M, N, 2, msbfirst, b);
+	bt += 2 * M * n;
+	for (; n < N; n++)
 	{
 		for (m = 0; m < M; m++)
 		{
@@ -210,7 +414,9 @@ long Read24BitNM(int **x, long M, long N, short msbfirst, unsigned char *b, HALS
 
 	r = fread(b, 1, 3 * N * M, fp);
 
-	for (n = 0; n < N; n++)
+	n = ReadPcmFast(x, M, N, 3, msbfirst, b);
+	b += 3 * M * n;
+	for (; n < N; n++)
 	{
 		for (m = 0; m < M; m++)
 		{
@@ -246,7 +452,9 @@ long Write24BitNM(int **x, long M, long N, short msbfirst, unsigned char *b, HAL
 		c2 = 2;
 	}
 
-	for (n = 0; n < N; n++)
+	n = WritePcmFast(x, M, N, 3, msbfirst, b);
+	bt += 3 * M * n;
+	for (; n < N; n++)
 	{
 		for (m = 0; m < M; m++)
 		{
@@ -286,7 +494,9 @@ long Read32BitNM(int **x, long M, long N, short msbfirst, unsigned char *b, HALS
 
 	r = fread(b, 1, 4 * N * M, fp);
 
-	for (n = 0; n < N; n++)
+	n = ReadPcmFast(x, M, N, 4, msbfirst, b);
+	b += 4 * M * n;
+	for (; n < N; n++)
 	{
 		for (m = 0; m < M; m++)
 			x[m][n] = b[4*m+c0] | (static_cast<unsigned int>(b[4*m+c1]) << 8) | (static_cast<unsigned int>(b[4*m+c2]) << 16) | (static_cast<unsigned int>(b[4*m+c3]) << 24);
@@ -320,7 +530,9 @@ long Write32BitNM(int **x, long M, long N, short msbfirst, unsigned char *b, HAL
 		c3 = 3;
 	}
 
-	for (n = 0; n < N; n++)
+	n = WritePcmFast(x, M, N, 4, msbfirst, b);
+	bt += 4 * M * n;
+	for (; n < N; n++)
 	{
 		for (m = 0; m < M; m++)
 		{
@@ -364,7 +576,10 @@ long	ReadFloatNM( int** ppLongBuf, long M, long N, short msbfirst, unsigned char
 	}
 
 	// Convert raw data to long/float array
-	for( iSample=0; iSample<N; iSample++ ) {
+	// * The raw bits are copied like 32-bit integers.
+	iSample = ReadPcmFast( reinterpret_cast<int**>( ppFloatBuf ), M, N, 4, msbfirst, b );
+	b += sizeof(float) * M * iSample;
+	for( ; iSample<N; iSample++ ) {
 		for( iChannel=0; iChannel<M; iChannel++ ) {
 			ul = b[4*iChannel+c0] | ( static_cast<unsigned int>(b[4*iChannel+c1]) << 8 ) | ( static_cast<unsigned int>(b[4*iChannel+c2]) << 16 ) | ( static_cast<unsigned int>(b[4*iChannel+c3]) << 24 );
 			// ul shold be copied as unsigned int. (it may lost some bits when copied as float.)
@@ -374,3 +589,110 @@ long	ReadFloatNM( int** ppLongBuf, long M, long N, short msbfirst, unsigned char
 	}
 	return 0;
 }
+
+// Conversion of decoded samples into PCM buffers in memory
+// ---------------------------------------------------------
+// - out receives N interleaved samples of M channels in the given format (PCM_INT16 ...)
+// - Integer formats are in native byte order, except PCM_INT24 (3 bytes, LSByte first)
+// - Integer samples are scaled by shifting: 16-bit audio in PCM_INT32 is x << 16,
+//   24-bit audio in PCM_INT16 is x >> 8 (the lower bits are dropped)
+// - PCM_FLOAT32 of integer audio is x / 2^(res-1), float audio in integer formats
+//   is multiplied by 2^(bits-1), rounded and clipped
+// Both functions return the number of bytes written to out (0 for an unknown format).
+
+static void StoreInt24(unsigned char *p, int v)
+{
+	p[0] = v & 0xFF;
+	p[1] = (v >> 8) & 0xFF;
+	p[2] = (v >> 16) & 0xFF;
+}
+
+// Shift a sample of res bits to bits bits
+static int ScaleInt(int v, short res, short bits)
+{
+	if (res > bits)
+		return(v >> (res - bits));
+	else
+		return(static_cast<int>(static_cast<unsigned int>(v) << (bits - res)));
+}
+
+// Integer audio: x = samples of res bits
+long ConvertIntNM(int **x, long M, long N, short res, void *out, short format)
+{
+	long n, m;
+	float scale;
+
+	if (format == PCM_INT16)
+	{
+		short *p = static_cast<short*>(out);
+		for (n = 0; n < N; n++)
+			for (m = 0; m < M; m++)
+				*p++ = static_cast<short>(ScaleInt(x[m][n], res, 16));
+		return(2 * N * M);
+	}
+	else if (format == PCM_INT24)
+	{
+		unsigned char *p = static_cast<unsigned char*>(out);
+		for (n = 0; n < N; n++)
+			for (m = 0; m < M; m++, p += 3)
+				StoreInt24(p, ScaleInt(x[m][n], res, 24));
+		return(3 * N * M);
+	}
+	else if (format == PCM_INT32)
+	{
+		int *p = static_cast<int*>(out);
+		for (n = 0; n < N; n++)
+			for (m = 0; m < M; m++)
+				*p++ = ScaleInt(x[m][n], res, 32);
+		return(4 * N * M);
+	}
+	else if (format == PCM_FLOAT32)
+	{
+		float *p = static_cast<float*>(out);
+		scale = static_cast<float>(1.0 / static_cast<double>(1UL << (res - 1)));
+		for (n = 0; n < N; n++)
+			for (m = 0; m < M; m++)
+				*p++ = static_cast<float>(x[m][n]) * scale;
+		return(4 * N * M);
+	}
+	return(0);
+}
+
+// Scale a float sample to an integer of bits bits
+static int FloatToInt(float f, short bits)
+{
+	double v = floor(static_cast<double>(f) * static_cast<double>(1UL << (bits - 1)) + 0.5);
+	double vmax = static_cast<double>(1UL << (bits - 1)) - 1.0;
+
+	if (v > vmax)
+		return(static_cast<int>(vmax));
+	if (v < -vmax - 1.0)
+		return(static_cast<int>(-vmax - 1.0));
+	return(static_cast<int>(v));
+}
+
+// Floating-point audio: b = interleaved IEEE 754 samples, LSByte first
+long ConvertFloatNM(const unsigned char *b, long M, long N, void *out, short format)
+{
+	long i, MN = M * N;
+	unsigned int ul;
+	float f;
+
+	if ((format != PCM_INT16) && (format != PCM_INT24) && (format != PCM_INT32) && (format != PCM_FLOAT32))
+		return(0);
+
+	for (i = 0; i < MN; i++, b += 4)
+	{
+		ul = b[0] | (static_cast<unsigned int>(b[1]) << 8) | (static_cast<unsigned int>(b[2]) << 16) | (static_cast<unsigned int>(b[3]) << 24);
+		memcpy(&f, &ul, sizeof(float));
+		if (format == PCM_FLOAT32)
+			static_cast<float*>(out)[i] = f;
+		else if (format == PCM_INT16)
+			static_cast<short*>(out)[i] = static_cast<short>(FloatToInt(f, 16));
+		else if (format == PCM_INT24)
+			StoreInt24(static_cast<unsigned char*>(out) + 3 * i, FloatToInt(f, 24));
+		else
+			static_cast<int*>(out)[i] = FloatToInt(f, 32);
+	}
+	return(((format == PCM_INT16) ? 2 : (format == PCM_INT24) ? 3 : 4) * MN);
+}
@@ -62,3 +62,13 @@ long Write24BitNM(int **x, long M, long N, short msbfirst, unsigned char *b, HAL
 long Read32BitNM(int **x, long M, long N, short msbfirst, unsigned char *b, HALSSTREAM fp);
 long Write32BitNM(int **x, long M, long N, short msbfirst, unsigned char *b, HALSSTREAM fp);
 long ReadFloatNM( int** ppLongBuf, long M, long N, short msbfirst, unsigned char* b, HALSSTREAM fp, float** ppFloatBuf );
+
+// PCM formats of decoded samples in memory
+#define	PCM_PLANAR_INT32	0		// One int buffer per channel, samples at their original resolution
+#define	PCM_INT16			1		// Interleaved 16-bit
+#define	PCM_INT24			2		// Interleaved 24-bit (3 bytes, LSByte first)
+#define	PCM_INT32			3		// Interleaved 32-bit
+#define	PCM_FLOAT32			4		// Interleaved float (-1.0 <= x < 1.0)
+
+long ConvertIntNM(int **x, long M, long N, short res, void *out, short format);
+long ConvertFloatNM(const unsigned char *b, long M, long N, void *out, short format);
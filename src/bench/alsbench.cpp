@@ -0,0 +1,850 @@
+/***************** MPEG-4 Audio Lossless Coding **************************
+
+This software module was originally developed by
+
+NTT (Nippon Telegraph and Telephone Corporation), Japan
+
+in the course of development of the MPEG-4 Audio standard ISO/IEC 14496-3
+and associated amendments. This software module is an implementation of
+a part of one or more MPEG-4 Audio lossless coding tools as specified
+by the MPEG-4 Audio standard. ISO/IEC gives users of the MPEG-4 Audio
+standards free license to this software module or modifications
+thereof for use in hardware or software products claiming conformance
+to the MPEG-4 Audio standards. Those intending to use this software
+module in hardware or software products are advised that this use may
+infringe existing patents. The original developer of this software
+module, the subsequent editors and their companies, and ISO/IEC have
+no liability for use of this software module or modifications thereof
+in an implementation. Copyright is not released for non MPEG-4 Audio
+conforming products. The original developer retains full right to use
+the code for the developer's own purpose, assign or donate the code to
+a third party and to inhibit third party from using the code for non
+MPEG-4 Audio conforming products. This copyright notice must be included
+in all copies or derivative works.
+
+Copyright (c) 2007.
+
+filename : alsbench.cpp
+project  : MPEG-4 Audio Lossless Coding
+contents : Encoder/decoder throughput benchmark
+
+*************************************************************************/
+
+// Usage: alsbench [options] [file.wav ...]
+//
+// Encodes and decodes a synthetic corpus (generated from a fixed seed, so every run
+// uses the same samples) and the given reference files in memory with a set of
+// encoder presets, then runs microbenchmarks of the coding tools. The results are
+// written as JSON. Throughput is given in MB/s (10^6 bytes of PCM per second) and
+// in multiples of real time. Each measurement is the best of several repetitions.
+
+#include	<cstdio>
+#include	<cstdlib>
+#include	<cstring>
+#include	<cmath>
+#include	<string>
+#include	<vector>
+#include	<new>
+#if defined( _WIN32 )
+#include	<windows.h>
+#else
+#include	<sys/time.h>
+#include	<sys/resource.h>
+#endif
+#include	"alsbuffer.h"
+#include	"encoder.h"
+#include	"decoder.h"
+#include	"lpc.h"
+#include	"lms.h"
+#include	"crc.h"
+#include	"ec.h"
+#include	"rn_bitio.h"
+
+//////////////////////////////////////////////////////////////////////
+//                                                                  //
+//                         Type definition                          //
+//                                                                  //
+//////////////////////////////////////////////////////////////////////
+
+// Synthetic corpus entry
+struct	SYNTHCONFIG {
+	long	Frequency;		// Sampling frequency in Hz
+	short	Wordlength;		// Bits per sample
+	long	Channels;		// Number of channels
+	short	SampleType;		// 0:Integer / 1:Floating point
+};
+
+// Benchmark settings
+struct	BENCHOPTIONS {
+	double	Seconds;		// Length of synthetic signals in seconds
+	int		Repeat;			// Number of repetitions per measurement
+	double	MicroTime;		// Minimum run time of one microbenchmark in seconds
+	bool	Synthetic;		// true:Run the synthetic corpus
+	bool	Micro;			// true:Run the microbenchmarks
+	const char*	pPreset;	// Run this preset only (NULL:All)
+};
+
+//////////////////////////////////////////////////////////////////////
+//                                                                  //
+//                         Corpus and presets                       //
+//                                                                  //
+//////////////////////////////////////////////////////////////////////
+
+static const SYNTHCONFIG	s_Synth[] = {
+	{  44100, 16, 1, 0 },
+	{  44100, 16, 2, 0 },
+	{  48000, 24, 2, 0 },
+	{  96000, 24, 6, 0 },
+	{ 192000, 24, 2, 0 },
+	{  48000, 32, 2, 1 },
+};
+
+// "-t" is run as "-t<channels>", "-f#" only for floating-point audio.
+static const char*	s_Presets[] = { "", "-7", "-a -b -o32", "-z3", "-t", "-f0", "-f5" };
+
+static bool	s_RssReset = false;		// true:Peak RSS can be reset per configuration
+
+//////////////////////////////////////////////////////////////////////
+//                                                                  //
+//                        Allocation counter                        //
+//                                                                  //
+//////////////////////////////////////////////////////////////////////
+
+// Number of heap allocations by operator new/new[] of the whole program
+static volatile long	s_Allocations = 0;
+
+#if __cplusplus >= 201103L
+#define	BENCH_THROW_BAD_ALLOC
+#else
+#define	BENCH_THROW_BAD_ALLOC	throw( std::bad_alloc )
+#endif
+
+void*	operator new( size_t Size ) BENCH_THROW_BAD_ALLOC
+{
+	void*	p;
+
+	// The codec may allocate from several threads.
+#if defined( _WIN32 )
+	InterlockedIncrement( &s_Allocations );
+#else
+	__sync_fetch_and_add( &s_Allocations, 1 );
+#endif
+	p = malloc( ( Size > 0 ) ? Size : 1 );
+	if ( p == NULL ) throw std::bad_alloc();
+	return p;
+}
+
+void*	operator new[]( size_t Size ) BENCH_THROW_BAD_ALLOC
+{
+	return operator new( Size );
+}
+
+void	operator delete( void* p ) throw()
+{
+	free( p );
+}
+
+void	operator delete[]( void* p ) throw()
+{
+	free( p );
+}
+
+////////////////////////////////////////
+//                                    //
+//          Get current time          //
+//                                    //
+////////////////////////////////////////
+// Return value = Time in seconds
+static double	GetTime( void )
+{
+#if defined( _WIN32 )
+	LARGE_INTEGER	Frequency, Counter;
+	QueryPerformanceFrequency( &Frequency );
+	QueryPerformanceCounter( &Counter );
+	return static_cast<double>( Counter.QuadPart ) / static_cast<double>( Frequency.QuadPart );
+#else
+	struct timeval	tv;
+	gettimeofday( &tv, NULL );
+	return tv.tv_sec + tv.tv_usec * 1e-6;
+#endif
+}
+
+////////////////////////////////////////
+//                                    //
+//           Reset peak RSS           //
+//                                    //
+////////////////////////////////////////
+// * Linux only (/proc/self/clear_refs). Elsewhere the peak of the whole run is reported.
+static void	ResetPeakRss( void )
+{
+#if defined( __linux__ )
+	FILE*	fp = fopen( "/proc/self/clear_refs", "w" );
+	if ( fp == NULL ) return;
+	s_RssReset = ( fputs( "5", fp ) >= 0 );
+	if ( fclose( fp ) != 0 ) s_RssReset = false;
+#endif
+}
+
+////////////////////////////////////////
+//                                    //
+//            Get peak RSS            //
+//                                    //
+////////////////////////////////////////
+// Return value = Peak resident set size in kB / -1:Unknown
+static long	GetPeakRss( void )
+{
+#if defined( _WIN32 )
+	return -1;
+#else
+	long	Peak = -1;
+#if defined( __linux__ )
+	FILE*	fp = fopen( "/proc/self/status", "r" );
+	char	Line[256];
+	if ( fp != NULL ) {
+		while( fgets( Line, sizeof(Line), fp ) != NULL ) {
+			if ( strncmp( Line, "VmHWM:", 6 ) == 0 ) { Peak = atol( Line + 6 ); break; }
+		}
+		fclose( fp );
+	}
+	if ( Peak >= 0 ) return Peak;
+#endif
+	struct rusage	Usage;
+	if ( getrusage( RUSAGE_SELF, &Usage ) != 0 ) return -1;
+#if defined( __APPLE__ )
+	return Usage.ru_maxrss / 1024;		// bytes
+#else
+	return Usage.ru_maxrss;				// kB
+#endif
+#endif
+}
+
+////////////////////////////////////////
+//                                    //
+//        Pseudo random numbers       //
+//                                    //
+////////////////////////////////////////
+// State = Generator state
+// Return value = Uniform random number in [-1, 1)
+static double	Random( unsigned int& State )
+{
+	State = State * 1664525 + 1013904223;
+	return static_cast<double>( State >> 8 ) / 8388608.0 - 1.0;
+}
+
+////////////////////////////////////////
+//                                    //
+//      Generate synthetic signal     //
+//                                    //
+////////////////////////////////////////
+// Config = Audio format
+// Seconds = Length in seconds
+// Pcm = Receives interleaved little-endian PCM data
+// * Tones with a slow envelope, a component common to all channels, filtered noise
+//   and a short silence, so that prediction, joint coding and zero blocks are used.
+static void	Synthesize( const SYNTHCONFIG& Config, double Seconds, std::vector<unsigned char>& Pcm )
+{
+	const double	Pi = 3.14159265358979;
+	long			Samples = static_cast<long>( Seconds * Config.Frequency );
+	long			Bytes = Config.Wordlength / 8;
+	unsigned int	State = 0x414c5300 + Config.Channels;
+	std::vector<double>	Noise( Config.Channels, 0.0 );
+	double			t, Common, Value, Env, Full;
+	long			n, c, b, Quant;
+	unsigned char*	p;
+
+	Pcm.resize( Samples * Config.Channels * Bytes );
+	p = Pcm.empty() ? NULL : &Pcm[0];
+	Full = ldexp( 1.0, ( ( Config.SampleType == 1 ) ? 24 : Config.Wordlength ) - 1 ) - 1.0;
+
+	for( n=0; n<Samples; n++ ) {
+		t = static_cast<double>( n ) / Config.Frequency;
+		Env = 0.55 + 0.45 * sin( 2.0 * Pi * 0.5 * t );
+		Common = 0.4 * sin( 2.0 * Pi * 220.0 * t ) + 0.2 * sin( 2.0 * Pi * 660.0 * t + 0.3 ) + 0.1 * sin( 2.0 * Pi * 1870.0 * t );
+		for( c=0; c<Config.Channels; c++ ) {
+			Noise[c] = 0.97 * Noise[c] + 0.03 * Random( State );
+			Value = Env * ( 0.7 * Common + 0.25 * sin( 2.0 * Pi * ( 330.0 + 55.0 * c ) * t ) ) + 0.02 * Noise[c] + 0.0005 * Random( State );
+			if ( ( t >= 0.25 ) && ( t < 0.3 ) ) Value = 0.0;		// Silence
+			Quant = static_cast<long>( floor( Value * Full + 0.5 ) );
+			if ( Config.SampleType == 1 ) {
+				// 24-bit values with some gain, as written by a mixer
+				float	f = static_cast<float>( Quant / ( Full + 1.0 ) * 0.9 );
+				unsigned int	u;
+				memcpy( &u, &f, sizeof(u) );
+				for( b=0; b<4; b++ ) *p++ = static_cast<unsigned char>( u >> ( 8 * b ) );
+			} else if ( Bytes == 1 ) {
+				*p++ = static_cast<unsigned char>( Quant + 128 );
+			} else {
+				for( b=0; b<Bytes; b++ ) *p++ = static_cast<unsigned char>( static_cast<unsigned long>( Quant ) >> ( 8 * b ) );
+			}
+		}
+	}
+}
+
+////////////////////////////////////////
+//                                    //
+//           Apply a preset           //
+//                                    //
+////////////////////////////////////////
+// pPreset = Preset name (command line options)
+// Info = Audio format
+// pOptions = Encoder options to modify (initialized by InitEncodeOptions())
+// Name = Receives the preset name as reported
+// Return value = true:Preset applies to the format / false:Skip
+static bool	ApplyPreset( const char* pPreset, const AUDIOINFO& Info, ALS_ENCODEOPTIONS* pOptions, std::string& Name )
+{
+	char	Buffer[32];
+
+	Name = pPreset;
+	if ( strcmp( pPreset, "-7" ) == 0 ) {
+		// Same as the -7 option of the command line
+		pOptions->Adapt = 1;
+		pOptions->BGMC = 1;
+		pOptions->Sub = 5;
+		pOptions->LSBcheck = 1;
+		if ( Info.Freq <= 48000 ) { pOptions->Order = 1023; pOptions->FrameLength = 20480; }
+		else if ( Info.Freq <= 96000 ) { pOptions->Order = 511; pOptions->FrameLength = 20480; }
+		else { pOptions->Order = 127; pOptions->FrameLength = 30720; }
+	} else if ( strcmp( pPreset, "-a -b -o32" ) == 0 ) {
+		pOptions->Adapt = 1;
+		pOptions->BGMC = 1;
+		pOptions->Order = 32;
+	} else if ( strcmp( pPreset, "-z3" ) == 0 ) {
+		pOptions->HEMode = 3;
+	} else if ( strcmp( pPreset, "-t" ) == 0 ) {
+		if ( Info.Chan < 2 ) return false;
+		pOptions->MCC = Info.Chan;
+		sprintf( Buffer, "-t%u", Info.Chan );
+		Name = Buffer;
+	} else if ( ( strcmp( pPreset, "-f0" ) == 0 ) || ( strcmp( pPreset, "-f5" ) == 0 ) ) {
+		if ( Info.SampleType != 1 ) return false;
+		pOptions->AcfMode = static_cast<short>( ( pPreset[2] - '0' ) >> 1 );
+		pOptions->MlzMode = static_cast<short>( ( pPreset[2] - '0' ) & 1 );
+	} else if ( *pPreset != '\0' ) {
+		return false;
+	}
+	return true;
+}
+
+////////////////////////////////////////
+//                                    //
+//    Count allocations per frame     //
+//                                    //
+////////////////////////////////////////
+// Input = Raw PCM data (pFormat != NULL) or file image (pFormat == NULL)
+// pFormat = Format of raw PCM data / NULL:Input is a file image
+// EncOptions = Encoder options
+// Als = Input encoded with EncOptions
+// EncAllocs = Receives the heap allocations per frame of the encoder (-1:Error)
+// DecAllocs = Receives the heap allocations per frame of the decoder (-1:Error)
+// * The frames are encoded and decoded one by one into buffers of the final size.
+//   The first frame is left out, only the steady state is counted.
+static void	CountAllocations( const std::vector<unsigned char>& Input, const ALS_PCMFORMAT* pFormat, const ALS_ENCODEOPTIONS& EncOptions, const std::vector<unsigned char>& Als, double& EncAllocs, double& DecAllocs )
+{
+	std::vector<unsigned char>	Buffer( Input.size() + Als.size() + 65536 );
+	AUDIOINFO	Info;
+	ENCINFO		EncInfo;
+	MP4INFO		Mp4Info;
+	HALSSTREAM	hInput, hOutput;
+	ALS_INT64	Frames, f;
+	long		Count;
+
+	EncAllocs = DecAllocs = -1.0;
+
+	// Encoder
+	hInput = hOutput = NULL;
+	if ( !OpenMemoryReader( &Input[0], static_cast<ALS_UINT32>( Input.size() ), &hInput ) &&
+		 !OpenMemoryWriter( &hOutput, &Buffer[0], static_cast<ALS_UINT32>( Buffer.size() ) ) ) {
+		CLpacEncoder	Encoder;
+		Encoder.SetInputFile( hInput );
+		if ( pFormat != NULL ) {
+			Encoder.SetRawAudio( 1 );
+			Encoder.SetChannels( pFormat->Channels );
+			Encoder.SetSampleType( pFormat->SampleType );
+			Encoder.SetWordlength( pFormat->Wordlength );
+			Encoder.SetFrequency( pFormat->Frequency );
+			Encoder.SetMSBfirst( pFormat->MSBfirst ? 1 : 0 );
+			Encoder.SetHeaderSize( 0 );
+			Encoder.SetTrailerSize( 0 );
+		}
+		if ( !Encoder.AnalyseInputFile( &Info ) && SetEncodeOptions( Encoder, &EncOptions ) ) {
+			Encoder.SetOutputFile( hOutput, false, false );
+			Frames = Encoder.WriteHeader( &EncInfo );
+			if ( ( Frames > 1 ) && !Encoder.EncodeFrame() ) {
+				Count = s_Allocations;
+				for( f=1; f<Frames; f++ ) if ( Encoder.EncodeFrame() ) break;
+				if ( f == Frames ) EncAllocs = static_cast<double>( s_Allocations - Count ) / static_cast<double>( Frames - 1 );
+			}
+		}
+		Encoder.CloseFiles();
+	}
+	if ( hOutput != NULL ) fclose( hOutput );
+	if ( hInput != NULL ) fclose( hInput );
+
+	// Decoder
+	hInput = hOutput = NULL;
+	ClearMp4Info( Mp4Info );
+	if ( !OpenMemoryReader( &Als[0], static_cast<ALS_UINT32>( Als.size() ), &hInput ) &&
+		 !OpenMemoryWriter( &hOutput, &Buffer[0], static_cast<ALS_UINT32>( Buffer.size() ) ) ) {
+		CLpacDecoder	Decoder;
+		Decoder.SetInputStream( hInput, false );
+		if ( !Decoder.AnalyseInputFile( &Info, &EncInfo, Mp4Info ) ) {
+			Decoder.SetOutputStream( hOutput );
+			Frames = Decoder.WriteHeader( Mp4Info );
+			if ( ( Frames > 1 ) && !Decoder.DecodeFrame() ) {
+				Count = s_Allocations;
+				for( f=1; f<Frames; f++ ) if ( Decoder.DecodeFrame() ) break;
+				if ( f == Frames ) DecAllocs = static_cast<double>( s_Allocations - Count ) / static_cast<double>( Frames - 1 );
+			}
+		}
+		Decoder.CloseFiles();
+	}
+	if ( hOutput != NULL ) fclose( hOutput );
+	if ( hInput != NULL ) fclose( hInput );
+}
+
+////////////////////////////////////////
+//                                    //
+//      Encode and decode one item    //
+//                                    //
+////////////////////////////////////////
+// pOut = JSON output
+// pSource = "synthetic" or "file"
+// pName = Name of the item
+// Input = Raw PCM data (pFormat != NULL) or file image (pFormat == NULL)
+// pFormat = Format of raw PCM data / NULL:Input is a file image
+// Options = Benchmark settings
+// First = true:First result (no separator)
+// Return value = Number of results written
+static int	RunItem( FILE* pOut, const char* pSource, const char* pName, const std::vector<unsigned char>& Input, const ALS_PCMFORMAT* pFormat, const BENCHOPTIONS& Options, bool First )
+{
+	std::vector<unsigned char>	Als, Output;
+	AUDIOINFO			Info;
+	ALS_ENCODEOPTIONS	EncOptions;
+	std::string			Preset;
+	double				Start, Encode, Decode, Duration, PcmBytes, EncAllocs, DecAllocs;
+	bool				Lossless;
+	long				Rss;
+	int					Results = 0;
+	unsigned int		i, r;
+
+	// Audio format of file images is taken from a first decode.
+	if ( pFormat != NULL ) {
+		Info.Chan = static_cast<unsigned int>( pFormat->Channels );
+		Info.Freq = static_cast<unsigned long>( pFormat->Frequency );
+		Info.Res = static_cast<unsigned short>( pFormat->Wordlength );
+		Info.SampleType = pFormat->SampleType;
+		Info.Samples = Input.size() / ( pFormat->Channels * ( pFormat->Wordlength / 8 ) );
+	} else {
+		InitEncodeOptions( &EncOptions );
+		if ( EncodeBuffer( &Input[0], static_cast<ALS_UINT32>( Input.size() ), NULL, &EncOptions, Als ) ||
+			 DecodeBuffer( &Als[0], static_cast<ALS_UINT32>( Als.size() ), Output, &Info ) ) {
+			fprintf( stderr, "%s: Cannot encode.\n", pName );
+			return 0;
+		}
+	}
+	Duration = static_cast<double>( Info.Samples ) / Info.Freq;
+	PcmBytes = static_cast<double>( Info.Samples ) * Info.Chan * ( Info.Res / 8 );
+
+	for( i=0; i<sizeof(s_Presets)/sizeof(s_Presets[0]); i++ ) {
+		InitEncodeOptions( &EncOptions );
+		if ( !ApplyPreset( s_Presets[i], Info, &EncOptions, Preset ) ) continue;
+		if ( ( Options.pPreset != NULL ) && ( Preset != Options.pPreset ) ) continue;
+		fprintf( stderr, "%s [%s]\n", pName, Preset.c_str() );
+
+		ResetPeakRss();
+		Encode = Decode = 0.0;
+		Lossless = true;
+		for( r=0; r<static_cast<unsigned int>( Options.Repeat ); r++ ) {
+			Start = GetTime();
+			if ( EncodeBuffer( &Input[0], static_cast<ALS_UINT32>( Input.size() ), pFormat, &EncOptions, Als ) ) break;
+			Start = GetTime() - Start;
+			if ( ( r == 0 ) || ( Start < Encode ) ) Encode = Start;
+
+			Start = GetTime();
+			if ( DecodeBuffer( &Als[0], static_cast<ALS_UINT32>( Als.size() ), Output ) ) { Lossless = false; break; }
+			Start = GetTime() - Start;
+			if ( ( r == 0 ) || ( Start < Decode ) ) Decode = Start;
+			if ( Output != Input ) Lossless = false;
+		}
+		if ( r < static_cast<unsigned int>( Options.Repeat ) && Lossless ) {
+			fprintf( stderr, "%s [%s]: Cannot encode.\n", pName, Preset.c_str() );
+			continue;
+		}
+		Rss = GetPeakRss();
+		CountAllocations( Input, pFormat, EncOptions, Als, EncAllocs, DecAllocs );
+		if ( Encode <= 0.0 ) Encode = 1e-9;
+		if ( Decode <= 0.0 ) Decode = 1e-9;
+
+		fprintf( pOut, "%s\n    {\"source\": \"%s\", \"name\": \"%s\", \"preset\": \"%s\", ", ( First && ( Results == 0 ) ) ? "" : ",", pSource, pName, Preset.c_str() );
+		fprintf( pOut, "\"rate\": %lu, \"bits\": %u, \"channels\": %u, \"float\": %s, \"seconds\": %.3f, ", Info.Freq, Info.Res, Info.Chan, ( Info.SampleType == 1 ) ? "true" : "false", Duration );
+		fprintf( pOut, "\"pcm_bytes\": %.0f, \"als_bytes\": %lu, \"ratio\": %.5f, ", PcmBytes, static_cast<unsigned long>( Als.size() ), Als.size() / PcmBytes );
+		fprintf( pOut, "\"encode\": {\"seconds\": %.6f, \"mb_per_s\": %.3f, \"x_realtime\": %.2f}, ", Encode, PcmBytes / Encode * 1e-6, Duration / Encode );
+		fprintf( pOut, "\"decode\": {\"seconds\": %.6f, \"mb_per_s\": %.3f, \"x_realtime\": %.2f}, ", Decode, PcmBytes / Decode * 1e-6, Duration / Decode );
+		fprintf( pOut, "\"allocs_per_frame\": {\"encode\": %.2f, \"decode\": %.2f}, ", EncAllocs, DecAllocs );
+		fprintf( pOut, "\"peak_rss_kb\": %ld, \"lossless\": %s}", Rss, Lossless ? "true" : "false" );
+		fflush( pOut );
+		Results++;
+	}
+	return Results;
+}
+
+////////////////////////////////////////
+//                                    //
+//        Read reference file         //
+//                                    //
+////////////////////////////////////////
+// pFilename = File name
+// Data = Receives the file image
+// Return value = true:Success / false:Error
+static bool	ReadFile( const char* pFilename, std::vector<unsigned char>& Data )
+{
+	FILE*	fp = fopen( pFilename, "rb" );
+	long	Size;
+	bool	Result;
+
+	if ( fp == NULL ) return false;
+	fseek( fp, 0, SEEK_END );
+	Size = ftell( fp );
+	fseek( fp, 0, SEEK_SET );
+	Data.resize( ( Size > 0 ) ? Size : 0 );
+	Result = ( Size > 0 ) && ( fread( &Data[0], 1, Size, fp ) == static_cast<size_t>( Size ) );
+	fclose( fp );
+	return Result;
+}
+
+//////////////////////////////////////////////////////////////////////
+//                                                                  //
+//                         Microbenchmarks                          //
+//                                                                  //
+//////////////////////////////////////////////////////////////////////
+
+#define	MICRO_N		4096		// Samples per call
+#define	MICRO_SUB	8			// Sub-blocks for entropy coding
+
+// State of all microbenchmarks
+struct	MICROSTATE {
+	int				Residual[MICRO_N];				// Laplacian residual
+	int				Signal[MICRO_N + 1024];			// Audio signal with history
+	int				Work[MICRO_N];					// Output buffer
+	double			Acf[MICRO_N];					// Windowed signal
+	double			Rxx[33];						// Autocorrelation
+	int				Cof[32];						// Quantized predictor coefficients
+	short			s[MICRO_SUB], sx[MICRO_SUB];	// Entropy code parameters
+	unsigned char	Bits[MICRO_N * 8];				// Coded bits
+	rlslms_buf_ptr	Rls;							// RLS-LMS state
+};
+
+typedef	void	(*MICROPROC)( MICROSTATE& State );
+
+static void	MicroRiceEncode( MICROSTATE& State )
+{
+	BITIO	Bio;
+	long	j;
+	bitio_init( State.Bits, 1, &Bio );
+	for( j=0; j<MICRO_SUB; j++ ) rice_encode_block( State.Residual + j * ( MICRO_N / MICRO_SUB ), State.s[j], MICRO_N / MICRO_SUB, &Bio );
+	bitio_term( &Bio );
+}
+
+static void	MicroRiceDecode( MICROSTATE& State )
+{
+	BITIO	Bio;
+	long	j;
+	bitio_init( State.Bits, 0, &Bio );
+	for( j=0; j<MICRO_SUB; j++ ) rice_decode_block( State.Work + j * ( MICRO_N / MICRO_SUB ), State.s[j], MICRO_N / MICRO_SUB, &Bio );
+	bitio_term( &Bio );
+}
+
+static void	MicroBgmcEncode( MICROSTATE& State )
+{
+	BITIO	Bio;
+	bitio_init( State.Bits, 1, &Bio );
+	bgmc_encode_blocks( State.Residual, 0, State.s, State.sx, MICRO_N, MICRO_SUB, &Bio );
+	bitio_term( &Bio );
+}
+
+static void	MicroBgmcDecode( MICROSTATE& State )
+{
+	BITIO	Bio;
+	bitio_init( State.Bits, 0, &Bio );
+	bgmc_decode_blocks( State.Work, 0, State.s, State.sx, MICRO_N, MICRO_SUB, &Bio );
+	bitio_term( &Bio );
+}
+
+static void	MicroGetResidual( MICROSTATE& State )
+{
+	GetResidual( State.Signal + 1024, MICRO_N, 32, 20, State.Cof, State.Work );
+}
+
+static void	MicroGetSignal( MICROSTATE& State )
+{
+	// Reconstruct into a copy so that the signal stays the same for every call.
+	memcpy( State.Work, State.Residual, sizeof(State.Work) );
+	GetSignal( State.Signal + 1024, MICRO_N, 32, 20, State.Cof, State.Residual );
+	memcpy( State.Residual, State.Work, sizeof(State.Work) );
+}
+
+static void	MicroAcf( MICROSTATE& State )
+{
+	acf( State.Acf, MICRO_N, 32, 1, State.Rxx );
+}
+
+static void	MicroPredict( MICROSTATE& State )
+{
+	State.Rls.channel = 0;
+	predict_init( &State.Rls );
+	predict( State.Signal + 1024, State.Work, MICRO_N, &State.Rls, 0, 0, ENCODE );
+}
+
+static void	MicroCrc( MICROSTATE& State )
+{
+	CalculateBlockCRC32( sizeof(State.Bits), 0xffffffff, State.Bits );
+}
+
+static void	MicroCrcSlice16( MICROSTATE& State )
+{
+	CalculateBlockCRC32Slice16( sizeof(State.Bits), 0xffffffff, State.Bits );
+}
+
+static void	MicroCrcBytewise( MICROSTATE& State )
+{
+	CalculateBlockCRC32Bytewise( sizeof(State.Bits), 0xffffffff, State.Bits );
+}
+
+////////////////////////////////////////
+//                                    //
+//      Prepare microbenchmarks       //
+//                                    //
+////////////////////////////////////////
+// State = State to initialize
+static void	InitMicro( MICROSTATE& State )
+{
+	unsigned int	Seed = 12345;
+	long			n, j;
+	double			u;
+
+	// Laplacian residual and a second order signal built from it
+	for( n=0; n<MICRO_N; n++ ) {
+		u = 0.5 * ( Random( Seed ) + 1.0 ) + 1e-9;
+		State.Residual[n] = static_cast<int>( ( ( Random( Seed ) < 0.0 ) ? -1.0 : 1.0 ) * -log( u ) * 200.0 );
+	}
+	for( n=0; n<MICRO_N+1024; n++ ) {
+		State.Signal[n] = static_cast<int>( 8000.0 * sin( n * 0.02 ) + 2000.0 * sin( n * 0.17 ) + 100.0 * Random( Seed ) );
+	}
+	for( n=0; n<MICRO_N; n++ ) State.Acf[n] = State.Signal[n+1024] * ( 0.5 - 0.5 * cos( 2.0 * 3.14159265358979 * n / MICRO_N ) );
+
+	// d[n] = x[n] - 2 x[n-1] + x[n-2], other taps small
+	memset( State.Cof, 0, sizeof(State.Cof) );
+	State.Cof[0] = -( 2 << 20 );
+	State.Cof[1] = 1 << 20;
+	for( j=2; j<32; j++ ) State.Cof[j] = ( j & 1 ) ? 64 : -64;
+
+	for( j=0; j<MICRO_SUB; j++ ) State.s[j] = GetRicePara( State.Residual + j * ( MICRO_N / MICRO_SUB ), 0, MICRO_N / MICRO_SUB, State.sx + j );
+
+	// RLS-LMS predictor of the -z3 mode
+	initCoefTable( &State.Rls, 3, 0 );
+	State.Rls.pbuf = new BUF_TYPE*[1];
+	State.Rls.weight = new W_TYPE*[1];
+	State.Rls.Pmatrix = new P_TYPE*[1];
+	State.Rls.pbuf[0] = new BUF_TYPE[TOTAL_LMS_LEN];
+	State.Rls.weight[0] = new W_TYPE[TOTAL_LMS_LEN];
+	State.Rls.Pmatrix[0] = new P_TYPE[JS_LEN*JS_LEN];
+}
+
+////////////////////////////////////////
+//                                    //
+//        Free microbenchmarks        //
+//                                    //
+////////////////////////////////////////
+// State = State to free
+static void	FreeMicro( MICROSTATE& State )
+{
+	delete[] State.Rls.pbuf[0];
+	delete[] State.Rls.weight[0];
+	delete[] State.Rls.Pmatrix[0];
+	delete[] State.Rls.pbuf;
+	delete[] State.Rls.weight;
+	delete[] State.Rls.Pmatrix;
+}
+
+////////////////////////////////////////
+//                                    //
+//       Run one microbenchmark       //
+//                                    //
+////////////////////////////////////////
+// pOut = JSON output
+// pName = Function name
+// pUnit = "sample" or "byte"
+// Items = Number of items per call
+// pProc = Benchmark procedure
+// State = Benchmark state
+// Options = Benchmark settings
+// First = true:First result (no separator)
+static void	RunMicro( FILE* pOut, const char* pName, const char* pUnit, double Items, MICROPROC pProc, MICROSTATE& State, const BENCHOPTIONS& Options, bool First )
+{
+	double	Start, Time, Best = 0.0;
+	long	Calls, Total = 0, i;
+	int		r;
+
+	fprintf( stderr, "micro %s\n", pName );
+	pProc( State );		// Warm up
+
+	for( r=0; r<Options.Repeat; r++ ) {
+		// Double the number of calls until the minimum run time is reached.
+		Start = GetTime();
+		Calls = 0;
+		for( i=1; ( Time = GetTime() - Start ) < Options.MicroTime; i*=2 ) {
+			long	k;
+			for( k=0; k<i; k++ ) pProc( State );
+			Calls += i;
+		}
+		Time /= Calls;
+		if ( ( r == 0 ) || ( Time < Best ) ) Best = Time;
+		Total += Calls;
+	}
+
+	fprintf( pOut, "%s\n    {\"name\": \"%s\", \"unit\": \"%s\", \"items_per_call\": %.0f, \"calls\": %ld, ", First ? "" : ",", pName, pUnit, Items, Total );
+	fprintf( pOut, "\"ns_per_item\": %.4f, \"mitems_per_s\": %.3f}", Best / Items * 1e9, Items / Best * 1e-6 );
+	fflush( pOut );
+}
+
+////////////////////////////////////////
+//                                    //
+//       Run all microbenchmarks      //
+//                                    //
+////////////////////////////////////////
+// pOut = JSON output
+// Options = Benchmark settings
+static void	RunMicroAll( FILE* pOut, const BENCHOPTIONS& Options )
+{
+	MICROSTATE*	pState = new MICROSTATE;
+
+	InitMicro( *pState );
+	RunMicro( pOut, "rice_encode_block", "sample", MICRO_N, MicroRiceEncode, *pState, Options, true );
+	RunMicro( pOut, "rice_decode_block", "sample", MICRO_N, MicroRiceDecode, *pState, Options, false );
+	RunMicro( pOut, "bgmc_encode_blocks", "sample", MICRO_N, MicroBgmcEncode, *pState, Options, false );
+	RunMicro( pOut, "bgmc_decode_blocks", "sample", MICRO_N, MicroBgmcDecode, *pState, Options, false );
+	RunMicro( pOut, "GetResidual", "sample", MICRO_N, MicroGetResidual, *pState, Options, false );
+	RunMicro( pOut, "GetSignal", "sample", MICRO_N, MicroGetSignal, *pState, Options, false );
+	RunMicro( pOut, "acf", "sample", MICRO_N, MicroAcf, *pState, Options, false );
+	RunMicro( pOut, "predict", "sample", MICRO_N, MicroPredict, *pState, Options, false );
+	RunMicro( pOut, "CalculateBlockCRC32", "byte", sizeof(pState->Bits), MicroCrc, *pState, Options, false );
+	RunMicro( pOut, "CalculateBlockCRC32Slice16", "byte", sizeof(pState->Bits), MicroCrcSlice16, *pState, Options, false );
+	RunMicro( pOut, "CalculateBlockCRC32Bytewise", "byte", sizeof(pState->Bits), MicroCrcBytewise, *pState, Options, false );
+	FreeMicro( *pState );
+	delete pState;
+}
+
+////////////////////////////////////////
+//                                    //
+//            Print usage             //
+//                                    //
+////////////////////////////////////////
+static void	PrintUsage( void )
+{
+	printf( "Usage: alsbench [options] [file.wav ...]\n" );
+	printf( "  -o <file> : Write JSON results to <file> (default = stdout)\n" );
+	printf( "  -d#       : Length of synthetic signals in seconds (default = 5)\n" );
+	printf( "  -r#       : Repetitions per measurement, the best is reported (default = 3)\n" );
+	printf( "  -p <opts> : Run only this preset (e.g. \"-7\", \"\" for default options)\n" );
+	printf( "  -q        : Quick run (-d1 -r1, short microbenchmarks)\n" );
+	printf( "  -nosynth  : Do not run the synthetic corpus\n" );
+	printf( "  -nomicro  : Do not run the microbenchmarks\n" );
+	printf( "Files are encoded and decoded with all presets, like the synthetic corpus.\n" );
+}
+
+////////////////////////////////////////
+//                                    //
+//            Main function           //
+//                                    //
+////////////////////////////////////////
+int	main( int argc, char** argv )
+{
+	BENCHOPTIONS	Options;
+	FILE*			pOut = stdout;
+	std::vector<const char*>	Files;
+	std::vector<unsigned char>	Data;
+	ALS_PCMFORMAT	Format;
+	char			Name[64];
+	bool			First = true;
+	double			Start;
+	int				i;
+	unsigned int	k;
+
+	Options.Seconds = 5.0;
+	Options.Repeat = 3;
+	Options.MicroTime = 0.2;
+	Options.Synthetic = true;
+	Options.Micro = true;
+	Options.pPreset = NULL;
+
+	for( i=1; i<argc; i++ ) {
+		if ( ( strcmp( argv[i], "-o" ) == 0 ) && ( i + 1 < argc ) ) {
+			if ( ( pOut = fopen( argv[++i], "w" ) ) == NULL ) { fprintf( stderr, "Cannot open %s.\n", argv[i] ); return 1; }
+		} else if ( ( strcmp( argv[i], "-p" ) == 0 ) && ( i + 1 < argc ) ) {
+			Options.pPreset = argv[++i];
+		} else if ( strncmp( argv[i], "-d", 2 ) == 0 ) {
+			Options.Seconds = atof( argv[i] + 2 );
+		} else if ( strncmp( argv[i], "-r", 2 ) == 0 ) {
+			Options.Repeat = atoi( argv[i] + 2 );
+		} else if ( strcmp( argv[i], "-q" ) == 0 ) {
+			Options.Seconds = 1.0;
+			Options.Repeat = 1;
+			Options.MicroTime = 0.02;
+		} else if ( strcmp( argv[i], "-nosynth" ) == 0 ) {
+			Options.Synthetic = false;
+		} else if ( strcmp( argv[i], "-nomicro" ) == 0 ) {
+			Options.Micro = false;
+		} else if ( ( strcmp( argv[i], "-h" ) == 0 ) || ( argv[i][0] == '-' ) ) {
+			PrintUsage();
+			return ( strcmp( argv[i], "-h" ) == 0 ) ? 0 : 1;
+		} else {
+			Files.push_back( argv[i] );
+		}
+	}
+	if ( ( Options.Seconds <= 0.0 ) || ( Options.Repeat < 1 ) ) { PrintUsage(); return 1; }
+
+	Start = GetTime();
+	fprintf( pOut, "{\n  \"benchmark\": \"alsbench\",\n  \"version\": 1,\n" );
+	fprintf( pOut, "  \"settings\": {\"synthetic_seconds\": %.3f, \"repeat\": %d, \"micro_seconds\": %.3f},\n", Options.Seconds, Options.Repeat, Options.MicroTime );
+	fprintf( pOut, "  \"results\": [" );
+
+	// Synthetic corpus
+	if ( Options.Synthetic ) {
+		for( k=0; k<sizeof(s_Synth)/sizeof(s_Synth[0]); k++ ) {
+			const SYNTHCONFIG&	Config = s_Synth[k];
+			Synthesize( Config, Options.Seconds, Data );
+			Format.Channels = Config.Channels;
+			Format.Frequency = Config.Frequency;
+			Format.Wordlength = Config.Wordlength;
+			Format.SampleType = static_cast<unsigned char>( Config.SampleType );
+			Format.MSBfirst = 0;
+			sprintf( Name, "synth-%ld-%d%s-%ld", Config.Frequency, Config.Wordlength, Config.SampleType ? "f" : "", Config.Channels );
+			if ( RunItem( pOut, "synthetic", Name, Data, &Format, Options, First ) > 0 ) First = false;
+		}
+	}
+
+	// Reference corpus
+	for( k=0; k<Files.size(); k++ ) {
+		std::string	Escaped;
+		const char*	p;
+		if ( !ReadFile( Files[k], Data ) ) { fprintf( stderr, "Cannot read %s.\n", Files[k] ); continue; }
+		for( p=Files[k]; *p; p++ ) {
+			if ( ( *p == '"' ) || ( *p == '\\' ) ) Escaped += '\\';
+			Escaped += *p;
+		}
+		if ( RunItem( pOut, "file", Escaped.c_str(), Data, NULL, Options, First ) > 0 ) First = false;
+	}
+	fprintf( pOut, "\n  ],\n" );
+
+	// Microbenchmarks
+	fprintf( pOut, "  \"micro\": [" );
+	if ( Options.Micro ) RunMicroAll( pOut, Options );
+	fprintf( pOut, "\n  ],\n" );
+
+	fprintf( pOut, "  \"peak_rss_per_result\": %s,\n", s_RssReset ? "true" : "false" );
+	fprintf( pOut, "  \"total_seconds\": %.3f\n}\n", GetTime() - Start );
+	if ( pOut != stdout ) fclose( pOut );
+	return 0;
+}
+
+// End of alsbench.cpp
@@ -142,6 +142,20 @@ long GetOptionValues(short argc, char **argv, const char *opt, long N, unsigned
 	return(0);			// Option not set
 }
 
+// Get the text of an arbitrary option, e.g. "out.txt" if option is "--trace=out.txt"
+// Returns NULL if option is not set
+const char *GetOptionString(short argc, char **argv, const char *opt)
+{
+	short i;
+	size_t	OptLen = strlen( opt );
+
+	for (i=1; i<argc; ++i) {
+		if (!strncmp(argv[i], opt, OptLen))
+			return argv[i] + OptLen;
+	}
+	return(NULL);
+}
+
 // Get and parse -f option.
 //   -f0: ACF=off, MLZ=off
 //   -f1: ACF=off, MLZ=on
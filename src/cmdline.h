@@ -56,4 +56,5 @@ contents : Header file for cmdline.cpp
 short CheckOption(short argc, char **argv, const char *opt);
 long GetOptionValue(short argc, char **argv, const char *opt, long default_value = 0);
 long GetOptionValues(short argc, char **argv, const char *opt, long N, unsigned short *val);
+const char *GetOptionString(short argc, char **argv, const char *opt);
 bool GetFOption( short argc, char** argv, short& AcfMode, float& AcfValue, short& MlzMode );
@@ -35,5 +35,15 @@ contents : Header file for crc.cpp
 #define CRC_MASK           0xFFFFFFFFL
 #define CRC32_POLYNOMIAL   0xEDB88320L
 
-void BuildCRCTable();
+// Length type of CombineCRC32(), kept local so that crc.h stands alone
+#if defined( _MSC_VER )
+typedef unsigned __int64 CRC_UINT64;
+#else
+typedef unsigned long long CRC_UINT64;
+#endif
+
+// The tables are constant, no initialization is needed.
 unsigned int CalculateBlockCRC32(unsigned int count, unsigned int crc, void *buffer);
+unsigned int CalculateBlockCRC32Slice16(unsigned int count, unsigned int crc, const void *buffer);
+unsigned int CalculateBlockCRC32Bytewise(unsigned int count, unsigned int crc, const void *buffer);
+unsigned int CombineCRC32(unsigned int crc1, unsigned int crc2, CRC_UINT64 len2);
@@ -214,6 +214,15 @@ CLpacDecoder::CLpacDecoder()
 	fid = 0;		// No frame decoded yet
 	CRC = 0;		// CRC initialization
 	Q = 20;			// Quantizer value
+	RAUpos = NULL;	// No RAU positions yet
+	RAUknown = 0;
+	TrailerData = NULL;
+	OutSkip = 0;	// Output every sample
+	OutLeft = -1;
+	PullOutput = false;
+	OutFirst = OutCount = 0;
+	IndexFile = NULL;	// No seek index
+	BuildIndex = false;
 	CloseInput = CloseOutput = false;
 	ChanSort = 0;
 	mp4file = false;
@@ -238,9 +247,11 @@ CLpacDecoder::~CLpacDecoder()
 			{
 				delete [] rlslms_ptr.pbuf[i];
 				delete [] rlslms_ptr.weight[i];
+				delete [] rlslms_ptr.Pmatrix[i];
 			}
 			delete [] rlslms_ptr.pbuf;
 			delete [] rlslms_ptr.weight;
+			delete [] rlslms_ptr.Pmatrix;
 		}
 
 		delete [] tmpbuf;
@@ -251,7 +262,9 @@ CLpacDecoder::~CLpacDecoder()
 
 		if (RA && (RAflag == 2))
 			delete [] RAUsize;
+		delete [] RAUpos;
 	}
+	delete [] TrailerData;
 
 	if (ChanSort)
 		delete [] ChPos;
@@ -260,6 +273,7 @@ CLpacDecoder::~CLpacDecoder()
 	if ( SampleType == SAMPLE_TYPE_FLOAT ) Float.FreeBuffer();
 	// Deallocate MCC buffer
 	FreeMccDecBuffer( &MccBuf );
+	Scratch.Free();
 
 	// Close files
 	CloseFiles();
@@ -410,30 +424,35 @@ short CLpacDecoder::AnalyseInputFile(AUDIOINFO *ainfo, ENCINFO *encinfo, const M
 	return(0);
 }
 
-ALS_INT64 CLpacDecoder::WriteHeader( const MP4INFO& Mp4Info )
+ALS_INT64 CLpacDecoder::WriteHeader( const MP4INFO& Mp4Info, bool CopyHeader )
 {
 	long i, j, rest;
 
 	// Copy header
 	if ( HeaderSize == 0xffffffff ) {
 		if ( !mp4file ) return ( frames = -2 );
-		if ( !CopyData( Mp4Info.m_pOriginalFile, Mp4Info.m_HeaderOffset, Mp4Info.m_HeaderSize, fpOutput ) ) return ( frames = -2 );
+		if ( CopyHeader && !CopyData( Mp4Info.m_pOriginalFile, Mp4Info.m_HeaderOffset, Mp4Info.m_HeaderSize, fpOutput ) ) return ( frames = -2 );
 	} else {
 		if ( HeaderSize >> 32 ) return ( frames = -2 );
-		if ( !CopyData( fpInput, HeaderSize, fpOutput ) ) return ( frames = -2 );
+		if ( !CopyHeader ) fseek( fpInput, HeaderSize, SEEK_CUR );
+		else if ( !CopyData( fpInput, HeaderSize, fpOutput ) ) return ( frames = -2 );
 	}
 	
-	// Read trailer
+	// Read trailer. Usual sizes are kept in memory, so that a pipe input
+	// does not have to come back for it in WriteTrailer().
 	if ( TrailerSize != 0xffffffff ) {
 		TrailerOffset = ftell( fpInput );
-		fseek( fpInput, TrailerSize, SEEK_CUR );
+		if ( ( TrailerSize > 0 ) && ( TrailerSize <= 0x100000 ) ) {
+			TrailerData = new unsigned char[static_cast<long>( TrailerSize )];
+			if ( fread( TrailerData, 1, static_cast<ALS_UINT32>( TrailerSize ), fpInput ) != TrailerSize ) return ( frames = -2 );
+		}
+		else fseek( fpInput, TrailerSize, SEEK_CUR );
 	}
 
 	if (CRCenabled)
 	{
 		CRCorg = ReadUIntMSBfirst(fpInput);
 		// Initialize CRC
-		BuildCRCTable();
 		CRC = CRC_MASK;
 	}
 
@@ -468,6 +487,17 @@ ALS_INT64 CLpacDecoder::WriteHeader( const MP4INFO& Mp4Info )
 		fseek(fpInput, size, SEEK_CUR);				// skip aux data
 	}
 
+	// Positions of RAUs (without random access, the whole stream is one unit)
+	RAUpos = new ALS_INT64[RA ? RAUnits : 1];
+	RAUpos[0] = ftell(fpInput);
+	RAUknown = 1;
+	if (RA && (RAflag == 2))
+	{
+		for (long r = 1; r < RAUnits; r++)
+			RAUpos[r] = RAUpos[r-1] + RAUsize[r-1];
+		RAUknown = RAUnits;
+	}
+
 	if (Chan == 1)
 		Joint = 0;
 
@@ -491,6 +521,7 @@ ALS_INT64 CLpacDecoder::WriteHeader( const MP4INFO& Mp4Info )
 		rlslms_ptr.pbuf = new BUF_TYPE*[Chan];
 		rlslms_ptr.weight  = new W_TYPE*[Chan];
 		rlslms_ptr.Pmatrix  = new P_TYPE*[Chan];
+		rlslms_ptr.old_flag = 0;
 		for (i = 0; i < Chan; i++)
 		{
 			rlslms_ptr.pbuf[i] = new BUF_TYPE[TOTAL_LMS_LEN];
@@ -515,7 +546,7 @@ ALS_INT64 CLpacDecoder::WriteHeader( const MP4INFO& Mp4Info )
 	else
 		NeedTdBit = 5;
 
-	AllocateMccDecBuffer( &MccBuf, Chan, N);
+	AllocateMccDecBuffer( &MccBuf, Chan, N, &Scratch );
 
 	// #bits/channel: NeedPuchBit = max(1,ceil(log2(Chan)))
 	i = (Chan > 1) ? (Chan-1) : 1;
@@ -528,11 +559,26 @@ ALS_INT64 CLpacDecoder::WriteHeader( const MP4INFO& Mp4Info )
 	d = new int[N];								// Prediction residual
 	cofQ = new int[P];								// Quantized coefficients
 
+	// Work buffers of DecodeFrame() and DecodeNextFrame(): channel pointers, samples
+	// saved for the LSB shift and MCC flags
+	Scratch.Allocate((sizeof(int*) * 3 + sizeof(char)) * Chan + sizeof(int) * P + 64);
+
 	// Length of last frame
 	if (rest)
 		N0 = rest;
 	else
 		N0 = N;
+	Nframe = N;
+
+	// Seek index: load it, or find the RAU positions and save them for the next time
+	if (RA && (RAUknown < RAUnits))
+	{
+		if ((IndexFile == NULL) || ReadRauIndex(IndexFile))
+		{
+			if (BuildIndex && !BuildRauIndex() && (IndexFile != NULL))
+				WriteRauIndex(IndexFile);
+		}
+	}
 
 	return(frames);
 }
@@ -544,8 +590,12 @@ ALS_INT64 CLpacDecoder::WriteTrailer( const MP4INFO& Mp4Info )
 		if ( !CopyData( Mp4Info.m_pOriginalFile, Mp4Info.m_TrailerOffset, Mp4Info.m_TrailerSize, fpOutput ) ) return -1;
 	} else {
 		if ( TrailerSize >> 32 ) return -1;
-		fseek( fpInput, TrailerOffset, SEEK_SET );
-		if ( !CopyData( fpInput, TrailerSize, fpOutput ) ) return -1;
+		if ( TrailerData != NULL ) {
+			if ( fwrite( TrailerData, 1, static_cast<ALS_UINT32>( TrailerSize ), fpOutput ) != TrailerSize ) return -1;
+		} else {
+			fseek( fpInput, TrailerOffset, SEEK_SET );
+			if ( !CopyData( fpInput, TrailerSize, fpOutput ) ) return -1;
+		}
 	}
 
 	CRC ^= CRC_MASK;
@@ -580,6 +630,208 @@ unsigned int CLpacDecoder::GetCRC()
 	return(CRC);
 }
 
+// Set positions of all RAUs in the input stream (e.g. taken from an MP4 frame table)
+// Call after WriteHeader(). Returns 0 on success, -1 if the table does not match the stream.
+short CLpacDecoder::SetRauIndex( const ALS_INT64 *pos, long units )
+{
+	if ((frames < 1) || !RA || (units < 1) || (units != RAUnits))
+		return(-1);
+
+	memcpy(RAUpos, pos, units * sizeof(ALS_INT64));
+	RAUknown = units;
+	return(0);
+}
+
+// Move decoding to any sample position. Decoding restarts at the first frame of the random
+// access unit that contains the sample, and the output of the following DecodeFrame() calls
+// begins exactly at the requested sample. Call after WriteHeader().
+// Returns 0 on success, -1 if the position is invalid or cannot be reached.
+short CLpacDecoder::Seek( ALS_INT64 sample )
+{
+	ALS_INT64 frame, first, pos;
+	long r, k;
+
+	if ((frames < 1) || (sample < 0) || (sample >= Samples))
+		return(-1);
+
+	frame = sample / Nframe;
+	r = RA ? static_cast<long>( frame / RA ) : 0;
+	pos = ftell(fpInput);
+
+	// If the RAU position is unknown, start at the last known RAU before it
+	LocateRau(r);
+	k = (r < RAUknown) ? r : (RAUknown - 1);
+	first = static_cast<ALS_INT64>( k ) * (RA ? RA : 1);
+
+	if ((fid >= first) && (fid <= frame))
+	{
+		// Going on from the current frame is not longer than restarting
+		if (fseek(fpInput, pos, SEEK_SET))
+			return(-1);
+	}
+	else
+	{
+		// Without random access, the prediction state cannot be restored
+		if (!RA || fseek(fpInput, RAUpos[k], SEEK_SET))
+			return(-1);
+		fid = first;
+	}
+	N = Nframe;
+	OutSkip = sample - fid * Nframe;
+	return(0);
+}
+
+// Find all RAU positions, following the RAU sizes in the frames or decoding all frames.
+// If the frames had to be decoded, decoding starts again at the beginning of the stream.
+// Call after WriteHeader().
+// Returns 0 on success, -1 on error.
+short CLpacDecoder::BuildRauIndex()
+{
+	ALS_INT64 pos;
+	unsigned int crc;
+
+	if (frames < 1)
+		return(-1);
+	if (!RA)
+		return(0);
+
+	// RAU sizes in the header or in the frames
+	pos = ftell(fpInput);
+	if (LocateRau(RAUnits - 1))
+		return(fseek(fpInput, pos, SEEK_SET) ? -1 : 0);
+
+	// No RAU sizes in the stream: go through the frames from the last known RAU without output
+	crc = CRC;
+	if (fseek(fpInput, RAUpos[RAUknown-1], SEEK_SET))
+		return(-1);
+	fid = static_cast<ALS_INT64>( RAUknown - 1 ) * RA;
+	OutSkip = 0;
+	OutLeft = 0;
+	while (fid < frames)
+	{
+		if (DecodeFrame())
+			break;
+	}
+	OutLeft = -1;
+	N = Nframe;
+	CRC = crc;
+
+	fid = 0;
+	if (fseek(fpInput, RAUpos[0], SEEK_SET) || (RAUknown < RAUnits))
+		return(-1);
+	return(0);
+}
+
+// Seek index file layout (all values MSB first):
+//   'ALSI', ALS file size (64 bits), samples (64 bits), frame length, RA distance, RAU count,
+//   then for each RAU: byte offset in the ALS file (64 bits), first sample (64 bits)
+#define ALS_INDEX_ID 0x414C5349UL
+
+// Size of the input stream in bytes, or -1 if it cannot be determined
+static ALS_INT64 GetStreamSize( HALSSTREAM fp )
+{
+	ALS_INT64 pos, size;
+
+	pos = ftell(fp);
+	if ((pos < 0) || fseek(fp, 0, SEEK_END))
+		return(-1);
+	size = ftell(fp);
+	if (fseek(fp, pos, SEEK_SET))
+		return(-1);
+	return(size);
+}
+
+// Load RAU positions from a seek index file. Call after WriteHeader().
+// Returns 0 on success, -1 if the file is missing or does not belong to the stream.
+short CLpacDecoder::ReadRauIndex( const char *name )
+{
+	HALSSTREAM fp;
+	ALS_INT64 *pos, size;
+	long r;
+	short result = -1;
+
+	// The file size tells an index of a re-encoded file with the same parameters apart
+	size = GetStreamSize(fpInput);
+	if ((frames < 1) || !RA || (size < 0) || OpenFileReader(name, &fp))
+		return(-1);
+
+	if ((ReadUIntMSBfirst(fp) == ALS_INDEX_ID) && (static_cast<ALS_INT64>( ReadUINT64MSBfirst(fp) ) == size) &&
+		(static_cast<ALS_INT64>( ReadUINT64MSBfirst(fp) ) == Samples) &&
+		(static_cast<long>( ReadUIntMSBfirst(fp) ) == Nframe) && (ReadUIntMSBfirst(fp) == static_cast<unsigned int>( RA )) &&
+		(static_cast<long>( ReadUIntMSBfirst(fp) ) == RAUnits))
+	{
+		pos = new ALS_INT64[RAUnits];
+		for (r = 0; r < RAUnits; r++)
+		{
+			pos[r] = static_cast<ALS_INT64>( ReadUINT64MSBfirst(fp) );
+			if ((static_cast<ALS_INT64>( ReadUINT64MSBfirst(fp) ) != static_cast<ALS_INT64>( r ) * RA * Nframe) ||
+				((r > 0) && (pos[r] <= pos[r-1])))
+				break;
+		}
+		// The first RAU has to be where the stream says
+		if ((r == RAUnits) && (pos[0] == RAUpos[0]))
+		{
+			memcpy(RAUpos, pos, RAUnits * sizeof(ALS_INT64));
+			RAUknown = RAUnits;
+			result = 0;
+		}
+		delete [] pos;
+	}
+	fclose(fp);
+	return(result);
+}
+
+// Save RAU positions into a seek index file. Call after BuildRauIndex().
+// Returns 0 on success, -1 on error.
+short CLpacDecoder::WriteRauIndex( const char *name )
+{
+	HALSSTREAM fp;
+	ALS_INT64 size;
+	long r;
+
+	size = GetStreamSize(fpInput);
+	if ((frames < 1) || !RA || (RAUknown < RAUnits) || (size < 0) || OpenFileWriter(name, &fp))
+		return(-1);
+
+	WriteUIntMSBfirst(ALS_INDEX_ID, fp);
+	WriteUINT64MSBfirst(static_cast<ALS_UINT64>( size ), fp);
+	WriteUINT64MSBfirst(static_cast<ALS_UINT64>( Samples ), fp);
+	WriteUIntMSBfirst(static_cast<unsigned int>( Nframe ), fp);
+	WriteUIntMSBfirst(static_cast<unsigned int>( RA ), fp);
+	WriteUIntMSBfirst(static_cast<unsigned int>( RAUnits ), fp);
+	for (r = 0; r < RAUnits; r++)
+	{
+		WriteUINT64MSBfirst(static_cast<ALS_UINT64>( RAUpos[r] ), fp);
+		WriteUINT64MSBfirst(static_cast<ALS_UINT64>( r ) * RA * Nframe, fp);
+	}
+	return((fclose(fp) == 0) ? 0 : -1);
+}
+
+// Decode count samples beginning at sample start, without header and trailer.
+// Call after WriteHeader(). Returns the number of samples written, -1 if the position is
+// invalid, or -2 on a decoding error.
+ALS_INT64 CLpacDecoder::DecodeRange( ALS_INT64 start, ALS_INT64 count )
+{
+	if ((start < 0) || (start > Samples) || (count < 0))
+		return(-1);
+	if (count > Samples - start)
+		count = Samples - start;
+	if ((count > 0) && Seek(start))
+		return(-1);
+
+	OutLeft = count;
+	while ((OutLeft > 0) && (fid < frames))
+	{
+		if (DecodeFrame())
+		{
+			OutLeft = -1;
+			return(-2);
+		}
+	}
+	OutLeft = -1;
+	return(count);
+}
+
 /*short CLpacDecoder::GetFrameSize()
 {
 	return(N * Chan * (IntRes / 8));
@@ -658,10 +910,16 @@ short CLpacDecoder::DecodeFrame()
 	UINT BSflags;
 	short CBS;
 	BYTE h, typ, flag;
+	long skip, count, bytes;
+	bool window;
+	HALSSTREAM fpOut;
+	ALS_INT64 TraceStart = 0, TraceFloat = 0;	// Frame position and floating-point data size (decision trace)
 
+	// Work buffers are released when the frame is done.
+	CAlsScratchScope Frame(Scratch);
 	int **xsave, **xtmp;
-	xsave = new int*[Chan];
-	xtmp = new int*[Chan];
+	xsave = Scratch.Get<int*>(Chan);
+	xtmp = Scratch.Get<int*>(Chan);
 	
 	fid++;						// Number of current frame
 
@@ -673,8 +931,21 @@ short CLpacDecoder::DecodeFrame()
 	{
 		if (((fid - 1) % RA))	// Not first frame of RA unit
 			RAframe = 0;		// Turn off RA for current frame
-		else if (RAflag == 1)
-			ReadUIntMSBfirst(fpInput);		// read size of RAU
+		else
+		{
+			// remember RAU positions on the way for Seek()
+			RAUid = static_cast<long>( (fid - 1) / RA );
+			if ((RAUid == RAUknown) && ((RAUpos[RAUid] = ftell(fpInput)) >= 0))
+				RAUknown++;
+			if (RAflag == 1)
+				ReadUIntMSBfirst(fpInput);		// read size of RAU
+		}
+	}
+
+	if (Trace.IsEnabled())
+	{
+		Trace.BeginFrame(fid - 1, (fid == frames) ? N0 : N, Chan);
+		TraceStart = ftell(fpInput);
 	}
 
 	MCCflag=0;
@@ -726,6 +997,13 @@ short CLpacDecoder::DecodeFrame()
 
 				// get #blocks B and block lengths Nb[]
 				B = GetBlockSequence(BSflags, NN, Nb);
+
+				if (Trace.IsEnabled())
+				{
+					Trace.SetBlockSwitching(c, BSflags);
+					if (CBS)
+						Trace.SetBlockSwitching(c + 1, BSflags);
+				}
 			}
 			else		// fixed block length (= frame length)
 			{
@@ -754,10 +1032,9 @@ short CLpacDecoder::DecodeFrame()
 				for (b = 0; b < B; b++)
 				{
 					// Difference method
-					fread(&h, 1, 1, fpInput);
+					h = PeekInput(1)[0];	// Block header of channel 1
 					typ = h >> 6;
 					flag = h & 0x20;
-					fseek(fpInput, -1, SEEK_CUR);
 
 					if ((typ == 0x03) || ((typ < 0x02) && flag))	// Channel 1 = difference signal
 					{
@@ -767,8 +1044,8 @@ short CLpacDecoder::DecodeFrame()
 								x[c][i] = x[c1][i] - x[c][i];
 						}
 
-						DecodeBlock(x[c],  Nb[b], RAframe && (b == 0));
-						DecodeBlock(x[c1], Nb[b], RAframe && (b == 0));
+						DecodeBlock(x[c],  Nb[b], RAframe && (b == 0), c);
+						DecodeBlock(x[c1], Nb[b], RAframe && (b == 0), c1);
 
 						if (!(RAframe && (b == 0))) {
 							/* Restore P samples from the previous block */
@@ -782,12 +1059,11 @@ short CLpacDecoder::DecodeFrame()
 					}
 					else											// Channel 1 = normal signal
 					{
-						DecodeBlock(x[c], Nb[b], RAframe && (b == 0));
+						DecodeBlock(x[c], Nb[b], RAframe && (b == 0), c);
 
-						fread(&h, 1, 1, fpInput);
+						h = PeekInput(1)[0];	// Block header of channel 2
 						typ = h >> 6;
 						flag = h & 0x20;
-						fseek(fpInput, -1, SEEK_CUR);
 
 						if ((typ == 0x03) || ((typ < 0x02) && flag))	// Channel 2 = difference signal
 						{
@@ -796,7 +1072,7 @@ short CLpacDecoder::DecodeFrame()
 								for (i = -P; i < 0; i++)
 									x[c1][i] -= x[c][i];
 							}
-							DecodeBlock(x[c1], Nb[b], RAframe && (b == 0));
+							DecodeBlock(x[c1], Nb[b], RAframe && (b == 0), c1);
 
 							if (!(RAframe && (b == 0))) {
 								/* Restore P samples from the previous block */
@@ -810,7 +1086,7 @@ short CLpacDecoder::DecodeFrame()
 						}
 						else											// Channel 2 = normal signal
 						{
-							DecodeBlock(x[c1], Nb[b], RAframe && (b == 0));
+							DecodeBlock(x[c1], Nb[b], RAframe && (b == 0), c1);
 						}
 					}
 					// Increment pointers (except for last subblock)
@@ -827,7 +1103,7 @@ short CLpacDecoder::DecodeFrame()
 			{
 				for (b = 0; b < B; b++)
 				{
-					DecodeBlock(x[c], Nb[b], RAframe && (b == 0));
+					DecodeBlock(x[c], Nb[b], RAframe && (b == 0), c);
 
 					// Increment pointers (except for last subblock)
 					if (b < B - 1)
@@ -868,11 +1144,13 @@ short CLpacDecoder::DecodeFrame()
 					{
 						rlslms_ptr.channel=c0;
 						DecodeBlockParameter( &MccBuf, c0, N, RAframe);
+						if (Trace.IsEnabled()) Trace.AddBlock(TraceBlock, c0);
 						DecodeBlockReconstructRLSLMS( &MccBuf, c0, x[c0]);
 						synthesize(x[c0], N, &rlslms_ptr, RAframe || RLSLMS_ext==7, &MccBuf);
 
 						rlslms_ptr.channel=c1;
 						DecodeBlockParameter( &MccBuf, c1, N, RAframe);
+						if (Trace.IsEnabled()) Trace.AddBlock(TraceBlock, c1);
 						DecodeBlockReconstructRLSLMS( &MccBuf,  c1, x[c1]);
 
 						synthesize(x[c1], N, &rlslms_ptr, RAframe || RLSLMS_ext==7, &MccBuf);
@@ -887,8 +1165,10 @@ short CLpacDecoder::DecodeFrame()
 						char *xpr1=&MccBuf.m_xpara[c1];
 						
 						DecodeBlockParameter( &MccBuf, c0, N, RAframe);
+						if (Trace.IsEnabled()) Trace.AddBlock(TraceBlock, c0);
 						DecodeBlockReconstructRLSLMS( &MccBuf, c0, x[c0]);
 						DecodeBlockParameter( &MccBuf, c1, N, RAframe);
+						if (Trace.IsEnabled()) Trace.AddBlock(TraceBlock, c1);
 						DecodeBlockReconstructRLSLMS( &MccBuf, c1, x[c1]);
 						rlslms_ptr.channel=c0;
 						synthesize_joint(x[c0],x[c1], N, &rlslms_ptr, RAframe || RLSLMS_ext==7, mono_frame, &MccBuf);
@@ -901,6 +1181,7 @@ short CLpacDecoder::DecodeFrame()
 			{
 				c0 = sce+2*(Chan/2);
 				DecodeBlockParameter( &MccBuf, c0, N, RAframe);
+				if (Trace.IsEnabled()) Trace.AddBlock(TraceBlock, c0);
 				DecodeBlockReconstructRLSLMS( &MccBuf, c0, x[c0]);
 				rlslms_ptr.channel=c0;
 				synthesize(x[c0], N, &rlslms_ptr, RAframe || RLSLMS_ext==7, &MccBuf);
@@ -937,6 +1218,12 @@ short CLpacDecoder::DecodeFrame()
 
 			// get #blocks B and block lengths Nb[]
 			B = GetBlockSequence(BSflags, NN, Nb);
+
+			if (Trace.IsEnabled())
+			{
+				for (c = 0; c < Chan; c++)
+					Trace.SetBlockSwitching(c, BSflags);
+			}
 		}
 		else		// fixed block length (= frame length)
 		{
@@ -959,7 +1246,10 @@ short CLpacDecoder::DecodeFrame()
 			InitMccDecBuffer( &MccBuf );
 
 			for(c = 0; c < Chan; c++)
+			{
 				DecodeBlockParameter( &MccBuf, c, Nb[b], RAframe && (b == 0)); // Get residual and parameter
+				if (Trace.IsEnabled()) Trace.AddBlock(TraceBlock, c);
+			}
 
 			for(oaa = 0; oaa < OAA; oaa++)
 			{
@@ -996,6 +1286,19 @@ short CLpacDecoder::DecodeFrame()
 	for (c = 0; c < Chan; c++)
 		memcpy(x[c] - P, x[c] + (N - P), P * sizeof(int));
 
+	// Output window set by Seek() and DecodeRange()
+	window = (OutSkip > 0) || (OutLeft >= 0);
+	skip = static_cast<long>( min(OutSkip, static_cast<ALS_INT64>( N )) );
+	count = N - skip;
+	if ((OutLeft >= 0) && (count > OutLeft))
+		count = static_cast<long>( OutLeft );
+	OutSkip -= skip;
+	if (OutLeft >= 0)
+		OutLeft -= count;
+	OutFirst = skip;
+	OutCount = count;
+	fpOut = (window || PullOutput) ? NULL : fpOutput;
+
 	// Write PCM audio data
 	if ( SampleType == SAMPLE_TYPE_INT )
 	{
@@ -1010,22 +1313,22 @@ short CLpacDecoder::DecodeFrame()
 
 		if (Res == 16)
 		{
-			if ((Write16BitNM(x, Chan, N, MSBfirst, bbuf, fpOutput) != 2L*Chan*N) && (fpOutput != NULL)) return(-1);
+			if ((Write16BitNM(x, Chan, N, MSBfirst, bbuf, fpOut) != 2L*Chan*N) && (fpOut != NULL)) return(-1);
 			CRC = CalculateBlockCRC32(2L*Chan*N, CRC, (void*)bbuf);
 		}
 		else if (Res == 8)
 		{
-			if ((Write8BitOffsetNM(x, Chan, N, bbuf, fpOutput) != (long)Chan*N) && (fpOutput != NULL)) return(-1);
+			if ((Write8BitOffsetNM(x, Chan, N, bbuf, fpOut) != (long)Chan*N) && (fpOut != NULL)) return(-1);
 			CRC = CalculateBlockCRC32((long)Chan*N, CRC, (void*)bbuf);
 		}
 		else if (Res == 24)
 		{
-			if ((Write24BitNM(x, Chan, N, MSBfirst, bbuf, fpOutput) != 3L*Chan*N) && (fpOutput != NULL)) return(-1);
+			if ((Write24BitNM(x, Chan, N, MSBfirst, bbuf, fpOut) != 3L*Chan*N) && (fpOut != NULL)) return(-1);
 			CRC = CalculateBlockCRC32(3L*Chan*N, CRC, (void*)bbuf);
 		}
 		else	// Res == 32
 		{
-			if ((Write32BitNM(x, Chan, N, MSBfirst, bbuf, fpOutput) != 4L*Chan*N) && (fpOutput != NULL)) return(-1);
+			if ((Write32BitNM(x, Chan, N, MSBfirst, bbuf, fpOut) != 4L*Chan*N) && (fpOut != NULL)) return(-1);
 			CRC = CalculateBlockCRC32(4L*Chan*N, CRC, (void*)bbuf);
 		}
 
@@ -1043,34 +1346,135 @@ short CLpacDecoder::DecodeFrame()
 		Float.ReformatData( x, N );
 
 	if ( SampleType == SAMPLE_TYPE_FLOAT ) {
+		if ( Trace.IsEnabled() ) TraceFloat = ftell( fpInput );
 		if ( !Float.DecodeDiff( fpInput, N, RAframe != 0 ) ) return -1;
+		if ( Trace.IsEnabled() ) TraceFloat = ftell( fpInput ) - TraceFloat;
 		if ( !Float.AddIEEEDiff( N ) ) return -1;
 		if ( ChanSort ) Float.ChannelSort( ChPos, false );
 		Float.ConvertFloatToRBuff( bbuf, N );
 		if ( ChanSort ) Float.ChannelSort( ChPos, true );
 
 		// Write floating point data into output file
-		if ( fwrite( bbuf, 1, N * Chan * IEEE754_BYTES_PER_SAMPLE, fpOutput ) != N * Chan * IEEE754_BYTES_PER_SAMPLE ) {
+		if ( !window && !PullOutput && ( fwrite( bbuf, 1, N * Chan * IEEE754_BYTES_PER_SAMPLE, fpOutput ) != N * Chan * IEEE754_BYTES_PER_SAMPLE ) ) {
 			// Write error
 			return -1;
 		}
 		CRC = CalculateBlockCRC32( Chan * N * IEEE754_BYTES_PER_SAMPLE, CRC, static_cast<void*>( bbuf ) );
 	}
 
-	delete [] xsave;
-	delete [] xtmp;
+	// Write the part of the frame inside the output window
+	if (window && !PullOutput && (count > 0))
+	{
+		bytes = ( SampleType == SAMPLE_TYPE_FLOAT ) ? IEEE754_BYTES_PER_SAMPLE : Res / 8;
+		if (fwrite(bbuf + skip * Chan * bytes, 1, count * Chan * bytes, fpOutput) != static_cast<ALS_UINT32>( count * Chan * bytes )) return(-1);
+	}
+
+	if (Trace.IsEnabled() && !Trace.EndFrame(static_cast<long>(ftell(fpInput) - TraceStart), static_cast<long>(TraceFloat), MCCflag != 0))
+		return(-1);
 
 	return(0);
 }
 
+// Decode the next frame into one int buffer per channel (PCM_PLANAR_INT32), without output to
+// a file. planar[c] must hold GetFrameLength() samples. Integer audio only.
+// count and pos receive the number of samples and the position of the first one.
+// Returns 1 if a frame has been decoded, 0 at the end of the stream, -1 on a decoding error,
+// or -2 if the audio data is not available in this format.
+short CLpacDecoder::DecodeNextFrame( int **planar, long *count, ALS_INT64 *pos )
+{
+	return(DecodeNextFrame(static_cast<void*>(planar), PCM_PLANAR_INT32, count, pos));
+}
+
+// Decode the next frame into an interleaved buffer in the given format (PCM_INT16 ...), without
+// output to a file. pcm must hold GetFrameLength() samples of all channels.
+// After Seek(), the first frame starts at the requested sample.
+// Return values as above. WriteTrailer() after the last frame checks the CRC.
+short CLpacDecoder::DecodeNextFrame( void *pcm, short format, long *count, ALS_INT64 *pos )
+{
+	int **xo;
+	long c;
+	short result;
+
+	*count = 0;
+	if ((pcm == NULL) || (format < PCM_PLANAR_INT32) || (format > PCM_FLOAT32) ||
+		((format == PCM_PLANAR_INT32) && (SampleType == SAMPLE_TYPE_FLOAT)))
+		return(-2);
+	if (fid >= frames)
+		return(0);
+
+	*pos = fid * Nframe;
+	PullOutput = true;
+	result = DecodeFrame();
+	PullOutput = false;
+	if (result)
+		return(-1);
+	*pos += OutFirst;
+	*count = OutCount;
+
+	if (SampleType == SAMPLE_TYPE_FLOAT)
+	{
+		// bbuf holds the samples as IEEE 754 floats in the original channel order
+		ConvertFloatNM(bbuf + OutFirst * Chan * IEEE754_BYTES_PER_SAMPLE, Chan, OutCount, pcm, format);
+		return(1);
+	}
+
+	// Samples of the output window in the original channel order
+	CAlsScratchScope Frame(Scratch);
+	xo = Scratch.Get<int*>(Chan);
+	for (c = 0; c < Chan; c++)
+		xo[ChanSort ? ChPos[c] : c] = x[c] + OutFirst;
+
+	if (format == PCM_PLANAR_INT32)
+	{
+		for (c = 0; c < Chan; c++)
+			memcpy(static_cast<int**>(pcm)[c], xo[c], OutCount * sizeof(int));
+	}
+	else
+		ConvertIntNM(xo, Chan, OutCount, Res, pcm, format);
+
+	return(1);
+}
+
 // Decode block (Normal)
-short CLpacDecoder::DecodeBlock(int *x, long Nb, short ra)
+short CLpacDecoder::DecodeBlock(int *x, long Nb, short ra, long Channel)
 {
 	DecodeBlockParameter(&MccBuf, 0, Nb, ra);
+	if (Trace.IsEnabled())
+		Trace.AddBlock(TraceBlock, Channel);
 	DecodeBlockReconstruct(&MccBuf, 0, x, Nb, ra);
 	return (0);
 }
 
+// Look at the next size bytes of the input without consuming them.
+// Mapped, buffered and memory inputs are parsed in place; at the end of the
+// stream the rest is copied into tmpbuf, so the bit reader may run past it.
+// Only inputs which cannot peek are read into tmpbuf and stepped back.
+unsigned char *CLpacDecoder::PeekInput(long size)
+{
+	const unsigned char *p;
+	ALS_UINT32 avail;
+	long count;
+
+	p = fpeek(fpInput, size, &avail);
+	if (p && (avail >= (ALS_UINT32)size))
+		return const_cast<unsigned char*>(p);
+	if (p)
+	{
+		memcpy(tmpbuf, p, avail);
+		return tmpbuf;
+	}
+	count = fread(tmpbuf, 1, size, fpInput);
+	if (count > 0)
+		fseek(fpInput, -count, SEEK_CUR);
+	return tmpbuf;
+}
+
+// Consume bytes of the input which have been parsed after PeekInput().
+void CLpacDecoder::ConsumeInput(long bytes)
+{
+	fseek(fpInput, bytes, SEEK_CUR);
+}
+
 // Decode block parameter
 void CLpacDecoder::DecodeBlockParameter(MCC_DEC_BUFFER *pBuffer, long Channel, long Nb, short ra)
 {
@@ -1089,7 +1493,7 @@ void CLpacDecoder::DecodeBlockParameter(MCC_DEC_BUFFER *pBuffer, long Channel, l
 	BYTE h, hl[4];
 	short BlockType, optP, shift = 0;
 	int c;
-	long count, bytes, i, Ns;
+	long bytes, i, Ns;
     int asi[1023];
     int parq[1023];
 	UINT u;
@@ -1139,14 +1543,28 @@ void CLpacDecoder::DecodeBlockParameter(MCC_DEC_BUFFER *pBuffer, long Channel, l
 
     optP = 10;
 
-	// Read block header
-	fread(&h, 1, 1, fpInput);
+	// Decision trace
+	ALS_TRACEBLOCK *pTrace = Trace.IsEnabled() ? &TraceBlock : NULL;
+	if (pTrace)
+		CAlsTrace::ClearBlock(*pTrace, Nb, ra != 0);
+
+	// Read block header (a normal block parses it again with the rest)
+	h = PeekInput(1)[0];
 	BlockType = h >> 6;			// Type of block
+	if (BlockType <= 1)
+		ConsumeInput(1);
 
 	// ZERO BLOCK
 	if (BlockType == 0)
 	{
 		*xpra=1;
+		if (pTrace)
+		{
+			pTrace->m_Type = TRACE_BLOCK_ZERO;
+			pTrace->m_Diff = (h & 0x20) ? 1 : 0;
+			pTrace->m_Bits[TRACE_PART_HEADER] = 8;
+			pTrace->m_Bytes = 1;
+		}
 	}
 	// CONSTANT BLOCK
 	else if (BlockType == 1)
@@ -1172,17 +1590,21 @@ void CLpacDecoder::DecodeBlockParameter(MCC_DEC_BUFFER *pBuffer, long Channel, l
 		
 		d[0] = c;
 		*xpra=2;
+		if (pTrace)
+		{
+			pTrace->m_Type = TRACE_BLOCK_CONST;
+			pTrace->m_Diff = (h & 0x20) ? 1 : 0;
+			pTrace->m_Bytes = 1 + (IntRes + 7) / 8;
+			pTrace->m_Bits[TRACE_PART_HEADER] = 8 * pTrace->m_Bytes;
+		}
 	}
 	// NORMAL BLOCK
 	else if (BlockType > 1)
 	{
-		fseek(fpInput, -1, SEEK_CUR);	// Go back one byte which was already read
 		// following buffer size is enough if only forward predictor is used.
 		//		count = fread(tmpbuf, 1, (((long)((IntRes+7)/8)+1)*Nb + 4*P + 128), fpInput);   // Fill input buffer
         // for RLS-LMS
-		count = fread(tmpbuf, 1, long(IntRes/8+10) * Nb + P + 16 + 255*4, fpInput);   // Fill input buffer
-
-        in.InitBitRead(tmpbuf);
+        in.InitBitRead(PeekInput(long(IntRes/8+10) * Nb + P + 16 + 255*4));   // Fill input buffer
 		
 		in.ReadBits(&u, 2);		// 1J
 
@@ -1254,6 +1676,20 @@ void CLpacDecoder::DecodeBlockParameter(MCC_DEC_BUFFER *pBuffer, long Channel, l
 			in.ReadBits(&u, 4);
 			shift = short(u + 1);
 		}
+		if (pTrace)
+		{
+			pTrace->m_Type = TRACE_BLOCK_NORMAL;
+			pTrace->m_Diff = (BlockType == 3) ? 1 : 0;
+			pTrace->m_Bgmc = BGMC ? 1 : 0;
+			pTrace->m_Shift = shift;
+			pTrace->m_Sub = sub;
+			for (i = 0; i < sub; i++)
+			{
+				pTrace->m_S[i] = s[i];
+				pTrace->m_Sx[i] = BGMC ? sx[i] : 0;
+			}
+			CAlsTrace::Mark(*pTrace, TRACE_PART_HEADER, &in.bio);
+		}
 		if (!RLSLMS)
 		{
 			if (Adapt)
@@ -1265,6 +1701,8 @@ void CLpacDecoder::DecodeBlockParameter(MCC_DEC_BUFFER *pBuffer, long Channel, l
 			}
 			else
 				optP = P;
+			if (pTrace)
+				CAlsTrace::Mark(*pTrace, TRACE_PART_HEADER, &in.bio);
 
 			/* decode quantized coefficients: */
 			if (CoefTable == 3)
@@ -1293,8 +1731,19 @@ void CLpacDecoder::DecodeBlockParameter(MCC_DEC_BUFFER *pBuffer, long Channel, l
 			for (i = 2; i < optP; i++)
 				parq[i] = (asi[i] << (Q -6)) + (1 << (Q-7));
 		}
+		if (pTrace)
+		{
+			pTrace->m_OptP = optP;
+			CAlsTrace::Mark(*pTrace, TRACE_PART_COEF, &in.bio);
+		}
 
 		if(PITCH) pBuffer->m_Ltp.Decode( Channel, Nb, Freq, &in );
+		if (pTrace && PITCH)
+		{
+			pTrace->m_Ltp = pBuffer->m_Ltp.m_pBuffer[Channel].m_ltp;
+			pTrace->m_Lag = pTrace->m_Ltp ? pBuffer->m_Ltp.m_pBuffer[Channel].m_plag : 0;
+			CAlsTrace::Mark(*pTrace, TRACE_PART_LTP, &in.bio);
+		}
 
 		Ns = Nb / sub;
 		if (!ra)	// No random access
@@ -1332,6 +1781,8 @@ void CLpacDecoder::DecodeBlockParameter(MCC_DEC_BUFFER *pBuffer, long Channel, l
 				bgmc_decode_blocks(d, num, s, sx, Nb, sub, &in.bio);
 			}
 		}
+		if (pTrace)
+			CAlsTrace::Mark(*pTrace, TRACE_PART_RESIDUAL, &in.bio);
 
 		for(i = 0; i < optP; i++)
 			mccparq[i] = parq[i];
@@ -1342,7 +1793,9 @@ void CLpacDecoder::DecodeBlockParameter(MCC_DEC_BUFFER *pBuffer, long Channel, l
 		if (!RLSLMS && !MCCflag)
 		{
 			bytes = in.EndBitRead();					// Number of bytes read
-			fseek(fpInput, bytes - count, SEEK_CUR);	// Set working pointer to current position
+			ConsumeInput(bytes);						// Set working pointer to current position
+			if (pTrace)
+				pTrace->m_Bytes += bytes;
 		}
 	}
 
@@ -1350,54 +1803,64 @@ void CLpacDecoder::DecodeBlockParameter(MCC_DEC_BUFFER *pBuffer, long Channel, l
 	{
 		if (BlockType<=1)
 		{
-			count = fread(tmpbuf, 1, 400, fpInput);   // Fill input buffer
-			in.InitBitRead(tmpbuf);
+			in.InitBitRead(PeekInput(400));   // Fill input buffer
 		}
 		in.ReadBits(&u,1);
 		mono_frame = u;
+		if (pTrace)
+		{
+			pTrace->m_MonoFrame = mono_frame;
+			pTrace->m_RlsExt = 0;
+		}
 		in.ReadBits(&u,1);
 		if (u!=0)
 		{
 			in.ReadBits(&u,3);
 			RLSLMS_ext = u;
+			if (pTrace)
+				pTrace->m_RlsExt = RLSLMS_ext;
 			//printf("%d %d ",RLSLMS_ext,optP);
 			if (RLSLMS_ext&0x01) 
 			{
-				c_mode_table.filter_len[0]=1;
+				rlslms_ptr.c_mode_table.filter_len[0]=1;
 				in.ReadBits(&u,4);
-				c_mode_table.filter_len[1]=(u)<<1;
+				rlslms_ptr.c_mode_table.filter_len[1]=(u)<<1;
 				in.ReadBits(&u,3);
-				c_mode_table.nstage=u+2;
-				for(i=2;i<c_mode_table.nstage;i++)
+				rlslms_ptr.c_mode_table.nstage=u+2;
+				for(i=2;i<rlslms_ptr.c_mode_table.nstage;i++)
 				{
 					in.ReadBits(&u,5);
-					c_mode_table.filter_len[i]=lms_order_table[u];						
+					rlslms_ptr.c_mode_table.filter_len[i]=lms_order_table[u];						
 				}
 			}
 			if (RLSLMS_ext&0x02)
 			{
-				if (c_mode_table.filter_len[1]){
+				if (rlslms_ptr.c_mode_table.filter_len[1]){
 					in.ReadBits(&u,10);
-					c_mode_table.lambda[0]=u;
+					rlslms_ptr.c_mode_table.lambda[0]=u;
 					in.ReadBits(&u,10);
-					c_mode_table.lambda[1]=u;
+					rlslms_ptr.c_mode_table.lambda[1]=u;
 				}
 			}
 			if (RLSLMS_ext&0x04)
 			{
-				for(i=2;i<c_mode_table.nstage;i++)
+				for(i=2;i<rlslms_ptr.c_mode_table.nstage;i++)
 				{
 					in.ReadBits(&u,5);
-					c_mode_table.opt_mu[i]=mu_table[u];
+					rlslms_ptr.c_mode_table.opt_mu[i]=mu_table[u];
 				}
 				in.ReadBits(&u,3);
-				c_mode_table.step_size=u*LMS_MU_INT;
+				rlslms_ptr.c_mode_table.step_size=u*LMS_MU_INT;
 			}
 		}
+		if (pTrace)
+			CAlsTrace::Mark(*pTrace, TRACE_PART_RLSLMS, &in.bio);
 		if(!MCCflag)
 		{
 			bytes = in.EndBitRead();					// Number of bytes read
-			fseek(fpInput, bytes - count, SEEK_CUR);	// Set working pointer to current position
+			ConsumeInput(bytes);						// Set working pointer to current position
+			if (pTrace)
+				pTrace->m_Bytes += bytes;
 		}
 	}
 
@@ -1406,8 +1869,7 @@ void CLpacDecoder::DecodeBlockParameter(MCC_DEC_BUFFER *pBuffer, long Channel, l
 	{
 		if ( (BlockType<=1) && !RLSLMS)
 		{
-			count = fread(tmpbuf, 1, 256, fpInput);   // Fill input buffer
-			in.InitBitRead(tmpbuf);
+			in.InitBitRead(PeekInput(256));   // Fill input buffer
 		}
 
 		for (oaa = 0; oaa < OAA+1; oaa++)
@@ -1460,10 +1922,21 @@ void CLpacDecoder::DecodeBlockParameter(MCC_DEC_BUFFER *pBuffer, long Channel, l
 				for(i = 0; i < Mtap; i++)
 						mtgmm[oaa][i] += 16;
 			}
+			if (pTrace && (oaa < TRACE_MAX_MCC))
+			{
+				pTrace->m_MccRef[oaa] = puch[oaa];
+				pTrace->m_MccMode[oaa] = (puch[oaa] == Channel) ? 0 : MccMode[oaa];
+				pTrace->m_MccTau[oaa] = ((puch[oaa] == Channel) || (MccMode[oaa] == 1)) ? 0 : tdtauval[oaa];
+				pTrace->m_MccStages = oaa + 1;
+			}
 		}
 		CheckAlsProfiles_MCCStages(ConformantProfiles, oaa);
+		if (pTrace)
+			CAlsTrace::Mark(*pTrace, TRACE_PART_MCC, &in.bio);
 		bytes = in.EndBitRead();					// Number of bytes read
-		fseek(fpInput, bytes - count, SEEK_CUR);	// Set working pointer to current position
+		ConsumeInput(bytes);						// Set working pointer to current position
+		if (pTrace)
+			pTrace->m_Bytes += bytes;
 	}
 }
 
@@ -1477,6 +1950,7 @@ short	CLpacDecoder::DecodeBlockReconstruct( MCC_DEC_BUFFER* pBuffer, long Channe
 	short	xpara = pBuffer->m_xpara[Channel];
 	long	i;
 	int*	xtmp;
+	CAlsScratchScope	Scope( Scratch );
 
 	if ( xpara == 1 ) {
 		memset( x, 0, sizeof(int) * Nb );
@@ -1486,7 +1960,7 @@ short	CLpacDecoder::DecodeBlockReconstruct( MCC_DEC_BUFFER* pBuffer, long Channe
 
 	} else {
 		if ( shift ) {
-			xtmp = new int [optP];
+			xtmp = Scratch.Get<int>( optP );
 			// "Shift" last P samples of previous block
 			for( i=-optP; i<0; i++ ) {
 				xtmp[optP+i] = x[i];		// buffer original values
@@ -1522,7 +1996,6 @@ short	CLpacDecoder::DecodeBlockReconstruct( MCC_DEC_BUFFER* pBuffer, long Channe
 			// Undo "shift" of whole block (and restore optP samples of the previous block)
 			for( i=-optP; i<0; i++ ) x[i] = xtmp[optP+i];
 			for( i=0; i<Nb; i++ ) x[i] <<= shift;
-			delete[] xtmp;
 		}
 	}
 	return 0;
@@ -1582,6 +2055,20 @@ short CLpacDecoder::DecodeBlockReconstructRLSLMS(MCC_DEC_BUFFER *pBuffer, long C
 	return(0);
 }
 
+// Follow the RAU sizes in the frames until the position of RAU r is known.
+// Returns true if it is known.
+bool CLpacDecoder::LocateRau( long r )
+{
+	while ((RAUknown <= r) && (RAflag == 1))
+	{
+		if (fseek(fpInput, RAUpos[RAUknown-1], SEEK_SET))
+			return(false);
+		RAUpos[RAUknown] = RAUpos[RAUknown-1] + 4 + ReadUIntMSBfirst(fpInput);
+		RAUknown++;
+	}
+	return(RAUknown > r);
+}
+
 bool	CLpacDecoder::CopyData( const char* pFilename, ALS_UINT64 Offset, ALS_UINT64 Size, HALSSTREAM hOutFile )
 {
 	HALSSTREAM	hInFile = NULL;
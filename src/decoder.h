@@ -98,6 +98,8 @@ contents : Header file for decoder.cpp
 #include "stream.h"
 #include "als2mp4.h"
 #include "profiles.h"
+#include "trace.h"
+#include "scratch.h"
 
 class CLpacDecoder
 {
@@ -128,6 +130,7 @@ protected:
 	ALS_INT64 HeaderSize;	// Length of file header (in bytes)
 	ALS_INT64 TrailerSize;	// Number of trailing non-audio bytes
 	ALS_INT64 TrailerOffset;	// Trailer offset
+	unsigned char *TrailerData;	// Trailer kept in memory (NULL: read again from TrailerOffset)
 
 	ALS_INT64 frames;			// Number of frames
 	ALS_INT64 fid;				// Current frame
@@ -147,6 +150,16 @@ protected:
 	long RAUid;				// current RAU
 	unsigned int *RAUsize;	// sizes of RAUs
 	unsigned int CRCorg;	// original (transmitted) CRC value
+	ALS_INT64 *RAUpos;		// positions of RAUs in the input stream
+	long RAUknown;			// number of valid entries in RAUpos
+	long Nframe;			// frame length (N is shortened in the last frame)
+	ALS_INT64 OutSkip;		// number of samples to drop before output
+	ALS_INT64 OutLeft;		// number of samples left to output (-1 = no limit)
+	bool PullOutput;		// true: DecodeFrame() keeps the samples for DecodeNextFrame()
+	long OutFirst;			// first sample of the last frame inside the output window
+	long OutCount;			// number of samples of the last frame inside the output window
+	const char *IndexFile;	// seek index file (NULL = none)
+	bool BuildIndex;		// find all RAU positions in WriteHeader()
 	short AUXenabled;		// AUX data present
 
 	HALSSTREAM	fpInput;		// Input file
@@ -160,6 +173,7 @@ protected:
 
 	CFloat			Float;		// Floating point class
 	MCC_DEC_BUFFER	MccBuf;		// Buffer for multi-channel correlation
+	CAlsScratch	Scratch;		// Per-frame work buffers (sized in WriteHeader())
 
 	// RLSLMS related variables
 	short mono_frame;        // frame is mono
@@ -168,6 +182,9 @@ protected:
 
 	ALS_PROFILES ConformantProfiles;
 
+	CAlsTrace Trace;			// Trace of the coding decisions
+	ALS_TRACEBLOCK TraceBlock;	// Last parsed block
+
 public:
 	short MCCflag;				// Multi-channel correlation
 	CLpacDecoder();				// Constructor
@@ -178,20 +195,35 @@ public:
 	short AnalyseInputFile(AUDIOINFO *ainfo, ENCINFO *encinfo, const MP4INFO& Mp4Info);
 	short OpenOutputFile( const char *name ) { CloseOutput = ( OpenFileWriter( name, &fpOutput ) == 0 ); return CloseOutput ? 0 : 1; }
 	short SetOutputStream( HALSSTREAM hStream ) { fpOutput = hStream; CloseOutput = false; return 0; }
-	ALS_INT64 WriteHeader( const MP4INFO& Mp4Info );
+	ALS_INT64 WriteHeader( const MP4INFO& Mp4Info, bool CopyHeader = true );
 	ALS_INT64 WriteTrailer( const MP4INFO& Mp4Info );
 	short DecodeAll( const MP4INFO& Mp4Info );
 	short DecodeFrame();		// Decode one frame
+	short DecodeNextFrame( int **planar, long *count, ALS_INT64 *pos );			// Decode one frame into channel buffers
+	short DecodeNextFrame( void *pcm, short format, long *count, ALS_INT64 *pos );	// Decode one frame into an interleaved buffer
+	long GetFrameLength() const { return Nframe; }			// Maximum number of samples per frame
+	short SetRauIndex( const ALS_INT64 *pos, long units );	// Set RAU positions for Seek()
+	short Seek( ALS_INT64 sample );							// Continue decoding at any sample
+	ALS_INT64 DecodeRange( ALS_INT64 start, ALS_INT64 count );	// Decode part of the audio data
+	ALS_INT64 GetFrameIndex() const { return fid; }			// Number of the next frame (0-)
+	void SetSeekIndex( const char *name, bool build ) { IndexFile = name; BuildIndex = build; }	// Seek index for WriteHeader()
+	short BuildRauIndex();									// Find all RAU positions
+	short ReadRauIndex( const char *name );					// Load RAU positions from a seek index file
+	short WriteRauIndex( const char *name );				// Save RAU positions into a seek index file
 	unsigned int GetCRC();
 	ALS_PROFILES GetConformantProfiles() const { return ConformantProfiles; }
+	void SetTrace(CAlsTraceSink *pSink) { Trace.SetSink(pSink); }	// Trace the coding decisions (NULL: off)
 
 protected:
-	short DecodeBlock(int *x, long Nb, short ra);			// Decode one block
+	short DecodeBlock(int *x, long Nb, short ra, long Channel);	// Decode one block
 	void  DecodeBlockParameter(MCC_DEC_BUFFER *pBuffer, long Channel, long Nb, short ra);
 	short DecodeBlockReconstruct(MCC_DEC_BUFFER *pBuffer, long Channel, int *x, long Nb, short ra);
 	void  DecodeBlockParameterRLSLMS(MCC_DEC_BUFFER *pBuffer, long Channel);
 	short DecodeBlockReconstructRLSLMS(MCC_DEC_BUFFER *pBuffer, long Channel, int *x);
 	bool CopyData( const char* pFilename, ALS_UINT64 Offset, ALS_UINT64 Size, HALSSTREAM hOutFile );
 	bool CopyData( HALSSTREAM hInFile, ALS_UINT64 Size, HALSSTREAM hOutFile );
+	bool LocateRau( long r );
+	unsigned char *PeekInput(long size);		// Look ahead in the input without consuming it
+	void ConsumeInput(long bytes);				// Skip input bytes parsed after PeekInput()
 };
 
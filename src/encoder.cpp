@@ -263,6 +263,7 @@ contents : Implementation of the CLpacEncoder class
 #include "stream.h"
 
 #define PI 3.14159265359
+#define SINK_PART_SIZE 1048576		// Bytes of an unfinished RAU kept in sink mode
 
 #define min(a, b)  (((a) < (b)) ? (a) : (b))
 #define max(a, b)  (((a) > (b)) ? (a) : (b))
@@ -322,6 +323,13 @@ CLpacEncoder::CLpacEncoder()
 	frames = 0;
 	mp4file = false;
 	oafi_flag = false;
+	pSink = NULL;
+	AudioTop = 0;
+	RauSamples = 0;
+	SinkBytes = 0;
+	ra_bytes = 0;
+	PushMode = false;
+	PushFill = 0;
 
 	ALSProfFillSet( ConformantProfiles );
 	ALSProfEmptySet( EnforcedProfiles );
@@ -347,9 +355,11 @@ CLpacEncoder::~CLpacEncoder()
 			{
 				delete [] rlslms_ptr.pbuf[i];
 				delete [] rlslms_ptr.weight[i];
+				delete [] rlslms_ptr.Pmatrix[i];
 			}
 			delete [] rlslms_ptr.pbuf;
 			delete [] rlslms_ptr.weight;
+			delete [] rlslms_ptr.Pmatrix;
 		}
 
 		delete [] tmpbuf1;
@@ -388,6 +398,7 @@ CLpacEncoder::~CLpacEncoder()
 		if ( SampleType == SAMPLE_TYPE_FLOAT ) Float.FreeBuffer();
 		// Deallocate MCC buffer
 		FreeMccEncBuffer ( &MccBuf );
+		Scratch.Free();
 		for (i = 0; i < Chan; i++)
 			delete [] tmpbuf_MCC[i];
 		delete [] tmpbuf_MCC;
@@ -413,15 +424,61 @@ short CLpacEncoder::CloseFiles()
 		fpOutput = NULL;
 		CloseOutput = false;
 	}
+	SinkBuffer.Close();
+	PushBuffer.Close();
 	return 0;
 }
 
+///////////////////////////////////////////////////////////////////////////////////////////////////
+// Hand the encoded bitstream to pRauSink instead of writing a file.
+// The ALS header is kept in memory and each RAU is passed on as soon as its last frame is
+// encoded, so no intermediate ALS file is needed for MP4 output.
+// pRauSink = receiver of header and RAUs (must outlive the encoder's output)
+// oafi = true:Use oafi / false:Do not use oafi
+short CLpacEncoder::SetOutputSink( CAlsRauSink *pRauSink, bool oafi )
+{
+	mp4file = true;
+	oafi_flag = oafi;
+	pSink = pRauSink;
+	AudioTop = 0;
+	RauSamples = 0;
+	SinkBytes = 0;
+	if ( !SinkBuffer.Open() ) return 1;
+	CloseOutput = ( OpenStream( &SinkBuffer, &fpOutput ) == 0 );
+	return CloseOutput ? 0 : 1;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+// Pass the frames of the current RAU to pSink and drop them from SinkBuffer
+// complete = true: RAU is finished / false: only pass the frames encoded so far
+bool CLpacEncoder::FlushRau( bool complete )
+{
+	ALS_UINT32 size = SinkBuffer.GetSize() - AudioTop;
+
+	if ( complete )
+	{
+		if ( RauSamples >> 32 ) return false;
+		if ( !mp4file && RA && ( RAflag == 1 ) )
+		{
+			// ALS stream: fill in the RAU size in front of its first frame
+			if ( ( size < 4 ) || ( fseek( fpOutput, AudioTop, SEEK_SET ) != 0 ) ) return false;
+			WriteUIntMSBfirst( size - 4, fpOutput );
+		}
+		if ( !pSink->WriteRau( SinkBuffer.GetBuffer() + AudioTop, size, static_cast<ALS_UINT32>( RauSamples ) ) ) return false;
+		RauSamples = 0;
+	}
+	else if ( !pSink->WriteRauPart( SinkBuffer.GetBuffer() + AudioTop, size ) ) return false;
+	SinkBytes += size;
+
+	return SinkBuffer.Truncate( AudioTop ) && ( fseek( fpOutput, AudioTop, SEEK_SET ) == 0 );
+}
+
 ///////////////////////////////////////////////////////////////////////////////////////////////////
 // Get positions of file pointers
 void CLpacEncoder::GetFilePositions(ALS_INT64 *SizeIn, ALS_INT64 *SizeOut)
 {
 	*SizeIn = ftell(fpInput);
-	*SizeOut = ftell(fpOutput);
+	*SizeOut = pSink ? SinkBuffer.GetSize() + SinkBytes : ftell(fpOutput);
 }
 
 ///////////////////////////////////////////////////////////////////////////////////////////////////
@@ -694,6 +751,7 @@ ALS_INT64 CLpacEncoder::WriteHeader(ENCINFO *encinfo)
 			RAUnits++;
 		RAUid = 0;			// RAU index (0..RAUnits-1)
 	}
+	ra_bytes = 0;
 
 	// Allocate memory (will be deallocated by the destructor)
 	xp = new int*[Chan];
@@ -710,6 +768,7 @@ ALS_INT64 CLpacEncoder::WriteHeader(ENCINFO *encinfo)
 		rlslms_ptr.pbuf = new BUF_TYPE*[Chan];
 		rlslms_ptr.weight = new W_TYPE*[Chan];
 		rlslms_ptr.Pmatrix = new P_TYPE*[Chan];
+		rlslms_ptr.old_flag = 0;
 		for (i = 0; i < Chan; i++ )
 		{
 			rlslms_ptr.pbuf[i] = new BUF_TYPE[TOTAL_LMS_LEN];
@@ -759,7 +818,7 @@ ALS_INT64 CLpacEncoder::WriteHeader(ENCINFO *encinfo)
 	else
 		NeedTdBit = 5;
 
-	AllocateMccEncBuffer( &MccBuf, Chan, N, IntRes,(1<<NeedTdBit));
+	AllocateMccEncBuffer( &MccBuf, Chan, N, IntRes,(1<<NeedTdBit), &Scratch );
 
 	// #bits/channel: NeedPuchBit = max(1,ceil(log2(Chan)))
 	i = (Chan > 1) ? (Chan-1) : 1;
@@ -797,6 +856,16 @@ ALS_INT64 CLpacEncoder::WriteHeader(ENCINFO *encinfo)
 	for (short s = 1; s <= Sub; s++)
 		buffer[s] = new unsigned char[4L*N*Chan + 4L*P + N*Chan*IEEE754_BYTES_PER_SAMPLE+100]; // Frame buffer for all channel (subblock)
 
+	// Work buffers of EncodeFrame(): channel pointers, buffers of independent channel coding
+	// for all block switching levels, then the block analysis (GetCof(), LTP) or the MCC analysis
+	size_t ScratchSize = (sizeof(int*) * 3 + sizeof(long)) * Chan
+		+ 2 * (Sub + 1) * static_cast<size_t>(max(((long)((IntRes+7)/8)+1)*N + 4*P + 128, 4L*N))
+		+ sizeof(double) * (N + P + 1) + sizeof(int) * (4L*N + P) + sizeof(double) * 2 * (N + 2048);
+	if (MCC)
+		ScratchSize += (sizeof(short) + sizeof(long) + sizeof(int*) * 2 + sizeof(int) * (Mtap + 1 + N) + 16 + sizeof(CHANDISTMAT) * 2 * Chan) * Chan
+			+ sizeof(int) * 2 * (N + 2 * ((1 << NeedTdBit) + 1)) + sizeof(double) * 2 * N;
+	Scratch.Allocate(ScratchSize);
+
 	short SubX = Sub;	// Index for block switching level
 	if (Sub)
 		SubX = (Sub < 3) ? 1 : Sub - 2;
@@ -821,7 +890,7 @@ ALS_INT64 CLpacEncoder::WriteHeader(ENCINFO *encinfo)
 
 	if (RLSLMS)
 	{
-		initCoefTable(RLSLMS, CoefTable);
+		initCoefTable(&rlslms_ptr, RLSLMS, CoefTable);
 		RLSLMS_ext = 7;
 		for(i=0;i<Chan;i++)
 		{
@@ -840,8 +909,8 @@ ALS_INT64 CLpacEncoder::WriteHeader(ENCINFO *encinfo)
 		if ( Samples >= 0xffffffff ) WriteUIntMSBfirst( 0xffffffff, fpOutput );	// samples
 		else WriteUIntMSBfirst( static_cast<ALS_UINT32>( Samples ), fpOutput );
 	} else {
-		if ( Samples >= 0xffffffff ) return ( frames = -4 );		// ALS can support samples up to 4GB.
-		WriteUIntMSBfirst( static_cast<ALS_UINT32>( Samples ), fpOutput );
+		if ( ( Samples >= 0xffffffff ) && !PushMode ) return ( frames = -4 );		// ALS can support samples up to 4GB.
+		WriteUIntMSBfirst( static_cast<ALS_UINT32>( Samples ), fpOutput );	// Push mode: 0xffffffff until Finish()
 	}
 	WriteUShortMSBfirst(USHORT(Chan - 1), fpOutput);				// channels
 
@@ -906,7 +975,6 @@ ALS_INT64 CLpacEncoder::WriteHeader(ENCINFO *encinfo)
 	if (CRCenabled)
 	{
 		// CRC initialization
-		BuildCRCTable();
 		CRC = CRC_MASK;
 		// write dummy bytes
 		if (fwrite(buff, 1, 4, fpOutput) != 4) return(frames = -2);
@@ -932,6 +1000,12 @@ ALS_INT64 CLpacEncoder::WriteHeader(ENCINFO *encinfo)
 
 	// End of header information //////////////////////////////////////////////////////////////////
 
+	if ( pSink )
+	{
+		AudioTop = static_cast<ALS_UINT32>( ftell( fpOutput ) );
+		if ( !pSink->BeginStream( SinkBuffer.GetBuffer(), AudioTop ) ) return(frames = -2);
+	}
+
 	AUDIOINFO ainfo;
 	ainfo.Chan = Chan;
 	ainfo.FileType = FileType;
@@ -968,6 +1042,13 @@ ALS_INT64 CLpacEncoder::WriteTrailer()
 {
 	long r;
 
+	if ( PushMode )
+	{
+		// Number of samples is known now
+		fseek( fpOutput, 8, SEEK_SET );
+		WriteUIntMSBfirst( static_cast<ALS_UINT32>( Samples ), fpOutput );
+	}
+
 	fseek(fpOutput, FilePos, SEEK_SET);
 	
 	if ( oafi_flag ) {
@@ -991,6 +1072,13 @@ ALS_INT64 CLpacEncoder::WriteTrailer()
 
 	fseek(fpOutput, 0, SEEK_END);
 
+	if ( pSink )
+	{
+		// Frames have all been flushed, only the completed header is left.
+		if ( ( ( SinkBuffer.GetSize() > AudioTop ) || RauSamples ) && !FlushRau( true ) ) return ( frames = -1 );
+		if ( !pSink->EndStream( SinkBuffer.GetBuffer(), AudioTop ) ) return ( frames = -1 );
+	}
+
 	return TrailerSize;
 };
 
@@ -1016,6 +1104,105 @@ short CLpacEncoder::EncodeAll()
 	return(0);
 }
 
+///////////////////////////////////////////////////////////////////////////////////////////////////
+// Start encoding of samples passed by PushSamples(), without knowing their number in advance.
+// Set the PCM format (SetChannels(), SetSampleType(), SetWordlength(), SetFrequency(), SetMSBfirst())
+// and the encoder options before. The ALS stream is passed to pRauSink: the header first, then each
+// frame (without random access) or each RAU as soon as it is complete, and the final header with the
+// number of samples and the CRC from Finish().
+// Returns the maximum number of frames, or a negative value on error (see WriteHeader()).
+ALS_INT64 CLpacEncoder::BeginPush(CAlsRauSink *pRauSink, ENCINFO *encinfo)
+{
+	if ((pRauSink == NULL) || (RAflag == 2))		// RAU sizes in the header need the length in advance
+		return(-1);
+	if ((Res != 8) && (Res != 16) && (Res != 24) && (Res != 32))
+		return(-1);
+	if (((SampleType == SAMPLE_TYPE_FLOAT) && (Res != 32)) || (Chan < 1) || (Chan > MAXCHAN))
+		return(-1);
+
+	// Raw PCM without header and trailer, the length is written by Finish()
+	FileType = 0;
+	HeaderSize = TrailerSize = 0;
+	Samples = 0xffffffff;
+	PushMode = true;
+	PushFill = 0;
+	if (!PushBuffer.Open() || OpenStream(&PushBuffer, &fpInput))
+		return(-7);
+	CloseInput = true;
+
+	// Plain ALS stream to pRauSink
+	if (SetOutputSink(pRauSink, false))
+		return(-7);
+	mp4file = false;
+
+	return(WriteHeader(encinfo));
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+// Push interleaved samples in the format given before BeginPush(). Each frame is encoded as soon
+// as it is complete. count = number of samples per channel
+// Returns 0 on success, 1 on error.
+short CLpacEncoder::PushSamples(const void *pcm, long count)
+{
+	const unsigned char *p = static_cast<const unsigned char*>(pcm);
+	long bytes = Chan * (Res / 8);
+	long n;
+
+	if (!PushMode || (frames <= 0) || (count < 0))
+		return(1);
+	if (count >= 0xffffffff - (fid * N + PushFill))		// ALS can support samples up to 4GB.
+		return(1);
+
+	while (count > 0)
+	{
+		n = (count < N - PushFill) ? count : N - PushFill;
+		if (PushBuffer.Write(p, n * bytes) != static_cast<ALS_UINT32>(n * bytes))
+			return(1);
+		p += n * bytes;
+		count -= n;
+		PushFill += n;
+
+		if (PushFill == N)
+		{
+			PushBuffer.Seek(0, NAlsImf::CBaseStream::S_BEGIN);
+			if (EncodeFrame())
+				return(1);
+			PushBuffer.Truncate(0);
+			PushFill = 0;
+		}
+	}
+	return(0);
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+// Encode the remaining samples as the last (short) frame and complete the header with the number
+// of samples and the CRC.
+// Returns 0 on success, -1 if no samples have been pushed, -2 on errors.
+short CLpacEncoder::Finish()
+{
+	if (!PushMode || (frames <= 0))
+		return(-1);
+	if ((Samples = fid * N + PushFill) == 0)
+		return(-1);
+
+	if (PushFill > 0)
+	{
+		frames = fid + 1;
+		N0 = PushFill;
+		PushBuffer.Seek(0, NAlsImf::CBaseStream::S_BEGIN);
+		if (EncodeFrame())
+			return(-2);
+		PushFill = 0;
+	}
+	else
+		frames = fid;
+
+	if (WriteTrailer() < 0)
+		return(-2);
+
+	return(0);
+}
+
 ///////////////////////////////////////////////////////////////////////////////////////////////////
 // SetXXX(): Set encoder options
 long CLpacEncoder::SetFrameLength(long N_x)
@@ -1254,7 +1441,6 @@ short CLpacEncoder::EncodeFrame()
 	long bytes_1, bytes_2 = 0, bytes_3, oaa=0;		// Bytes for blocks 1, 2, difference
 	long bpf_total = 0;						// Bytes for frame
 	long bpf_total_m = 0;						// Bytes for frame
-	static unsigned long ra_bytes = 0;		// Bytes for all frames of a RA unit
 	short RAsave, RAframe = 0;
 	long cpe, sce, c0, c1, c, c2;
 	unsigned long bytes_diff;
@@ -1264,18 +1450,22 @@ short CLpacEncoder::EncodeFrame()
 	short b, Bsub, a, B, CBS;
 	long i, NN, Nrem, Nb;
 
+	// Work buffers are released when the frame is done.
+	CAlsScratchScope Frame(Scratch);
 	int **xsave, **xssave, **xtmp;
 	long *bytes_MCC;
-	xsave = new int*[Chan];
-	xssave = new int*[(long)Chan/2];
-	xtmp = new int*[Chan];
-	bytes_MCC = new long[Chan];
+	xsave = Scratch.Get<int*>(Chan);
+	xssave = Scratch.Get<int*>((long)Chan/2);
+	xtmp = Scratch.Get<int*>(Chan);
+	bytes_MCC = Scratch.Get<long>(Chan);
 
 	long bpbi_total;						// Bytes per frame (total)
 	long bpfi[2][6];						// Bytes per frame [channel][level], independent channel coding
 	long bpbi[2][6][32];					// Bytes per block [channel][level][block], independent channel coding
-	BYTE *bufferi[2][6];					// Buffer for independent channels (locally allocated and deleted)
+	BYTE *bufferi[2][6];					// Buffer for independent channels (taken from Scratch)
 	short CheckIC = 1;						// Check independent coding (including block switching) of channel pairs
+	short indep;							// Independent coding chosen for the channel pair
+	bool TraceMcc = false;					// MCC chosen for the frame (decision trace)
     short RESET;
 	long tmp;
 	if (!Joint)
@@ -1283,6 +1473,8 @@ short CLpacEncoder::EncodeFrame()
 
 	BYTE *buffer0 = buffer[0];		// store original address of buffer[0]
 	BYTE *buffer0_m= buffer_m;
+
+	ALS_STATS_BEGIN_FRAME(Stats);
 	
 	// Block switching level
 	Bsub = Sub;
@@ -1298,32 +1490,59 @@ short CLpacEncoder::EncodeFrame()
 	if (fid == frames)			// Last frame
 		N = N0;
 
+	if (Trace.IsEnabled())
+	{
+		Trace.BeginFrame(fid - 1, N, Chan);
+		TraceCoded.resize(Chan);
+		TraceTab.resize(max(4L, Chan) * 6 * 32);
+	}
+
 	// Read audio data
 	if ( SampleType == SAMPLE_TYPE_INT ) {
 		if (Res == 16)
 		{
+			ALS_STATS_ENTER(Stats, STAGE_READ);
 			Read16BitNM(x, Chan, N, MSBfirst, bbuf, fpInput);
+			ALS_STATS_LEAVE(Stats);
+			ALS_STATS_ENTER(Stats, STAGE_CRC);
 			CRC = CalculateBlockCRC32(2L*Chan*N, CRC, (void*)bbuf);
+			ALS_STATS_LEAVE(Stats);
 		}
 		else if (Res == 8)
 		{
+			ALS_STATS_ENTER(Stats, STAGE_READ);
 			Read8BitOffsetNM(x, Chan, N, bbuf, fpInput);
+			ALS_STATS_LEAVE(Stats);
+			ALS_STATS_ENTER(Stats, STAGE_CRC);
 			CRC = CalculateBlockCRC32((long)Chan*N, CRC, (void*)bbuf);
+			ALS_STATS_LEAVE(Stats);
 		}
 		else if (Res == 24)
 		{
+			ALS_STATS_ENTER(Stats, STAGE_READ);
 			Read24BitNM(x, Chan, N, MSBfirst, bbuf, fpInput);
+			ALS_STATS_LEAVE(Stats);
+			ALS_STATS_ENTER(Stats, STAGE_CRC);
 			CRC = CalculateBlockCRC32(3L*Chan*N, CRC, (void*)bbuf);
+			ALS_STATS_LEAVE(Stats);
 		}
 		else	// Res == 32
 		{
+			ALS_STATS_ENTER(Stats, STAGE_READ);
 			Read32BitNM(x, Chan, N, MSBfirst, bbuf, fpInput);
+			ALS_STATS_LEAVE(Stats);
+			ALS_STATS_ENTER(Stats, STAGE_CRC);
 			CRC = CalculateBlockCRC32(4L*Chan*N, CRC, (void*)bbuf);
+			ALS_STATS_LEAVE(Stats);
 		}
 	} else {
 		// floating-point
+		ALS_STATS_ENTER(Stats, STAGE_READ);
 		ReadFloatNM( x, Chan, N, MSBfirst, bbuf, fpInput, Float.GetFloatBuffer() );
+		ALS_STATS_LEAVE(Stats);
+		ALS_STATS_ENTER(Stats, STAGE_CRC);
 		CRC = CalculateBlockCRC32( sizeof(float) * Chan * N, CRC, (void*)bbuf );
+		ALS_STATS_LEAVE(Stats);
 	}
 
 	if (ChanSort)
@@ -1342,9 +1561,12 @@ short CLpacEncoder::EncodeFrame()
 	{
 		if (((fid - 1) % RA) == 0)	// first frame of RA unit
 		{
-			if (RAflag == 1) 			// save random access info in frame
+			// In sink mode, RAU sizes are kept by the container and the frames go out without them.
+			if ( pSink && ( fid > 1 ) && RauSamples && !FlushRau( true ) ) return 1;
+
+			if ((RAflag == 1) && (!pSink || !mp4file))	// save random access info in frame (sink mode: size is filled in by FlushRau())
 			{
-				if (fid > 1)
+				if ((fid > 1) && !pSink)
 				{
 					// save size of RAU before its first frame
 					fseek(fpOutput, -(long)ra_bytes - 4, SEEK_CUR);	// back to the last RAU
@@ -1370,14 +1592,15 @@ short CLpacEncoder::EncodeFrame()
 	}
 
 	if ( SampleType == SAMPLE_TYPE_FLOAT ) {
+		ALS_STATS_SCOPE(Stats, STAGE_FLOAT_ANALYZE);
 		Float.ConvertFloatToInteger( x, N, RA != 0, AcfMode, AcfGain, MlzMode );
-		if ( !Float.FindDiffFloatPCM( x, N ) ) return 1;
+		Float.FindDiffFloatPCM( x, N );
 	}
 
 	if (RLSLMS)
 	{
 		if (RAframe) RLSLMS_ext=7;
-		initCoefTable(RLSLMS, CoefTable);
+		initCoefTable(&rlslms_ptr, RLSLMS, CoefTable);
 		RESET = (RLSLMS_ext==7);
 	}
 
@@ -1392,8 +1615,8 @@ short CLpacEncoder::EncodeFrame()
 			{
 				//bufferi[0][s] = new unsigned char[4L*N];	// Buffer for short frames
 				//bufferi[1][s] = new unsigned char[4L*N];	// Buffer for short frames
-				bufferi[0][s] = new unsigned char[((long)((IntRes+7)/8)+1)*N + 4*P + 128];	// Buffer for short frames
-				bufferi[1][s] = new unsigned char[((long)((IntRes+7)/8)+1)*N + 4*P + 128];	// Buffer for short frames
+				bufferi[0][s] = Scratch.Get<BYTE>(((long)((IntRes+7)/8)+1)*N + 4*P + 128);	// Buffer for short frames
+				bufferi[1][s] = Scratch.Get<BYTE>(((long)((IntRes+7)/8)+1)*N + 4*P + 128);	// Buffer for short frames
 			}
 		}
 
@@ -1412,6 +1635,8 @@ short CLpacEncoder::EncodeFrame()
 			// Coupled block switching if joint coding, and not the last channel
 			CBS = (Joint && (c < Chan - 1) && ((c % 2) == 0));
 
+			ALS_STATS_ENTER(Stats, Bsub ? STAGE_BLOCKSWITCH : STAGE_OTHER);
+
 			// Block switching levels /////////////////////////////////////////////////////////////////
 			for (a = 0; a <= Bsub; a++)
 			{
@@ -1455,10 +1680,17 @@ short CLpacEncoder::EncodeFrame()
 							RA = 0;
 
 						bytes_1 = EncodeBlock(x[c], tmpbuf1);
+						TraceKeep(0, a, b);
 						bytes_2 = EncodeBlock(x[c1], tmpbuf2);
+						TraceKeep(1, a, b);
 
 						if (CheckIC)
 						{
+							if (Trace.IsEnabled())
+							{
+								TraceEntry(2, a, b) = TraceEntry(0, a, b);
+								TraceEntry(3, a, b) = TraceEntry(1, a, b);
+							}
 							// byte per block
 							bpbi[0][a][b] = bytes_1;
 							bpbi[1][a][b] = bytes_2;
@@ -1471,12 +1703,14 @@ short CLpacEncoder::EncodeFrame()
 						}
 
 						// Generate difference signal
+						ALS_STATS_ENTER(Stats, STAGE_JOINT);
 						for (i = 0; i < Nb; i++)
 							xs[c2][i] = x[c1][i] - x[c][i];
 
 						if ((bytes_1 > 3) && (bytes_2 > 3))			// No channel is zero or constant
 						{
 							bytes_3 = EncodeBlock(xs[c2], tmpbuf3);		// Encode difference signal
+							ALS_STATS_COUNT(Stats, COUNTER_JOINT_TRIALS);
 
 							if ((bytes_3 < bytes_1) || (bytes_3 <= bytes_2))
 							{
@@ -1490,14 +1724,18 @@ short CLpacEncoder::EncodeFrame()
 								{
 									memcpy(tmpbuf2, tmpbuf3, bytes_3);		// Difference substitutes channel 2
 									bytes_2 = bytes_3;
+									TraceKeep(1, a, b, 0, true);
 								}
 								else
 								{
 									memcpy(tmpbuf1, tmpbuf3, bytes_3);		// Difference substitutes channel 1
 									bytes_1 = bytes_3;
+									TraceKeep(0, a, b, 0, true);
 								}
+								ALS_STATS_COUNT(Stats, COUNTER_JOINT_USED);
 							}
 						}
+						ALS_STATS_LEAVE(Stats);
 
 						// Write data to buffer
 						memcpy(buffer[a] + bpf[a], tmpbuf1, bytes_1);
@@ -1541,6 +1779,7 @@ short CLpacEncoder::EncodeFrame()
 							RA = 0;
 
 						bytes_1 = EncodeBlock(x[c], tmpbuf1);
+						TraceKeep(0, a, b);
 
 						// Write data to buffer
 						memcpy(buffer[a] + bpf[a], tmpbuf1, bytes_1);
@@ -1630,6 +1869,7 @@ short CLpacEncoder::EncodeFrame()
 			// check independent coding as well ///////////////////////////////////////////////////////
 			if (CheckIC && CBS)
 			{
+				ALS_STATS_SCOPE(Stats, STAGE_JOINT);
 				long bitsi[2][16];
 				short ch;
 				for (ch = 0; ch < 2; ch++)			// channels
@@ -1695,6 +1935,7 @@ short CLpacEncoder::EncodeFrame()
 			// end of independent coding check ////////////////////////////////////////////////////////
 
 			// Compose frame data 
+			indep = 0;
 			if (Sub)
 			{
 				// Use buffer[1] to rearrange data
@@ -1742,6 +1983,7 @@ short CLpacEncoder::EncodeFrame()
 							buffer[1][off+3] = BSflagsi[1] & 0xFF;
 						}
 						bpb[0][0] = bpbi_total + BSbits;
+						indep = 1;
 					}
 					else	// use coupled block switching
 						memcpy(buffer[1] + BSbits, buffer[0], bpb[0][0]);	// copy encoded block data
@@ -1758,6 +2000,30 @@ short CLpacEncoder::EncodeFrame()
 				buffer[0] += bpb[0][0];
 				bpf_total += bpb[0][0];
 			}
+			ALS_STATS_LEAVE(Stats);
+
+			// Trace the blocks of the chosen partition
+			if (Trace.IsEnabled())
+			{
+				if (indep)
+				{
+					Trace.SetBlockSwitching(c, BSflagsi[0]);
+					Trace.SetBlockSwitching(c + 1, BSflagsi[1]);
+					TraceLeaves(BSflagsi[0], 2, c, 0, 0, Bsub, NN);
+					TraceLeaves(BSflagsi[1], 3, c + 1, 0, 0, Bsub, NN);
+				}
+				else
+				{
+					Trace.SetBlockSwitching(c, BSflags);
+					TraceLeaves(BSflags, 0, c, 0, 0, Bsub, NN);
+					if (CBS)
+					{
+						Trace.SetBlockSwitching(c + 1, BSflags);
+						TraceLeaves(BSflags, 1, c + 1, 0, 0, Bsub, NN);
+					}
+				}
+			}
+
 			// increment channel index if two channels have been processed
 			if (CBS)
 				c++;
@@ -1780,14 +2046,15 @@ short CLpacEncoder::EncodeFrame()
 	}
     else if (RLSLMS)//------------RLSLMS mode --------------------------
 	{
+		ALS_STATS_SCOPE(Stats, STAGE_RLSLMS);
 		MCCflag=0;
 		if (CheckIC)
 		{
 			// allocate memory locally
 			for (short s = 0; s <= Sub; s++)
 			{
-				bufferi[0][s] = new unsigned char[4L*N];	// Buffer for short frames
-				bufferi[1][s] = new unsigned char[4L*N];	// Buffer for short frames
+				bufferi[0][s] = Scratch.Get<BYTE>(4L*N);	// Buffer for short frames
+				bufferi[1][s] = Scratch.Get<BYTE>(4L*N);	// Buffer for short frames
 			}
 		}
 		// Channel Pair Elements
@@ -1843,7 +2110,7 @@ short CLpacEncoder::EncodeFrame()
 					if (bytes_1>N*IntRes/8 || bytes_2>N*IntRes/8)
 					{
 						// Copy safe_mode_table
-						memcpy(&c_mode_table, &safe_mode_table, sizeof(mtable));
+						memcpy(&rlslms_ptr.c_mode_table, &safe_mode_table, sizeof(mtable));
 						RLSLMS_ext = 7;
 						RESET = 1;
 
@@ -1910,7 +2177,7 @@ short CLpacEncoder::EncodeFrame()
 					if (bytes_1>N*IntRes/8 || bytes_2>N*IntRes/8)
 					{
 						// Copy safe_mode_table
-						memcpy(&c_mode_table, &safe_mode_table, sizeof(mtable));
+						memcpy(&rlslms_ptr.c_mode_table, &safe_mode_table, sizeof(mtable));
 						RLSLMS_ext = 7;
 						RESET = 1;
 
@@ -1947,6 +2214,11 @@ short CLpacEncoder::EncodeFrame()
 			memcpy(buffer[0] + bpf_total, tmpbuf1, bytes_1);
 			memcpy(buffer[0] + bpf_total + bytes_1, tmpbuf2, bytes_2);
 			bpf_total += bytes_1 + bytes_2;
+			if (Trace.IsEnabled())
+			{
+				Trace.AddBlock(TraceCoded[c0], c0);
+				Trace.AddBlock(TraceCoded[c1], c1);
+			}
 		}
 
 		// Single Channel Elements
@@ -1973,7 +2245,7 @@ short CLpacEncoder::EncodeFrame()
 			if (bytes_1>N*IntRes/8)
 			{
 				// Copy safe_mode_table
-				memcpy(&c_mode_table, &safe_mode_table, sizeof(mtable));
+				memcpy(&rlslms_ptr.c_mode_table, &safe_mode_table, sizeof(mtable));
 				RLSLMS_ext = 7;
 				RESET = 1;
 
@@ -1993,6 +2265,8 @@ short CLpacEncoder::EncodeFrame()
 			// Write data to buffer
 			memcpy(buffer[0] + bpf_total, tmpbuf1, bytes_1);
 			bpf_total += bytes_1;
+			if (Trace.IsEnabled())
+				Trace.AddBlock(TraceCoded[c0], c0);
 		}
 		if (RAframe)		// turn on RA again in RA frames
 			RA = RAsave;
@@ -2016,7 +2290,8 @@ short CLpacEncoder::EncodeFrame()
 		// Save original pointers
 		for (c = 0; c < Chan; c++)
 			xsave[c] = x[c];
-			
+
+		ALS_STATS_ENTER(Stats, Bsub ? STAGE_BLOCKSWITCH : STAGE_OTHER);
 		
 		// Block switching levels /////////////////////////////////////////////////////////////////
 		for (a = 0; a <= Bsub; a++)
@@ -2061,15 +2336,16 @@ short CLpacEncoder::EncodeFrame()
 					memcpy( MccBuf.m_orgdmat[c], MccBuf.m_dmat[c], N * sizeof(int) );
 				}
 
+				CAlsScratchScope Block(Scratch);
 				short	tt,TauTap=2,*ttOPT,mtp;
 				long *ttMinBytes;
-				ttOPT=new short[Chan];
-				ttMinBytes=new long[Chan];
+				ttOPT=Scratch.Get<short>(Chan);
+				ttMinBytes=Scratch.Get<long>(Chan);
 				int **stackmtgmm,*stdtau;
-				stackmtgmm=new int*[Chan];
+				stackmtgmm=Scratch.Get<int*>(Chan);
 				for(c = 0; c < Chan; c++)
-					stackmtgmm[c]=new int[Mtap];
-				stdtau=new int[Chan];
+					stackmtgmm[c]=Scratch.Get<int>(Mtap);
+				stdtau=Scratch.Get<int>(Chan);
 
 				for(c = 0; c < Chan; c++)
 				{
@@ -2081,7 +2357,9 @@ short CLpacEncoder::EncodeFrame()
 					MccBuf.m_puchan[c][oaa]=c;
 				}
 
+				ALS_STATS_ENTER(Stats, STAGE_MCC);
 				CheckFrameDistanceTD( &MccBuf, Chan, N, MCCflag);	// Calculate channel correlation
+				ALS_STATS_LEAVE(Stats);
 
 				for(c = 0; c < Chan; c++)
 					MccBuf.m_puchan[c][oaa]=MccBuf.m_tmppuchan[c];
@@ -2096,7 +2374,9 @@ short CLpacEncoder::EncodeFrame()
 						memcpy( MccBuf.m_dmat[c], MccBuf.m_orgdmat[c], N * sizeof(int) );
 					}
 
+					ALS_STATS_ENTER(Stats, STAGE_MCC);
 					SubtractResidualTD( &MccBuf, Chan, N ,tt);			// Slave channel - Master channel
+					ALS_STATS_LEAVE(Stats);
 
 					// Channel loop
 					for(c = 0; c < Chan; c++)
@@ -2131,6 +2411,7 @@ short CLpacEncoder::EncodeFrame()
 				for(c = 0; c < Chan; c++)
 				{						
 					bytes_MCC[c] = EncodeBlockCoding( &MccBuf, c, MccBuf.m_dmat[c], tmpbuf_MCC[c], MccBuf.m_gmmodr[c]);
+					TraceKeep(c, a, b, c);
 
 					// Write data to buffer
 					memcpy(buffer[a] + bpf[a], tmpbuf_MCC[c], bytes_MCC[c]);
@@ -2142,12 +2423,6 @@ short CLpacEncoder::EncodeFrame()
 						x[c] = x[c] + Nb;
 				}
 
-				delete [] ttOPT;
-				delete [] ttMinBytes;
-				for(c = 0; c < Chan; c++) delete [] stackmtgmm[c];
-				delete [] stackmtgmm;
-				delete [] stdtau;
-
 				N = NN;		// restore value
 			}
 			// End of blocks //////////////////////////////////////////////////////////////////
@@ -2252,6 +2527,7 @@ short CLpacEncoder::EncodeFrame()
 			buffer[0] += bpb[0][0];
 			bpf_total += bpb[0][0];
 		}
+		ALS_STATS_LEAVE(Stats);
 
 		// Restore original pointers
 		buffer[0] = buffer0;
@@ -2259,6 +2535,18 @@ short CLpacEncoder::EncodeFrame()
 		for (c = 0; c < Chan; c++)
 			x[c] = xsave[c];
 
+		// Trace the blocks of the chosen partition (instead of joint stereo)
+		if (Trace.IsEnabled() && (MCCnoJS || (bpf_total_m >= bpf_total)))
+		{
+			Trace.ClearBlocks();
+			for (c = 0; c < Chan; c++)
+			{
+				Trace.SetBlockSwitching(c, BSflags);
+				TraceLeaves(BSflags, c, c, 0, 0, Bsub, NN);
+			}
+			TraceMcc = true;
+		}
+
 		if(!MCCnoJS)
 		{
 			unsigned char uu;
@@ -2281,6 +2569,7 @@ short CLpacEncoder::EncodeFrame()
 
 
 	if ( SampleType == SAMPLE_TYPE_FLOAT ) {
+		ALS_STATS_SCOPE(Stats, STAGE_FLOAT_DIFF);
 		bytes_diff = Float.EncodeDiff( ( fid == frames ) ? N0 : N, RA != 0, MlzMode );
 		bpf_total += bytes_diff + 4;
 	}
@@ -2298,6 +2587,7 @@ short CLpacEncoder::EncodeFrame()
 	}
 
 	// Write frame buffer
+	ALS_STATS_ENTER(Stats, STAGE_WRITE);
 	if ( SampleType == SAMPLE_TYPE_FLOAT ) {
 		// Floating point PCM
 		if ( fwrite( buffer[0], 1, bpf_total - 4 - bytes_diff, fpOutput ) != bpf_total - 4 - bytes_diff ) return 1;
@@ -2312,9 +2602,30 @@ short CLpacEncoder::EncodeFrame()
 	if (RA)
 		ra_bytes += bpf_total;
 
+	if ( pSink )
+	{
+		RauSamples += ( fid == frames ) ? N0 : N;
+		if ( ( fid == frames ) || ( PushMode && RA && ( ( fid % RA ) == 0 ) ) )
+		{
+			// Push mode passes each RAU on right after its last frame.
+			if ( !FlushRau( true ) ) return 1;
+		}
+		else if ( PushMode && !RA )
+		{
+			// Push mode without random access: pass on every frame.
+			if ( !FlushRau( false ) ) return 1;
+		}
+		else if ( !PushMode && ( SinkBuffer.GetSize() - AudioTop >= SINK_PART_SIZE ) )
+		{
+			// Long RAU (or no RA at all): keep memory bounded by passing it on in pieces.
+			if ( !FlushRau( false ) ) return 1;
+		}
+	}
+	ALS_STATS_LEAVE(Stats);
+
 	if (RA && (fid == frames))	// Last frame
 	{
-		if (RAflag == 1)
+		if ((RAflag == 1) && !pSink)
 		{
 			// save size last RAU before the first frame of last RAU
 			fseek(fpOutput, -(long)ra_bytes - 4, SEEK_CUR);		// back to last RAU
@@ -2335,24 +2646,40 @@ short CLpacEncoder::EncodeFrame()
 		if ( SampleType == SAMPLE_TYPE_FLOAT ) Float.ChannelSort( ChPos, false );
 	}
 
-	if (CheckIC)
-	{
-
-		for (short s = 0; s <= Sub; s++)
-		{
-			delete [] bufferi[0][s];
-			delete [] bufferi[1][s];
-		}
-	}
+	ALS_STATS_END_FRAME(Stats, fid - 1, (fid == frames) ? N0 : N, bpf_total);
 
-	delete [] xsave;
-	delete [] xssave;
-	delete [] xtmp;
-	delete [] bytes_MCC;
+	if (Trace.IsEnabled() && !Trace.EndFrame(bpf_total, (SampleType == SAMPLE_TYPE_FLOAT) ? long(bytes_diff) + 4 : 0, TraceMcc))
+		return(1);
 
 	return(0);
 }
 
+///////////////////////////////////////////////////////////////////////////////////////////////////
+// Keep the last coded block of a channel as candidate for block b of block switching level a
+void CLpacEncoder::TraceKeep(long Slot, short a, short b, long Channel, bool Diff)
+{
+	if (!Trace.IsEnabled())
+		return;
+	TraceEntry(Slot, a, b) = TraceCoded[Channel];
+	TraceEntry(Slot, a, b).m_Diff = Diff ? 1 : 0;
+}
+
+// Trace the candidates chosen by the block switching flags, starting from block b of level a
+void CLpacEncoder::TraceLeaves(unsigned long BSflags, long Slot, long Channel, short a, short b, short Bsub, long NN)
+{
+	long Nb = NN >> (a + 1);						// block length of the next level
+	long Nlast = (fid == frames) ? N0 : NN;			// the last frame may end early
+
+	if ((a < Bsub) && (BSflags & (0x40000000 >> ((1 << a) - 1 + b))))
+	{
+		TraceLeaves(BSflags, Slot, Channel, a + 1, 2*b, Bsub, NN);
+		if ((2*b + 1) * Nb < Nlast)
+			TraceLeaves(BSflags, Slot, Channel, a + 1, 2*b + 1, Bsub, NN);
+	}
+	else
+		Trace.AddBlock(TraceEntry(Slot, a, b), Channel);
+}
+
 ///////////////////////////////////////////////////////////////////////////////////////////////////
 // Encode a single block
 long CLpacEncoder::EncodeBlock(int *x, unsigned char *bytebuf)
@@ -2394,12 +2721,15 @@ void CLpacEncoder::EncodeBlockAnalysis(MCC_ENC_BUFFER *pBuffer, long Channel, in
         542752, 571424, 600352, 629536, 658976, 688672, 718624, 748832, 779296, 810016, 840992,
         872224, 903712, 935456, 967456, 999712, 1032224 };
 
+	ALS_STATS_COUNT(Stats, COUNTER_BLOCKS);
+
 	// ZERO BLOCK
 	if (BlockIsZero(x, N))
 	{
 		for(i=0;i<N;i++)
 			d[i]=0;
 		*xpr=1;
+		ALS_STATS_COUNT(Stats, COUNTER_ZERO_BLOCKS);
 	}
 	// CONSTANT BLOCK
 	else if (c = BlockIsConstant(x, N, IntRes))
@@ -2407,6 +2737,7 @@ void CLpacEncoder::EncodeBlockAnalysis(MCC_ENC_BUFFER *pBuffer, long Channel, in
 		for(i=0;i<N;i++)
 			d[i]=c;
 		*xpr=2;
+		ALS_STATS_COUNT(Stats, COUNTER_CONST_BLOCKS);
 	}
 	// NORMAL BLOCK
 	else
@@ -2414,6 +2745,7 @@ void CLpacEncoder::EncodeBlockAnalysis(MCC_ENC_BUFFER *pBuffer, long Channel, in
 		*xpr=0;
 		int asi[1023], parq[1023], *xtmp;
 		short shift = 0;
+		CAlsScratchScope Scope(Scratch);
 
 		optP = P;
 		short Pmax = P;
@@ -2431,7 +2763,7 @@ void CLpacEncoder::EncodeBlockAnalysis(MCC_ENC_BUFFER *pBuffer, long Channel, in
 			// Empty LSBs?
 			if (shift = ShiftOutEmptyLSBs(x, N))
 			{
-				xtmp = new int[Pmax];
+				xtmp = Scratch.Get<int>(Pmax);
 				// "Shift" last Pmax samples of previous block
 				for (i = -Pmax; i < 0; i++)
 				{
@@ -2444,8 +2776,9 @@ void CLpacEncoder::EncodeBlockAnalysis(MCC_ENC_BUFFER *pBuffer, long Channel, in
 		// Calculate the LPC coefficients for a fixed order
 		// To adapt the order as well, use a function which returns the optimal order (optP)
 		// for this block and the corresponding set of parcor coefficients (par).
+		ALS_STATS_ENTER(Stats, STAGE_COF);
 		if (!Adapt)
-			GetCof(x, N, P, Win, par);						// Fixed order
+			GetCof(x, N, P, Win, par, Scratch.Get<double>(N), Scratch.Get<double>(P+1));	// Fixed order
 #ifdef	LPC_ADAPT
 		else
 			//optP = GetCofAdaptOrder(x, N, Pmax, Win, par, Freq);		// Adaptive order
@@ -2476,8 +2809,10 @@ void CLpacEncoder::EncodeBlockAnalysis(MCC_ENC_BUFFER *pBuffer, long Channel, in
 			asi[i] = a;
 			parq[i] = (a << (Q -6)) + (1 << (Q-7));
 		}
+		ALS_STATS_LEAVE(Stats);
 
 		// Estimation of the residual
+		ALS_STATS_ENTER(Stats, STAGE_RESIDUAL);
 		if (!RA)
 		{
 			if (par2cof(cof, parq, optP, Q))	// Conversion from parcor to direct form coefficients
@@ -2546,6 +2881,7 @@ void CLpacEncoder::EncodeBlockAnalysis(MCC_ENC_BUFFER *pBuffer, long Channel, in
 				GetResidualRA(x, N, optP, Q, parq, cof, d);		// Try again (always works)
 			}
 		}
+		ALS_STATS_LEAVE(Stats);
 
 		for(i=0;i<optP;i++)
 			mccasi[i]=asi[i];
@@ -2565,7 +2901,6 @@ void CLpacEncoder::EncodeBlockAnalysis(MCC_ENC_BUFFER *pBuffer, long Channel, in
 				x[i] = xtmp[Pmax+i];
 			for (i = 0; i < N; i++)
 				x[i] <<= shift;
-			delete [] xtmp;
 		}
 
 	}	// End of NORMAL BLOCK
@@ -2618,16 +2953,29 @@ long CLpacEncoder:: EncodeBlockCoding(MCC_ENC_BUFFER *pBuffer, long Channel, int
 	else if (CoefTable == 2)
 		parcor_vars = parcor_vars_2;
 
+	ALS_STATS_SCOPE(Stats, STAGE_ENTROPY);
+	ALS_STATS_COUNT(Stats, COUNTER_CODED_BLOCKS);
+
 	// Bit-oriented output (header + Rice codes)
 	CBitIO out;
 	out.InitBitWrite(bytebuf);
 
+	// Decision trace
+	ALS_TRACEBLOCK *pTrace = Trace.IsEnabled() ? &TraceCoded[Channel] : NULL;
+	if (pTrace)
+		CAlsTrace::ClearBlock(*pTrace, N, RA != 0);
+
 	// ZERO BLOCK
 	if( xpra == 1 )
 	{
 		h = (BYTE)0;							// Block header h = 0000 0000
 		out.WriteByteAlign(h);
 		if(MCCflag) gmod=0; //Ignore MCC
+		if (pTrace)
+		{
+			pTrace->m_Type = TRACE_BLOCK_ZERO;
+			CAlsTrace::Mark(*pTrace, TRACE_PART_HEADER, &out.bio);
+		}
 	}
 	// CONSTANT BLOCK
 	else if ( xpra == 2 )
@@ -2669,6 +3017,11 @@ long CLpacEncoder:: EncodeBlockCoding(MCC_ENC_BUFFER *pBuffer, long Channel, int
 			out.WriteByteAlign(hl[3]);
 		}
 		if(MCCflag) gmod=0; //Ignore MCC
+		if (pTrace)
+		{
+			pTrace->m_Type = TRACE_BLOCK_CONST;
+			CAlsTrace::Mark(*pTrace, TRACE_PART_HEADER, &out.bio);
+		}
 	}
 	// NORMAL BLOCK
 	else
@@ -2838,6 +3191,20 @@ long CLpacEncoder:: EncodeBlockCoding(MCC_ENC_BUFFER *pBuffer, long Channel, int
 		}
 		else
 			out.WriteBits(0, 1); // 0 if RLSLMS is used
+		if (pTrace)
+		{
+			pTrace->m_Type = TRACE_BLOCK_NORMAL;
+			pTrace->m_Bgmc = BGMC ? 1 : 0;
+			pTrace->m_OptP = optP;
+			pTrace->m_Shift = RLSLMS ? 0 : shift;
+			pTrace->m_Sub = sub;
+			for (j = 0; j < sub; j++)
+			{
+				pTrace->m_S[j] = BGMC ? (S[j] >> 4) : s[j];
+				pTrace->m_Sx[j] = BGMC ? (S[j] & 0x0F) : 0;
+			}
+			CAlsTrace::Mark(*pTrace, TRACE_PART_HEADER, &out.bio);
+		}
 		if (!RLSLMS)
 		{
 			// Predictor order (optP <= P, write only necessary bits)
@@ -2847,6 +3214,8 @@ long CLpacEncoder:: EncodeBlockCoding(MCC_ENC_BUFFER *pBuffer, long Channel, int
 				h = (N < 8) ? 1 : min(ilog2_ceil(P+1), max(ilog2_ceil(N >> 3), 1));
 				out.WriteBits(UINT(optP), h);	// max. 10 bits for 512 <= P <= 1023
 			}
+			if (pTrace)
+				CAlsTrace::Mark(*pTrace, TRACE_PART_HEADER, &out.bio);
 
 			/* encode coefs: */
 			if (parcor_vars != 0) {
@@ -2863,8 +3232,16 @@ long CLpacEncoder:: EncodeBlockCoding(MCC_ENC_BUFFER *pBuffer, long Channel, int
 					out.WriteBits(asi[i] + 64, 7);
 			}
 		}
+		if (pTrace)
+			CAlsTrace::Mark(*pTrace, TRACE_PART_COEF, &out.bio);
 
 		if (PITCH) 	pBuffer->m_Ltp.Encode( Channel, d, bytebuf, N, Freq, &out );
+		if (pTrace && PITCH)
+		{
+			pTrace->m_Ltp = pBuffer->m_Ltp.m_pBuffer[Channel].m_ltp;
+			pTrace->m_Lag = pTrace->m_Ltp ? pBuffer->m_Ltp.m_pBuffer[Channel].m_plag : 0;
+			CAlsTrace::Mark(*pTrace, TRACE_PART_LTP, &out.bio);
+		}
 
 		// Residual
 		if (!RA)
@@ -2901,6 +3278,8 @@ long CLpacEncoder:: EncodeBlockCoding(MCC_ENC_BUFFER *pBuffer, long Channel, int
 				bgmc_encode_blocks(d, num, s, sx, N, sub, &out.bio);
 			}
 		}
+		if (pTrace)
+			CAlsTrace::Mark(*pTrace, TRACE_PART_RESIDUAL, &out.bio);
 	
 	}	// End of NORMAL BLOCK
 
@@ -2914,29 +3293,29 @@ long CLpacEncoder:: EncodeBlockCoding(MCC_ENC_BUFFER *pBuffer, long Channel, int
 			out.WriteBits((UINT) RLSLMS_ext,3);
 			if (RLSLMS_ext&0x01) // change lambda only
 			{
-				out.WriteBits((c_mode_table.filter_len[1]>>1),4);
-				out.WriteBits(c_mode_table.nstage-2,3);
-				for(i=2;i<c_mode_table.nstage;i++)
+				out.WriteBits((rlslms_ptr.c_mode_table.filter_len[1]>>1),4);
+				out.WriteBits(rlslms_ptr.c_mode_table.nstage-2,3);
+				for(i=2;i<rlslms_ptr.c_mode_table.nstage;i++)
 				{
 					out.WriteBits(lookup_table(lms_order_table,
-							               c_mode_table.filter_len[i]
+							               rlslms_ptr.c_mode_table.filter_len[i]
 										   ),5);						
 				}
 			}
 			if (RLSLMS_ext&0x02)
 			{
-				if (c_mode_table.filter_len[1]){
-					out.WriteBits(c_mode_table.lambda[0],10);
-					out.WriteBits(c_mode_table.lambda[1],10);
+				if (rlslms_ptr.c_mode_table.filter_len[1]){
+					out.WriteBits(rlslms_ptr.c_mode_table.lambda[0],10);
+					out.WriteBits(rlslms_ptr.c_mode_table.lambda[1],10);
 				}
 			}
 			if (RLSLMS_ext&0x04)
 			{
-				for(i=2;i<c_mode_table.nstage;i++)
+				for(i=2;i<rlslms_ptr.c_mode_table.nstage;i++)
 				{
-					out.WriteBits(lookup_mu(c_mode_table.opt_mu[i]),5);
+					out.WriteBits(lookup_mu(rlslms_ptr.c_mode_table.opt_mu[i]),5);
 				}
-				out.WriteBits(c_mode_table.step_size/LMS_MU_INT,3);
+				out.WriteBits(rlslms_ptr.c_mode_table.step_size/LMS_MU_INT,3);
 			}
 		}
 		else
@@ -2944,6 +3323,12 @@ long CLpacEncoder:: EncodeBlockCoding(MCC_ENC_BUFFER *pBuffer, long Channel, int
 			out.WriteBits(0,1);
 		}
 		//RLSLMS_ext=0;
+		if (pTrace)
+		{
+			pTrace->m_MonoFrame = mono_frame;
+			pTrace->m_RlsExt = RLSLMS_ext;
+			CAlsTrace::Mark(*pTrace, TRACE_PART_RLSLMS, &out.bio);
+		}
 	}
 
 	// MCC Coefficients (Reference channels and weighting factor)
@@ -2954,6 +3339,13 @@ long CLpacEncoder:: EncodeBlockCoding(MCC_ENC_BUFFER *pBuffer, long Channel, int
 			out.WriteBits(0,1); // End Flag OFF -> Continue
 
 			out.WriteBits((puch[oaa]),NeedPuchBit); //Reference Channel
+			if (pTrace && (oaa < TRACE_MAX_MCC))
+			{
+				pTrace->m_MccRef[oaa] = puch[oaa];
+				pTrace->m_MccMode[oaa] = (puch[oaa] == Channel) ? 0 : MccMode[oaa];
+				pTrace->m_MccTau[oaa] = ((puch[oaa] == Channel) || (MccMode[oaa] == 1)) ? 0 : tdtauval[oaa];
+				pTrace->m_MccStages = oaa + 1;
+			}
 
 			if(puch[oaa]==Channel)
 			{
@@ -2991,8 +3383,15 @@ long CLpacEncoder:: EncodeBlockCoding(MCC_ENC_BUFFER *pBuffer, long Channel, int
 			}
 		}
 		out.WriteBits(1,1); // End Flag ON (Anyway terminate)
+		if (pTrace)
+			CAlsTrace::Mark(*pTrace, TRACE_PART_MCC, &out.bio);
 	}
 
+	if (pTrace)
+	{
+		pTrace->m_Bytes = out.EndBitWrite();
+		return(pTrace->m_Bytes);
+	}
 	return(out.EndBitWrite());		// Return number of written bytes
 }
 
@@ -3005,7 +3404,8 @@ void	CLpacEncoder::LTPanalysis( MCC_ENC_BUFFER* pBuffer, long Channel, long N, s
 {
 	CLtpBuffer*	pLtpBuf = pBuffer->m_Ltp.m_pBuffer + Channel;
 	int*	dd = pLtpBuf->m_ltpmat + 2048;
-	int*	dd0 = new int [ 4 * N ];
+	CAlsScratchScope	Scope( Scratch );
+	int*	dd0 = Scratch.Get<int>( 4 * N );
 	long	tmpbytes0 = 0;
 	long	minbytes;
 
@@ -3033,7 +3433,6 @@ void	CLpacEncoder::LTPanalysis( MCC_ENC_BUFFER* pBuffer, long Channel, long N, s
 		memcpy( pBuffer->m_dmat[Channel], dd0, N * sizeof(int) );
 		memcpy( pLtpBuf->m_pcoef_multi, inpitch.m_pcoef_multi, 5 * sizeof(short) );
 	}
-	delete[] dd0;
 }
 
 bool CLpacEncoder::EnforceProfiles()
@@ -120,6 +120,10 @@ contents : Header file for encoder.cpp
 #include "lms.h"
 #include "stream.h"
 #include "profiles.h"
+#include "stats.h"
+#include "trace.h"
+#include "scratch.h"
+#include "ImfMemoryStream.h"
 
 class CLpacEncoder
 {
@@ -174,6 +178,7 @@ protected:
 	long RAUnits;					// number of random access units
 	long RAUid;						// current RAU
 	unsigned int *RAUsize;			// sizes of RAUs
+	unsigned long ra_bytes;			// bytes for all frames of the current RAU
 
 	ALS_INT64 FilePos;				// file position pointer
 
@@ -184,12 +189,23 @@ protected:
 	bool mp4file;					// true:MP4 file format / false:ALS file format
 	bool oafi_flag;					// true:Use oafi / false:Do not use oafi
 
+	CAlsRauSink *pSink;				// Receiver of RAUs (NULL: write to fpOutput)
+	NAlsImf::CMemoryStream SinkBuffer;	// ALS header and frames of the current RAU (sink mode)
+	ALS_UINT32 AudioTop;			// Size of the ALS header in SinkBuffer
+	ALS_INT64 RauSamples;			// Samples in the current RAU
+	ALS_INT64 SinkBytes;			// Bytes handed to pSink so far
+
+	bool PushMode;					// true: samples are pushed by PushSamples()
+	NAlsImf::CMemoryStream PushBuffer;	// Pushed samples of the current frame (push mode)
+	long PushFill;					// Samples per channel in PushBuffer
+
 	unsigned char *bbuf, *buff, *tmpbuf1, *tmpbuf2, *tmpbuf3, *buffer[6], **tmpbuf_MCC, *buffer_m;
 	int **x, **xp, **xs, **xps, *d, *cof;
 	double *par;
 
 	CFloat Float;					// Floating point class
 	MCC_ENC_BUFFER MccBuf;			// Buffer for multi-channel correlation method
+	CAlsScratch Scratch;			// Per-frame work buffers (sized in WriteHeader())
 
 	// RLSLMS related variables
 	short mono_frame;				// frame is mono
@@ -199,6 +215,11 @@ protected:
 	ALS_PROFILES EnforcedProfiles;
 	ALS_PROFILES ConformantProfiles;
 
+	CAlsStats Stats;				// Per-stage timing and counters
+	CAlsTrace Trace;				// Trace of the coding decisions
+	std::vector<ALS_TRACEBLOCK> TraceCoded;	// Last coded block of each channel
+	std::vector<ALS_TRACEBLOCK> TraceTab;	// Candidate blocks [slot][level][block] of the block switching
+
 public:
 	long MCCflag;					// Multi-channel correlation method	CLpacEncoder();	
 	CLpacEncoder();					// Constructor
@@ -214,9 +235,18 @@ public:
 	short SpecifyAudioInfo(AUDIOINFO *ainfo);
 	short OpenOutputFile( const char *name, bool mp4, bool oafi ) { mp4file = mp4; oafi_flag = oafi; CloseOutput = ( OpenFileWriter( name, &fpOutput ) == 0 ); return CloseOutput ? 0 : 1; }
 	short SetOutputFile( HALSSTREAM hStream, bool mp4, bool oafi ) { mp4file = mp4; oafi_flag = oafi; fpOutput = hStream; CloseOutput = false; return 0; }
+	short SetOutputSink( CAlsRauSink *pRauSink, bool oafi );
 	ALS_INT64 WriteHeader(ENCINFO *encinfo);
 	ALS_INT64 WriteTrailer();
 	short EncodeAll();
+	ALS_INT64 BeginPush(CAlsRauSink *pRauSink, ENCINFO *encinfo);	// Start encoding of pushed samples
+	short PushSamples(const void *pcm, long count);	// Encode interleaved samples as frames fill up
+	short Finish();									// Encode the last frame and complete the header
+	long GetFrameLength() const { return N; }				// Frame length (final after WriteHeader())
+	ALS_INT64 GetFrameIndex() const { return fid; }			// Number of the next frame (0-)
+	bool EnableStats(bool enable, bool frames = true) { Stats.Reset(); return Stats.Enable(enable, frames); }	// Measure the encoding stages
+	const CAlsStats& GetStats() const { return Stats; }		// Measured stages
+	void SetTrace(CAlsTraceSink *pSink) { Trace.SetSink(pSink); }	// Trace the coding decisions (NULL: off)
 
 	long SetFrameLength(long N);
 	short SetOrder(short P);
@@ -252,6 +282,10 @@ protected:
 	void EncodeBlockAnalysis(MCC_ENC_BUFFER *pBuffer, long Channel, int *d); //MCC
 	long EncodeBlockCoding(MCC_ENC_BUFFER *pBuffer, long Channel, int *x, unsigned char *bytebuf, long gmod); //MCC
 	void LTPanalysis(MCC_ENC_BUFFER *pBuffer, long Channel, long N, short optP, int *x);
+	ALS_TRACEBLOCK& TraceEntry(long Slot, short a, short b) { return TraceTab[(Slot * 6 + a) * 32 + b]; }
+	void TraceKeep(long Slot, short a, short b, long Channel = 0, bool Diff = false);	// Keep a coded block as candidate
+	void TraceLeaves(unsigned long BSflags, long Slot, long Channel, short a, short b, short Bsub, long NN);	// Trace the chosen candidates
 
 	bool EnforceProfiles();
+	bool FlushRau( bool complete );
 };
@@ -126,7 +126,6 @@ contents : Floating-point PCM support
 #include	<cstring>
 #include	<cmath>
 #include	<cfloat>
-#include	<vector>
 #include	"floating.h"
 #include	"mlz.h"
 #include	"stream.h"
@@ -411,6 +410,53 @@ CIEEE32	CIEEE32::Multiple( const CIEEE32& f1, const CIEEE32& f2 )
 	return CIEEE32( (unsigned char)( f1.m_sign ^ f2.m_sign ), Mantissa ? (int)( f1.m_exp + f2.m_exp + BitCount - 47 ) : -IEEE754_EXP_BIASED, Mantissa );
 }
 
+////////////////////////////////////////
+//                                    //
+//     Multiple (bit pattern form)    //
+//                                    //
+////////////////////////////////////////
+// f1, f2 = Bit patterns of float values to multiple
+// Return value = Bit pattern of Multiple( f1, f2 )
+// * Normalized operands with a normalized product are handled here
+//   without branches on the bit count. Everything else falls back to
+//   Multiple(), so the result is always identical to it.
+unsigned int	CIEEE32::MultipleBits( unsigned int f1, unsigned int f2 )
+{
+	UINT64			Mantissa64;
+	unsigned int	e1, e2, Half, Lsb, Rest, Carry, Mantissa;
+	int				CutoffBitCount, exp;
+	CIEEE32			x1, x2;
+
+	e1 = ( f1 >> 23 ) & 0xff;
+	e2 = ( f2 >> 23 ) & 0xff;
+	if ( ( e1 - 1 < 0xfe ) && ( e2 - 1 < 0xfe ) ) {
+		// Product of two 24-bit mantissas has 47 or 48 valid bits
+		Mantissa64 = (UINT64)( ( f1 & 0x007fffffU ) | 0x00800000U ) * (UINT64)( ( f2 & 0x007fffffU ) | 0x00800000U );
+		CutoffBitCount = 23 + (int)( Mantissa64 >> 47 );
+
+		// Round off (same rule as Multiple())
+		Half = (unsigned int)( Mantissa64 >> ( CutoffBitCount - 1 ) ) & 0x1;
+		Lsb = (unsigned int)( Mantissa64 >> CutoffBitCount ) & 0x1;
+		Rest = (unsigned int)Mantissa64 & ( ( 0x1U << ( CutoffBitCount - 1 ) ) - 1 );
+		Mantissa64 += (UINT64)( Half & ( Lsb | ( Rest != 0 ) ) ) << CutoffBitCount;
+		Mantissa = (unsigned int)( Mantissa64 >> CutoffBitCount );
+
+		// Need one more shift?
+		Carry = Mantissa >> 24;
+		Mantissa >>= Carry;
+
+		exp = (int)( e1 + e2 ) - 2 * IEEE754_EXP_BIASED + CutoffBitCount + (int)Carry - 23;
+		if ( ( exp > -IEEE754_EXP_BIASED ) && ( exp <= IEEE754_EXP_BIASED ) )
+			return ( ( f1 ^ f2 ) & 0x80000000U ) | ( (unsigned int)( exp + IEEE754_EXP_BIASED ) << 23 ) | ( Mantissa & 0x007fffffU );
+	}
+
+	// Denormalized number, NaN or out of range
+	x1.Set( f1 );
+	x2.Set( f2 );
+	x1 = Multiple( x1, x2 );
+	return *reinterpret_cast<unsigned int*>( &x1.m_floatnum );
+}
+
 ////////////////////////////////////////
 //                                    //
 //               Divide               //
@@ -481,6 +527,15 @@ CFloat::CFloat( void )
 	m_pLastExistResidual = NULL;
 	m_pGhb = NULL;
 	m_pMlz = NULL;
+	m_pPrevAcfGCF = NULL;
+	m_pEstimateBuf = NULL;
+	m_pMlzLength = NULL;
+	m_pMlzArray = NULL;
+	m_pMlzArrayMask = NULL;
+	m_pMlzEncoded = NULL;
+	m_pPCMBits = NULL;
+	m_pMlzDecLength = NULL;
+	m_ppSortBuf = NULL;
 }
 
 ////////////////////////////////////////
@@ -521,7 +576,8 @@ void	CFloat::AllocateBuffer( long Channels, int FrameSize, int IntRes )
 
 	// Allocate temporary buffer
 	m_ppCBuffD = new unsigned char* [ m_Channels * m_FrameSize ];
-	for( iChannel=0; iChannel<m_Channels * m_FrameSize; iChannel++ ) m_ppCBuffD[iChannel] = new unsigned char [ IEEE754_BYTES_PER_SAMPLE ];
+	m_ppCBuffD[0] = new unsigned char [ m_Channels * m_FrameSize * IEEE754_BYTES_PER_SAMPLE ];
+	for( iChannel=1; iChannel<m_Channels * m_FrameSize; iChannel++ ) m_ppCBuffD[iChannel] = m_ppCBuffD[iChannel-1] + IEEE754_BYTES_PER_SAMPLE;
 
 	// Allocate bit stream buffer
 	m_pCbitBuff = new unsigned char[ m_FrameSize * m_Channels * IEEE754_BYTES_PER_SAMPLE + 100 ];
@@ -555,6 +611,39 @@ void	CFloat::AllocateBuffer( long Channels, int FrameSize, int IntRes )
 	// Alocate global highest byte buffer
 	m_pGhb = new int [ m_Channels ];
 
+	// Allocate previous GCF buffer for Analyze()
+	m_pPrevAcfGCF = new float [ m_Channels ];
+	for( iChannel=0; iChannel<m_Channels; iChannel++ ) m_pPrevAcfGCF[iChannel] = 0.f;
+
+	// Allocate work buffers for EstimateMultiplier()
+	m_pEstimateBuf = new ESTIMATE_BUF [ m_Channels ];
+	for( iChannel=0; iChannel<m_Channels; iChannel++ ) {
+		m_pEstimateBuf[iChannel].m_pMantissa = new unsigned int [ m_FrameSize ];
+		m_pEstimateBuf[iChannel].m_pMantissaTmp = new unsigned int [ X_CANDIDATES ];
+		m_pEstimateBuf[iChannel].m_pX2 = new FLOAT_EXP [ m_FrameSize ];
+		m_pEstimateBuf[iChannel].m_pX2Sorted = new FLOAT_EXP [ X_CANDIDATES ];
+		m_pEstimateBuf[iChannel].m_pRes = new CONVERGENCE_RES [ X_CANDIDATES ];
+		m_pEstimateBuf[iChannel].m_pResTmp = new CONVERGENCE_RES [ X_CANDIDATES ];
+		m_pEstimateBuf[iChannel].m_pNmRes = new int [ X_CANDIDATES ];
+		m_pEstimateBuf[iChannel].m_pDns = new int [ X_CANDIDATES ];
+		m_pEstimateBuf[iChannel].m_pDnsCount = new int [ X_CANDIDATES ];
+	}
+
+	// Allocate buffers for MLZ coding in EncodeDiff()
+	m_pMlzLength = new int [ m_FrameSize ];
+	m_pMlzArray = new unsigned char [ m_FrameSize * ( 32 / WORD_SIZE ) ];
+	m_pMlzArrayMask = new unsigned char [ m_FrameSize * ( 32 / WORD_SIZE ) ];
+	m_pMlzEncoded = new unsigned char [ m_FrameSize * 32 ];
+
+	// Allocate work buffer for FindDiffFloatPCM() and AddIEEEDiff()
+	m_pPCMBits = new unsigned int [ m_FrameSize ];
+
+	// Allocate work buffer for DecodeDiff()
+	m_pMlzDecLength = new unsigned char [ m_FrameSize ];
+
+	// Allocate work buffer for ChannelSort()
+	m_ppSortBuf = new float* [ m_Channels * 2 ];
+
 	// Create CMLZ object
 	m_pMlz = new CMLZ;
 }
@@ -601,7 +690,7 @@ void	CFloat::FreeBuffer( void )
 
 	// Free temporary buffer
 	if ( m_ppCBuffD ) {
-		for( iChannel=0; iChannel<m_Channels * m_FrameSize; iChannel++ ) delete[] m_ppCBuffD[iChannel];
+		delete[] m_ppCBuffD[0];
 		delete[] m_ppCBuffD;
 		m_ppCBuffD = NULL;
 	}
@@ -663,6 +752,59 @@ void	CFloat::FreeBuffer( void )
 		m_pGhb = NULL;
 	}
 
+	// Free previous GCF buffer
+	if ( m_pPrevAcfGCF != NULL ) {
+		delete[] m_pPrevAcfGCF;
+		m_pPrevAcfGCF = NULL;
+	}
+
+	// Free work buffers for EstimateMultiplier()
+	if ( m_pEstimateBuf != NULL ) {
+		for( iChannel=0; iChannel<m_Channels; iChannel++ ) {
+			delete[] m_pEstimateBuf[iChannel].m_pMantissa;
+			delete[] m_pEstimateBuf[iChannel].m_pMantissaTmp;
+			delete[] m_pEstimateBuf[iChannel].m_pX2;
+			delete[] m_pEstimateBuf[iChannel].m_pX2Sorted;
+			delete[] m_pEstimateBuf[iChannel].m_pRes;
+			delete[] m_pEstimateBuf[iChannel].m_pResTmp;
+			delete[] m_pEstimateBuf[iChannel].m_pNmRes;
+			delete[] m_pEstimateBuf[iChannel].m_pDns;
+			delete[] m_pEstimateBuf[iChannel].m_pDnsCount;
+		}
+		delete[] m_pEstimateBuf;
+		m_pEstimateBuf = NULL;
+	}
+
+	// Free buffers for MLZ coding
+	if ( m_pMlzLength != NULL ) {
+		delete[] m_pMlzLength;
+		m_pMlzLength = NULL;
+	}
+	if ( m_pMlzArray != NULL ) {
+		delete[] m_pMlzArray;
+		m_pMlzArray = NULL;
+	}
+	if ( m_pMlzArrayMask != NULL ) {
+		delete[] m_pMlzArrayMask;
+		m_pMlzArrayMask = NULL;
+	}
+	if ( m_pMlzEncoded != NULL ) {
+		delete[] m_pMlzEncoded;
+		m_pMlzEncoded = NULL;
+	}
+	if ( m_pPCMBits != NULL ) {
+		delete[] m_pPCMBits;
+		m_pPCMBits = NULL;
+	}
+	if ( m_pMlzDecLength != NULL ) {
+		delete[] m_pMlzDecLength;
+		m_pMlzDecLength = NULL;
+	}
+	if ( m_ppSortBuf != NULL ) {
+		delete[] m_ppSortBuf;
+		m_ppSortBuf = NULL;
+	}
+
 	// Destroy CMLZ object
 	if ( m_pMlz != NULL ) {
 		m_pMlz->FreeDict();
@@ -683,8 +825,8 @@ void	CFloat::FreeBuffer( void )
 void	CFloat::ChannelSort( const unsigned short* pChPos, bool Direction )
 {
 	int	i;
-	float**	ppFloatBuf = new float* [ m_Channels ];
-	float**	ppAcfBuff = new float* [ m_Channels ];
+	float**	ppFloatBuf = m_ppSortBuf;
+	float**	ppAcfBuff = m_ppSortBuf + m_Channels;
 
 	// Save the current pointers
 	for( i=0; i<m_Channels; i++ ) {
@@ -705,8 +847,6 @@ void	CFloat::ChannelSort( const unsigned short* pChPos, bool Direction )
 			m_ppAcfBuff[pChPos[i]] = ppAcfBuff[i];
 		}
 	}
-	delete[] ppFloatBuf;
-	delete[] ppAcfBuff;
 }
 
 //////////////////////////////////////////////////////////////////////
@@ -943,7 +1083,34 @@ int	CFloat::ilog2( unsigned int x )
 // MlzMode = MLZ mode (0-1)
 void	CFloat::ConvertFloatToInteger( int** ppIntBuf, int FrameSize, bool RandomAccess, short AcfMode, float AcfGain, short MlzMode )
 {
-	long	iSample, iChannel, badCount;
+	long	iChannel;
+
+	PrepareAnalysis( RandomAccess, AcfMode );
+
+	// Channel loop
+	// Channels are analyzed and converted independently of each other, so
+	// they are processed concurrently when compiled with OpenMP.
+#pragma omp parallel for schedule(dynamic) if( m_Channels > 1 )
+	for( iChannel=0; iChannel<m_Channels; iChannel++ ) {
+		Analyze( iChannel, FrameSize, AcfMode, AcfGain, MlzMode );
+		ConvertChannel( iChannel, ppIntBuf[iChannel], FrameSize, AcfMode, AcfGain, MlzMode );
+	} // Channel loop
+}
+
+////////////////////////////////////////
+//                                    //
+//  Convert float to integer (1 ch)   //
+//                                    //
+////////////////////////////////////////
+// iChannel = Channel index
+// pIntBuf = y signal of iChannel in integer format (output)
+// FrameSize = Number of samples per frame
+// AcfMode = ACF mode (0-3)
+// AcfGain = ACF gain value (valid when AcfMode==3)
+// MlzMode = MLZ mode (0-1)
+void	CFloat::ConvertChannel( long iChannel, int* pIntBuf, int FrameSize, short AcfMode, float AcfGain, short MlzMode )
+{
+	long	iSample, badCount;
 	int		ShiftBit, mode, shiftMode;
 	float	Scale;
 	float	y, y1, a, x, x1;
@@ -951,201 +1118,188 @@ void	CFloat::ConvertFloatToInteger( int** ppIntBuf, int FrameSize, bool RandomAc
 	unsigned int mantissa;
 	long err;
 
-	Analyze( FrameSize, RandomAccess, AcfMode, AcfGain, MlzMode );
-
-	// Channel loop
-	for( iChannel=0; iChannel<m_Channels; iChannel++ ) {
-		if ( ( MlzMode == 0 ) && ( m_pAcfMode[iChannel] == 1 ) ) m_pAcfGCF[iChannel] = 0.f;
-		a = m_pAcfGCF[iChannel];
-		if ( ( a != 1.f ) && ( a != 0.f ) ) {
-			// Find an appropriate shift parameter
-			mode = m_pAcfMode[iChannel];
-
-			// set shift mode
-			if ( AcfMode == 3 && AcfGain <= 0.f ) {
-				// force to use given shift value
-				fx.Set(AcfGain);
-				shiftMode = fx.m_exp;
-				if ( shiftMode <= -127 || shiftMode >=128 ) shiftMode = -IEEE754_EXP_BIASED; 
-			} else {
-				// auto detection mode
-				shiftMode = -IEEE754_EXP_BIASED;
-			}
-			ShiftBit = SearchShift( m_ppFloatBuf[iChannel], m_ppAcfBuff[iChannel], a, m_pLastShiftBit[iChannel], FrameSize, &mode, shiftMode );
-			if ( mode != m_pAcfMode[iChannel]) {
-				a = m_pAcfGCF[iChannel] = 0.f;
-			} else {
-				m_pShiftBit[iChannel] = static_cast<unsigned char>( ShiftBit + IEEE754_EXP_BIASED );
-
-				// Convert to integer
-				Scale = CIEEE32::PowOfTwo( m_IntRes - 1 - ShiftBit );
-
-				badCount = 0;
-				// modify y[]
-				for( iSample=0; iSample<FrameSize; iSample++ ) {
-					x = m_ppFloatBuf[iChannel][iSample];
-					y = m_ppAcfBuff[iChannel][iSample];
-					err = 0;
+	if ( ( MlzMode == 0 ) && ( m_pAcfMode[iChannel] == 1 ) ) m_pAcfGCF[iChannel] = 0.f;
+	a = m_pAcfGCF[iChannel];
+	if ( ( a != 1.f ) && ( a != 0.f ) ) {
+		// Find an appropriate shift parameter
+		mode = m_pAcfMode[iChannel];
+
+		// set shift mode
+		if ( AcfMode == 3 && AcfGain <= 0.f ) {
+			// force to use given shift value
+			fx.Set(AcfGain);
+			shiftMode = fx.m_exp;
+			if ( shiftMode <= -127 || shiftMode >=128 ) shiftMode = -IEEE754_EXP_BIASED; 
+		} else {
+			// auto detection mode
+			shiftMode = -IEEE754_EXP_BIASED;
+		}
+		ShiftBit = SearchShift( m_ppFloatBuf[iChannel], m_ppAcfBuff[iChannel], a, m_pLastShiftBit[iChannel], FrameSize, &mode, shiftMode );
+		if ( mode != m_pAcfMode[iChannel]) {
+			a = m_pAcfGCF[iChannel] = 0.f;
+		} else {
+			m_pShiftBit[iChannel] = static_cast<unsigned char>( ShiftBit + IEEE754_EXP_BIASED );
 
-					if ( ( m_ppAcfBuff[iChannel][iSample] == 0.f ) || ( m_ppAcfBuff[iChannel][iSample] == -0.f ) ) {
-						ppIntBuf[iChannel][iSample] = 0;
-						x1 = y1 = 0.f;
+			// Convert to integer
+			Scale = CIEEE32::PowOfTwo( m_IntRes - 1 - ShiftBit );
 
-					} else if ( m_ppAcfBuff[iChannel][iSample] > 0 ) {
-						ppIntBuf[iChannel][iSample] = static_cast<int>( floor( m_ppAcfBuff[iChannel][iSample] * Scale ) );
-						y1 = static_cast<float>( ppIntBuf[iChannel][iSample] ) / Scale;
-						x1 = CIEEE32::Multiple( y1, a );	// x'[i] = y'[i] * a
-						if ( x1 != x ) {
-							while ( x1 < x ) {	// x'[] < x[]
-								ppIntBuf[iChannel][iSample]++;
-								y1 = static_cast<float>( ppIntBuf[iChannel][iSample] ) / Scale;	// y'[]
-								x1 = CIEEE32::Multiple( y1, a );	// x'[i] = y'[i] * a
-							}
-							while ( x1 > x ) {
-								ppIntBuf[iChannel][iSample]--;
-								y1 = static_cast<float>( ppIntBuf[iChannel][iSample] ) / Scale;	// y'[]
-								x1 = CIEEE32::Multiple( y1, a );	// x'[i] = y'[i] * a
-							}
+			badCount = 0;
+			// modify y[]
+			for( iSample=0; iSample<FrameSize; iSample++ ) {
+				x = m_ppFloatBuf[iChannel][iSample];
+				y = m_ppAcfBuff[iChannel][iSample];
+				err = 0;
+
+				if ( ( m_ppAcfBuff[iChannel][iSample] == 0.f ) || ( m_ppAcfBuff[iChannel][iSample] == -0.f ) ) {
+					pIntBuf[iSample] = 0;
+					x1 = y1 = 0.f;
+
+				} else if ( m_ppAcfBuff[iChannel][iSample] > 0 ) {
+					pIntBuf[iSample] = static_cast<int>( floor( m_ppAcfBuff[iChannel][iSample] * Scale ) );
+					y1 = static_cast<float>( pIntBuf[iSample] ) / Scale;
+					x1 = CIEEE32::Multiple( y1, a );	// x'[i] = y'[i] * a
+					if ( x1 != x ) {
+						while ( x1 < x ) {	// x'[] < x[]
+							pIntBuf[iSample]++;
+							y1 = static_cast<float>( pIntBuf[iSample] ) / Scale;	// y'[]
+							x1 = CIEEE32::Multiple( y1, a );	// x'[i] = y'[i] * a
 						}
-						// check difference
-						fx.Set(x);
-						fx1.Set(x1);
-						if ( fx.m_exp == fx1.m_exp ) {
-							err = (fx.m_mantissa - fx1.m_mantissa);
-						} else if ( fx.m_exp > fx1.m_exp ) {
-							mantissa = fx.m_mantissa << (fx.m_exp - fx1.m_exp);
-							err = (mantissa - fx1.m_mantissa);
+						while ( x1 > x ) {
+							pIntBuf[iSample]--;
+							y1 = static_cast<float>( pIntBuf[iSample] ) / Scale;	// y'[]
+							x1 = CIEEE32::Multiple( y1, a );	// x'[i] = y'[i] * a
 						}
-						if ( err >= 0x0800000UL ) {
-							ppIntBuf[iChannel][iSample] = 0;
-							x1 = y1 = 0.f;
-							badCount += 32;
-							err = 32;
-						} else {
+					}
+					// check difference
+					fx.Set(x);
+					fx1.Set(x1);
+					if ( fx.m_exp == fx1.m_exp ) {
+						err = (fx.m_mantissa - fx1.m_mantissa);
+					} else if ( fx.m_exp > fx1.m_exp ) {
+						mantissa = fx.m_mantissa << (fx.m_exp - fx1.m_exp);
+						err = (mantissa - fx1.m_mantissa);
+					}
+					if ( err >= 0x0800000UL ) {
+						pIntBuf[iSample] = 0;
+						x1 = y1 = 0.f;
+						badCount += 32;
+						err = 32;
+					} else {
 //							if ( fx.m_exp < fx1.m_exp ) {
 //								printf("ERRR!! fx.m_exp < fx1.m_exp\n");
 //							}
-							err = (long )ilog2(err);
-							badCount += err;
-						}
-						if ( (badCount > (iSample+1)*24) || (badCount > FrameSize*4) ) {
+						err = (long )ilog2(err);
+						badCount += err;
+					}
+					if ( (badCount > (iSample+1)*24) || (badCount > FrameSize*4) ) {
 //							printf("NG(acf = %f): badCount = %d\n", a, badCount);
-							a = m_pAcfGCF[iChannel] = 0.f;
-							break;
-						}
-					} else {
-						ppIntBuf[iChannel][iSample] = static_cast<int>( ceil( m_ppAcfBuff[iChannel][iSample] * Scale ) );
-						y1 = static_cast<float>( ppIntBuf[iChannel][iSample] ) / Scale;	// y'[]
-						x1 = CIEEE32::Multiple( y1, a );
-						if ( x1 != x ) {
-							while ( x1 > x ) {	// x'[] > x[]
-								ppIntBuf[iChannel][iSample]--;
-								y1 = static_cast<float>( ppIntBuf[iChannel][iSample] ) / Scale;	// y'[]
-								x1 = CIEEE32::Multiple( y1, a );	// x'[i] = y'[i] * a
-							}
-							// don't need ppIntBuf[iChannel][iSample]++
-							// changed for 299\48k24bit\haffner.wav
-							while ( x1 < x ) {
-								ppIntBuf[iChannel][iSample]++;
-								y1 = static_cast<float>( ppIntBuf[iChannel][iSample] ) / Scale;	// y'[]
-								x1 = CIEEE32::Multiple( y1, a );	// x'[i] = y'[i] * a
-							}
+						a = m_pAcfGCF[iChannel] = 0.f;
+						break;
+					}
+				} else {
+					pIntBuf[iSample] = static_cast<int>( ceil( m_ppAcfBuff[iChannel][iSample] * Scale ) );
+					y1 = static_cast<float>( pIntBuf[iSample] ) / Scale;	// y'[]
+					x1 = CIEEE32::Multiple( y1, a );
+					if ( x1 != x ) {
+						while ( x1 > x ) {	// x'[] > x[]
+							pIntBuf[iSample]--;
+							y1 = static_cast<float>( pIntBuf[iSample] ) / Scale;	// y'[]
+							x1 = CIEEE32::Multiple( y1, a );	// x'[i] = y'[i] * a
 						}
-						// check difference
-						fx.Set(x);
-						fx1.Set(x1);
-						if ( fx.m_exp == fx1.m_exp ) {
-							err = (fx.m_mantissa - fx1.m_mantissa);
-						} else if ( fx.m_exp > fx1.m_exp ) {
-							mantissa = fx.m_mantissa << (fx.m_exp - fx1.m_exp);
-							err = (mantissa - fx1.m_mantissa);
+						// don't need pIntBuf[iSample]++
+						// changed for 299\48k24bit\haffner.wav
+						while ( x1 < x ) {
+							pIntBuf[iSample]++;
+							y1 = static_cast<float>( pIntBuf[iSample] ) / Scale;	// y'[]
+							x1 = CIEEE32::Multiple( y1, a );	// x'[i] = y'[i] * a
 						}
-						if ( err >= 0x0800000UL ) {
-							ppIntBuf[iChannel][iSample] = 0;
-							x1 = y1 = 0.f;
-							badCount += 32;
-							err = 32;
-						} else {
+					}
+					// check difference
+					fx.Set(x);
+					fx1.Set(x1);
+					if ( fx.m_exp == fx1.m_exp ) {
+						err = (fx.m_mantissa - fx1.m_mantissa);
+					} else if ( fx.m_exp > fx1.m_exp ) {
+						mantissa = fx.m_mantissa << (fx.m_exp - fx1.m_exp);
+						err = (mantissa - fx1.m_mantissa);
+					}
+					if ( err >= 0x0800000UL ) {
+						pIntBuf[iSample] = 0;
+						x1 = y1 = 0.f;
+						badCount += 32;
+						err = 32;
+					} else {
 //							if ( fx.m_exp < fx1.m_exp ) {
 //								printf("ERRR!! fx.m_exp < fx1.m_exp\n");
 //							}
-							err = (long )ilog2(err);
-							badCount += err; 
-						}
-						if ( (badCount > (iSample+1)*24) || (badCount > FrameSize*4) ) {
-							a = m_pAcfGCF[iChannel] = 0.f;
-							break;
-						}
+						err = (long )ilog2(err);
+						badCount += err; 
 					}
-					if ( badCount > FrameSize*3 ) {
+					if ( (badCount > (iSample+1)*24) || (badCount > FrameSize*4) ) {
 						a = m_pAcfGCF[iChannel] = 0.f;
 						break;
 					}
 				}
-			} // sample loop
-		} // Acf != 1.0
+				if ( badCount > FrameSize*3 ) {
+					a = m_pAcfGCF[iChannel] = 0.f;
+					break;
+				}
+			}
+		} // sample loop
+	} // Acf != 1.0
 
-		if ( ( a == 1.f ) || ( a == 0.f ) ) {
-			m_pAcfSearchCount[iChannel]++;
-			if ( m_pAcfSearchCount[iChannel] > 20 )
-				m_pAcfSearchCount[iChannel] = 0;
-			mode = m_pAcfMode[iChannel];
+	if ( ( a == 1.f ) || ( a == 0.f ) ) {
+		m_pAcfSearchCount[iChannel]++;
+		if ( m_pAcfSearchCount[iChannel] > 20 )
+			m_pAcfSearchCount[iChannel] = 0;
+		mode = m_pAcfMode[iChannel];
 
-			// set shift mode
-			// auto detection mode
-			shiftMode = -IEEE754_EXP_BIASED;
-			ShiftBit = SearchShift( m_ppFloatBuf[iChannel], m_ppAcfBuff[iChannel], a, m_pLastShiftBit[iChannel], FrameSize, &mode, shiftMode );
-			m_pShiftBit[iChannel] = static_cast<unsigned char>( ShiftBit + IEEE754_EXP_BIASED );
+		// set shift mode
+		// auto detection mode
+		shiftMode = -IEEE754_EXP_BIASED;
+		ShiftBit = SearchShift( m_ppFloatBuf[iChannel], m_ppAcfBuff[iChannel], a, m_pLastShiftBit[iChannel], FrameSize, &mode, shiftMode );
+		m_pShiftBit[iChannel] = static_cast<unsigned char>( ShiftBit + IEEE754_EXP_BIASED );
 
-			// Convert to integer
-			Scale = CIEEE32::PowOfTwo( m_IntRes - 1 - ShiftBit );
-			for( iSample=0; iSample<FrameSize; iSample++ ) {
-				fx.Set( m_ppFloatBuf[iChannel][iSample] );
-				if ( (-127 < fx.m_exp) && ( fx.m_exp < 128 ) ) {
-					if ( m_ppFloatBuf[iChannel][iSample] > 0 ) {
-						ppIntBuf[iChannel][iSample] = static_cast<int>( floor( m_ppFloatBuf[iChannel][iSample] * Scale ) );
-					} else {
-						ppIntBuf[iChannel][iSample] = static_cast<int>( ceil( m_ppFloatBuf[iChannel][iSample] * Scale ) );
-					}
+		// Convert to integer
+		Scale = CIEEE32::PowOfTwo( m_IntRes - 1 - ShiftBit );
+		for( iSample=0; iSample<FrameSize; iSample++ ) {
+			fx.Set( m_ppFloatBuf[iChannel][iSample] );
+			if ( (-127 < fx.m_exp) && ( fx.m_exp < 128 ) ) {
+				if ( m_ppFloatBuf[iChannel][iSample] > 0 ) {
+					pIntBuf[iSample] = static_cast<int>( floor( m_ppFloatBuf[iChannel][iSample] * Scale ) );
 				} else {
-					// 0 or denormalized number
-					// NaN or +/-infinite
-					ppIntBuf[iChannel][iSample] = 0;
+					pIntBuf[iSample] = static_cast<int>( ceil( m_ppFloatBuf[iChannel][iSample] * Scale ) );
 				}
-				if ( ppIntBuf[iChannel][iSample] > 8388607L || ppIntBuf[iChannel][iSample] < -8388608L ) {
+			} else {
+				// 0 or denormalized number
+				// NaN or +/-infinite
+				pIntBuf[iSample] = 0;
+			}
+			if ( pIntBuf[iSample] > 8388607L || pIntBuf[iSample] < -8388608L ) {
 //					printf("Err!!: Shifted value exceeded 24bit!!, ShiftBit=%d\n", ShiftBit);
-					ppIntBuf[iChannel][iSample] = 0;
-				}
+				pIntBuf[iSample] = 0;
 			}
-		} // acf == 1.f || acf == 0.f
-		else {
-			m_pAcfSearchCount[iChannel] = 0;
 		}
-	} // Channel loop
+	} // acf == 1.f || acf == 0.f
+	else {
+		m_pAcfSearchCount[iChannel] = 0;
+	}
 }
 
 ////////////////////////////////////////
 //                                    //
-//              Analyze               //
+//         Prepare analysis           //
 //                                    //
 ////////////////////////////////////////
-// FrameSize = Number of samples per frame
 // RandomAccess = true:Random accessable frame
 // AcfMode = ACF mode (0-3)
-// AcfGain = ACF gain value (valid when AcfMode==3)
-// MlzMode = MLZ mode (0-1)
-void	CFloat::Analyze( long FrameSize, bool RandomAccess, short AcfMode, float AcfGain, short MlzMode )
+void	CFloat::PrepareAnalysis( bool RandomAccess, short AcfMode )
 {
-	long			i, j, k, err;
-	CIEEE32			fnum;
-	float			acfCandidates[NUM_ACF_MAX];
-	int				num_acf, cand;
-	unsigned int	r;
+	long	j;
 
 	for( j=0; j<m_Channels; j++ ) {
-		cand = 0;
-		m_pExistResidual[j] = 0;
-		m_pAcfMode[j] = 0;
+		// Keep the previous frame's value for the cross-channel ACF test in Analyze().
+		m_pPrevAcfGCF[j] = m_pLastAcfGCF[j];
 
 		// In random access frame, m_pLastAcfGCF[] is forced to be 0.f.
 		if ( RandomAccess ) {
@@ -1155,149 +1309,176 @@ void	CFloat::Analyze( long FrameSize, bool RandomAccess, short AcfMode, float Ac
 
 		// When -noACF is specified, m_pLastAcfGCF[] is always 1.f.
 		if ( AcfMode == 0 ) m_pLastAcfGCF[j] = 1.f;
+	}
+}
 
-		if ( AcfMode == 3 ) {
-			// When AcfMode==3, use AcfGain.
-			if ( AcfGain <= -0.f )	AcfGain *= -1.f;
-			m_pAcfGCF[j] = AcfGain;
-			if ( ( m_pAcfGCF[j] >= 2.f ) || ( 1.f > m_pAcfGCF[j] ) ) {
-				fnum.Set( m_pAcfGCF[j] );
-				m_pAcfGCF[j] *= CIEEE32::PowOfTwo( -fnum.m_exp );
+////////////////////////////////////////
+//                                    //
+//              Analyze               //
+//                                    //
+////////////////////////////////////////
+// j = Channel index
+// FrameSize = Number of samples per frame
+// AcfMode = ACF mode (0-3)
+// AcfGain = ACF gain value (valid when AcfMode==3)
+// MlzMode = MLZ mode (0-1)
+// * PrepareAnalysis() must be called before analyzing the first channel.
+void	CFloat::Analyze( long j, long FrameSize, short AcfMode, float AcfGain, short MlzMode )
+{
+	long			i, k, err;
+	CIEEE32			fnum;
+	float			acfCandidates[NUM_ACF_MAX];
+	float			LastAcfGCF;
+	int				num_acf, cand;
+	unsigned int	r;
+
+	cand = 0;
+	m_pExistResidual[j] = 0;
+	m_pAcfMode[j] = 0;
+
+	if ( AcfMode == 3 ) {
+		// When AcfMode==3, use AcfGain.
+		if ( AcfGain <= -0.f )	AcfGain *= -1.f;
+		m_pAcfGCF[j] = AcfGain;
+		if ( ( m_pAcfGCF[j] >= 2.f ) || ( 1.f > m_pAcfGCF[j] ) ) {
+			fnum.Set( m_pAcfGCF[j] );
+			m_pAcfGCF[j] *= CIEEE32::PowOfTwo( -fnum.m_exp );
+		}
+		// try AcfGain
+		r = Check( m_ppFloatBuf[j], m_ppAcfBuff[j], m_pAcfGCF[j], FrameSize );
+
+	} else if ( m_pLastAcfGCF[j] == 1.f ) {
+		// when m_pLastAcfGCF[j] == 1.0, use that value.
+		m_pAcfGCF[j] = m_pLastAcfGCF[j];
+		r = 0;	// skip search branch
+		for( i=0; i<FrameSize; i++ ) m_ppAcfBuff[j][i] = m_ppFloatBuf[j][i];
+
+	} else if ( m_pLastAcfGCF[j] != 0.f ) {
+		// when m_pLastAcfGCF[j] != 0.0, try the last acf value.
+		m_pAcfGCF[j] = m_pLastAcfGCF[j];
+		r = Check( m_ppFloatBuf[j], m_ppAcfBuff[j], m_pAcfGCF[j], FrameSize );
+
+		if ( r != 0 && ( MlzMode != 0 ) ) {
+			// try to check the case of z!=0
+			if ( ( err = CheckZneZ( m_ppFloatBuf[j], m_ppAcfBuff[j], m_pAcfGCF[j], FrameSize ) ) < (FrameSize / 24) ) {
+				m_pAcfMode[j] = 1;
+				m_pExistResidual[j] = 1;
+				r = 0;		// set OK flag.
 			}
-			// try AcfGain
-			r = Check( m_ppFloatBuf[j], m_ppAcfBuff[j], m_pAcfGCF[j], FrameSize );
-
-		} else if ( m_pLastAcfGCF[j] == 1.f ) {
-			// when m_pLastAcfGCF[j] == 1.0, use that value.
-			m_pAcfGCF[j] = m_pLastAcfGCF[j];
-			r = 0;	// skip search branch
-			for( i=0; i<FrameSize; i++ ) m_ppAcfBuff[j][i] = m_ppFloatBuf[j][i];
-
-		} else if ( m_pLastAcfGCF[j] != 0.f ) {
-			// when m_pLastAcfGCF[j] != 0.0, try the last acf value.
-			m_pAcfGCF[j] = m_pLastAcfGCF[j];
-			r = Check( m_ppFloatBuf[j], m_ppAcfBuff[j], m_pAcfGCF[j], FrameSize );
-
-			if ( r != 0 && ( MlzMode != 0 ) ) {
-				// try to check the case of z!=0
-				if ( ( err = CheckZneZ( m_ppFloatBuf[j], m_ppAcfBuff[j], m_pAcfGCF[j], FrameSize ) ) < (FrameSize / 24) ) {
-					m_pAcfMode[j] = 1;
-					m_pExistResidual[j] = 1;
-					r = 0;		// set OK flag.
-				}
+		}
+	} else {
+		// otherwise (m_pLastAcfGCF[j] == 0.0), force to search	
+		r = 1;
+		if ( AcfMode != 2 ) {	// Not full search
+			// count up to find
+			if( m_pAcfSearchCount[j] > 3 ) {
+				m_pAcfGCF[j] = m_pLastAcfGCF[j];
+				r = 0;	// skip search branch
+				for( i=0; i<FrameSize; i++ ) m_ppAcfBuff[j][i] = m_ppFloatBuf[j][i];
 			}
+		}
+	}
+
+	// in the case of the m_pLastAcfGCF is not good enough
+	if ( r != 0 ) {
+		m_pExistResidual[j] = 0;
+		if ( AcfMode == 3 ) {
+			num_acf = 1;
+			acfCandidates[0] = AcfGain;
 		} else {
-			// otherwise (m_pLastAcfGCF[j] == 0.0), force to search	
-			r = 1;
-			if ( AcfMode != 2 ) {	// Not full search
-				// count up to find
-				if( m_pAcfSearchCount[j] > 3 ) {
-					m_pAcfGCF[j] = m_pLastAcfGCF[j];
-					r = 0;	// skip search branch
-					for( i=0; i<FrameSize; i++ ) m_ppAcfBuff[j][i] = m_ppFloatBuf[j][i];
-				}
-			}
+			num_acf = EstimateMultiplier( m_ppFloatBuf[j], FrameSize, acfCandidates, NUM_ACF_MAX, m_pEstimateBuf[j] );
 		}
 
-		// in the case of the m_pLastAcfGCF is not good enough
-		if ( r != 0 ) {
-			m_pExistResidual[j] = 0;
-			if ( AcfMode == 3 ) {
-				num_acf = 1;
-				acfCandidates[0] = AcfGain;
-			} else {
-				num_acf = EstimateMultiplier( m_ppFloatBuf[j], FrameSize, acfCandidates, NUM_ACF_MAX );
+		cand = 0;
+		for( ; cand<num_acf; cand++ ) {
+			m_pAcfGCF[j] = acfCandidates[cand];
+			if (m_pAcfGCF[j] == 1.0f) continue;
+			if ( ( m_pAcfGCF[j] >= 2.f ) || ( 1.f > m_pAcfGCF[j] ) ) {
+				fnum.Set( m_pAcfGCF[j] );
+				m_pAcfGCF[j] *= CIEEE32::PowOfTwo( -fnum.m_exp );
+				acfCandidates[cand] = m_pAcfGCF[j];
 			}
 
-			cand = 0;
-			for( ; cand<num_acf; cand++ ) {
-				m_pAcfGCF[j] = acfCandidates[cand];
-				if (m_pAcfGCF[j] == 1.0f) continue;
-				if ( ( m_pAcfGCF[j] >= 2.f ) || ( 1.f > m_pAcfGCF[j] ) ) {
-					fnum.Set( m_pAcfGCF[j] );
-					m_pAcfGCF[j] *= CIEEE32::PowOfTwo( -fnum.m_exp );
-					acfCandidates[cand] = m_pAcfGCF[j];
-				}
-
-				if ( ( m_pAcfGCF[j] != 1.f ) && ( ( r = Check( m_ppFloatBuf[j], m_ppAcfBuff[j], m_pAcfGCF[j], FrameSize ) ) == 0 ) ) {
-					// good acf was found
-					break;
-				}
+			if ( ( m_pAcfGCF[j] != 1.f ) && ( ( r = Check( m_ppFloatBuf[j], m_ppAcfBuff[j], m_pAcfGCF[j], FrameSize ) ) == 0 ) ) {
+				// good acf was found
+				break;
 			}
+		}
 
-			if ( ( cand == num_acf ) && ( r != 0 ) ) {
-				// test other channel's ACF
-				for( k=0; k<m_Channels; k++ ) {
-					if ( k == j ) continue;
-
-					if ( ( m_pLastAcfGCF[k] != 1.f ) && ( m_pLastAcfGCF[k] != 0.f ) ) {
-						m_pAcfGCF[j] = m_pLastAcfGCF[k];
-						if ( ( r = Check( m_ppFloatBuf[j], m_ppAcfBuff[j], m_pAcfGCF[j], FrameSize ) ) == 0 ) break;
-					}
+		if ( ( cand == num_acf ) && ( r != 0 ) ) {
+			// test other channel's ACF
+			for( k=0; k<m_Channels; k++ ) {
+				if ( k == j ) continue;
+
+				// Channels before j see the value after PrepareAnalysis(), the
+				// others the one from the previous frame.
+				LastAcfGCF = ( k < j ) ? m_pLastAcfGCF[k] : m_pPrevAcfGCF[k];
+				if ( ( LastAcfGCF != 1.f ) && ( LastAcfGCF != 0.f ) ) {
+					m_pAcfGCF[j] = LastAcfGCF;
+					if ( ( r = Check( m_ppFloatBuf[j], m_ppAcfBuff[j], m_pAcfGCF[j], FrameSize ) ) == 0 ) break;
 				}
+			}
 
-				if ( r != 0 ) {
-					if ( MlzMode != 0 ) {
-						// try to check the case of z!=0
-						long err_min;
-						long thres;
-						int i_err_min, num_test;
-
-						err_min = -1;
-						i_err_min = 1;
-						for ( cand = 0; cand <num_acf; cand++) {
-							if ( acfCandidates[cand] != 1.f && acfCandidates[cand] != 0.f ) {
-								for ( k = cand + 1; k < num_acf; k++ ) {
-									if ( acfCandidates[k] == acfCandidates[cand] )
-										acfCandidates[k] = 0.f;
-								}
+			if ( r != 0 ) {
+				if ( MlzMode != 0 ) {
+					// try to check the case of z!=0
+					long err_min;
+					long thres;
+					int i_err_min, num_test;
+
+					err_min = -1;
+					i_err_min = 1;
+					for ( cand = 0; cand <num_acf; cand++) {
+						if ( acfCandidates[cand] != 1.f && acfCandidates[cand] != 0.f ) {
+							for ( k = cand + 1; k < num_acf; k++ ) {
+								if ( acfCandidates[k] == acfCandidates[cand] )
+									acfCandidates[k] = 0.f;
 							}
 						}
+					}
 
-						if ( AcfMode == 3 )
-							thres = FrameSize / 5;
-						else
-							thres = FrameSize / 24;
-
-						cand = 0;
-						num_test = 0;
-						for( ; cand<num_acf; cand++ ) {
-							m_pAcfGCF[j] = acfCandidates[cand];
-							if (m_pAcfGCF[j] == 1.0f || m_pAcfGCF[j] == 0.0f) continue;
-
-							err = CheckZneZ( m_ppFloatBuf[j], m_ppAcfBuff[j], m_pAcfGCF[j], FrameSize );
-							if ( ( err_min < 0 ) || ( err < err_min ) ) {
-								err_min = err;
-								i_err_min = cand;
-							}
-							num_test++;
-							// good acf was found
-						}
-
-						if ( ( err_min >= 0 ) && ( err_min < thres ) ) {
-							m_pAcfGCF[j] = acfCandidates[i_err_min];
-							if ( ( m_pAcfGCF[j] != 1.f ) && ( m_pAcfGCF[j] != 0.f ) ){
-								if ( num_test != 1 )
-									err = CheckZneZ( m_ppFloatBuf[j], m_ppAcfBuff[j], m_pAcfGCF[j], FrameSize );
-								m_pExistResidual[j] = 1;
-								r = 0; // set OK flag.
-								m_pAcfMode[j] = 1;
-							}
+					if ( AcfMode == 3 )
+						thres = FrameSize / 5;
+					else
+						thres = FrameSize / 24;
+
+					cand = 0;
+					num_test = 0;
+					for( ; cand<num_acf; cand++ ) {
+						m_pAcfGCF[j] = acfCandidates[cand];
+						if (m_pAcfGCF[j] == 1.0f || m_pAcfGCF[j] == 0.0f) continue;
+
+						err = CheckZneZ( m_ppFloatBuf[j], m_ppAcfBuff[j], m_pAcfGCF[j], FrameSize );
+						if ( ( err_min < 0 ) || ( err < err_min ) ) {
+							err_min = err;
+							i_err_min = cand;
 						}
+						num_test++;
+						// good acf was found
 					}
 
-					// No good ACF has been found.
-					if ( r != 0 ) {
-						m_pAcfGCF[j] = 0.f;
-						for( i=0; i<FrameSize; i++ ) m_ppAcfBuff[j][i] = m_ppFloatBuf[j][i];
+					if ( ( err_min >= 0 ) && ( err_min < thres ) ) {
+						m_pAcfGCF[j] = acfCandidates[i_err_min];
+						if ( ( m_pAcfGCF[j] != 1.f ) && ( m_pAcfGCF[j] != 0.f ) ){
+							if ( num_test != 1 )
+								err = CheckZneZ( m_ppFloatBuf[j], m_ppAcfBuff[j], m_pAcfGCF[j], FrameSize );
+							m_pExistResidual[j] = 1;
+							r = 0; // set OK flag.
+							m_pAcfMode[j] = 1;
+						}
 					}
+				}
 
+				// No good ACF has been found.
+				if ( r != 0 ) {
+					m_pAcfGCF[j] = 0.f;
+					for( i=0; i<FrameSize; i++ ) m_ppAcfBuff[j][i] = m_ppFloatBuf[j][i];
 				}
+
 			}
 		}
-		m_pLastExistResidual[j] = m_pExistResidual[j];
-
-	} // channel loop
+	}
+	m_pLastExistResidual[j] = m_pExistResidual[j];
 }
 
 ////////////////////////////////////////
@@ -1307,51 +1488,81 @@ void	CFloat::Analyze( long FrameSize, bool RandomAccess, short AcfMode, float Ac
 ////////////////////////////////////////
 // ppIntBuf = Long data buffer
 // FrameSize = Number of samples per frame
-// Return value = true:Success / false:Error
-bool	CFloat::FindDiffFloatPCM( int** ppIntBuf, long FrameSize )
+void	CFloat::FindDiffFloatPCM( int** ppIntBuf, long FrameSize )
 {
-	long	iChannel, iSample;
-	float	floatFromPCM, Scale;
-	CIEEE32	FloatNum;
-	float	y, a;
+	long				iChannel, iSample;
+	float				Scale, y;
+	unsigned int		abits, x, t, ex, et, m1, m2, DiffMantissa;
+	int					shift, e1, e2;
+	unsigned char		cDiffExp;
+	bool				Acf;
+	const int*			pIn;
+	const unsigned int*	pX;
+	unsigned char*		pD;
 
 	// Channel loop
 	for( iChannel=0; iChannel<m_Channels; iChannel++ ) {
-		a = m_pAcfGCF[iChannel];
-		if ( ( a == 1.f ) || ( a == 0.f ) ) {
+		pIn = ppIntBuf[iChannel];
+		pX = reinterpret_cast<const unsigned int*>( m_ppFloatBuf[iChannel] );
+		pD = m_ppCBuffD[iChannel*FrameSize];
+		shift = m_pShiftBit[iChannel] - IEEE754_EXP_BIASED;
+		Acf = ( m_pAcfGCF[iChannel] != 1.f ) && ( m_pAcfGCF[iChannel] != 0.f );
+
+		// Bit patterns of x'[] for the whole channel (unused where the integer sample is 0)
+		if ( !Acf ) {
 			Scale = CIEEE32::PowOfTwo( m_IntRes - 1 );
-			// Sample loop
 			for( iSample=0; iSample<FrameSize; iSample++ ) {
-				if ( ppIntBuf[iChannel][iSample] == 0 ) {
-					FloatNum.Set( reinterpret_cast<unsigned int&>(m_ppFloatBuf[iChannel][iSample]) );
-					FloatNum.Store( m_ppCBuffD[iChannel*FrameSize+iSample], true );
-					m_ppIEEE32numPCM[iChannel][iSample].Set( 0.f );
-				} else {
-					floatFromPCM = (float)ppIntBuf[iChannel][iSample] / Scale;
-					FloatNum.Set( m_ppFloatBuf[iChannel][iSample] );
-					if ( FloatNum.m_mantissa ) FloatNum.m_exp -= ( m_pShiftBit[iChannel] - IEEE754_EXP_BIASED );
-					m_ppIEEE32numPCM[iChannel][iSample].Set( floatFromPCM );
-					if ( !DiffIEEE32num( m_ppCBuffD[iChannel*FrameSize+iSample], FloatNum, m_ppIEEE32numPCM[iChannel][iSample], &m_ppDiffMantissa[iChannel][iSample]) ) return false;
-				}
+				y = (float)pIn[iSample] / Scale;
+				m_pPCMBits[iSample] = reinterpret_cast<unsigned int&>( y );
 			}
 		} else {
-			Scale = CIEEE32::PowOfTwo( m_IntRes - 1 - ( m_pShiftBit[iChannel] - IEEE754_EXP_BIASED ) );
+			Scale = CIEEE32::PowOfTwo( m_IntRes - 1 - shift );
+			abits = *reinterpret_cast<unsigned int*>( &m_pAcfGCF[iChannel] );
 			for( iSample=0; iSample<FrameSize; iSample++ ) {
-				if ( ppIntBuf[iChannel][iSample] == 0 ) {
-					FloatNum.Set( reinterpret_cast<unsigned int&>(m_ppFloatBuf[iChannel][iSample]) );
-					FloatNum.Store( m_ppCBuffD[iChannel*FrameSize+iSample], true );
-					m_ppIEEE32numPCM[iChannel][iSample].Set( 0.f );
-				} else {
-					y = (float)ppIntBuf[iChannel][iSample] / Scale;	// y'[]
-					floatFromPCM = CIEEE32::Multiple( y, a );			// x'[] = y'[] * a
-					FloatNum.Set( m_ppFloatBuf[iChannel][iSample] );	// x[][]
-					m_ppIEEE32numPCM[iChannel][iSample].Set( floatFromPCM );
-					if ( !DiffIEEE32num( m_ppCBuffD[iChannel*FrameSize+iSample], FloatNum, m_ppIEEE32numPCM[iChannel][iSample], &m_ppDiffMantissa[iChannel][iSample] ) ) return false;
-				}
+				y = (float)pIn[iSample] / Scale;					// y'[]
+				m_pPCMBits[iSample] = pIn[iSample] ? CIEEE32::MultipleBits( reinterpret_cast<unsigned int&>( y ), abits ) : 0;	// x'[] = y'[] * a
+			}
+		}
+
+		// Difference between x[] and x'[]: exponent difference and mantissa difference
+		for( iSample=0; iSample<FrameSize; iSample++, pD+=IEEE754_BYTES_PER_SAMPLE ) {
+			x = pX[iSample];
+			if ( pIn[iSample] == 0 ) {
+				// x[] is stored as it is (big endian)
+				pD[0] = (unsigned char)( x >> 24 );
+				pD[1] = (unsigned char)( x >> 16 );
+				pD[2] = (unsigned char)( x >> 8 );
+				pD[3] = (unsigned char)x;
+				m_ppIEEE32numPCM[iChannel][iSample].Set( 0.f );
+				continue;
+			}
+			t = m_pPCMBits[iSample];
+			m_ppIEEE32numPCM[iChannel][iSample].Set( t );
+
+			// The implicit bit exists for normalized numbers only (see CIEEE32::Set())
+			ex = ( x >> 23 ) & 0xff;
+			et = ( t >> 23 ) & 0xff;
+			m1 = ( x & 0x007fffffU ) | ( ( ex - 1 < 0xfe ) ? 0x00800000U : 0 );
+			m2 = ( t & 0x007fffffU ) | ( ( et - 1 < 0xfe ) ? 0x00800000U : 0 );
+			e1 = (int)ex - IEEE754_EXP_BIASED;
+			e2 = (int)et - IEEE754_EXP_BIASED;
+			if ( !Acf && m1 ) e1 -= shift;
+
+			cDiffExp = (unsigned char)abs( e1 - e2 );
+			if ( ( e1 - e2 > 0 ) && ( e2 != -IEEE754_EXP_BIASED ) ) {
+				// shift x[] to equalize exps, then subtract
+				DiffMantissa = abs( (int)( ( m1 << cDiffExp ) - m2 ) );
+				cDiffExp = 0;
+			} else {
+				DiffMantissa = abs( (int)( m1 - m2 ) );
 			}
+			m_ppDiffMantissa[iChannel][iSample] = DiffMantissa;
+			pD[0] = cDiffExp;
+			pD[1] = (unsigned char)( DiffMantissa >> 16 );
+			pD[2] = (unsigned char)( DiffMantissa >> 8 );
+			pD[3] = (unsigned char)DiffMantissa;
 		}
 	}
-	return true;
 }
 
 ////////////////////////////////////////
@@ -1396,11 +1607,11 @@ unsigned long	CFloat::EncodeDiff( long FrameSize, bool RandomAccess, short MlzMo
 	unsigned long  encodedSizeOfPartB;
 	unsigned long  sum_all;
 
-	// Allocate buffers for lzm
-	larray = new unsigned char [ FrameSize * ( 32 / WORD_SIZE )];
-	larrayMask = new unsigned char [ FrameSize * ( 32 / WORD_SIZE )];
-	length = new int [ FrameSize ];
-	encodedBuffer = new unsigned char [ FrameSize * 32 ];
+	// Buffers for lzm
+	larray = m_pMlzArray;
+	larrayMask = m_pMlzArrayMask;
+	length = m_pMlzLength;
+	encodedBuffer = m_pMlzEncoded;
 
 	m_BitIO.InitBitWrite( m_pCbitBuff );
 	cpBuffAppend = m_pDiffBuf;
@@ -1685,50 +1896,9 @@ unsigned long	CFloat::EncodeDiff( long FrameSize, bool RandomAccess, short MlzMo
 	memcpy( cpBuffAppend, cpGzipInBuff, nGzipInByte );
 	nNumByteAppend = nGzipInByte;
 
-	delete[] encodedBuffer;
-	delete[] larray;
-	delete[] larrayMask;
-	delete[] length;
-
 	return nNumByteAppend;
 }
 
-////////////////////////////////////////
-//                                    //
-// Set difference of CIEEE32 objects  //
-//                                    //
-////////////////////////////////////////
-// cpOutput = Output buffer
-// FNum1, FNum2 = CIEEE32 objects to be compared
-// pDiffMantissa = Output buffer of mantissa difference
-// Return value = true:Success / false:Error
-bool	CFloat::DiffIEEE32num( unsigned char* cpOutput, const CIEEE32& FNum1, const CIEEE32& FNum2, unsigned int* pDiffMantissa )
-{
-	unsigned char	cDiffExp, cHighestBit_1, cHighestBit_2;
-	unsigned int   mantissa1, mantissa2;
-
-	cDiffExp = abs( FNum1.m_exp - FNum2.m_exp );
-	cHighestBit_1 = (unsigned char)FNum1.m_mantissa >> 23;
-	cHighestBit_2 = (unsigned char)FNum2.m_mantissa >> 23;
-
-	if( ((FNum1.m_exp - FNum2.m_exp) > 0) && ( FNum2.m_exp != -IEEE754_EXP_BIASED ) ) {
-		// shift num_1 to eqalize exps, then substruct
-		mantissa1 = (FNum1.m_mantissa) << cDiffExp; 
-		mantissa2 = FNum2.m_mantissa;
-		*pDiffMantissa = abs( (int)( mantissa1 - mantissa2 ) );
-		cDiffExp = 0;
-
-	}else{
-		*pDiffMantissa = abs( (int)( FNum1.m_mantissa - FNum2.m_mantissa ) );
-	}
-
-	cpOutput[0] = cDiffExp;
-	cpOutput[1] = (unsigned char) ( ( *pDiffMantissa & 0x00FF0000 ) >> 16 );
-	cpOutput[2] = (unsigned char) ( ( *pDiffMantissa & 0x0000FF00 ) >>  8 );
-	cpOutput[3] = (unsigned char)   ( *pDiffMantissa & 0x000000FF );
-	return true;
-}
-
 //////////////////////////////////////////////////////////////////////
 //                                                                  //
 //                        Decoding functions                        //
@@ -1744,13 +1914,23 @@ bool	CFloat::DiffIEEE32num( unsigned char* cpOutput, const CIEEE32& FNum1, const
 // FrameSize = Number of samples per frame
 void	CFloat::ConvertFloatToRBuff( unsigned char* pRawBuf, long FrameSize )
 {
-	long	iChannel, iSample;
-	CIEEE32	fx;
-
+	long				iChannel, iSample, Step;
+	const unsigned int*	pX;
+	unsigned char*		pOut;
+	unsigned int		x;
+
+	// CIEEE32::Store() of a value set by bit pattern reproduces the bit
+	// pattern, so each sample is simply written as little endian.
+	Step = m_Channels * IEEE754_BYTES_PER_SAMPLE;
 	for( iChannel=0; iChannel<m_Channels; iChannel++ ) {
-		for( iSample=0; iSample<FrameSize; iSample++ ) {
-			fx.Set( reinterpret_cast<unsigned int&>(m_ppAcfBuff[iChannel][iSample]) );
-			fx.Store( &pRawBuf[ ( iSample * m_Channels + iChannel ) * IEEE754_BYTES_PER_SAMPLE ] );
+		pX = reinterpret_cast<const unsigned int*>( m_ppAcfBuff[iChannel] );
+		pOut = pRawBuf + iChannel * IEEE754_BYTES_PER_SAMPLE;
+		for( iSample=0; iSample<FrameSize; iSample++, pOut+=Step ) {
+			x = pX[iSample];
+			pOut[0] = (unsigned char)x;
+			pOut[1] = (unsigned char)( x >> 8 );
+			pOut[2] = (unsigned char)( x >> 16 );
+			pOut[3] = (unsigned char)( x >> 24 );
 		}
 	}
 }
@@ -1764,23 +1944,18 @@ void	CFloat::ConvertFloatToRBuff( unsigned char* pRawBuf, long FrameSize )
 // FrameSize = Number of samples per frame
 void	CFloat::ReformatData( int const* const* ppIntBuf, long FrameSize )
 {
-	float	scale;
-	int		i, ch;
+	float		scale;
+	long		i, ch;
+	const int*	pIn;
+	float*		pOut;
 
-	scale = CIEEE32::PowOfTwo( m_IntRes - 1 );
+	// Multiplying by the reciprocal of a power of two is exact, and 0 gives +0.f.
+	scale = 1.f / CIEEE32::PowOfTwo( m_IntRes - 1 );
 
-	for( i=0; i<FrameSize; i++ ) {
-		for( ch=0; ch<m_Channels; ch++ ) {
-			if ( ppIntBuf[ch][i] == 0 ) {
-				m_ppAcfBuff[ch][i] = 0.f;
-			} else {
-				m_ppAcfBuff[ch][i] = (float)( ppIntBuf[ch][i] / scale );
-//				// CAOUSION for debug
-//				if ( (m_ppAcfBuff[ch][i] == +0.0f) || (m_ppAcfBuff[ch][i] == -0.0f) ) {
-//					printf(" It's not good for decoder %d = %f\n", ppIntBuf[ch][i], m_ppAcfBuff[ch][i]);
-//				}
-			}
-		}
+	for( ch=0; ch<m_Channels; ch++ ) {
+		pIn = ppIntBuf[ch];
+		pOut = m_ppAcfBuff[ch];
+		for( i=0; i<FrameSize; i++ ) pOut[i] = (float)pIn[i] * scale;
 	}
 }
 
@@ -1795,10 +1970,51 @@ void	CFloat::ReformatData( int const* const* ppIntBuf, long FrameSize )
 // Return value = true:Success / false:Error
 bool	CFloat::DecodeDiff( HALSSTREAM fp, long FrameSize, bool RandomAccess )
 {
-	unsigned long	destLen, nNumByteAppend;
+	unsigned long	nNumByteAppend, UsedSize;
+	const unsigned char*	pData;
+	ALS_UINT32		Avail;
+
+	// Decode straight from a mapped or buffered input when the whole part is there.
+	pData = fpeek( fp, 4, &Avail );
+	if ( ( pData != NULL ) && ( Avail >= 4 ) ) {
+		nNumByteAppend = (unsigned int)( ( static_cast<unsigned int>( pData[0] ) << 24 ) | ( static_cast<unsigned int>( pData[1] ) << 16 ) | ( static_cast<unsigned int>( pData[2] ) << 8 ) | pData[3] );
+		if ( nNumByteAppend <= (unsigned long)( m_FrameSize * m_Channels * IEEE754_BYTES_PER_SAMPLE + 100 - 8 ) ) {
+			// (4 more bytes for the look-ahead of CBitIO)
+			pData = fpeek( fp, nNumByteAppend + 4 + 4, &Avail );
+			if ( ( pData != NULL ) && ( Avail >= nNumByteAppend + 4 + 4 ) ) {
+				if ( !DecodeDiff( pData, nNumByteAppend + 4, &UsedSize, FrameSize, RandomAccess ) ) return false;
+				return ( fseek( fp, UsedSize, SEEK_CUR ) == 0 );
+			}
+		}
+	}
+
+	// Read the size field and the difference data once into the bit stream buffer.
+	if ( fread( m_pCbitBuff, 1, 4, fp ) != 4 ) return false;
+	nNumByteAppend = (unsigned int)( ( static_cast<unsigned int>( m_pCbitBuff[0] ) << 24 ) | ( static_cast<unsigned int>( m_pCbitBuff[1] ) << 16 ) | ( static_cast<unsigned int>( m_pCbitBuff[2] ) << 8 ) | m_pCbitBuff[3] );
+	// (leave 4 bytes for the look-ahead of CBitIO)
+	if ( nNumByteAppend > (unsigned long)( m_FrameSize * m_Channels * IEEE754_BYTES_PER_SAMPLE + 100 - 8 ) ) return false;
+	if ( fread( m_pCbitBuff + 4, 1, nNumByteAppend, fp ) != nNumByteAppend ) return false;
+
+	return DecodeDiff( m_pCbitBuff, nNumByteAppend + 4, &UsedSize, FrameSize, RandomAccess );
+}
+
+////////////////////////////////////////
+//                                    //
+//   Decode difference from memory    //
+//                                    //
+////////////////////////////////////////
+// pData = Float part of the frame, starting with its size field
+// DataSize = Available bytes in pData
+// pUsedSize = Returns the bytes used from pData
+// FrameSize = Number of samples per frame
+// RandomAccess = true:Random accessible frame
+// Return value = true:Success / false:Error
+// * pData is decoded in place. CBitIO reads up to 4 bytes ahead, so that
+//   many bytes after the float part must be readable.
+bool	CFloat::DecodeDiff( const unsigned char* pData, unsigned long DataSize, unsigned long* pUsedSize, long FrameSize, bool RandomAccess )
+{
+	unsigned long	nNumByteAppend;
 	unsigned long	bit_count;
-	unsigned char*	cpOutBuff;
-	unsigned char	tmp[4];
 	int				i, j, ch, startPos, highest_bit;
 	unsigned int	readbuf;
 	CIEEE32			fx;
@@ -1817,25 +2033,17 @@ bool	CFloat::DecodeDiff( HALSSTREAM fp, long FrameSize, bool RandomAccess )
 	unsigned char* length;
 	unsigned char* larray;
 
-	// Allocate buffers for lzm
-	larray = new unsigned char [ FrameSize * ( 32 / WORD_SIZE )];
-	length = new unsigned char [ FrameSize ];
-	//encodedBuffer = new unsigned char [ FrameSize * 32 ];
-
-	m_BitIO.InitBitRead( m_pCbitBuff );
-	cpOutBuff = m_pCbitBuff;
-
 	// read UIntMSBfirst
-	for ( i = 0; i < 4; i++ ) {
-		if ( fread( &(tmp[i]), 1, 1, fp ) != 1 ) return false;
-	}
-	nNumByteAppend = (unsigned int)( ( static_cast<unsigned int>(tmp[0]) << 24 ) | ( static_cast<unsigned int>(tmp[1]) << 16 ) | ( static_cast<unsigned int>(tmp[2]) << 8 ) | tmp[3] );
+	if ( DataSize < 4 ) return false;
+	nNumByteAppend = (unsigned int)( ( static_cast<unsigned int>( pData[0] ) << 24 ) | ( static_cast<unsigned int>( pData[1] ) << 16 ) | ( static_cast<unsigned int>( pData[2] ) << 8 ) | pData[3] );
+	if ( nNumByteAppend > DataSize - 4 ) return false;
+	*pUsedSize = nNumByteAppend + 4;
 
-	if ( fread( m_pCBuffD, 1, nNumByteAppend, fp ) != nNumByteAppend ) return false;
-	destLen = FrameSize * m_Channels * IEEE754_BYTES_PER_SAMPLE * 2;
+	// Buffers for lzm
+	larray = m_pMlzArray;
+	length = m_pMlzDecLength;
 
-	memcpy( cpOutBuff, m_pCBuffD, nNumByteAppend );
-	destLen = nNumByteAppend;
+	m_BitIO.InitBitRead( const_cast<unsigned char*>( pData + 4 ) );
 
 	bit_count = 0;
 	// out put ACD coding parameters
@@ -2053,8 +2261,6 @@ bool	CFloat::DecodeDiff( HALSSTREAM fp, long FrameSize, bool RandomAccess )
 			bit_count = ( bit_count | 0x7 ) + 1;
 		}
 	}			
-	delete[] larray;
-	delete[] length;
 
 	return true;
 }
@@ -2070,70 +2276,59 @@ bool	CFloat::AddIEEEDiff( long FrameSize )
 {
 	// cpBufD[0]: difference of exp
 	// cpBufD[1][2][3]: difference of mentissa
-	int				magnitude, i;
-	long			iChannel, iSample;
-	unsigned char	sign;
-	int		        e;
-	unsigned int   mantissa;
-	unsigned char	CBufD;
-	unsigned char*	pPCMtemp;
-	float			floattemp, a;
-	CIEEE32			FloatNum;
-
+	long					iChannel, iSample;
+	unsigned int			abits, x, t, d, dexp, sign, mantissa, carry, bad;
+	int						e, shift;
+	unsigned int*			pX;
+	const unsigned int*		pPCM;
+	const unsigned char*	pD;
+
+	bad = 0;
 	for( iChannel=0; iChannel<m_Channels; iChannel++ ) {
-		a = m_pAcfGCF[iChannel];
-		for( iSample=0; iSample<FrameSize; iSample++ ) {
-			if ( ( m_ppAcfBuff[iChannel][iSample] == 0.f ) || ( m_ppAcfBuff[iChannel][iSample] == -0.f ) ) {
-				FloatNum.Set( &m_pCBuffD[ ( iChannel * FrameSize + iSample ) * IEEE754_BYTES_PER_SAMPLE ], true );
-				*reinterpret_cast<unsigned int*>( &m_ppAcfBuff[iChannel][iSample] ) = *reinterpret_cast<unsigned int*>( &FloatNum.m_floatnum );
-
-			} else {
-				if ( a == 1.f ) floattemp = m_ppAcfBuff[iChannel][iSample];
-				else floattemp = CIEEE32::Multiple( m_ppAcfBuff[iChannel][iSample], a );
-				pPCMtemp = (unsigned char*)&floattemp;
-#ifdef __BIG_ENDIAN__
-				if ( !m_ppIEEE32numPCM[iChannel][iSample].Set( pPCMtemp, true ) ) return false;
-#else
-				if ( !m_ppIEEE32numPCM[iChannel][iSample].Set( pPCMtemp ) ) return false;
-#endif
+		pX = reinterpret_cast<unsigned int*>( m_ppAcfBuff[iChannel] );
+		pD = &m_pCBuffD[ iChannel * FrameSize * IEEE754_BYTES_PER_SAMPLE ];
+		shift = m_pShiftBit[iChannel] - 127;
 
-				// sign part
-				sign = m_ppIEEE32numPCM[iChannel][iSample].m_sign;
-				// exp part
-				magnitude = 0;
-				CBufD = m_pCBuffD[ ( iChannel * FrameSize + iSample ) * IEEE754_BYTES_PER_SAMPLE ];
-				if ( CBufD ) {
-					if ( m_ppIEEE32numPCM[iChannel][iSample].m_exp == -IEEE754_EXP_BIASED ) {
-						sign = CBufD & 0x01;	// change the sign
-						magnitude = CBufD >> 1;
-					} else {
-						// exp change does not comply with the rule!!!
-						return false;
-					}
-				}
-				e = m_ppIEEE32numPCM[iChannel][iSample].m_exp + magnitude;
-
-				// mantissa part
-				magnitude = 0;
-				for( i=1; i<IEEE754_BYTES_PER_SAMPLE; i++ ) {
-					magnitude = ( magnitude << 8 ) | m_pCBuffD[ ( iChannel * FrameSize + iSample ) * IEEE754_BYTES_PER_SAMPLE + i ];
-				}
-				if ( m_ppIEEE32numPCM[iChannel][iSample].m_exp != -IEEE754_EXP_BIASED ) {
-					mantissa = ( m_ppIEEE32numPCM[iChannel][iSample].m_mantissa | 0x800000 ) + magnitude;
-				} else {
-					mantissa = m_ppIEEE32numPCM[iChannel][iSample].m_mantissa  + magnitude;
-				}
-				while( mantissa >= 0x1000000 ) {
-					e++;
-					mantissa >>= 1;
-				}
-				if ( mantissa ) e += ( m_pShiftBit[iChannel] - 127 );
+		// x'[i] = y'[i] * a
+		if ( m_pAcfGCF[iChannel] == 1.f ) {
+			pPCM = pX;
+		} else {
+			abits = *reinterpret_cast<unsigned int*>( &m_pAcfGCF[iChannel] );
+			for( iSample=0; iSample<FrameSize; iSample++ )
+				m_pPCMBits[iSample] = ( pX[iSample] & 0x7fffffffU ) ? CIEEE32::MultipleBits( pX[iSample], abits ) : 0;
+			pPCM = m_pPCMBits;
+		}
 
-				m_ppAcfBuff[iChannel][iSample] = CIEEE32( sign, e, mantissa );
-			}
+		// Reassemble x[i] from x'[i] and the difference, on bit patterns
+		for( iSample=0; iSample<FrameSize; iSample++, pD+=IEEE754_BYTES_PER_SAMPLE ) {
+			x = pX[iSample];
+			t = pPCM[iSample];
+			d = ( (unsigned int)pD[0] << 24 ) | ( (unsigned int)pD[1] << 16 ) | ( (unsigned int)pD[2] << 8 ) | (unsigned int)pD[3];
+
+			// exp part (the exp may change only when x'[i] is denormalized)
+			dexp = d >> 24;
+			e = (int)( ( t >> 23 ) & 0xff ) - IEEE754_EXP_BIASED;
+			bad |= ( dexp != 0 ) & ( e != -IEEE754_EXP_BIASED );
+			sign = dexp ? ( dexp & 0x01 ) : ( t >> 31 );
+			e += dexp >> 1;
+
+			// mantissa part
+			mantissa = ( t & 0x007fffffU ) | ( ( ( t >> 23 ) & 0xff ) ? 0x00800000U : 0 );
+			mantissa += d & 0x00ffffffU;
+			carry = mantissa >> 24;
+			e += carry;
+			mantissa >>= carry;
+			if ( mantissa ) e += shift;
+
+			// Same bit pattern as CIEEE32( sign, e, mantissa )
+			t = ( sign << 31 ) | ( (unsigned int)( e + IEEE754_EXP_BIASED ) << 23 ) | ( mantissa & 0x007fffffU );
+
+			// int_zero[c][n] is true: d holds the original float data.
+			pX[iSample] = ( x & 0x7fffffffU ) ? t : d;
 		}
 	}
-	return true;
+	// exp change does not comply with the rule!!!
+	return ( bad == 0 );
 }
 
 //////////////////////////////////////////////////////////////////////
@@ -2515,20 +2710,27 @@ void	CFloat::SearchDownward( float Target, float& x1, float& y1, const CIEEE32&
 //        Estimate multiplier         //
 //                                    //
 ////////////////////////////////////////
-int	CFloat::EstimateMultiplier( const float* x, long FrameSize, float* agcd, int max_agcd_num )
+// x = Input samples
+// FrameSize = Number of samples per frame
+// agcd = Estimated multipliers (output)
+// max_agcd_num = Maximum number of multipliers
+// Buf = Work buffers (must hold m_FrameSize samples)
+// Return value = Number of multipliers set to agcd[]
+int	CFloat::EstimateMultiplier( const float* x, long FrameSize, float* agcd, int max_agcd_num, ESTIMATE_BUF& Buf )
 {
 	int				num_agcd;
 	long			num_agcd_max;
 	long			cand;
 	long			mmm, ii, ii_max;
 	long			maxd, size, y, ind;
-	int			i, j, k, nm_med, dn_med, count;
+	int			i, j, nm_med, dn_med, count;
 	unsigned int	nm_low, dn_low;
 	unsigned int	nm_high, dn_high;
 	unsigned int	g_low, g_high;
 	double			aa;
 	float			bb;
 	CIEEE32			fx;
+	unsigned int	bits;
 	unsigned int*	ulMantissa;
 	int*			nm_res;
 	int*			dns;
@@ -2536,32 +2738,33 @@ int	CFloat::EstimateMultiplier( const float* x, long FrameSize, float* agcd, int
 	// for fast search
 	CONVERGENCE_RES*	res;
 	FLOAT_EXP*		x2;
-	int				max_exp;
-
-	// memory allocation
-	ulMantissa = new unsigned int [FrameSize];
-	x2         = new FLOAT_EXP [FrameSize];
-	res        = new CONVERGENCE_RES [X_CANDIDATES];
-	nm_res     = new int [X_CANDIDATES];
-	dns        = new int [X_CANDIDATES];
-	dns_count  = new int [X_CANDIDATES];
+	FLOAT_EXP*		x2_sorted;
+	int				max_exp, e;
+	bool			last_accepted;
+	float			last_bb;
+
+	// work buffers
+	ulMantissa = Buf.m_pMantissa;
+	x2         = Buf.m_pX2;
+	x2_sorted  = Buf.m_pX2Sorted;
+	res        = Buf.m_pRes;
+	nm_res     = Buf.m_pNmRes;
+	dns        = Buf.m_pDns;
+	dns_count  = Buf.m_pDnsCount;
 
 	num_agcd_max = max_agcd_num;
 	num_agcd = 0;
 	max_exp = -128;
 	j = 0;
-	k = FrameSize - 1;
 	for( i = 0; i < FrameSize; i++ ) {
-		fx.Set( x[i] );
-		if ( ( -127 < fx.m_exp ) && ( fx.m_exp < 128 ) ) {
+		// Exponent taken directly from the bit pattern (same as CIEEE32::m_exp)
+		bits = reinterpret_cast<const unsigned int&>( x[i] );
+		e = (int)( ( bits >> 23 ) & 0xff ) - IEEE754_EXP_BIASED;
+		if ( ( -127 < e ) && ( e < 128 ) ) {
 			x2[j].m_floatnum = x[i];
-			x2[j].m_exp = fx.m_exp;
-			if ( fx.m_exp > max_exp ) max_exp = fx.m_exp;
+			x2[j].m_exp = e;
+			if ( e > max_exp ) max_exp = e;
 			j++;
-		} else {
-			x2[k].m_floatnum = 0.f;
-			x2[k].m_exp = -128;
-			k--;
 		}
 	}
 	size = j; // num samples which is not 0, NaN or Inf
@@ -2573,35 +2776,53 @@ int	CFloat::EstimateMultiplier( const float* x, long FrameSize, float* agcd, int
 	}
 
 	// sort abs(x2[i]) in ascending order
-	BucketSortExp( COMPARE_EXP_RANGE, max_exp, size, x2 );
-
-	if ( size > X_CANDIDATES ) size = X_CANDIDATES;
+	// Only the first X_CANDIDATES elements are used below.
+	size = BucketSortExp( max_exp, size, x2, x2_sorted, X_CANDIDATES );
 	
 	// set mantissa to the ulMantissa[i]
+	// (sorted samples are all normalized numbers)
 	for( i = 0; i < size; i++ ) {
-		fx.Set( x2[i].m_floatnum );
-		ulMantissa[i] = fx.m_mantissa;
+		bits = reinterpret_cast<const unsigned int&>( x2_sorted[i].m_floatnum );
+		ulMantissa[i] = ( bits & 0x007fffffUL ) | 0x00800000UL;
 	}
 
 	// sort ulMantissa[] in descending order
 	// size <= X_CANDIDATES;
-	qsort( ulMantissa, (size_t)size, sizeof(unsigned int), CompareUL );
+	SortMantissa( ulMantissa, Buf.m_pMantissaTmp, size );
 
 	if ( TRY_MAX > size )
 		ii_max = size;
 	else
 		ii_max = TRY_MAX;
 
+	last_accepted = false;
+	last_bb = 0.f;
 	for( cand=ii=0; ii < ii_max ; ii++ ) {
 		// select maxd
 		maxd = ulMantissa[ii];
 
+		// The result only depends on maxd, so the same maxd as the last
+		// trial is accepted or rejected without searching again.
+		if ( ( ii > 0 ) && ( ulMantissa[ii] == ulMantissa[ii-1] ) ) {
+			if ( last_accepted ) {
+				agcd[cand++] = last_bb;
+				if ( cand == num_agcd_max ) break;
+			}
+			continue;
+		}
+		last_accepted = false;
+
 		for( i=0; i<size; i++ ) nm_res[i] = res[i].m_dn = res[i].m_idx = dns[i] = dns_count[i] = 0;
 
 		// find the intermediate convergent having the smallest denominator in the interval
 		int max_dn = 0;
 		for( i=0; i<size; i++ ) {
-			if ( ulMantissa[i] == (unsigned int)maxd ) {
+			if ( ( i > 0 ) && ( ulMantissa[i] == ulMantissa[i-1] ) ) {
+				// same mantissa as the previous one
+				nm_res[i] = nm_res[i-1];
+				res[i].m_dn = res[i-1].m_dn;
+				res[i].m_idx = i;
+			} else if ( ulMantissa[i] == (unsigned int)maxd ) {
 				nm_res[i] = res[i].m_dn = 1;
 				res[i].m_idx = i;
 			} else if ( ulMantissa[i] > 0 ) {
@@ -2634,7 +2855,7 @@ int	CFloat::EstimateMultiplier( const float* x, long FrameSize, float* agcd, int
 		}
 
 		// how many kinds of denominators?
-		qsort( res, (size_t)size, sizeof(CONVERGENCE_RES), CompareDN );
+		SortDN( res, Buf.m_pResTmp, size );
 		int j, max_j;
 		dns[0] = res[0].m_dn;
 		dns_count[0] = 1;
@@ -2723,20 +2944,14 @@ int	CFloat::EstimateMultiplier( const float* x, long FrameSize, float* agcd, int
 			}
 			// aa/mmm: average
 			bb = (float)( aa / mmm );
+			last_accepted = true;
+			last_bb = bb;
 			agcd[cand++] = bb;
 			if ( cand == num_agcd_max ) break;
 		}
 	}
 	for( ; cand<num_agcd_max; cand++ ) agcd[cand] = 1.f;
 
-
-	delete[] ulMantissa;
-	delete[] x2;
-	delete[] res;
-	delete[] nm_res;
-	delete[] dns;
-	delete[] dns_count;
-
 	return cand;
 }
 
@@ -2898,30 +3113,76 @@ int	CFloat::CompareFloat( const void* elem1, const void* elem2 )
 
 ////////////////////////////////////////
 //                                    //
-//    Compare unsigned int values     //
+//      Sort mantissa values          //
 //                                    //
 ////////////////////////////////////////
-// elem1, elem2 = unsigned int values
-// Return value = 1:elem1<elem2 / 0:elem1==elem2 / -1:elem1>elem2
-int	CFloat::CompareUL( const void* elem1, const void* elem2 )
+// x = 24-bit mantissa values (sorted in descending order on return)
+// tmp = Work buffer (length elements)
+// length = Number of elements
+// * LSD radix sort with 8-bit digits. Digits which are the same for all
+//   elements are skipped.
+void	CFloat::SortMantissa( unsigned int* x, unsigned int* tmp, int length )
 {
-	unsigned int	e1 = *reinterpret_cast<const unsigned int*>( elem1 );
-	unsigned int	e2 = *reinterpret_cast<const unsigned int*>( elem2 );
-	return ( e1 == e2 ) ? 0 : ( e1 > e2 ) ? -1 : 1;
+	int				count[256];
+	int				i, d, shift, pos;
+	unsigned int	diff;
+	unsigned int*	src = x;
+	unsigned int*	dst = tmp;
+	unsigned int*	t;
+
+	if ( length <= 1 ) return;
+
+	diff = 0;
+	for( i=1; i<length; i++ ) diff |= x[i] ^ x[0];
+
+	for( shift=0; shift<24; shift+=8 ) {
+		if ( ( ( diff >> shift ) & 0xff ) == 0 ) continue;
+
+		// Descending order: use the inverted digit as the bucket index
+		for( d=0; d<256; d++ ) count[d] = 0;
+		for( i=0; i<length; i++ ) count[ 0xff - ( ( src[i] >> shift ) & 0xff ) ]++;
+		for( pos=d=0; d<256; d++ ) { i = count[d]; count[d] = pos; pos += i; }
+		for( i=0; i<length; i++ ) dst[ count[ 0xff - ( ( src[i] >> shift ) & 0xff ) ]++ ] = src[i];
+		t = src; src = dst; dst = t;
+	}
+	if ( src != x ) memcpy( x, src, length * sizeof(unsigned int) );
 }
 
 ////////////////////////////////////////
 //                                    //
-//    Compare Denominator values      //
+//    Sort by denominator values      //
 //                                    //
 ////////////////////////////////////////
-// elem1, elem2 = convergence_res struct
-// Return value = 1:elem1<elem2 / 0:elem1==elem2 / -1:elem1>elem2
-int	CFloat::CompareDN( const void* elem1, const void* elem2 )
+// x = Convergence results (sorted by m_dn in descending order on return)
+// tmp = Work buffer (length elements)
+// length = Number of elements
+// * Stable LSD radix sort with 8-bit digits. Elements which have the same
+//   denominator keep their order.
+void	CFloat::SortDN( CONVERGENCE_RES* x, CONVERGENCE_RES* tmp, int length )
 {
-	CONVERGENCE_RES	e1 = *reinterpret_cast<const CONVERGENCE_RES*>( elem1 );
-	CONVERGENCE_RES	e2 = *reinterpret_cast<const CONVERGENCE_RES*>( elem2 );
-	return ( e1.m_dn == e2.m_dn ) ? 0 : ( e1.m_dn > e2.m_dn ) ? -1 : 1;
+	int					count[256];
+	int					i, d, shift, pos;
+	unsigned int		diff;
+	CONVERGENCE_RES*	src = x;
+	CONVERGENCE_RES*	dst = tmp;
+	CONVERGENCE_RES*	t;
+
+	if ( length <= 1 ) return;
+
+	diff = 0;
+	for( i=1; i<length; i++ ) diff |= (unsigned int)x[i].m_dn ^ (unsigned int)x[0].m_dn;
+
+	for( shift=0; shift<32; shift+=8 ) {
+		if ( ( ( diff >> shift ) & 0xff ) == 0 ) continue;
+
+		// Descending order: use the inverted digit as the bucket index
+		for( d=0; d<256; d++ ) count[d] = 0;
+		for( i=0; i<length; i++ ) count[ 0xff - ( ( (unsigned int)src[i].m_dn >> shift ) & 0xff ) ]++;
+		for( pos=d=0; d<256; d++ ) { i = count[d]; count[d] = pos; pos += i; }
+		for( i=0; i<length; i++ ) dst[ count[ 0xff - ( ( (unsigned int)src[i].m_dn >> shift ) & 0xff ) ]++ ] = src[i];
+		t = src; src = dst; dst = t;
+	}
+	if ( src != x ) memcpy( x, src, length * sizeof(CONVERGENCE_RES) );
 }
 
 ////////////////////////////////////////
@@ -2929,45 +3190,63 @@ int	CFloat::CompareDN( const void* elem1, const void* elem2 )
 // Bucket sort with exponent of float //
 //                                    //
 ////////////////////////////////////////
-// range = effective exponential range
 // max_mag_exp = maximim exponential value of data array
 // length = length of data array
 // x = data array (FLOAT_EXP)
-void CFloat::BucketSortExp(const int range, const int max_mag_exp, const int length, FLOAT_EXP* x )
+// sorted = sorted data array (output)
+// max_sorted = maximum number of elements to store in sorted[]
+// Return value = number of elements stored in sorted[]
+// * Elements are grouped into COMPARE_EXP_RANGE + 3 buckets by exponent.
+//   The order of elements in the same bucket is kept.
+int	CFloat::BucketSortExp( const int max_mag_exp, const int length, const FLOAT_EXP* x, FLOAT_EXP* sorted, const int max_sorted )
 {
-	int i;
-	std::vector<FLOAT_EXP> *bucket = new std::vector<FLOAT_EXP> [ range + 3 ];
+	const int	range = COMPARE_EXP_RANGE;
+	int			count[ COMPARE_EXP_RANGE + 3 ];
+	int			i, b, pos;
+
+	// count elements of each bucket
+	for ( b = 0; b < range + 3; b++ ) count[b] = 0;
+	for ( i = 0; i < length; i++ ) count[ BucketExp( range, max_mag_exp, x[i].m_exp ) ]++;
+
+	// set start position of each bucket
+	for ( pos = b = 0; b < range + 3; b++ ) {
+		i = count[b];
+		count[b] = pos;
+		pos += i;
+	}
 
-	// push x from array to buckets
+	// move x from array to buckets
 	for ( i = 0; i < length; i++ )
 	{
-		// Check exponential range
-		if ( x[i].m_exp > max_mag_exp ) {
-			// bucket[range+1] is used to store too large elements
-			bucket[ range + 1].push_back( x[i] );
-		} else if ( x[i].m_exp == -128 ) {
-			// bucket[range+2] is used to store zero elements
-			bucket[ range + 2 ].push_back( x[i] );
-		} else if ( x[i].m_exp <= max_mag_exp - range ) {
-			// bucket[range] is used to store too small elements
-			bucket[range ].push_back( x[i] );
-		} else {
-			bucket[ x[i].m_exp - max_mag_exp + range - 1 ].push_back( x[i] );
-		}
+		pos = count[ BucketExp( range, max_mag_exp, x[i].m_exp ) ]++;
+		if ( pos < max_sorted ) sorted[pos] = x[i];
 	}
 
-	// pop x from buckets to array
-	int x_i = 0;
-	for ( i = 0; i < range+3; i++ )
-	{
-		for ( int j = 0; j < bucket[i].size(); j++ )
-		{
-			x[x_i] = bucket[i][j];
-			x_i++;
-		}
-	}
+	return ( length < max_sorted ) ? length : max_sorted;
+}
 
-	delete[] bucket;
+////////////////////////////////////////
+//                                    //
+//    Bucket index for BucketSortExp  //
+//                                    //
+////////////////////////////////////////
+// range = effective exponential range
+// max_mag_exp = maximim exponential value of data array
+// exp = exponent of the element
+int	CFloat::BucketExp( int range, int max_mag_exp, int exp )
+{
+	// Check exponential range
+	if ( exp > max_mag_exp ) {
+		// bucket[range+1] is used to store too large elements
+		return range + 1;
+	} else if ( exp == -128 ) {
+		// bucket[range+2] is used to store zero elements
+		return range + 2;
+	} else if ( exp <= max_mag_exp - range ) {
+		// bucket[range] is used to store too small elements
+		return range;
+	}
+	return exp - max_mag_exp + range - 1;
 }
 
 ////////////////////////////////////////
@@ -120,6 +120,7 @@ public:
 	static	float	PowOfTwo( int shiftbit );
 	static	bool	IsSame( float f1, float f2 );
 	static	CIEEE32	Multiple( const CIEEE32& f1, const CIEEE32& f2 );
+	static	unsigned int	MultipleBits( unsigned int f1, unsigned int f2 );
 	static	CIEEE32	Divide( const CIEEE32& f1, const CIEEE32& f2 );
 
 public:
@@ -167,6 +168,19 @@ private:
 		int		m_idx;
 		int		m_count;
 	} CDNS_COUNT;
+
+	// Work buffers for EstimateMultiplier() (one set per channel)
+	typedef	struct tagESTIMATE_BUF {
+		unsigned int*		m_pMantissa;	// FrameSize
+		unsigned int*		m_pMantissaTmp;	// X_CANDIDATES
+		FLOAT_EXP*			m_pX2;			// FrameSize
+		FLOAT_EXP*			m_pX2Sorted;	// X_CANDIDATES
+		CONVERGENCE_RES*	m_pRes;			// X_CANDIDATES
+		CONVERGENCE_RES*	m_pResTmp;		// X_CANDIDATES
+		int*				m_pNmRes;		// X_CANDIDATES
+		int*				m_pDns;			// X_CANDIDATES
+		int*				m_pDnsCount;	// X_CANDIDATES
+	} ESTIMATE_BUF;
 	
 	// Constants
 	static	const int			NUM_ACF_MAX;
@@ -194,19 +208,21 @@ public:
 	// Encoding functions
 	int		SearchShift( float* pInX, float* pInY, float acf, int lastShift, int FrameSize, int* pMode, int shiftMode );
 	void	ConvertFloatToInteger( int** ppIntBuf, int FrameSize, bool RandomAccess, short AcfMode, float AcfGain, short MlzMode);
-	bool	FindDiffFloatPCM( int** ppIntBuf, long FrameSize );
-	bool	DiffIEEE32num( unsigned char* cpOutput, const CIEEE32& FNum1, const CIEEE32& FNum2, unsigned int* pDiffMantissa );
+	void	FindDiffFloatPCM( int** ppIntBuf, long FrameSize );
 	unsigned long	EncodeDiff( long FrameSize, bool RandomAccess, short MlzMode );
 
 	// Decoding functions
 	void	ConvertFloatToRBuff( unsigned char* pRawBuf, long FrameSize );
 	void	ReformatData( int const* const* ppIntBuf, long FrameSize );
 	bool	DecodeDiff( HALSSTREAM fp, long FrameSize, bool RandomAccess );
+	bool	DecodeDiff( const unsigned char* pData, unsigned long DataSize, unsigned long* pUsedSize, long FrameSize, bool RandomAccess );
 	bool	AddIEEEDiff( long FrameSize );
 
 protected:
-	void	Analyze( long FrameSize, bool RandomAccess, short AcfMode, float AcfGain, short MlzMode );
-	int		EstimateMultiplier( const float* x, long FrameSize, float* agcd, int max_agcd_num );
+	void	PrepareAnalysis( bool RandomAccess, short AcfMode );
+	void	Analyze( long j, long FrameSize, short AcfMode, float AcfGain, short MlzMode );
+	void	ConvertChannel( long iChannel, int* pIntBuf, int FrameSize, short AcfMode, float AcfGain, short MlzMode );
+	int		EstimateMultiplier( const float* x, long FrameSize, float* agcd, int max_agcd_num, ESTIMATE_BUF& Buf );
 
 	// Static functions
 	static	int				CountZeros( unsigned int mantissa );
@@ -222,9 +238,12 @@ protected:
 
 	// Compare functions for sorting
 	static	int		CompareFloat( const void* elem1, const void* elem2 );
-	static	int		CompareUL( const void* elem1, const void* elem2 );
-	static	int		CompareDN( const void* elem1, const void* elem2 );
-	static	void	BucketSortExp( int range, int max_mag_exp, int length, FLOAT_EXP* x );
+
+	// Sort functions
+	static	void	SortMantissa( unsigned int* x, unsigned int* tmp, int length );
+	static	void	SortDN( CONVERGENCE_RES* x, CONVERGENCE_RES* tmp, int length );
+	static	int		BucketSortExp( int max_mag_exp, int length, const FLOAT_EXP* x, FLOAT_EXP* sorted, int max_sorted );
+	static	int		BucketExp( int range, int max_mag_exp, int exp );
 	static	void	InsertDNSCount( CDNS_COUNT* dns_count_large, int size, const int* dns_count, int dns_idx );
 
 protected:
@@ -250,6 +269,15 @@ protected:
 	char*			m_pLastExistResidual;	// flag for ACF
 	int*			m_pGhb;					// Global highest byte
 	CMLZ*			m_pMlz;					// MLZ object
+	float*			m_pPrevAcfGCF;			// Approximate GCF of the previous frame
+	ESTIMATE_BUF*	m_pEstimateBuf;			// Work buffers for EstimateMultiplier()
+	int*			m_pMlzLength;			// MLZ length buffer
+	unsigned char*	m_pMlzArray;			// MLZ input buffer (output in DecodeDiff())
+	unsigned char*	m_pMlzArrayMask;		// MLZ input mask buffer
+	unsigned char*	m_pMlzEncoded;			// MLZ output buffer
+	unsigned int*	m_pPCMBits;				// Bit patterns of x'[] for FindDiffFloatPCM() and AddIEEEDiff()
+	unsigned char*	m_pMlzDecLength;		// MLZ length buffer for DecodeDiff()
+	float**			m_ppSortBuf;			// Saved channel pointers for ChannelSort()
 };
 
 #endif	// FLOATING_INCLUDED
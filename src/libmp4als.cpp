@@ -0,0 +1,467 @@
+/***************** MPEG-4 Audio Lossless Coding **************************
+
+This software module was originally developed by
+
+NTT (Nippon Telegraph and Telephone Corporation), Japan
+
+in the course of development of the MPEG-4 Audio standard ISO/IEC 14496-3
+and associated amendments. This software module is an implementation of
+a part of one or more MPEG-4 Audio lossless coding tools as specified
+by the MPEG-4 Audio standard. ISO/IEC gives users of the MPEG-4 Audio
+standards free license to this software module or modifications
+thereof for use in hardware or software products claiming conformance
+to the MPEG-4 Audio standards. Those intending to use this software
+module in hardware or software products are advised that this use may
+infringe existing patents. The original developer of this software
+module, the subsequent editors and their companies, and ISO/IEC have
+no liability for use of this software module or modifications thereof
+in an implementation. Copyright is not released for non MPEG-4 Audio
+conforming products. The original developer retains full right to use
+the code for the developer's own purpose, assign or donate the code to
+a third party and to inhibit third party from using the code for non
+MPEG-4 Audio conforming products. This copyright notice must be included
+in all copies or derivative works.
+
+Copyright (c) 2007.
+
+filename : libmp4als.cpp
+project  : MPEG-4 Audio Lossless Coding
+contents : C interface of the libmp4als library
+
+*************************************************************************/
+
+#include	<cstring>
+#include	<string>
+#include	<vector>
+#if defined( _OPENMP )
+#include	<omp.h>
+#endif
+#include	"libmp4als.h"
+#include	"alsbuffer.h"
+#include	"encoder.h"
+#include	"decoder.h"
+#include	"audiorw.h"
+#include	"floating.h"
+#include	"mcc.h"
+
+using namespace NAlsImf;
+
+//////////////////////////////////////////////////////////////////////
+//                                                                  //
+//                        CLibRauSink class                         //
+//                                                                  //
+//////////////////////////////////////////////////////////////////////
+// Passes the ALS bitstream to the write procedure, or collects it in memory.
+class	CLibRauSink : public CAlsRauSink {
+public:
+	CLibRauSink( ALS_WRITEPROC pWriteProc, void* pUser ) : m_pWriteProc( pWriteProc ), m_pUser( pUser ), m_Offset( 0 ) {}
+	bool	BeginStream( const void* pHeader, ALS_UINT32 HeaderSize ) { return Put( pHeader, HeaderSize, m_Offset ); }
+	bool	WriteRauPart( const void* pData, ALS_UINT32 Size ) { return Put( pData, Size, m_Offset ); }
+	bool	WriteRau( const void* pRau, ALS_UINT32 RauSize, ALS_UINT32 Samples ) { return Put( pRau, RauSize, m_Offset ); }
+	bool	EndStream( const void* pHeader, ALS_UINT32 HeaderSize ) { return Put( pHeader, HeaderSize, 0 ); }	// Overwrite the header
+	bool	Open( void ) { return ( m_pWriteProc != NULL ) || m_Data.Open(); }
+	const void*	GetData( void ) const { return m_Data.GetBuffer(); }
+	ALSLIB_INT64	GetSize( void ) const { return m_Offset; }
+protected:
+	bool	Put( const void* pData, ALS_UINT32 Size, ALSLIB_INT64 Offset );
+protected:
+	ALS_WRITEPROC	m_pWriteProc;	// Write procedure (NULL:Collect in m_Data)
+	void*			m_pUser;		// User data for m_pWriteProc
+	CMemoryStream	m_Data;			// Collected bitstream
+	ALSLIB_INT64	m_Offset;		// Total number of bytes written
+};
+
+////////////////////////////////////////
+//                                    //
+//       Write part of bitstream      //
+//                                    //
+////////////////////////////////////////
+// pData = Data to write
+// Size = Number of bytes in pData
+// Offset = Byte offset of pData in the bitstream
+// Return value = true:Success / false:Error
+bool	CLibRauSink::Put( const void* pData, ALS_UINT32 Size, ALSLIB_INT64 Offset )
+{
+	if ( m_pWriteProc != NULL ) {
+		if ( m_pWriteProc( m_pUser, pData, Size, Offset ) != 0 ) return false;
+	} else {
+		if ( !m_Data.Seek( Offset, CBaseStream::S_BEGIN ) || ( m_Data.Write( pData, Size ) != Size ) ) return false;
+	}
+	if ( Offset + Size > m_Offset ) m_Offset = Offset + Size;
+	return true;
+}
+
+//////////////////////////////////////////////////////////////////////
+//                                                                  //
+//                         Handle structures                        //
+//                                                                  //
+//////////////////////////////////////////////////////////////////////
+struct	tagALSLIB_ENCODER {
+	tagALSLIB_ENCODER( ALS_WRITEPROC pWriteProc, void* pUser ) : m_Sink( pWriteProc, pUser ) {}
+	CLpacEncoder	m_Encoder;		// Encoder
+	CLibRauSink		m_Sink;			// Receiver of the ALS bitstream
+	int				m_Threads;		// Number of threads (0:Default)
+	std::string		m_Stats;		// Stage statistics in JSON
+};
+
+struct	tagALSLIB_DECODER {
+	CLpacDecoder	m_Decoder;		// Decoder
+	HALSSTREAM		m_hInput;		// Memory reader of the ALS bitstream
+	HALSSTREAM		m_hOutput;		// Memory writer which receives one frame
+	AUDIOINFO		m_Info;			// Audio format
+	ALS_INT64		m_Frames;		// Number of frames
+	ALS_INT64		m_Position;		// Number of samples per channel pulled so far
+	long			m_SampleBytes;	// Bytes per sample of all channels
+	int				m_Threads;		// Number of threads (0:Default)
+};
+
+////////////////////////////////////////
+//                                    //
+//       Set number of threads        //
+//                                    //
+////////////////////////////////////////
+// Threads = Number of threads for the calling thread (0:Do not change)
+// * Threads are used for floating-point analysis when built with OpenMP.
+static void	SetThreads( int Threads )
+{
+#if defined( _OPENMP )
+	if ( Threads > 0 ) omp_set_num_threads( Threads );
+#endif
+}
+
+////////////////////////////////////////
+//                                    //
+//      Initialize ALS_ENCPARAMS      //
+//                                    //
+////////////////////////////////////////
+// pParams = Pointer to structure which receives the default parameters
+// * Format is set to 16-bit stereo, 44.1 kHz, little endian.
+void	AlsInitParams( ALS_ENCPARAMS* pParams )
+{
+	if ( pParams == NULL ) return;
+	pParams->Format.Channels = 2;
+	pParams->Format.Frequency = 44100;
+	pParams->Format.Wordlength = 16;
+	pParams->Format.SampleType = 0;
+	pParams->Format.MSBfirst = 0;
+	InitEncodeOptions( &pParams->Options );
+	pParams->Threads = 0;
+	pParams->Stats = 0;
+}
+
+////////////////////////////////////////
+//                                    //
+//          Open an encoder           //
+//                                    //
+////////////////////////////////////////
+// pParams = Encoder parameters
+// pWriteProc = Procedure which receives the ALS bitstream (NULL:Return it from AlsEncoderFinish())
+// pUser = User data passed to pWriteProc
+// Return value = Encoder handle / NULL:Error
+// * RAmode 1 (random access info in the header) is not supported.
+// * The header is passed to pWriteProc first, then each frame (or each random access unit
+//   if random access is enabled) as soon as it is encoded. AlsEncoderFinish() passes the
+//   final header with the number of samples and the CRC again at offset 0.
+HALSENCODER	AlsEncoderOpen( const ALS_ENCPARAMS* pParams, ALS_WRITEPROC pWriteProc, void* pUser )
+{
+	HALSENCODER			hEncoder = NULL;
+	const ALS_PCMFORMAT*		pFormat;
+	const ALS_ENCODEOPTIONS*	pOptions;
+	ENCINFO				EncInfo;
+
+	// Check parameters.
+	if ( pParams == NULL ) return NULL;
+	pFormat = &pParams->Format;
+	pOptions = &pParams->Options;
+	if ( ( pFormat->Channels < 1 ) || ( pFormat->Channels > MAXCHAN ) || ( pFormat->Frequency <= 0 ) || ( pFormat->SampleType > 1 ) ) return NULL;
+	if ( ( pFormat->Wordlength != 8 ) && ( pFormat->Wordlength != 16 ) && ( pFormat->Wordlength != 24 ) && ( pFormat->Wordlength != 32 ) ) return NULL;
+	if ( ( pFormat->SampleType == 1 ) && ( pFormat->Wordlength != 32 ) ) return NULL;
+
+	hEncoder = new tagALSLIB_ENCODER( pWriteProc, pUser );
+	if ( hEncoder == NULL ) return NULL;
+	hEncoder->m_Threads = pParams->Threads;
+	SetThreads( hEncoder->m_Threads );
+
+	try {
+		CLpacEncoder&	Encoder = hEncoder->m_Encoder;
+
+		Encoder.SetMSBfirst( pFormat->MSBfirst ? 1 : 0 );
+		Encoder.SetChannels( pFormat->Channels );
+		Encoder.SetSampleType( pFormat->SampleType );
+		Encoder.SetWordlength( pFormat->Wordlength );
+		Encoder.SetFrequency( pFormat->Frequency );
+		if ( !SetEncodeOptions( Encoder, pOptions ) ) throw -1;
+		if ( ( pParams->Stats != 0 ) && !Encoder.EnableStats( true, pParams->Stats > 1 ) ) throw -1;
+
+		// Write the header. Frames are encoded as soon as their samples are pushed.
+		if ( !hEncoder->m_Sink.Open() ) throw -1;
+		if ( Encoder.BeginPush( &hEncoder->m_Sink, &EncInfo ) < 1 ) throw -2;
+	}
+	catch( int ) {
+		AlsEncoderClose( hEncoder );
+		hEncoder = NULL;
+	}
+	return hEncoder;
+}
+
+////////////////////////////////////////
+//                                    //
+//        Push samples to encode      //
+//                                    //
+////////////////////////////////////////
+// hEncoder = Encoder handle
+// pPcm = Interleaved PCM data in the format given to AlsEncoderOpen()
+// Samples = Number of samples per channel in pPcm
+// Return value = Number of frames encoded by this call / negative value:Error
+int	AlsEncoderPush( HALSENCODER hEncoder, const void* pPcm, unsigned int Samples )
+{
+	ALS_INT64	Frame;
+
+	if ( ( hEncoder == NULL ) || ( ( pPcm == NULL ) && ( Samples > 0 ) ) || ( Samples > 0x7fffffff ) ) return -1;
+	SetThreads( hEncoder->m_Threads );
+
+	Frame = hEncoder->m_Encoder.GetFrameIndex();
+	if ( hEncoder->m_Encoder.PushSamples( pPcm, static_cast<long>( Samples ) ) ) return -2;
+	return static_cast<int>( hEncoder->m_Encoder.GetFrameIndex() - Frame );
+}
+
+////////////////////////////////////////
+//                                    //
+//         Finish encoding            //
+//                                    //
+////////////////////////////////////////
+// hEncoder = Encoder handle
+// ppData = Pointer to variable which receives the ALS bitstream (may be NULL)
+// pSize = Pointer to variable which receives the bitstream size in bytes (may be NULL)
+// Return value = 0:Success / -3:Size does not fit in *pSize / other negative value:Error
+// * The remaining samples are encoded as the last frame.
+// * *ppData is valid until AlsEncoderClose(). It is NULL when a write procedure is used.
+// * A write procedure may receive more than 4 GB. Pass NULL as pSize in that case.
+int	AlsEncoderFinish( HALSENCODER hEncoder, const void** ppData, unsigned int* pSize )
+{
+	short	Result;
+
+	if ( hEncoder == NULL ) return -1;
+	SetThreads( hEncoder->m_Threads );
+
+	if ( ( Result = hEncoder->m_Encoder.Finish() ) != 0 ) return Result;
+	if ( ( pSize != NULL ) && ( hEncoder->m_Sink.GetSize() > 0xffffffff ) ) return -3;
+	if ( ppData != NULL ) *ppData = hEncoder->m_Sink.GetData();
+	if ( pSize != NULL ) *pSize = static_cast<unsigned int>( hEncoder->m_Sink.GetSize() );
+	return 0;
+}
+
+////////////////////////////////////////
+//                                    //
+//      Get encoder stage statistics  //
+//                                    //
+////////////////////////////////////////
+// hEncoder = Encoder handle
+// Return value = Time and counters of the encoder stages in JSON / NULL:Not measured
+// * ALS_ENCPARAMS::Stats must be set. The frames encoded so far are reported.
+// * The string is valid until the next call or AlsEncoderClose().
+const char*	AlsEncoderGetStats( HALSENCODER hEncoder )
+{
+	if ( ( hEncoder == NULL ) || !hEncoder->m_Encoder.GetStats().IsEnabled() ) return NULL;
+	hEncoder->m_Encoder.GetStats().GetJson( hEncoder->m_Stats );
+	return hEncoder->m_Stats.c_str();
+}
+
+////////////////////////////////////////
+//                                    //
+//          Close an encoder          //
+//                                    //
+////////////////////////////////////////
+// hEncoder = Encoder handle
+void	AlsEncoderClose( HALSENCODER hEncoder )
+{
+	if ( hEncoder == NULL ) return;
+	hEncoder->m_Encoder.CloseFiles();
+	delete hEncoder;
+}
+
+////////////////////////////////////////
+//                                    //
+//           Open a decoder           //
+//                                    //
+////////////////////////////////////////
+// pData = ALS bitstream
+// Size = Number of bytes in pData
+// Threads = Number of threads (0:Library default)
+// Return value = Decoder handle / NULL:Error
+// * pData is not copied. It must be kept valid until AlsDecoderClose().
+HALSDECODER	AlsDecoderOpen( const void* pData, unsigned int Size, int Threads )
+{
+	HALSDECODER	hDecoder;
+	ENCINFO		EncInfo;
+	MP4INFO		Mp4Info;
+
+	if ( pData == NULL ) return NULL;
+
+	hDecoder = new tagALSLIB_DECODER;
+	if ( hDecoder == NULL ) return NULL;
+	hDecoder->m_hInput = hDecoder->m_hOutput = NULL;
+	hDecoder->m_Position = 0;
+	hDecoder->m_Threads = Threads;
+	SetThreads( Threads );
+
+	ClearMp4Info( Mp4Info );		// Not used for ALS bitstreams
+
+	try {
+		CLpacDecoder&	Decoder = hDecoder->m_Decoder;
+
+		if ( OpenMemoryReader( pData, Size, &hDecoder->m_hInput ) ) throw -1;
+		if ( OpenMemoryWriter( &hDecoder->m_hOutput ) ) throw -1;
+		Decoder.SetInputStream( hDecoder->m_hInput, false );
+		if ( Decoder.AnalyseInputFile( &hDecoder->m_Info, &EncInfo, Mp4Info ) ) throw -1;
+		hDecoder->m_SampleBytes = hDecoder->m_Info.Chan * ( hDecoder->m_Info.Res / 8 );
+
+		// Skip the original file header, only samples are pulled.
+		Decoder.SetOutputStream( hDecoder->m_hOutput );
+		if ( ( hDecoder->m_Frames = Decoder.WriteHeader( Mp4Info, false ) ) < 1 ) throw -2;
+	}
+	catch( int ) {
+		AlsDecoderClose( hDecoder );
+		hDecoder = NULL;
+	}
+	return hDecoder;
+}
+
+////////////////////////////////////////
+//                                    //
+//        Get the audio format        //
+//                                    //
+////////////////////////////////////////
+// hDecoder = Decoder handle
+// pFormat = Pointer to structure which receives the PCM format of pulled samples
+// pSamples = Pointer to variable which receives the number of samples per channel (NULL:Not required)
+// Return value = 0:Success / negative value:Error
+int	AlsDecoderGetInfo( HALSDECODER hDecoder, ALS_PCMFORMAT* pFormat, ALSLIB_INT64* pSamples )
+{
+	if ( ( hDecoder == NULL ) || ( pFormat == NULL ) ) return -1;
+	pFormat->Channels = hDecoder->m_Info.Chan;
+	pFormat->Frequency = hDecoder->m_Info.Freq;
+	pFormat->Wordlength = hDecoder->m_Info.Res;
+	pFormat->SampleType = hDecoder->m_Info.SampleType;
+	pFormat->MSBfirst = hDecoder->m_Info.MSBfirst;
+	if ( pSamples != NULL ) *pSamples = hDecoder->m_Info.Samples;
+	return 0;
+}
+
+////////////////////////////////////////
+//                                    //
+//      Check the end of a stream     //
+//                                    //
+////////////////////////////////////////
+// hDecoder = Decoder handle
+// Return value = 0:End of stream / -2:Decoding error / -3:CRC error
+// * The CRC is checked only the first time. The original trailer is not returned.
+static int	EndOfStream( HALSDECODER hDecoder )
+{
+	MP4INFO	Mp4Info;
+
+	if ( hDecoder->m_Frames < 0 ) return 0;
+	hDecoder->m_Frames = -1;
+	ClearMp4Info( Mp4Info );
+	fseek( hDecoder->m_hOutput, 0, SEEK_SET );
+	if ( hDecoder->m_Decoder.WriteTrailer( Mp4Info ) < 0 ) return -2;
+	return ( hDecoder->m_Decoder.GetCRC() != 0 ) ? -3 : 0;
+}
+
+////////////////////////////////////////
+//                                    //
+//        Pull one decoded frame      //
+//                                    //
+////////////////////////////////////////
+// hDecoder = Decoder handle
+// ppPcm = Pointer to variable which receives interleaved PCM data of the frame
+// pSamples = Pointer to variable which receives the number of samples per channel
+// pPosition = Pointer to variable which receives the position of the first sample (NULL:Not required)
+// Return value = 1:Frame decoded / 0:End of stream / -1:Parameter error / -2:Decoding error / -3:CRC error
+// * *ppPcm is valid until the next call.
+int	AlsDecoderPull( HALSDECODER hDecoder, const void** ppPcm, unsigned int* pSamples, ALSLIB_INT64* pPosition )
+{
+	CLpacDecoder*	pDecoder;
+	ALS_UINT32		Size;
+
+	if ( ( hDecoder == NULL ) || ( ppPcm == NULL ) || ( pSamples == NULL ) ) return -1;
+	pDecoder = &hDecoder->m_Decoder;
+	*ppPcm = NULL;
+	*pSamples = 0;
+	if ( pPosition != NULL ) *pPosition = hDecoder->m_Position;
+	SetThreads( hDecoder->m_Threads );
+
+	if ( pDecoder->GetFrameIndex() >= hDecoder->m_Frames ) return EndOfStream( hDecoder );
+
+	// Decode one frame into the start of the memory writer.
+	fseek( hDecoder->m_hOutput, 0, SEEK_SET );
+	if ( pDecoder->DecodeFrame() ) return -2;
+	*ppPcm = GetMemoryData( hDecoder->m_hOutput, &Size );
+	*pSamples = static_cast<unsigned int>( ftell( hDecoder->m_hOutput ) / hDecoder->m_SampleBytes );
+	hDecoder->m_Position += *pSamples;
+	return 1;
+}
+
+////////////////////////////////////////
+//                                    //
+//          Get frame length          //
+//                                    //
+////////////////////////////////////////
+// hDecoder = Decoder handle
+// Return value = Maximum number of samples per channel returned by one call of AlsDecoderRead() / 0:Error
+unsigned int	AlsDecoderGetFrameLength( HALSDECODER hDecoder )
+{
+	if ( hDecoder == NULL ) return 0;
+	return static_cast<unsigned int>( hDecoder->m_Decoder.GetFrameLength() );
+}
+
+////////////////////////////////////////
+//                                    //
+//   Read one frame in given format   //
+//                                    //
+////////////////////////////////////////
+// hDecoder = Decoder handle
+// Format = PCM format (ALS_PCM_xxx)
+// pBuffer = Buffer which receives the samples. Array of Channels int* for ALS_PCM_PLANAR_INT32.
+//           It must hold AlsDecoderGetFrameLength() samples (per channel).
+// pSamples = Pointer to variable which receives the number of samples per channel
+// pPosition = Pointer to variable which receives the position of the first sample (NULL:Not required)
+// Return value = 1:Frame decoded / 0:End of stream / -1:Parameter error / -2:Decoding error / -3:CRC error
+int	AlsDecoderRead( HALSDECODER hDecoder, int Format, void* pBuffer, unsigned int* pSamples, ALSLIB_INT64* pPosition )
+{
+	long		Count;
+	ALS_INT64	Position;
+	short		Result;
+
+	if ( ( hDecoder == NULL ) || ( pBuffer == NULL ) || ( pSamples == NULL ) ) return -1;
+	*pSamples = 0;
+	if ( pPosition != NULL ) *pPosition = hDecoder->m_Position;
+	SetThreads( hDecoder->m_Threads );
+
+	if ( hDecoder->m_Decoder.GetFrameIndex() >= hDecoder->m_Frames ) return EndOfStream( hDecoder );
+
+	Result = hDecoder->m_Decoder.DecodeNextFrame( pBuffer, static_cast<short>( Format ), &Count, &Position );
+	if ( Result == -2 ) return -1;
+	if ( Result < 0 ) return -2;
+	*pSamples = static_cast<unsigned int>( Count );
+	if ( pPosition != NULL ) *pPosition = Position;
+	hDecoder->m_Position = Position + Count;
+	return 1;
+}
+
+////////////////////////////////////////
+//                                    //
+//          Close a decoder           //
+//                                    //
+////////////////////////////////////////
+// hDecoder = Decoder handle
+void	AlsDecoderClose( HALSDECODER hDecoder )
+{
+	if ( hDecoder == NULL ) return;
+	hDecoder->m_Decoder.CloseFiles();
+	if ( hDecoder->m_hOutput != NULL ) fclose( hDecoder->m_hOutput );
+	if ( hDecoder->m_hInput != NULL ) fclose( hDecoder->m_hInput );
+	delete hDecoder;
+}
+
+// End of libmp4als.cpp
@@ -0,0 +1,137 @@
+/***************** MPEG-4 Audio Lossless Coding **************************
+
+This software module was originally developed by
+
+NTT (Nippon Telegraph and Telephone Corporation), Japan
+
+in the course of development of the MPEG-4 Audio standard ISO/IEC 14496-3
+and associated amendments. This software module is an implementation of
+a part of one or more MPEG-4 Audio lossless coding tools as specified
+by the MPEG-4 Audio standard. ISO/IEC gives users of the MPEG-4 Audio
+standards free license to this software module or modifications
+thereof for use in hardware or software products claiming conformance
+to the MPEG-4 Audio standards. Those intending to use this software
+module in hardware or software products are advised that this use may
+infringe existing patents. The original developer of this software
+module, the subsequent editors and their companies, and ISO/IEC have
+no liability for use of this software module or modifications thereof
+in an implementation. Copyright is not released for non MPEG-4 Audio
+conforming products. The original developer retains full right to use
+the code for the developer's own purpose, assign or donate the code to
+a third party and to inhibit third party from using the code for non
+MPEG-4 Audio conforming products. This copyright notice must be included
+in all copies or derivative works.
+
+Copyright (c) 2007.
+
+filename : libmp4als.h
+project  : MPEG-4 Audio Lossless Coding
+contents : C interface of the libmp4als library
+
+*************************************************************************/
+
+#if !defined( LIBMP4ALS_INCLUDED )
+#define	LIBMP4ALS_INCLUDED
+
+#if defined( __cplusplus )
+extern "C" {
+#endif
+
+/********************************************************************/
+/*                                                                  */
+/*                         Type definition                          */
+/*                                                                  */
+/********************************************************************/
+
+#if defined( _MSC_VER )
+typedef	__int64		ALSLIB_INT64;
+#else
+typedef	long long	ALSLIB_INT64;
+#endif
+
+/* Encoder and decoder handles */
+typedef	struct tagALSLIB_ENCODER*	HALSENCODER;
+typedef	struct tagALSLIB_DECODER*	HALSDECODER;
+
+/* Format of raw PCM data */
+typedef	struct tagALS_PCMFORMAT {
+	long			Channels;		/* Number of channels */
+	long			Frequency;		/* Sampling frequency in Hz */
+	short			Wordlength;		/* Bits per sample (8, 16, 24, 32) */
+	unsigned char	SampleType;		/* 0:Integer / 1:Floating point (32-bit only) */
+	unsigned char	MSBfirst;		/* 1:Big endian / 0:Little endian */
+} ALS_PCMFORMAT;
+
+/* Encoder options (same meaning and defaults as the command line options) */
+typedef	struct tagALS_ENCODEOPTIONS {
+	long	FrameLength;	/* -n: Frame length (0:Auto) */
+	short	Order;			/* -o: Prediction order (-1:Default) */
+	short	Adapt;			/* -a: Adaptive prediction order */
+	short	Joint;			/* -i: 0:Joint stereo / -1:Independent coding */
+	short	LSBcheck;		/* -l: Check for empty LSBs */
+	short	RA;				/* -r: Random access distance in 1/10 sec (0:Off) */
+	short	RAmode;			/* -u: Random access info location */
+	short	BGMC;			/* -b: BGMC codes for the residual */
+	long	MCC;			/* -t: Multi-channel correlation (0:Off) */
+	short	PITCH;			/* -p: Long-term prediction */
+	short	Sub;			/* -g: Block switching level */
+	short	CRC;			/* -e: 1:CRC / 0:No CRC */
+	short	HEMode;			/* -z: RLS-LMS mode (0:Off) */
+	short	AcfMode;		/* -f: Floating point ACF mode */
+	float	AcfGain;		/* -f: ACF gain (AcfMode 3 only) */
+	short	MlzMode;		/* -f: Floating point MLZ mode */
+} ALS_ENCODEOPTIONS;
+
+/* PCM formats for AlsDecoderRead() */
+#define	ALS_PCM_PLANAR_INT32	0	/* int* per channel, samples at their original word length (integer PCM only) */
+#define	ALS_PCM_INT16			1	/* Interleaved 16-bit, native byte order */
+#define	ALS_PCM_INT24			2	/* Interleaved 24-bit, 3 bytes little endian */
+#define	ALS_PCM_INT32			3	/* Interleaved 32-bit, native byte order */
+#define	ALS_PCM_FLOAT32			4	/* Interleaved float (-1.0 <= x < 1.0), native byte order */
+
+/* Procedure which receives the encoded ALS bitstream
+   pUser = User data given to AlsEncoderOpen()
+   pData = Part of the bitstream
+   Size = Number of bytes in pData
+   Offset = Byte offset of pData in the bitstream (0 for the final header)
+   Return value = 0:Success / other:Error (encoding is aborted) */
+typedef	int	(*ALS_WRITEPROC)( void* pUser, const void* pData, unsigned int Size, ALSLIB_INT64 Offset );
+
+/* Encoder parameters */
+typedef	struct tagALS_ENCPARAMS {
+	ALS_PCMFORMAT		Format;		/* Format of the pushed PCM data */
+	ALS_ENCODEOPTIONS	Options;	/* Encoder options */
+	int					Threads;	/* Number of threads (0:Library default) */
+	int					Stats;		/* Stage statistics: 0:Off / 1:Per file / 2:Per file and frame */
+} ALS_ENCPARAMS;
+
+/********************************************************************/
+/*                                                                  */
+/*                      Prototype declaration                       */
+/*                                                                  */
+/********************************************************************/
+/* Functions returning int return 0 (or a positive value where noted) on success
+   and a negative value on error. Handles may be used by one thread at a time,
+   different handles may be used concurrently. */
+
+void		AlsInitParams( ALS_ENCPARAMS* pParams );
+HALSENCODER	AlsEncoderOpen( const ALS_ENCPARAMS* pParams, ALS_WRITEPROC pWriteProc, void* pUser );
+int			AlsEncoderPush( HALSENCODER hEncoder, const void* pPcm, unsigned int Samples );
+int			AlsEncoderFinish( HALSENCODER hEncoder, const void** ppData, unsigned int* pSize );
+const char*	AlsEncoderGetStats( HALSENCODER hEncoder );
+void		AlsEncoderClose( HALSENCODER hEncoder );
+
+HALSDECODER	AlsDecoderOpen( const void* pData, unsigned int Size, int Threads );
+int			AlsDecoderGetInfo( HALSDECODER hDecoder, ALS_PCMFORMAT* pFormat, ALSLIB_INT64* pSamples );
+int			AlsDecoderPull( HALSDECODER hDecoder, const void** ppPcm, unsigned int* pSamples, ALSLIB_INT64* pPosition );
+unsigned int	AlsDecoderGetFrameLength( HALSDECODER hDecoder );
+int			AlsDecoderRead( HALSDECODER hDecoder, int Format, void* pBuffer, unsigned int* pSamples, ALSLIB_INT64* pPosition );
+void		AlsDecoderClose( HALSDECODER hDecoder );
+
+#if defined( __cplusplus )
+}
+#endif
+
+#endif	/* LIBMP4ALS_INCLUDED */
+
+/* End of libmp4als.h */
@@ -65,12 +65,6 @@ contents : Recursive Least Square, Least Mean Square and related functions
 #define LEFT	0
 #define RIGHT	1
 
-BUF_TYPE *bufptr[MAX_STAGES];
-BUF_TYPE *bufptr_j[2][MAX_STAGES];
-W_TYPE *wptr[MAX_STAGES];  
-W_TYPE *wptr_j[2][MAX_STAGES];
-extern short store_residual;
-
 // mu for lms that can be used in the mode table
 char mu_table[32]={1,2,3,4,5,6,7,8,9,10,11,12,13,14,15,16,18,20,22,24,26,
                   28,30,35,40,45,50,55,60,70,80,100};
@@ -154,8 +148,6 @@ mtable safe_mode_table =
 {			0,	0,	30,	0,0,0,0,0,0,0},
 {99,999}, 16777};
 
-mtable c_mode_table;  // the current table used in the encode/decode
-
 /*************************************************************************/
 // fast_bitcount - locate and return the MSB bit of a 64 bit variable
 /*************************************************************************/
@@ -187,17 +179,17 @@ void buffer_update(int x, int *buf, short N)
 
 /*************************************************************************/
 // reinit_P - re-initialize P matrix ( inverse correlation matrix of RLS)
-//            with the initial values
+//            of order M with the initial values
 /*************************************************************************/
-void reinit_P(P_TYPE *Pmatrix)
+void reinit_P(P_TYPE *Pmatrix, short M)
 {
 	short i;
 	// clear the matrix of size rls_order by rls_order
-	for (i=0; i<c_mode_table.filter_len[1]*c_mode_table.filter_len[1];i++)
+	for (i=0; i<M*M;i++)
 		Pmatrix[i]=0;
 	// update the diagonal value with the initial value
-	for (i=0; i<c_mode_table.filter_len[1]; i++)
-		Pmatrix[i*c_mode_table.filter_len[1]+i]=(INT64) JS_INIT_P;
+	for (i=0; i<M; i++)
+		Pmatrix[i*M+i]=(INT64) JS_INIT_P;
 }
 
 /***********************************************************************/
@@ -308,7 +300,7 @@ void UpdateRLSFilter(int *x, int y, W_TYPE *w, short M,
 	else
 	{
 		assert(wtemp!=0);
-		reinit_P(P);
+		reinit_P(P, M);
 	}
 	wtemp2 = wtemp;
 	assert(i<90);
@@ -374,8 +366,8 @@ void UpdateRLSFilter(int *x, int y, W_TYPE *w, short M,
 		{
 			wtemp = ((INT64) k[i] * vl[j])>>(14-vscale);
 			P[i*M+j] -= wtemp;
-			if (P[i*M+j]>=_I64_MAX/2) { reinit_P(P); break; }
-			if (P[i*M+j]<=_I64_MIN/2) { reinit_P(P); break; }
+			if (P[i*M+j]>=_I64_MAX/2) { reinit_P(P, M); break; }
+			if (P[i*M+j]<=_I64_MIN/2) { reinit_P(P, M); break; }
 			wtemp = P[i*M+j]/lambda;
 			P[i*M+j] += wtemp;
 		}
@@ -393,21 +385,21 @@ void UpdateRLSFilter(int *x, int y, W_TYPE *w, short M,
 // **weight and large history buf, **buf into smaller ones
 // based on the c_mode_table definition 
 /***********************************************************/
-void update_ptr_array(W_TYPE **weight,BUF_TYPE **buf,short ch)
+void update_ptr_array(rlslms_buf_ptr *rlslms_ptr,W_TYPE **weight,BUF_TYPE **buf,short ch)
 {
 	short i,j,k;
-	bufptr_j[LEFT][0]=&buf[ch][0];
-	bufptr_j[RIGHT][0]=&buf[ch+1][0];
-	wptr_j[LEFT][0]=&weight[ch][0];
-	wptr_j[RIGHT][0]=&weight[ch+1][0];
+	rlslms_ptr->bufptr_j[LEFT][0]=&buf[ch][0];
+	rlslms_ptr->bufptr_j[RIGHT][0]=&buf[ch+1][0];
+	rlslms_ptr->wptr_j[LEFT][0]=&weight[ch][0];
+	rlslms_ptr->wptr_j[RIGHT][0]=&weight[ch+1][0];
 	for(j=0;j<2;j++)  // 2 channel 
 	{
 		k = 0;
-		for(i=1;i<=c_mode_table.nstage;i++)
+		for(i=1;i<=rlslms_ptr->c_mode_table.nstage;i++)
 		{
-			k += c_mode_table.filter_len[i-1];
-			bufptr_j[j][i]=&buf[ch+j][k];
-			wptr_j[j][i]=&weight[ch+j][k];
+			k += rlslms_ptr->c_mode_table.filter_len[i-1];
+			rlslms_ptr->bufptr_j[j][i]=&buf[ch+j][k];
+			rlslms_ptr->wptr_j[j][i]=&weight[ch+j][k];
 		}
 	}
 }
@@ -418,17 +410,17 @@ void update_ptr_array(W_TYPE **weight,BUF_TYPE **buf,short ch)
 // *weight and large history buf, *buf into smaller ones
 // based on the c_mode_table definition
 /***********************************************************/
-void update_ptr(W_TYPE *weight,BUF_TYPE *buf)
+void update_ptr(rlslms_buf_ptr *rlslms_ptr,W_TYPE *weight,BUF_TYPE *buf)
 {
 	short i,k;
-	bufptr[0]=buf;
-	wptr[0]=weight;
+	rlslms_ptr->bufptr[0]=buf;
+	rlslms_ptr->wptr[0]=weight;
 	k = 0;
-	for(i=1;i<=c_mode_table.nstage;i++)
+	for(i=1;i<=rlslms_ptr->c_mode_table.nstage;i++)
 	{
-		k += c_mode_table.filter_len[i-1];
-		bufptr[i]=&buf[k];
-		wptr[i]=&weight[k];
+		k += rlslms_ptr->c_mode_table.filter_len[i-1];
+		rlslms_ptr->bufptr[i]=&buf[k];
+		rlslms_ptr->wptr[i]=&weight[k];
 	}
 }
 
@@ -436,9 +428,9 @@ void update_ptr(W_TYPE *weight,BUF_TYPE *buf)
 // initCoefTable - initial the current_table c_mode_table based on 
 //                 the mode (1 to 3) and sampling_frequence 
 /*************************************************************************/
-void initCoefTable(short mode, unsigned char CoefTable)
+void initCoefTable(rlslms_buf_ptr *rlslms_ptr, short mode, unsigned char CoefTable)
 {		
-	memcpy((void*)&c_mode_table,
+	memcpy((void*)&rlslms_ptr->c_mode_table,
 		   &table_assigned[MIN(CoefTable,2)][mode],sizeof(mtable));
 }
 
@@ -450,24 +442,27 @@ void initCoefTable(short mode, unsigned char CoefTable)
 void predict_init(rlslms_buf_ptr *rlslms_ptr)
 {
 	short i,j,ch,rls_order;
+	mtable *table = &rlslms_ptr->c_mode_table;
+	W_TYPE **wptr = rlslms_ptr->wptr;
 
 	ch = rlslms_ptr->channel;
-	rls_order = c_mode_table.filter_len[1];
+	rls_order = table->filter_len[1];
 
-	update_ptr(rlslms_ptr->weight[ch],
+	update_ptr(rlslms_ptr,
+		       rlslms_ptr->weight[ch],
 		       rlslms_ptr->pbuf[ch]);
 
 	for (i=0; i<rls_order; i++)
 		wptr[1][i] = 0;  // RLS filter weight initialized to 0 
 	
-	for (j=LMS_START;j<c_mode_table.nstage;j++)
-		for (i=0; i<c_mode_table.filter_len[j]; i++)
+	for (j=LMS_START;j<table->nstage;j++)
+		for (i=0; i<table->filter_len[j]; i++)
 			wptr[j][i] = 0;
 		
-	for (i=0; i<c_mode_table.nstage; i++)
-		wptr[c_mode_table.nstage][i] = FRACTION;     // 7.24 format
+	for (i=0; i<table->nstage; i++)
+		wptr[table->nstage][i] = FRACTION;     // 7.24 format
 
-	reinit_P(rlslms_ptr->Pmatrix[ch]); // initialize Pmatrix
+	reinit_P(rlslms_ptr->Pmatrix[ch], rls_order); // initialize Pmatrix
 
 	for(j=0;j<TOTAL_LMS_LEN;j++)
 		rlslms_ptr->pbuf[ch][j] = 0; // reset all buffers
@@ -478,13 +473,12 @@ void predict_init(rlslms_buf_ptr *rlslms_ptr)
 // This is the weight combiner for all the predictors from DPCM, RLS and
 // LMS filter.   The function multiplied all the predictors with a set
 // of weights and output the final predictor.  The final error is computed
-// and used to update the weight of the LMS filter only.
+// and used to update the weight of the LMS filter only by wchange.
 /************************************************************************/
-int SignLMS(int x, int *predict, W_TYPE *w, short M, short RA, short mode)
+int SignLMS(int x, int *predict, W_TYPE *w, short M, short RA, short mode, int wchange)
 {
 	short i;
 	INT64 y,e,temp;
-	int wchange;
     y = 0;
 	for (i=0; i<M; i++)
 		y += (INT64) w[i]*predict[i];  // 8.24 * 24.4 -> 32.28 format
@@ -497,7 +491,6 @@ int SignLMS(int x, int *predict, W_TYPE *w, short M, short RA, short mode)
 	 	x = x + ROUND1(y); // reconstruct the sample from error
 		e = (x<<4) - y;    // compute the true error to update the weight
 	}
-	wchange = c_mode_table.step_size;
 	if (e>0)
 	{
 		for (i=LMS_START; i<M; i++)
@@ -676,39 +669,42 @@ void predict(int *x, int *d, long N,
 	INT64 pow[MAX_STAGES]; 
 	int predictor[MAX_STAGES];
 	int temp;
+	mtable *table = &rlslms_ptr->c_mode_table;
+	BUF_TYPE **bufptr = rlslms_ptr->bufptr;
+	W_TYPE **wptr = rlslms_ptr->wptr;
 
 	w			= rlslms_ptr->weight[ch];
 	buf			= rlslms_ptr->pbuf[ch];
 	Pmatrix		= rlslms_ptr->Pmatrix[ch];
-	rls_order	= c_mode_table.filter_len[1];
-	update_ptr(w,buf);	
+	rls_order	= table->filter_len[1];
+	update_ptr(rlslms_ptr,w,buf);	
 	
-	lambda		= c_mode_table.lambda[!RA];
+	lambda		= table->lambda[!RA];
 
-	for(j=LMS_START;j<c_mode_table.nstage;j++)
-		cal_power(&pow[j], bufptr[j], c_mode_table.filter_len[j]);
+	for(j=LMS_START;j<table->nstage;j++)
+		cal_power(&pow[j], bufptr[j], table->filter_len[j]);
 	
 	for(i=0;i<N;i++)
 	{
-		if (RA && i>300) lambda = c_mode_table.lambda[1];		
+		if (RA && i>300) lambda = table->lambda[1];		
 		// Cascade LMS predictors
 		predictor[0] = *bufptr[0]<<4;
 		predictor[1] = gen_rls_predictor(bufptr[1],	wptr[1],rls_order);
 
-		for(j=LMS_START;j<c_mode_table.nstage;j++)
+		for(j=LMS_START;j<table->nstage;j++)
 			predictor[j]=gen_predictor(	bufptr[j], wptr[j], 
-										c_mode_table.filter_len[j]);
+										table->filter_len[j]);
 		if (mode==ENCODE) // encoding
 		{
 			temp = (x[i]<<4)-(predictor[0]);
 			*bufptr[0]=x[i];
-			d[i] = SignLMS(x[i],predictor,wptr[c_mode_table.nstage],
-					           c_mode_table.nstage, RA, ENCODE);
+			d[i] = SignLMS(x[i],predictor,wptr[table->nstage],
+					           table->nstage, RA, ENCODE, table->step_size);
 		}
 		else // decoding
 		{
-			x[i] = SignLMS(	d[i],predictor,wptr[c_mode_table.nstage],
-								c_mode_table.nstage, RA, DECODE);
+			x[i] = SignLMS(	d[i],predictor,wptr[table->nstage],
+								table->nstage, RA, DECODE, table->step_size);
 			temp = (x[i]<<4)-(predictor[0]);
 			*bufptr[0]=x[i];
 		}
@@ -718,11 +714,11 @@ void predict(int *x, int *d, long N,
 		// update LMS filter weight
 		if ((RA && i>RA_TRANS) || !RA)
 		{
-			for(j=LMS_START;j<c_mode_table.nstage;j++)
+			for(j=LMS_START;j<table->nstage;j++)
 			{
 				update_predictor(&temp,predictor[j], bufptr[j],  wptr[j], 
-								c_mode_table.filter_len[j], 
-								c_mode_table.opt_mu[j], &pow[j]);
+								table->filter_len[j], 
+								table->opt_mu[j], &pow[j]);
 			}
 		}
 	}  //End of sample loop
@@ -759,28 +755,31 @@ void predict_joint(int *x_left, int *x_right, long N,
 	INT64 pow[2][MAX_STAGES];
 	int predictor[MAX_STAGES],temp;
 	int *ch_ptr[2];
+	mtable *table = &rlslms_ptr->c_mode_table;
+	BUF_TYPE *(*bufptr_j)[MAX_STAGES] = rlslms_ptr->bufptr_j;
+	W_TYPE *(*wptr_j)[MAX_STAGES] = rlslms_ptr->wptr_j;
 
 	w			= rlslms_ptr->weight;
 	buf			= rlslms_ptr->pbuf;
 	Pmatrix		= rlslms_ptr->Pmatrix;
 	ch			= rlslms_ptr->channel;
-	rls_order	= c_mode_table.filter_len[1];
+	rls_order	= table->filter_len[1];
 
-	update_ptr_array(w,buf,ch);
+	update_ptr_array(rlslms_ptr,w,buf,ch);
 
-	lambda = c_mode_table.lambda[!RA];
+	lambda = table->lambda[!RA];
 	ch_ptr[0] = x_left;
 	ch_ptr[1] = x_right;
 
     for(i=0;i<2;i++)  //  2 channel ch, ch+1
-		for(j=LMS_START;j<c_mode_table.nstage;j++)
+		for(j=LMS_START;j<table->nstage;j++)
 			cal_power(&pow[i][j], bufptr_j[i][j], 
-			          c_mode_table.filter_len[j]);
+			          table->filter_len[j]);
 
 	for(i=0;i<N;i++)
 	{
 		// reset to normal lambda after 300 samples 
-		if (RA && i>300) lambda = c_mode_table.lambda[1]; 
+		if (RA && i>300) lambda = table->lambda[1]; 
 		// loop for each channel 
 		for(k=0;k<2;k++)	
 		{
@@ -789,10 +788,10 @@ void predict_joint(int *x_left, int *x_right, long N,
 			predictor[1] = gen_rls_predictor(	bufptr_j[LEFT][1],
 												wptr_j[k][1],
 												rls_order);
-			for(j=LMS_START;j<c_mode_table.nstage;j++)
+			for(j=LMS_START;j<table->nstage;j++)
 				predictor[j]=gen_predictor(	bufptr_j[k][j],
 											wptr_j[k][j], 
-											c_mode_table.filter_len[j]);
+											table->filter_len[j]);
 			
 			if (mode==ENCODE) // encoding mode
 			{
@@ -801,15 +800,15 @@ void predict_joint(int *x_left, int *x_right, long N,
 
 				// combine weight update and compute the error signal
 				ch_ptr[k][i] = SignLMS(	ch_ptr[k][i], predictor,
-										wptr_j[k][c_mode_table.nstage],
-										c_mode_table.nstage, RA, ENCODE);
+										wptr_j[k][table->nstage],
+										table->nstage, RA, ENCODE, table->step_size);
 			}
 			else // decoding mode
 			{
 				// combine weight update and restore x from residual error
 				ch_ptr[k][i] = SignLMS(	ch_ptr[k][i], predictor,
-										wptr_j[k][c_mode_table.nstage],
-										c_mode_table.nstage, RA, DECODE);
+										wptr_j[k][table->nstage],
+										table->nstage, RA, DECODE, table->step_size);
 
 				*bufptr_j[k][0]=ch_ptr[k][i];				// DPCM buf update	
 				temp = (ch_ptr[k][i]<<4)-predictor[0];		// error computation.
@@ -821,10 +820,10 @@ void predict_joint(int *x_left, int *x_right, long N,
 			// LMS filter updates
 			if ((RA && i>RA_TRANS) || !RA)
 			{
-				for(j=LMS_START;j<c_mode_table.nstage;j++)
+				for(j=LMS_START;j<table->nstage;j++)
 					update_predictor(	&temp, predictor[j], bufptr_j[k][j],
-										wptr_j[k][j], c_mode_table.filter_len[j], 
-										c_mode_table.opt_mu[j], &pow[k][j]);
+										wptr_j[k][j], table->filter_len[j], 
+										table->opt_mu[j], &pow[k][j]);
 			}
 		} // end of channel
 	}// end of a sample
@@ -943,7 +942,6 @@ void analyze_joint(int *x0, int *x1, long N, rlslms_buf_ptr *rlslms_ptr,
 	char *xpr0, *xpr1;
 	long i;
 	short ch;
-	static short old_flag=0;
 	int x2[65536],d[65536];
 	ch = rlslms_ptr->channel;
 	xpr0 = &mccbuf->m_xpara[ch];
@@ -969,19 +967,19 @@ void analyze_joint(int *x0, int *x1, long N, rlslms_buf_ptr *rlslms_ptr,
 
 	if (*xpr0!=0 && *xpr1!=0) /* both block is zero */
 	{ 
-			reinit_P(rlslms_ptr->Pmatrix[ch]);
-			reinit_P(rlslms_ptr->Pmatrix[ch+1]);
+			reinit_P(rlslms_ptr->Pmatrix[ch], rlslms_ptr->c_mode_table.filter_len[1]);
+			reinit_P(rlslms_ptr->Pmatrix[ch+1], rlslms_ptr->c_mode_table.filter_len[1]);
 			return; 
 	} 
 	if (Left_equal_Right(x0,x1,x2,N)<=36*N)
 	{
 		*xpr0 = *xpr1 = 0;
-		if (old_flag == 0) 
+		if (rlslms_ptr->old_flag == 0) 
 		{ 
-			reinit_P(rlslms_ptr->Pmatrix[ch]);
-			reinit_P(rlslms_ptr->Pmatrix[ch+1]);
+			reinit_P(rlslms_ptr->Pmatrix[ch], rlslms_ptr->c_mode_table.filter_len[1]);
+			reinit_P(rlslms_ptr->Pmatrix[ch+1], rlslms_ptr->c_mode_table.filter_len[1]);
 		}
-		old_flag = 1;
+		rlslms_ptr->old_flag = 1;
 		*mono_frame = 1;
 		for(i=0;i<N;i++) x1[i]-=x0[i];
 		predict(x0, d, N, rlslms_ptr,ch,RA,ENCODE);
@@ -990,12 +988,12 @@ void analyze_joint(int *x0, int *x1, long N, rlslms_buf_ptr *rlslms_ptr,
 	else
 	{
 		*xpr0 = *xpr1 = 0;
-		if (old_flag==1)
+		if (rlslms_ptr->old_flag==1)
 		{
-			reinit_P(rlslms_ptr->Pmatrix[ch]);
-			reinit_P(rlslms_ptr->Pmatrix[ch+1]);
+			reinit_P(rlslms_ptr->Pmatrix[ch], rlslms_ptr->c_mode_table.filter_len[1]);
+			reinit_P(rlslms_ptr->Pmatrix[ch+1], rlslms_ptr->c_mode_table.filter_len[1]);
 		}
-		old_flag = 0;
+		rlslms_ptr->old_flag = 0;
 		*mono_frame = 0;
 		predict_joint(x0, x1, N, rlslms_ptr, RA, ENCODE);
 	}
@@ -1024,7 +1022,6 @@ void synthesize_joint(int *x0, int *x1, long N, rlslms_buf_ptr *rlslms_ptr,
 	char *xpr0,*xpr1;
 	long i;
 	short ch;
-	static short old_flag=0;
 	ch = rlslms_ptr->channel;
 	xpr0 = &mccbuf->m_xpara[ch];
 	xpr1 = &mccbuf->m_xpara[ch+1];
@@ -1040,30 +1037,30 @@ void synthesize_joint(int *x0, int *x1, long N, rlslms_buf_ptr *rlslms_ptr,
 
 	if (*xpr0!=0 && *xpr1!=0) /* both block are zero or constant */
 	{ 
-			reinit_P(rlslms_ptr->Pmatrix[ch]);
-			reinit_P(rlslms_ptr->Pmatrix[ch+1]);
+			reinit_P(rlslms_ptr->Pmatrix[ch], rlslms_ptr->c_mode_table.filter_len[1]);
+			reinit_P(rlslms_ptr->Pmatrix[ch+1], rlslms_ptr->c_mode_table.filter_len[1]);
 			return; 
 	} 
     if (mono_frame==1)
 	{
-		if (old_flag==0) 
+		if (rlslms_ptr->old_flag==0) 
 		{ 
-			reinit_P(rlslms_ptr->Pmatrix[ch]);
-			reinit_P(rlslms_ptr->Pmatrix[ch+1]);
+			reinit_P(rlslms_ptr->Pmatrix[ch], rlslms_ptr->c_mode_table.filter_len[1]);
+			reinit_P(rlslms_ptr->Pmatrix[ch+1], rlslms_ptr->c_mode_table.filter_len[1]);
 		}
 		for(i=0;i<N;i++) d[i]=x0[i];
 		predict(x0, d, N, rlslms_ptr, ch, RA, DECODE);
 		for(i=0;i<N;i++) x1[i]+=x0[i];
-		old_flag = 1;
+		rlslms_ptr->old_flag = 1;
 	}
 	else
 	{
-		if (old_flag==1) 
+		if (rlslms_ptr->old_flag==1) 
 		{ 
-			reinit_P(rlslms_ptr->Pmatrix[ch]); 
-			reinit_P(rlslms_ptr->Pmatrix[ch+1]); 
+			reinit_P(rlslms_ptr->Pmatrix[ch], rlslms_ptr->c_mode_table.filter_len[1]); 
+			reinit_P(rlslms_ptr->Pmatrix[ch+1], rlslms_ptr->c_mode_table.filter_len[1]); 
 		}
-		old_flag = 0;
+		rlslms_ptr->old_flag = 0;
 		predict_joint(x0, x1, N, rlslms_ptr, RA, DECODE);
 	}
 }
@@ -97,6 +97,12 @@ struct rlslms_buf_ptr {
 	W_TYPE **weight;
 	P_TYPE **Pmatrix;
     short channel; // which channel is currently processing		
+	short old_flag; // mono_frame of the last joint-stereo block
+	mtable c_mode_table; // the current table used in the encode/decode
+	BUF_TYPE *bufptr[MAX_STAGES]; // stages of pbuf[channel] (mono)
+	BUF_TYPE *bufptr_j[2][MAX_STAGES]; // stages of pbuf[channel], pbuf[channel+1] (joint stereo)
+	W_TYPE *wptr[MAX_STAGES]; // stages of weight[channel] (mono)
+	W_TYPE *wptr_j[2][MAX_STAGES]; // stages of weight[channel], weight[channel+1] (joint stereo)
 };
 
 void analyze(int *x, long N,  rlslms_buf_ptr *rlslms_ptr, short RA, short IntRes, MCC_ENC_BUFFER *mccbuf);
@@ -104,7 +110,8 @@ void synthesize(int *x, long N,  rlslms_buf_ptr *rlslms_ptr, short RA, MCC_DEC_B
 void analyze_joint(int *x0, int *x1, long N,  rlslms_buf_ptr *rlslms_ptr, short RA, short IntRes, short *mono, MCC_ENC_BUFFER *mccbuf);
 void synthesize_joint(int *x0, int *x1, long N, rlslms_buf_ptr *rlslms_ptr, short RA, short mono, MCC_DEC_BUFFER *mccbuf);
 void predict_init(rlslms_buf_ptr *ptr);
-void initCoefTable(short mode, unsigned char CoefTable);
+void predict(int *x, int *d, long N, rlslms_buf_ptr *rlslms_ptr, short ch, short RA, short mode);
+void initCoefTable(rlslms_buf_ptr *rlslms_ptr, short mode, unsigned char CoefTable);
 
 
 extern short BlockIsZero(int *x, long N);
@@ -114,7 +121,6 @@ extern short lookup_mu(short mu);
 extern short lookup_table(short *,short mu);
 
 
-extern mtable c_mode_table;
 extern mtable safe_mode_table;
 extern mtable *table_assigned[3];
 extern char mu_table[32];
@@ -170,11 +170,10 @@ short durbin(short ord, double *rxx, double *par)
 // -> P		: Predictor order
 // -> win	: Window type
 // <- par	: Parcor coefficients
-short GetCof(int *x, long N, short P, short win, double *par)
+// -- xd		: Work buffer (N)
+// -- rxx	: Work buffer (P+1)
+short GetCof(int *x, long N, short P, short win, double *par, double *xd, double *rxx)
 {
-	double *xd = new double[N];
-	double *rxx = new double[P+1];
-
 	// Windowing
 	if (win == 1)
 		hamming(x, xd, N);
@@ -191,9 +190,6 @@ short GetCof(int *x, long N, short P, short win, double *par)
 	// Calculate LPC coefficients
 	durbin(P, rxx, par);
 
-	delete [] xd;
-	delete [] rxx;
-
 	return(0);
 }
 
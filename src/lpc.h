@@ -55,7 +55,7 @@ void rect(int *x, double *xd, long N);
 short durbin(short ord, double *rxx, double *par);
 short par2cof(int *cof, int *par, short ord, short Q);
 
-short GetCof(int *x, long N, short P, short win, double *par);
+short GetCof(int *x, long N, short P, short win, double *par, double *xd, double *rxx);
 void GetResidual(int *x, long N, short P, short Q, int *cof, int *d);
 void GetSignal(int *x, long N, short P, short Q, int *cof, int *d);
 short GetResidualRA(int *x, long N, short P, short Q, int *par, int *cof, int *d);
@@ -92,7 +92,9 @@ contents : Multi-channel correlation
 // Chan = Number of channels
 // N = Number of samples per frame
 // Res = Resolution
-void	AllocateMccEncBuffer( MCC_ENC_BUFFER* pBuffer, long Chan, long N, short Res ,long MaxTau)
+// MaxTau = Maximum time lag
+// pScratch = Scratch memory for the per-frame work buffers
+void	AllocateMccEncBuffer( MCC_ENC_BUFFER* pBuffer, long Chan, long N, short Res ,long MaxTau, CAlsScratch* pScratch )
 {
 	long	i, j, k;
 	long	BytesPerSample;
@@ -158,7 +160,7 @@ void	AllocateMccEncBuffer( MCC_ENC_BUFFER* pBuffer, long Chan, long N, short Res
 	pBuffer->m_tmpMM = new short[Chan];
 
 	// Allocate buffers for LTP
-	pBuffer->m_Ltp.Allocate( Chan, N );
+	pBuffer->m_Ltp.Allocate( Chan, N, pScratch );
 
 	// Save number of channels
 	pBuffer->m_Chan = Chan;
@@ -166,6 +168,9 @@ void	AllocateMccEncBuffer( MCC_ENC_BUFFER* pBuffer, long Chan, long N, short Res
 	// Save maximum of time lag
 	pBuffer->m_MaxTau = MaxTau;
 
+	// Per-frame work buffers are taken from the scratch memory of the encoder.
+	pBuffer->m_pScratch = pScratch;
+
 }
 
 ////////////////////////////////////////
@@ -257,7 +262,8 @@ void	InitMccEncBuffer( MCC_ENC_BUFFER* pBuffer )
 // pBuffer = Pointer to MCC buffer structure
 // Chan = Number of channels
 // N = Number of samples per frame
-void	AllocateMccDecBuffer( MCC_DEC_BUFFER* pBuffer, long Chan, long N )
+// pScratch = Scratch memory for the per-frame work buffers
+void	AllocateMccDecBuffer( MCC_DEC_BUFFER* pBuffer, long Chan, long N, CAlsScratch* pScratch )
 {
 	long	i, j, k;
 
@@ -309,10 +315,13 @@ void	AllocateMccDecBuffer( MCC_DEC_BUFFER* pBuffer, long Chan, long N )
 	memset( pBuffer->m_mccparq, 0, MAXODR * sizeof(int) );
 
 	// Allocate buffers for LTP
-	pBuffer->m_Ltp.Allocate( Chan, N );
+	pBuffer->m_Ltp.Allocate( Chan, N, pScratch );
 
 	// Save number of channels
 	pBuffer->m_Chan = Chan;
+
+	// Per-frame work buffers are taken from the scratch memory of the decoder.
+	pBuffer->m_pScratch = pScratch;
 }
 
 ////////////////////////////////////////
@@ -442,11 +451,13 @@ const short	CLtp::m_QcfTable[16] = { 0, 8, 16, 24, 32, 40, 48, 56, 64, 70, 76, 8
 ////////////////////////////////////////
 // Chan = Number of channels
 // N = Number of samples per frame
-void	CLtp::Allocate( long Chan, long N )
+// pScratch = Scratch memory for the work buffers of PitchDetector()
+void	CLtp::Allocate( long Chan, long N, CAlsScratch* pScratch )
 {
 	Free();
 	m_pBuffer = new CLtpBuffer[Chan];
 	for( long i=0; i<Chan; i++ ) m_pBuffer[i].Allocate( N );
+	m_pScratch = pScratch;
 }
 
 ////////////////////////////////////////
@@ -605,8 +616,9 @@ void	CLtp::PitchDetector( CLtpBuffer* pOutput, int *d, long N, short P, long Fre
 		return;
 	}
 
-	buffd = new double [ N + end ];
-	buffdlp = new double [ N + end ];
+	CAlsScratchScope	Scope( *m_pScratch );
+	buffd = m_pScratch->Get<double>( N + end );
+	buffdlp = m_pScratch->Get<double>( N + end );
 	buffdp = buffd + end;
 	buffdplp = buffdlp + end;
 
@@ -719,9 +731,6 @@ void	CLtp::PitchDetector( CLtpBuffer* pOutput, int *d, long N, short P, long Fre
 		}
 	}
 	if ( !flag ) pOutput->m_pcoef_multi[2] = 0;
-
-	delete[] buffdlp;
-	delete[] buffd;
 }
 
 ////////////////////////////////////////
@@ -763,17 +772,17 @@ void	CLtp::SubMulti( const int* d, int* dout, long end, short ival, const short*
 //              Cholesky              //
 //                                    //
 ////////////////////////////////////////
+// * n must not exceed CHOLESKY_MAXDIM (LTP uses 5, MCC 3 or 6 taps).
+#define	CHOLESKY_MAXDIM	6
+
 void	Cholesky( double* a, double* b, const double* c, int n )
 {
 	int		i, j, k, zeroflag = 0;
-	double*	t;
-	double*	invt;
+	double	t[CHOLESKY_MAXDIM*CHOLESKY_MAXDIM];
+	double	invt[CHOLESKY_MAXDIM];
 	double	acc;
 	static	const double	eps = 1.e-16;
 
-	t = new double [ n * n ];
-	invt = new double [ n ];
-
 	t[0] = sqrt( a[0] + eps );
 	invt[0] = 1. / t[0];
 	for( k=1; k<n; k++ ) t[k*n] = a[k*n] * invt[0];
@@ -792,8 +801,6 @@ void	Cholesky( double* a, double* b, const double* c, int n )
 
 	if(zeroflag) {
 		for(i = 0; i < n; i++) b[i] = 0.0;
-		delete[] t;
-		delete[] invt;
 		return;
 	}
 
@@ -808,9 +815,6 @@ void	Cholesky( double* a, double* b, const double* c, int n )
 		for( k=i+1; k<n; k++ ) acc -= t[k*n+i] * b[k];
 		b[i] = acc * invt[i];
 	}
-
-	delete[] t;
-	delete[] invt;
 }
 
 ////////////////////////////////////////
@@ -879,7 +883,7 @@ unsigned int	CLtp::GetBit( BITIO* p )
 // Search Time Difference //
 ///////////////////////////
 
-long GetTimeDiff(int *sdmas, int *sdsla, long N, long MaxTau)
+long GetTimeDiff(int *sdmas, int *sdsla, long N, long MaxTau, CAlsScratch& Scratch)
 {
 	long smpl,outtau=3,tau;
 	double powin=0.0,maxpow=0.0;
@@ -892,8 +896,9 @@ long GetTimeDiff(int *sdmas, int *sdsla, long N, long MaxTau)
 
 		therefore minimum TimeDiff should be 4.
 												*/
-	double *dn = new double [N];
-	double *ds = new double [N];
+	CAlsScratchScope Scope(Scratch);
+	double *dn = Scratch.Get<double>(N);
+	double *ds = Scratch.Get<double>(N);
 	double *pds, *pdn;
 
 	for( smpl=0; smpl<N; smpl++ )
@@ -934,12 +939,10 @@ long GetTimeDiff(int *sdmas, int *sdsla, long N, long MaxTau)
 		}
 	}
 
-	delete[] dn;
-	delete[] ds;
 	return(outtau);
 }
 
-long GetTimeDiff0(int *sdmas, int *sdsla, long N, long MaxTau)
+long GetTimeDiff0(int *sdmas, int *sdsla, long N, long MaxTau, CAlsScratch& Scratch)
 {
 //include Tau=0
 	long smpl,outtau=3,tau;
@@ -953,8 +956,9 @@ long GetTimeDiff0(int *sdmas, int *sdsla, long N, long MaxTau)
 
 		therefore minimum TimeDiff should be 3.
 												*/
-	double *dn = new double [N];
-	double *ds = new double [N];
+	CAlsScratchScope Scope(Scratch);
+	double *dn = Scratch.Get<double>(N);
+	double *ds = Scratch.Get<double>(N);
 	double *pds, *pdn;
 
 	for( smpl=0; smpl<N; smpl++ )
@@ -997,8 +1001,6 @@ long GetTimeDiff0(int *sdmas, int *sdsla, long N, long MaxTau)
 		}
 	}
 
-	delete[] dn;
-	delete[] ds;
 	return(outtau);
 }
 
@@ -1015,6 +1017,8 @@ void	SubtractResidualTD( MCC_ENC_BUFFER* pBuffer, long Chan, long N , short MccM
 	int*	tdtau = pBuffer->m_tmptdtau;
 	int**	mtgmm = pBuffer->m_mtgmm;
 	long	maxtau = pBuffer->m_MaxTau;
+	CAlsScratch&	Scratch = *pBuffer->m_pScratch;
+	CAlsScratchScope	Scope( Scratch );
 	int	smpl, cnl, *sdmas, *sdsla, *sdmasbd, *sdslabd;
 	int**	stackdmat;
 	INT64 regg;
@@ -1024,21 +1028,21 @@ void	SubtractResidualTD( MCC_ENC_BUFFER* pBuffer, long Chan, long N , short MccM
 						   0, -12, -25, -38, -51, -64, -76, -89,
 						-102,-115,-128,-140,-153,-166,-179,-192};
 	
-	stackdmat = new int* [Chan];
+	stackdmat = Scratch.Get<int*>( Chan );
 	long ss, se;
 	int *pdmat, *pdmatp, *pdmatt;
 	short gain[6];
 	short ic;
 
-	sdmasbd = new int[N+((maxtau+1)*2)];
-	sdslabd = new int[N+((maxtau+1)*2)];
+	sdmasbd = Scratch.Get<int>( N+((maxtau+1)*2) );
+	sdslabd = Scratch.Get<int>( N+((maxtau+1)*2) );
 	sdmas = sdmasbd + (maxtau+1);
 	sdsla = sdslabd + (maxtau+1);
 	memset( sdmasbd, 0, (N+((maxtau+1)*2)) * sizeof(int) );
 	memset( sdslabd, 0, (N+((maxtau+1)*2)) * sizeof(int) );
 	
 	for( cnl=0; cnl<Chan; cnl++ ) {
-		 stackdmat[cnl] = new int [N];
+		 stackdmat[cnl] = Scratch.Get<int>( N );
 		 memcpy( stackdmat[cnl], dmat[cnl], N * sizeof(int) );
 	}
 
@@ -1075,7 +1079,7 @@ void	SubtractResidualTD( MCC_ENC_BUFFER* pBuffer, long Chan, long N , short MccM
 			}//MM=1
 			else if(MccMode==2)
 			{
-				tdtau[cnl]=GetTimeDiff(sdmas,sdsla,N,maxtau);
+				tdtau[cnl]=GetTimeDiff(sdmas,sdsla,N,maxtau,Scratch);
 				if(tdtau[cnl]>0) {ss=1; se=N-tdtau[cnl]-1;}
 				else {ss=-tdtau[cnl]+1; se=N-1;}
 				GetGammaMulti6Tap(sdmas,sdsla,N,mtgmm[cnl],tdtau[cnl]);
@@ -1104,11 +1108,6 @@ void	SubtractResidualTD( MCC_ENC_BUFFER* pBuffer, long Chan, long N , short MccM
 			}//MM=2
 		}
 	}
-
-	for( cnl=0; cnl<Chan; cnl++ ) delete[] stackdmat[cnl];
-	delete[] stackdmat;
-	delete[] sdmasbd;
-	delete[] sdslabd;
 }
 
 
@@ -1124,6 +1123,7 @@ void	ReconstructResidualTD( MCC_DEC_BUFFER* pBuffer, long Chan, long N )
 	int*	tdtau = pBuffer->m_tmptdtau;
 	short*	MccMode = pBuffer->m_tmpMM;
 	int**	mtgmm = pBuffer->m_mtgmm;
+	CAlsScratchScope	Scope( *pBuffer->m_pScratch );
 	long	smpl, cnl, stopflag;
 	char*	endflag;
 	INT64 regg;
@@ -1132,17 +1132,13 @@ void	ReconstructResidualTD( MCC_DEC_BUFFER* pBuffer, long Chan, long N )
 						   0, -12, -25, -38, -51, -64, -76, -89,
 						-102,-115,-128,-140,-153,-166,-179,-192};
 	
-	endflag = new char [Chan];
+	endflag = pBuffer->m_pScratch->Get<char>( Chan );
 	long ss, se;
 	memset( endflag, 0, Chan );
 	stopflag = 0;
-	int *pdmat, *pdmatp, *pdmatt, *dref;
+	int *pdmat, *pdmatp, *pdmatt;
 	short gain[6];
 	short ic;
-	short maxtau = 130;
-	dref = new int[N+((maxtau+1)*2)];
-	pdmat = dref + (maxtau+1);
-	memset( dref, 0, (N+((maxtau+1)*2)) * sizeof(int) );
 
 	for( cnl=0; cnl<Chan; cnl++ ) {	//At First,Get Original
 		if ( xpara[cnl] ) {
@@ -1218,9 +1214,6 @@ void	ReconstructResidualTD( MCC_DEC_BUFFER* pBuffer, long Chan, long N )
 		}
 		if ( stopflag == Chan ) break;
 	} while( stopflag <= Chan );
-
-	delete [] endflag;
-	delete [] dref;
 }
 
 
@@ -1244,22 +1237,24 @@ void	CheckFrameDistanceTD( MCC_ENC_BUFFER* pBuffer, long Chan, long N, long MCCv
 	CHANDISTMAT*	DistanceEandS;
 	CHANDISTMAT*	DistanceEonly;
 	int*	endflag;
+	CAlsScratch&	Scratch = *pBuffer->m_pScratch;
+	CAlsScratchScope	Scope( Scratch );
 
 	Nclus = MCCval;
 
 	Chan /= Nclus;
 	NumMat = Chan * Chan;
-	dmas = new int [N];
-	dsla = new int [N];
+	dmas = Scratch.Get<int>( N );
+	dsla = Scratch.Get<int>( N );
 
-	DistanceEandS = new CHANDISTMAT [NumMat];
-	DistanceEonly = new CHANDISTMAT [NumMat];
+	DistanceEandS = Scratch.Get<CHANDISTMAT>( NumMat );
+	DistanceEonly = Scratch.Get<CHANDISTMAT>( NumMat );
 	for( ntm=0; ntm<NumMat; ntm++ ) {
 		DistanceEandS[ntm].chandist = 0.0;
 		DistanceEonly[ntm].chandist = 0.0;
 	}
 
-	endflag = new int [ Chan * Nclus ];
+	endflag = Scratch.Get<int>( Chan * Nclus );
 
 	for( ite=0; ite<Nclus; ite++ ) {
 		for( cnl=ite*Chan; cnl<Chan*(ite+1); cnl++ ) endflag[cnl] = 0;
@@ -1299,7 +1294,7 @@ void	CheckFrameDistanceTD( MCC_ENC_BUFFER* pBuffer, long Chan, long N, long MCCv
 					powmas = 0.0;
 					tmpcos = 0.0;
 					powin = 0.0;
-					tdtau=GetTimeDiff0(dmas,dsla,N,maxtau);
+					tdtau=GetTimeDiff0(dmas,dsla,N,maxtau,Scratch);
 					if(tdtau>0) {ss=1; se=N-tdtau-1;}
 					else {ss=-tdtau+1; se=N-1;}
 					for( smpl=ss; smpl<se; smpl++ ) {
@@ -1386,11 +1381,6 @@ void	CheckFrameDistanceTD( MCC_ENC_BUFFER* pBuffer, long Chan, long N, long MCCv
 		}
 	}
 
-	delete [] DistanceEandS;
-	delete [] DistanceEonly;
-	delete [] dmas;
-	delete [] dsla;
-	delete [] endflag;
 }
 
 
@@ -1402,10 +1392,7 @@ void GetGammaMulti3Tap(int *sdmas, int *sdsla, long N, int *vgmm, long Tau)
 {
 	double gmm=0.0,tmpy=0.0, tmpz=0.0, tmpw=0.0, tmpv=0.0, ytz=0.0, ytw=0.0, ytv=0.0, ztz=0.0, wtw=0.0, vtv=0.0, ztw=0.0, ztv=0.0, wtv=0.0;
 	long dimn=3,di,smpl;
-	double *ioa,*ob,*ic;
-	ioa=new double [dimn*dimn];
-	ob=new double [dimn];
-	ic=new double [dimn];
+	double ioa[3*3],ob[3],ic[3];
 	long ss, se;
 	if(Tau>0) {ss=1; se=N-1-Tau;}
 	else {ss=-Tau+1; se=N-1;} 
@@ -1452,9 +1439,6 @@ void GetGammaMulti3Tap(int *sdmas, int *sdsla, long N, int *vgmm, long Tau)
 		else vgmm[di]=(short) ( gmm * (-10) + 1.5 )+15;
 	}
 
-	delete [] ioa;
-	delete [] ob;
-	delete [] ic;
 }
 
 
@@ -1474,10 +1458,7 @@ void GetGammaMulti6Tap(int *sdmas, int *sdsla, long N, int *vgmm, long Tau)
 		sts=0.0, stt=0.0,
 		ttt=0.0;
 	long dimn=6,di,smpl;
-	double *ioa,*ob,*ic;
-	ioa=new double [dimn*dimn];
-	ob=new double [dimn];
-	ic=new double [dimn];
+	double ioa[6*6],ob[6],ic[6];
 	long ss, se;
 	if(Tau>0) {ss=1; se=N-1-Tau;}
 	else {ss=-Tau+1; se=N-1;} 
@@ -1580,9 +1561,6 @@ void GetGammaMulti6Tap(int *sdmas, int *sdsla, long N, int *vgmm, long Tau)
 		else vgmm[di]=(short) ( gmm * (-10) + 1.5 )+15;
 	}
 
-	delete [] ioa;
-	delete [] ob;
-	delete [] ic;
 }
 
 // End of mcc.cpp
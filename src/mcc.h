@@ -44,6 +44,7 @@ contents : Header file for mcc.cpp
 #ifndef	MCC_INCLUDED
 #define	MCC_INCLUDED
 #include "bitio.h"
+#include "scratch.h"
 
 #define MAXODR 1023
 #define MAXCHAN 65536
@@ -83,9 +84,9 @@ public:
 //////////////////////////////////////////////////////////////////////
 class	CLtp {
 public:
-	CLtp( void ) : m_pBuffer( NULL ) {}
+	CLtp( void ) : m_pBuffer( NULL ), m_pScratch( NULL ) {}
 	~CLtp( void ) { Free(); }
-	void	Allocate( long Chan, long N );
+	void	Allocate( long Chan, long N, CAlsScratch* pScratch );
 	void	Free( void );
 	void	Encode( long Channel, int* d, unsigned char* bytebuf, long N, long Freq, CBitIO* out );
 	void	Decode( long Channel, long N, long Freq, CBitIO* in );
@@ -101,6 +102,7 @@ protected:
 	static	unsigned int	GetBit( BITIO* p );
 public:
 	CLtpBuffer*	m_pBuffer;
+	CAlsScratch*	m_pScratch;		// Work buffers of the pitch detector
 	static	const short	m_QcfTable[16];
 };
 
@@ -137,6 +139,7 @@ typedef	struct _MCC_ENC_BUFFER {
 	int**			m_mtgmm;
 	int*			m_vgmm;
 	long			m_MaxTau;
+	CAlsScratch*	m_pScratch;		// Work buffers of the MCC functions
 } MCC_ENC_BUFFER;
 
 typedef	struct _MCC_DEC_BUFFER {
@@ -159,6 +162,7 @@ typedef	struct _MCC_DEC_BUFFER {
 	int***		m_cubgmm;
 	int**		m_mtgmm;
 	int*		m_vgmm;
+	CAlsScratch*	m_pScratch;	// Work buffers of the MCC functions
 } MCC_DEC_BUFFER;
 
 typedef struct _CHANDISTMAT {
@@ -181,12 +185,12 @@ typedef struct _RXY {
 } RXY;
 
 // Encoding functions
-void	AllocateMccEncBuffer( MCC_ENC_BUFFER* pBuffer, long Chan, long N, short Res , long MaxTau);
+void	AllocateMccEncBuffer( MCC_ENC_BUFFER* pBuffer, long Chan, long N, short Res , long MaxTau, CAlsScratch* pScratch );
 void	FreeMccEncBuffer( MCC_ENC_BUFFER* pBuffer );
 void	InitMccEncBuffer( MCC_ENC_BUFFER* pBuffer );
 
 // Decoding functions
-void	AllocateMccDecBuffer( MCC_DEC_BUFFER* pBuffer, long Chan, long N );
+void	AllocateMccDecBuffer( MCC_DEC_BUFFER* pBuffer, long Chan, long N, CAlsScratch* pScratch );
 void	FreeMccDecBuffer( MCC_DEC_BUFFER* pBuffer );
 void	InitMccDecBuffer( MCC_DEC_BUFFER* pBuffer );
 
@@ -197,8 +201,8 @@ void	Cholesky( double* a, double* b, const double* c, int n );
 // MCC-extension functions
 void	SubtractResidualTD( MCC_ENC_BUFFER* pBuffer, long Chan, long N , short MccMode);
 void	ReconstructResidualTD( MCC_DEC_BUFFER* pBuffer, long Chan, long N );
-long	GetTimeDiff(int *sdmas, int *sdsla, long N, long MaxTau);
-long	GetTimeDiff0(int *sdmas, int *sdsla, long N, long MaxTau);
+long	GetTimeDiff(int *sdmas, int *sdsla, long N, long MaxTau, CAlsScratch& Scratch);
+long	GetTimeDiff0(int *sdmas, int *sdsla, long N, long MaxTau, CAlsScratch& Scratch);
 void	CheckFrameDistanceTD( MCC_ENC_BUFFER* pBuffer, long Chan, long N, long MCC );
 void	GetGammaMulti3Tap(int *sdmas, int *sdsla, long N, int *vgmm, long Tau);
 void	GetGammaMulti6Tap(int *sdmas, int *sdsla, long N, int *vgmm, long Tau);
@@ -53,8 +53,30 @@ contents : Masked-LZ support
  ************************************************************************/
 
 #include <stdio.h>
+#include <string.h>
 #include "mlz.h"
 
+#define HASH_TABLE_ALIGN	64		// cache line size
+#define HASH_JOURNAL_SIZE	( DIC_INDEX_MAX * WORD_SIZE )
+
+#if defined(__GNUC__)
+#define PREFETCH(p)			__builtin_prefetch( (p) )
+#else
+#define PREFETCH(p)
+#endif
+
+// Aligns a hash table buffer to the cache line
+static HASH_BUCKET* AlignHashTable( unsigned char *pBuff )
+{
+	return reinterpret_cast<HASH_BUCKET*>( ( reinterpret_cast<size_t>( pBuff ) + HASH_TABLE_ALIGN - 1 ) & ~( (size_t)HASH_TABLE_ALIGN - 1 ) );
+}
+
+// Mask of the upper mask_size bits of a char
+static inline int GetCharMask( int mask_size )
+{
+	return ( ( 0x01 << mask_size ) - 0x01 ) << ( WORD_SIZE - mask_size );
+}
+
 
 //////////////////////////////////////////////////////////////////////
 //                                                                  //
@@ -92,15 +114,19 @@ CMLZ::~CMLZ()
 void CMLZ::allocDict(
  void
 ){
-	int i;
-	pDict		= new DICT [ TABLE_SIZE ];
-	ppHashTable = new int * [ TABLE_SIZE ];
-	for ( i = 0; i < TABLE_SIZE; i++ ) ppHashTable[i] = new int [ WORD_SIZE ];
+	pDict			= new DICT [ TABLE_SIZE ];
+	pHashTableBuff	= new unsigned char [ TABLE_SIZE * sizeof(HASH_BUCKET) + HASH_TABLE_ALIGN ];
+	pHashTable		= AlignHashTable( pHashTableBuff );
+	m_HashUsed		= true;
 	
 	//for encoder
-	b_pDict		  = new DICT [ TABLE_SIZE ];
-	b_ppHashTable = new int * [ TABLE_SIZE ];
-	for ( i = 0; i < TABLE_SIZE; i++ ) b_ppHashTable[i] = new int [ WORD_SIZE ];
+	b_pDict			 = new DICT [ TABLE_SIZE ];
+	b_pHashTableBuff = new unsigned char [ TABLE_SIZE * sizeof(HASH_BUCKET) + HASH_TABLE_ALIGN ];
+	b_pHashTable	 = AlignHashTable( b_pHashTableBuff );
+	b_pJournal		 = new int [ HASH_JOURNAL_SIZE ];
+	b_JournalLen	 = 0;
+	b_Journaling	 = false;
+	b_FullBackup	 = false;
 }
 
 ////////////////////////////////////////
@@ -111,25 +137,28 @@ void CMLZ::allocDict(
 void CMLZ::FreeDict(
  void
 ) {
-	int i;
 	if ( pDict != NULL ) {
 		delete [] pDict;
 		pDict = NULL;
 	}
-	if ( ppHashTable != NULL ) {
-		for ( i = 0; i < TABLE_SIZE; i++ ) delete [] ppHashTable[i];
-		delete [] ppHashTable;
-		ppHashTable = NULL;
+	if ( pHashTableBuff != NULL ) {
+		delete [] pHashTableBuff;
+		pHashTableBuff = NULL;
+		pHashTable = NULL;
 	}
 
 	if ( b_pDict != NULL ) {
 		delete [] b_pDict;
 		b_pDict = NULL;
 	}
-	if ( b_ppHashTable != NULL ) {
-		for ( i = 0; i < TABLE_SIZE; i++ ) delete [] b_ppHashTable[i];
-		delete [] b_ppHashTable;
-		b_ppHashTable = NULL;
+	if ( b_pHashTableBuff != NULL ) {
+		delete [] b_pHashTableBuff;
+		b_pHashTableBuff = NULL;
+		b_pHashTable = NULL;
+	}
+	if ( b_pJournal != NULL ) {
+		delete [] b_pJournal;
+		b_pJournal = NULL;
 	}
 }
 
@@ -138,19 +167,13 @@ void CMLZ::FreeDict(
 //          Backup dictionary         //
 //                                    //
 ////////////////////////////////////////
+// Entries added from now on are journaled, so no copy is needed here.
 void CMLZ::BackupDict(
  void
  ) {
-	int i, j;
-	for ( i = 0; i < TABLE_SIZE; i++ ) {
-		b_pDict[i].stringCode = pDict[i].stringCode;
-		b_pDict[i].charCode   = pDict[i].charCode;
-		b_pDict[i].matchLen   = pDict[i].matchLen;
-		b_pDict[i].parentCode = pDict[i].parentCode;
-		for ( j = 0; j < WORD_SIZE; j++ ) {
-			b_ppHashTable[i][j] = ppHashTable[i][j];
-		}
-	}
+	b_JournalLen         = 0;
+	b_Journaling         = true;
+	b_FullBackup         = false;
 	b_CurrentDicIndexMax = m_CurrentDicIndexMax;
 	b_DicCodeBit         = m_DicCodeBit;
 	b_BumpCode           = m_BumpCode;
@@ -166,21 +189,41 @@ void CMLZ::BackupDict(
 void CMLZ::ResumeDict(
  void
  ) {
-	int i, j;
-	for ( i = 0; i < TABLE_SIZE; i++ ) {
-		pDict[i].stringCode = b_pDict[i].stringCode;
-		pDict[i].charCode   = b_pDict[i].charCode;
-		pDict[i].matchLen   = b_pDict[i].matchLen;
-		pDict[i].parentCode = b_pDict[i].parentCode;
-		for ( j = 0; j < WORD_SIZE; j++ ) {
-			ppHashTable[i][j] = b_ppHashTable[i][j];
-		}
+	if ( b_FullBackup ) {
+		memcpy( pDict, b_pDict, TABLE_SIZE * sizeof(DICT) );
+		memcpy( pHashTable, b_pHashTable, TABLE_SIZE * sizeof(HASH_BUCKET) );
+		m_HashUsed = true;
+	} else if ( b_Journaling ) {
+		undoJournal();
 	}
 	m_CurrentDicIndexMax = b_CurrentDicIndexMax;
 	m_DicCodeBit         = b_DicCodeBit;
 	m_BumpCode           = b_BumpCode;
 	m_NextCode           = b_NextCode;
 	m_FreezeFlag         = b_FreezeFlag;
+
+	// Now equal to the backup again
+	b_JournalLen         = 0;
+	b_Journaling         = true;
+	b_FullBackup         = false;
+}
+
+////////////////////////////////////////
+//                                    //
+//            Undo journal            //
+//                                    //
+////////////////////////////////////////
+// Removes the entries added after BackupDict().
+void CMLZ::undoJournal(
+ void
+ ) {
+	int i;
+	// Journaled slots were vacant before
+	for ( i = b_JournalLen - 1; i >= 0; i-- )
+		pHashTable[ b_pJournal[i] / WORD_SIZE ].stringCode[ b_pJournal[i] % WORD_SIZE ] = CODE_UNSET;
+	for ( i = b_NextCode; i < m_NextCode; i++ )
+		pDict[i] = b_pDict[i];
+	b_JournalLen = 0;
 }
 
 ////////////////////////////////////////
@@ -207,13 +250,38 @@ void CMLZ::initDict(		// set const
 void CMLZ::FlushDict(
  void
 ){
-	int i, j;
+	int i;
+	DICT *pTmpDict;
+	HASH_BUCKET *pTmpHashTable;
+	unsigned char *pTmpHashTableBuff;
+
+	// The journal cannot undo a flush. Turn the current tables back into
+	// the backup and swap them with the backup tables, which are cleared.
+	if ( b_Journaling ) {
+		undoJournal();
+		pTmpDict          = pDict;
+		pDict             = b_pDict;
+		b_pDict           = pTmpDict;
+		pTmpHashTable     = pHashTable;
+		pHashTable        = b_pHashTable;
+		b_pHashTable      = pTmpHashTable;
+		pTmpHashTableBuff = pHashTableBuff;
+		pHashTableBuff    = b_pHashTableBuff;
+		b_pHashTableBuff  = pTmpHashTableBuff;
+		m_HashUsed = true;
+		b_Journaling = false;
+		b_FullBackup = true;
+	}
+
 	for ( i = 0; i < TABLE_SIZE; i++ ) {
 		pDict[i].stringCode = CODE_UNSET;
 		pDict[i].parentCode = CODE_UNSET;
 		pDict[i].matchLen = 0;
-		for ( j=0; j < WORD_SIZE; j++ )
-			ppHashTable[i][j] = CODE_UNSET;
+	}
+	// The decoder never uses the hash table.
+	if ( m_HashUsed ) {
+		memset( pHashTable, 0xff, TABLE_SIZE * sizeof(HASH_BUCKET) );	// CODE_UNSET
+		m_HashUsed = false;
 	}
 	//// read first part
 	// initial DicCodes
@@ -300,6 +368,7 @@ unsigned long CMLZ::Encode(		//ret: encoded size (bits)
 				m_NextCode++;
 	
 				position += matchLen;
+				prefetchBucket( charCode, position + 1 );
 				lastStringCode = charCode;
 				lastMatchLen = matchLen;
 				// check index code
@@ -341,13 +410,12 @@ int CMLZ::getVacantHashIndex( // return vacant hash_index
 	int hash_index;
 	int offset;
 
-	hash_index = 0;
-	hash_index = ( charCode << ( CODE_BIT_MAX - WORD_SIZE ) ) ^ parentCode;  // here, charCode == charCode & mask
+	hash_index = getHashBucket( parentCode, charCode );  // here, charCode == charCode & mask
 	if ( hash_index == 0 )
 		offset = 1;
 	else
 		offset = TABLE_SIZE - hash_index;
-	while ( ppHashTable[ hash_index ][ mask_size % WORD_SIZE ] != CODE_UNSET )
+	while ( pHashTable[ hash_index ].stringCode[ mask_size % WORD_SIZE ] != CODE_UNSET )
 	{
 		hash_index -= offset;
 		if ( hash_index < 0 )
@@ -368,34 +436,27 @@ void CMLZ::setNewEntryToDictWithHash(
   int charCode,
   int matchLen
 ){
-	unsigned int mask;
 	int hash_index;
+	int key;
 	int i;
 	
 	// add stringCode to pDict
+	if ( b_Journaling ) b_pDict[ stringCode ] = pDict[ stringCode ];
 	pDict[ stringCode ].stringCode = stringCode;
 	pDict[ stringCode ].parentCode = parentCode;
 	pDict[ stringCode ].charCode   = charCode;
 	pDict[ stringCode ].matchLen   = matchLen;
 
-	// Update m_ppHashTable
-	// add stringCode to m_ppHashTable[][]
-	hash_index = getVacantHashIndex( parentCode, charCode, 0 );
-//	if ( ppHashTable[hash_index][0] != CODE_UNSET )
-//		fprintf(stderr, "Err in setNerEntryToDict: stringCode != CODE_UNSET %d\n", ppHashTable[hash_index][0] );
-//	else
-		ppHashTable[hash_index][0] = stringCode;
-
-	for ( i = 1; i < WORD_SIZE; i++ ) {
-		mask = ( 0x01 << i ) - 1;
-		mask <<= ( WORD_SIZE - i );
-		hash_index = getVacantHashIndex( parentCode, (charCode & mask), i );
-
-//		if ( ppHashTable[hash_index][i] != CODE_UNSET )
-//			fprintf(stderr, "Err in setNerEntryToDict: stringCode != CODE_UNSET %d\n", ppHashTable[hash_index][i] );
-//		else
-			ppHashTable[hash_index][i] = stringCode;
+	// Update pHashTable
+	// add stringCode to the slot of each mask size (0 stands for WORD_SIZE)
+	key = ( parentCode << WORD_SIZE ) | charCode;
+	for ( i = 0; i < WORD_SIZE; i++ ) {
+		hash_index = getVacantHashIndex( parentCode, ( i == 0 ) ? charCode : ( charCode & GetCharMask( i ) ), i );
+		pHashTable[hash_index].stringCode[i] = stringCode;
+		pHashTable[hash_index].key[i] = key;
+		if ( b_Journaling ) b_pJournal[ b_JournalLen++ ] = hash_index * WORD_SIZE + i;
 	}
+	m_HashUsed = true;
 }
 
 ////////////////////////////////////////
@@ -412,33 +473,27 @@ int CMLZ::getHashIndex( // return num candidates of hash_index matched with code
   int *pCandidates,	// out: list of stringCodes
   int  numIndexMax		// in: maxnum of candidates
 ){
-	int mask;
+	int mask, slot, key, keyMask, code;
 	int  num_candidates, hash_index, offset;
-	bool dflag;	
 
-	mask = ( 0x01 << mask_size ) - 0x01;
-	mask <<= ( WORD_SIZE - mask_size );
+	mask = GetCharMask( mask_size );
+	slot = mask_size % WORD_SIZE;
+
+	// pDict[code].parentCode == parentCode && ( pDict[code].charCode & mask ) == charCode
+	key = ( parentCode << WORD_SIZE ) | charCode;
+	keyMask = ~WORD_MASK | mask;
 
 	num_candidates = 0;
-	hash_index = 0;
-	hash_index = ( ( charCode & mask ) << ( CODE_BIT_MAX - WORD_SIZE ) ) ^ parentCode;  // here, charCode == charCode & mask
+	hash_index = getHashBucket( parentCode, charCode & mask );
 	if ( hash_index == 0 )
 		offset = 1;
 	else
 		offset = TABLE_SIZE - hash_index;
 
-	while ( ppHashTable[ hash_index ][ mask_size % WORD_SIZE ] != CODE_UNSET )
+	while ( ( code = pHashTable[ hash_index ].stringCode[ slot ] ) != CODE_UNSET )
 	{
-		dflag = true;
-		if ( pDict[ ppHashTable[ hash_index ][ mask_size % WORD_SIZE ] ].parentCode != parentCode ) {
-			dflag = false;
-		}
-		if ( charCode != ( pDict[ ppHashTable[ hash_index ][ mask_size % WORD_SIZE ] ].charCode & mask ) ) {	// needs to be compared with mask????
-			dflag = false;
-		}
-		if ( dflag == true ) {
-			pCandidates[ num_candidates++ ] = ppHashTable[ hash_index ][ mask_size % WORD_SIZE ]; //stringCode
-			//return num_candidates;
+		if ( ( pHashTable[ hash_index ].key[ slot ] & keyMask ) == key ) {
+			pCandidates[ num_candidates++ ] = code; //stringCode
 			if ( num_candidates >= numIndexMax ) {
 				return num_candidates;
 			}
@@ -450,6 +505,20 @@ int CMLZ::getHashIndex( // return num candidates of hash_index matched with code
 	return num_candidates;
 }
 
+////////////////////////////////////////
+//                                    //
+//          Prefetch Bucket           //
+//                                    //
+////////////////////////////////////////
+// Prefetches the first bucket getHashIndex() will probe.
+void CMLZ::prefetchBucket(
+  int parentCode,
+  unsigned long position
+){
+	if ( position < m_SizeofInputBuff )
+		PREFETCH( &pHashTable[ getHashBucket( parentCode, m_pInputBuff[position] & GetCharMask( m_pInputMask[position] ) ) ] );
+}
+
 ////////////////////////////////////////
 //                                    //
 //           Get Root Index           //
@@ -521,6 +590,7 @@ int CMLZ::searchDict(		// return: length of matched string indicated by the inde
 			return matchLen; 
 		} else {
 			if ( position + 2 < m_SizeofInputBuff ) {
+				for ( i = 0; i < num_candidates; i++ ) prefetchBucket( hashCandidates[i], position + 2 );
 				for ( i = 0; i < num_candidates; i++ ) {
 					retMatchLen = searchDict( hashCandidates[i], &retStringCode, position + 1 );
 					if ( retMatchLen > matchLen ) {
@@ -69,6 +69,12 @@ typedef struct dicionary {
     int  matchLen;
 } DICT;
 
+// One hash bucket holds the slots of all mask sizes and fits in one cache line.
+typedef struct hashBucket {
+	int  stringCode[WORD_SIZE];	// string code for each mask size (CODE_UNSET = vacant)
+	int  key[WORD_SIZE];		// ( parentCode << WORD_SIZE ) | charCode of stringCode
+} HASH_BUCKET;
+
 class CMLZ
 {
 public:
@@ -94,13 +100,19 @@ private:
 	//for decoder
     void setNewEntryToDict( int stringCode, int parentCode, int charCode );
 	long decodeString(unsigned char *pStack, int stringCode, int *firstCharCode, unsigned long bufsize);
+	int  getHashBucket( int parentCode, int charCode ) {
+		return ( charCode << ( CODE_BIT_MAX - WORD_SIZE ) ) ^ parentCode; };
+	void prefetchBucket( int parentCode, unsigned long position );
+	void undoJournal( void );
 	int  getMatchLenOfStringCode(int stringCode) {
 		if(stringCode<FIRST_CODE)return WORD_SIZE; else return(pDict[stringCode].matchLen);};
 
 	void initInputCode(CBitIO *p_bit_io);
 	int  inputCode( int *stringCode, int len );
 	DICT *pDict;
-	int **ppHashTable;
+	HASH_BUCKET *pHashTable;
+	unsigned char *pHashTableBuff;
+	bool  m_HashUsed;	// true if pHashTable may have entries
 	CBitIO        *pBitIO;	// Bit I/O stream object
 	
 	// buffer information
@@ -119,8 +131,17 @@ private:
 	int              m_FreezeFlag;
 
 	// dictionary backup area for the encoder
+	// While backed up, new entries are journaled so that ResumeDict() only
+	// has to undo them. b_pDict holds the old entries from b_NextCode.
+	// If the dictionary is flushed meanwhile, b_pDict and b_pHashTable
+	// take over the backed up tables.
 	DICT *			 b_pDict;
-	int **			 b_ppHashTable;
+	HASH_BUCKET *	 b_pHashTable;
+	unsigned char *	 b_pHashTableBuff;
+	int *			 b_pJournal;		// indexes of hash slots set while backed up
+	int				 b_JournalLen;
+	bool			 b_Journaling;
+	bool			 b_FullBackup;
 	int  			 b_DicCodeBit;
 	int				 b_CurrentDicIndexMax;
 	unsigned int	 b_BumpCode;
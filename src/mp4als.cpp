@@ -213,15 +213,17 @@ contents : Main file for MPEG-4 Audio Lossless Coding framework
 
 #if defined( _MSC_VER )
 #define	PRINTF_LL	"%I64d"
+#define	STRTOLL		_strtoi64
 #else
 #define	PRINTF_LL	"%lld"
+#define	STRTOLL		strtoll
 #endif
 
 #define CODEC_STR "mp4alsRM23"
-#define	ALS_TMP_FILENAME	CODEC_STR ".$$$"
 
 void ShowUsage(void);
 void ShowHelp(void);
+ALS_INT64 GetOptionValue64(short argc, char **argv, const char *opt, ALS_INT64 default_value);
 
 int main(int argc, char **argv)
 {
@@ -245,6 +247,8 @@ int main(int argc, char **argv)
 	mp4info.m_FileType = 0;
 	mp4info.m_RMflag = false;
 	mp4info.m_UseMeta = false;
+	mp4info.m_FastStart = false;
+	mp4info.m_FragmentRaus = 0;
 	mp4info.m_audioProfileLevelIndication = MP4_AUDIO_PROFILE_UNSPECIFIED;
 
 	// Check parameters ///////////////////////////////////////////////////////////////////////////
@@ -303,6 +307,18 @@ int main(int argc, char **argv)
 	mp4file = ( CheckOption( argc, argv, "-MP4" ) != 0 );
 	oafi_flag = ( CheckOption( argc, argv, "-OAFI" ) != 0 );
 
+	// File I/O buffering
+	{
+		bool	direct_io = ( CheckOption( argc, argv, "-D" ) != 0 );
+		long	io_buffer = GetOptionValue( argc, argv, "-B", direct_io ? 4 : 0 );	// in MB
+		if ( ( io_buffer < 0 ) || ( io_buffer > 1024 ) )
+		{
+			fprintf( stderr, "\nERROR: Invalid I/O buffer size (-B%ld)!\n", io_buffer );
+			return(3);
+		}
+		SetFileBuffering( static_cast<ALS_UINT32>( io_buffer ) << 20, direct_io );
+	}
+
 	if (info)
 	{
 		//decode = 1;
@@ -565,7 +581,7 @@ int main(int argc, char **argv)
 			if ( GetOptionValue( argc, argv, "-u" ) == 2 ) { fprintf( stderr, "\n-u2 option is not available for MP4 file format.\n" ); exit( 3 ); }
 
 			// Build up MP4INFO structure.
-			mp4info.m_pInFile = ALS_TMP_FILENAME;
+			mp4info.m_pInFile = NULL;		// Not used.
 			mp4info.m_pOutFile = outfile;
 			mp4info.m_pOriginalFile = infile;
 			mp4info.m_Samples = ainfo.Samples;
@@ -579,11 +595,16 @@ int main(int argc, char **argv)
 			mp4info.m_StripRaInfo = true;	// true:Strip RA info / false:Do not strip RA info
 			mp4info.m_RaLocation = 0;		// RAU size location: 0=frames, 1=header, 2=none
 			mp4info.m_UseMeta = oafi_flag;
-			outfile = (char*)ALS_TMP_FILENAME;
+			mp4info.m_FastStart = ( CheckOption( argc, argv, "-FS" ) != 0 );
+			mp4info.m_FragmentRaus = GetOptionValue( argc, argv, "-FR" );
 		}
 
 		// Open Output File
-		if (result = encoder.OpenOutputFile(outfile, mp4file, oafi_flag ))
+		// * In MP4 mode, RAUs are passed to the MP4 muxer as they are encoded.
+		CMp4aMuxer	muxer( mp4info );
+		if ( mp4file ) result = encoder.SetOutputSink( &muxer, oafi_flag );
+		else result = encoder.OpenOutputFile(outfile, mp4file, oafi_flag );
+		if (result)
 		{
 			fprintf(stderr, "\nUnable to open file %s for writing!\n", outfile);
 			exit(1);
@@ -599,6 +620,24 @@ int main(int argc, char **argv)
 			fflush(stdout);
 		}
 
+		// Per-stage timing and counters
+		if ( CheckOption( argc, argv, "--stats" ) && !encoder.EnableStats( true ) )
+		{
+			fprintf( stderr, "\n--stats option is not available in this build.\n" );
+			exit( 3 );
+		}
+
+		// Per-block decision trace
+		const char *tracefile = GetOptionString( argc, argv, "--trace=" );
+		FILE *fpTrace = NULL;
+		if ( ( tracefile != NULL ) && ( ( fpTrace = fopen( tracefile, "w" ) ) == NULL ) )
+		{
+			fprintf( stderr, "\nUnable to open file %s for writing!\n", tracefile );
+			exit( 1 );
+		}
+		CAlsTraceJsonSink TraceSink( fpTrace );
+		if ( fpTrace ) encoder.SetTrace( &TraceSink );
+
 		// Encoding ///////////////////////////////////////////////////////////////////////////////
 		if (!verbose)
 		{
@@ -656,21 +695,18 @@ int main(int argc, char **argv)
 					mp4info.m_audioProfileLevelIndication = MP4_AUDIO_PROFILE_ALS_SP_L1;
 			}
 
-			A2MERR	A2mErr = AlsToMp4( mp4info );
+			A2MERR	A2mErr = muxer.Close();
 			if ( A2mErr != A2MERR_NONE ) {
 				fprintf( stderr, "\nERROR: Unable to convert ALS to MP4: %s\n", ToErrorString( A2mErr ) );
 				encoder.CloseFiles();
-				remove( ALS_TMP_FILENAME );
 				exit( 1 );
 			}
-			outfile = const_cast<char*>( mp4info.m_pOutFile );
 		}
 
 		// End of encoding ////////////////////////////////////////////////////////////////////////
 
 		if ( result < 0 ) {
 			encoder.CloseFiles();
-			if ( mp4file ) remove( ALS_TMP_FILENAME );
 			switch( result ) {
 			case -1:
 				fprintf(stderr, "\nERROR: %s is not a supported sound file!\n", infile);
@@ -737,6 +773,10 @@ int main(int argc, char **argv)
 			fflush(stdout);
 		}
 
+		// Stage statistics go to stderr, so that they do not mix with the ALS data written to stdout.
+		if ( encoder.GetStats().IsEnabled() ) encoder.GetStats().WriteJson( stderr );
+		if ( fpTrace ) fclose( fpTrace );
+
 		// Check for accurate decoding
 		if (CheckOption(argc, argv, "-c"))
 		{
@@ -790,8 +830,15 @@ int main(int argc, char **argv)
 	// Decoder mode ///////////////////////////////////////////////////////////////////////////////
 	else
 	{
+		CMp4aAlsStream AlsStream;
+		HALSSTREAM hAlsStream = NULL;
 		CLpacDecoder decoder;
 		ALS_PROFILES IndicatedProfiles;
+		ALS_INT64 range_start = GetOptionValue64(argc, argv, "-xs", -1);	// first sample of partial decoding
+		ALS_INT64 range_count = GetOptionValue64(argc, argv, "-xn", -1);	// number of samples of partial decoding
+		bool range = (range_start >= 0) || (range_count > 0);
+		bool dump = ( CheckOption( argc, argv, "--dump" ) != 0 );	// trace only, no PCM output
+		char idxfile[260];
 
 		ALSProfEmptySet( IndicatedProfiles );
 
@@ -854,16 +901,15 @@ int main(int argc, char **argv)
 
 			// Build up MP4INFO structure.
 			mp4info.m_pInFile = infile;
-			mp4info.m_pOutFile = ALS_TMP_FILENAME;
+			mp4info.m_pOutFile = NULL;		// Not used.
 			mp4info.m_RMflag = true;
 			mp4info.m_StripRaInfo = true;	// true:Strip RA info / false:Do not strip RA info
 			mp4info.m_RaLocation = 0;		// RAU size location: 0=frames, 1=header, 2=none
 
-			// Convert MP4 to ALS.
-			A2MERR	A2mErr = Mp4ToAls( mp4info );
+			// Present MP4 as an ALS stream.
+			A2MERR	A2mErr = AlsStream.Open( mp4info );
 			if ( A2mErr != A2MERR_NONE ) {
 				fprintf( stderr, "\nERROR: Unable to convert MP4 to ALS: %s\n", ToErrorString( A2mErr ) );
-				remove( ALS_TMP_FILENAME );
 				exit( 1 );
 			}
 			switch ( mp4info.m_audioProfileLevelIndication ) {
@@ -873,19 +919,19 @@ int main(int argc, char **argv)
 		}
 
 		// Open Input File
-		if (result = decoder.OpenInputFile(mp4file ? mp4info.m_pOutFile : infile, mp4file))
+		if ( mp4file ) result = ( OpenStream( &AlsStream, &hAlsStream, true ) == 0 ) ? decoder.SetInputStream( hAlsStream, mp4file ) : 1;
+		else result = decoder.OpenInputFile( input ? "-" : infile, mp4file );
+		if (result)
 		{
-			fprintf(stderr, "\nUnable to open file %s for reading!\n", mp4file ? mp4info.m_pOutFile : infile);
-			if ( mp4file ) remove( ALS_TMP_FILENAME );
+			fprintf(stderr, "\nUnable to open file %s for reading!\n", infile);
 			exit(3);
 		}
 
 		// Analyse Input File
 		if (result = decoder.AnalyseInputFile(&ainfo, &encinfo, mp4info))
 		{
-			fprintf(stderr, "\nERROR: %s is not a valid ALS file!\n", mp4file ? mp4info.m_pOutFile : infile);
+			fprintf(stderr, "\nERROR: %s is not a valid ALS file!\n", infile);
 			decoder.CloseFiles();
-			if ( mp4file ) remove( ALS_TMP_FILENAME );
 			exit(2);
 		}
 
@@ -959,7 +1005,6 @@ int main(int argc, char **argv)
 
 			if (info) {
 				decoder.CloseFiles();
-				if ( mp4file ) remove( ALS_TMP_FILENAME );
 				exit(0);
 			}
 		}
@@ -968,22 +1013,87 @@ int main(int argc, char **argv)
 		{
 			// Append original file extension (if known)
 			static const char* KnownExt[5] = { "wav", "aif", "bwf", "w64", "bwf" };
-			if ( ( ainfo.FileType >= 1 ) && ( ainfo.FileType <= 5 ) ) strcpy( tmp2+1, KnownExt[ ainfo.FileType-1 ] );
+			if ( dump ) strcpy( tmp2+1, "jsonl" );
+			else if ( range ) strcpy( tmp2+1, "raw" );
+			else if ( ( ainfo.FileType >= 1 ) && ( ainfo.FileType <= 5 ) ) strcpy( tmp2+1, KnownExt[ ainfo.FileType-1 ] );
 			else strcpy( tmp2+1, "raw" );
 			outfile = tmp;
 		}
 
 		// Open Output File
-		if (result = decoder.OpenOutputFile(outfile))
+		if (!dump && (result = decoder.OpenOutputFile(outfile)))
 		{
 			fprintf(stderr, "\nUnable to open file %s for writing!\n", outfile);
 			decoder.CloseFiles();
-			if ( mp4file ) remove( ALS_TMP_FILENAME );
 			exit(1);
 		}
 
+		// Per-block decision trace (written to the output file with --dump)
+		const char *tracefile = dump ? outfile : GetOptionString( argc, argv, "--trace=" );
+		FILE *fpTrace = NULL;
+		if ( tracefile != NULL )
+		{
+			fpTrace = strcmp( tracefile, " " ) ? fopen( tracefile, "w" ) : stdout;
+			if ( fpTrace == NULL )
+			{
+				fprintf( stderr, "\nUnable to open file %s for writing!\n", tracefile );
+				decoder.CloseFiles();
+				exit( 1 );
+			}
+		}
+		CAlsTraceJsonSink TraceSink( fpTrace );
+		if ( fpTrace ) decoder.SetTrace( &TraceSink );
+
 		// Decoding ///////////////////////////////////////////////////////////////////////////////
-		if (!verbose)
+		if (dump)
+		{
+			// Decode all frames for the trace only (no PCM output and CRC check)
+			if (decoder.WriteHeader( mp4info, false ) < 1)
+				crc = -1;
+			else
+			{
+				float *pcm = new float[decoder.GetFrameLength() * ainfo.Chan];
+				long count;
+				ALS_INT64 pos;
+				short ret;
+
+				while ((ret = decoder.DecodeNextFrame(pcm, PCM_FLOAT32, &count, &pos)) > 0);
+				if (ret < 0)
+					crc = ferror(fpTrace) ? -2 : -1;
+				delete[] pcm;
+			}
+		}
+		else if (range)
+		{
+			// Partial decoding into raw PCM (no header, trailer and CRC check)
+			if (range_start < 0)
+				range_start = 0;
+			if (!mp4file && CheckOption(argc, argv, "-xi") && (strlen(infile) + 5 <= sizeof(idxfile)))
+			{
+				// Seek index next to the ALS file, created on first use
+				sprintf(idxfile, "%s.idx", infile);
+				decoder.SetSeekIndex(idxfile, true);
+			}
+			if (decoder.WriteHeader( mp4info, false ) < 1)
+				crc = -1;
+			else
+			{
+				// RAU positions are known from the MP4 frame table
+				if ( mp4file && !AlsStream.GetRauOffsets().empty() ) decoder.SetRauIndex( &AlsStream.GetRauOffsets()[0], static_cast<long>( AlsStream.GetRauOffsets().size() - 1 ) );
+				ALS_INT64 decoded = decoder.DecodeRange( range_start, (range_count > 0) ? range_count : ainfo.Samples - range_start );
+				if (decoded == -1)
+				{
+					fprintf(stderr, "\nERROR: Unable to decode from sample " PRINTF_LL "!\n", range_start);
+					decoder.CloseFiles();
+					exit(2);
+				}
+				else if (decoded < 0)
+					crc = -2;
+				else if (verbose)
+					printf("\n" PRINTF_LL " samples decoded from sample " PRINTF_LL "\n", decoded, range_start);
+			}
+		}
+		else if (!verbose)
 			crc = decoder.DecodeAll( mp4info );
 		else
 		{
@@ -1039,25 +1149,26 @@ int main(int argc, char **argv)
 			}
 		}
 		decoder.CloseFiles();
+		if ( fpTrace && ( fpTrace != stdout ) ) fclose( fpTrace );
+		if ( hAlsStream ) fclose( hAlsStream );
+		AlsStream.Close();
 		// End of decoding ////////////////////////////////////////////////////////////////////////
 
 		// Screen output
 		if (crc == -1)
 		{
 			fprintf(stderr, "\nERROR: %s is not a valid %s file!\n", infile, mp4file ? "MP4" : "ALS");
-			if ( mp4file ) remove( ALS_TMP_FILENAME );
 			exit(2);
 		}
 		else if (crc == -2)
 		{
 			fprintf(stderr, "\nERROR: Unable to write to %s - disk full?\n", outfile);
-			if ( mp4file ) remove( ALS_TMP_FILENAME );
 			exit(1);
 		}
 		else if (verbose)
 		{
 			printf(" done\n");
-			printf("\nCRC status: %s\n", encinfo.CRCenabled ? (crc ? "FAILED!" : "ok") : "n/a");
+			printf("\nCRC status: %s\n", (encinfo.CRCenabled && !dump) ? (crc ? "FAILED!" : "ok") : "n/a");
 
 			printf("\nDeclared Profiles      : %s\n", ALSProfToString(IndicatedProfiles).c_str());
 			printf("Conformant Profiles    : %s\n", ALSProfToString(decoder.GetConformantProfiles()).c_str());
@@ -1073,9 +1184,6 @@ int main(int argc, char **argv)
 			fprintf(stderr, "\nDECODING ERROR: CRC failed for %s\n", infile);
 	}
 
-	// Removing temporary file.
-	if ( mp4file ) remove( ALS_TMP_FILENAME );
-
 	// Delete input file?
 	if (!crc && CheckOption(argc, argv, "-d"))
 		remove(infile);
@@ -1099,6 +1207,24 @@ int main(int argc, char **argv)
 	return(0);
 }
 
+// Search for a 64-bit numeric option (sample positions may exceed the range of long)
+// Returns the value, or default_value if the option is not set
+ALS_INT64 GetOptionValue64(short argc, char **argv, const char *opt, ALS_INT64 default_value)
+{
+	size_t	OptLen = strlen( opt );
+	char	*end;
+
+	for (short i=1; i<argc; ++i) {
+		if (!strncmp(argv[i], opt, OptLen)) {
+			ALS_INT64 val = static_cast<ALS_INT64>( STRTOLL( argv[i] + OptLen, &end, 10 ) );
+			if (end != argv[i] + OptLen)
+				return val;
+			// Ignore if not in "-a#" format
+		}
+	}
+	return(default_value);
+}
+
 // Show usage message
 void ShowUsage()
 {
@@ -1135,7 +1261,16 @@ void ShowHelp()
 	printf("\n  -d  : Delete input file after completion.");
 	printf("\n  -h  : Help (this message)");
 	printf("\n  -v  : Verbose mode (file info, processing time)");
-	printf("\n  -x  : Extract (all options except -v and -MP4 are ignored)");
+	printf("\n  -B# : File I/O buffer size in MB (default: stdio buffering)");
+	printf("\n  -D  : Direct I/O for output files, bypassing the OS cache (-B defaults to 4)");
+	printf("\n  --stats: Print time and counters of the encoder stages as JSON to stderr");
+	printf("\n  --trace=<file>: Write the decisions and sizes of each block as JSON lines");
+	printf("\n          (encoder and decoder)");
+	printf("\n  --dump: Write the trace instead of PCM to the output file (with -x)");
+	printf("\n  -x  : Extract (all options except -v, -xs, -xn, -MP4, --trace and --dump are ignored)");
+	printf("\n  -xs#: Extract raw PCM from sample # on (seeks to the nearest random access unit)");
+	printf("\n  -xn#: Extract raw PCM of # samples (default: up to the end)");
+	printf("\n  -xi : Use seek index file <infile>.idx for -xs (created if missing)");
 	printf("\nEncoding Options:");
 	printf("\n  -7  : Set parameters for optimum compression (except LTP, MCC, RLSLMS)");
 	printf("\n  -a  : Adaptive prediction order");
@@ -1160,6 +1295,8 @@ void ShowHelp()
 	printf("\nMP4 File Format Support:");
 	printf("\n  -MP4: Use MP4 file format for compressed file (default if extension is .mp4)");
 	printf("\n  -OAFI:Force to embed meta box with oafi record");
+	printf("\n  -FS : Fast start (place moov box before mdat box)");
+	printf("\n  -FR#: Fragmented MP4, write a movie fragment every # random access units");
 	printf("\n  -npi: Do not indicate the conformant profiles in the MP4 file");
 	printf("\nAudio file support:");
 	printf("\n  -R  : Raw audio file (use -C, -W, -F and -M to specify format)");
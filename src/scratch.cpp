@@ -0,0 +1,111 @@
+/***************** MPEG-4 Audio Lossless Coding **************************
+
+This software module was originally developed by
+
+NTT (Nippon Telegraph and Telephone Corporation), Japan
+
+in the course of development of the MPEG-4 Audio standard ISO/IEC 14496-3
+and associated amendments. This software module is an implementation of
+a part of one or more MPEG-4 Audio lossless coding tools as specified
+by the MPEG-4 Audio standard. ISO/IEC gives users of the MPEG-4 Audio
+standards free license to this software module or modifications
+thereof for use in hardware or software products claiming conformance
+to the MPEG-4 Audio standards. Those intending to use this software
+module in hardware or software products are advised that this use may
+infringe existing patents. The original developer of this software
+module, the subsequent editors and their companies, and ISO/IEC have
+no liability for use of this software module or modifications thereof
+in an implementation. Copyright is not released for non MPEG-4 Audio
+conforming products. The original developer retains full right to use
+the code for the developer's own purpose, assign or donate the code to
+a third party and to inhibit third party from using the code for non
+MPEG-4 Audio conforming products. This copyright notice must be included
+in all copies or derivative works.
+
+Copyright (c) 2007.
+
+filename : scratch.cpp
+project  : MPEG-4 Audio Lossless Coding
+contents : Scratch memory for the per-frame work buffers
+
+*************************************************************************/
+
+#include	"scratch.h"
+
+// Alignment of the buffers (enough for SSE)
+#define	SCRATCH_ALIGN	16
+
+//////////////////////////////////////////////////////////////////////
+//                                                                  //
+//                         CAlsScratch class                        //
+//                                                                  //
+//////////////////////////////////////////////////////////////////////
+
+////////////////////////////////////////
+//                                    //
+//         Allocate the memory        //
+//                                    //
+////////////////////////////////////////
+// Bytes = Expected peak usage in bytes
+void	CAlsScratch::Allocate( size_t Bytes )
+{
+	// Avoid double allocation
+	Free();
+
+	m_Chunks.reserve( 8 );
+	Alloc( Bytes );
+	m_Used = 0;
+}
+
+////////////////////////////////////////
+//                                    //
+//           Free the memory          //
+//                                    //
+////////////////////////////////////////
+void	CAlsScratch::Free( void )
+{
+	for( size_t i=0; i<m_Chunks.size(); i++ ) delete[] m_Chunks[i].m_pData;
+	m_Chunks.clear();
+	m_Chunk = m_Used = 0;
+}
+
+////////////////////////////////////////
+//                                    //
+//           Take a buffer            //
+//                                    //
+////////////////////////////////////////
+// Bytes = Size of the buffer in bytes
+// Return value = Pointer to the buffer (valid until the arena is rewound before it)
+void*	CAlsScratch::Alloc( size_t Bytes )
+{
+	CHUNK	Chunk;
+	void*	p;
+	size_t	Total, i;
+
+	Bytes = ( Bytes + SCRATCH_ALIGN - 1 ) & ~static_cast<size_t>( SCRATCH_ALIGN - 1 );
+	if ( Bytes == 0 ) Bytes = SCRATCH_ALIGN;
+
+	// Take the buffer from the current chunk, or from the next one if it does not fit.
+	while( m_Chunk < m_Chunks.size() ) {
+		if ( m_Chunks[m_Chunk].m_Size - m_Used >= Bytes ) {
+			p = m_Chunks[m_Chunk].m_pData + m_Used;
+			m_Used += Bytes;
+			return p;
+		}
+		if ( m_Chunk + 1 == m_Chunks.size() ) break;
+		m_Chunk++;
+		m_Used = 0;
+	}
+
+	// Add a chunk. It is at least as large as all others together, so the arena
+	// settles after a few frames even if the expected peak usage was too small.
+	for( Total=0, i=0; i<m_Chunks.size(); i++ ) Total += m_Chunks[i].m_Size;
+	Chunk.m_Size = ( Bytes > Total ) ? Bytes : Total;
+	Chunk.m_pData = new unsigned char [ Chunk.m_Size ];
+	m_Chunks.push_back( Chunk );
+	m_Chunk = m_Chunks.size() - 1;
+	m_Used = Bytes;
+	return Chunk.m_pData;
+}
+
+// End of scratch.cpp
@@ -0,0 +1,100 @@
+/***************** MPEG-4 Audio Lossless Coding **************************
+
+This software module was originally developed by
+
+NTT (Nippon Telegraph and Telephone Corporation), Japan
+
+in the course of development of the MPEG-4 Audio standard ISO/IEC 14496-3
+and associated amendments. This software module is an implementation of
+a part of one or more MPEG-4 Audio lossless coding tools as specified
+by the MPEG-4 Audio standard. ISO/IEC gives users of the MPEG-4 Audio
+standards free license to this software module or modifications
+thereof for use in hardware or software products claiming conformance
+to the MPEG-4 Audio standards. Those intending to use this software
+module in hardware or software products are advised that this use may
+infringe existing patents. The original developer of this software
+module, the subsequent editors and their companies, and ISO/IEC have
+no liability for use of this software module or modifications thereof
+in an implementation. Copyright is not released for non MPEG-4 Audio
+conforming products. The original developer retains full right to use
+the code for the developer's own purpose, assign or donate the code to
+a third party and to inhibit third party from using the code for non
+MPEG-4 Audio conforming products. This copyright notice must be included
+in all copies or derivative works.
+
+Copyright (c) 2007.
+
+filename : scratch.h
+project  : MPEG-4 Audio Lossless Coding
+contents : Scratch memory for the per-frame work buffers
+
+*************************************************************************/
+
+#if !defined( SCRATCH_INCLUDED )
+#define	SCRATCH_INCLUDED
+
+#include	<stddef.h>
+#include	<vector>
+
+//////////////////////////////////////////////////////////////////////
+//                                                                  //
+//                         Type definition                          //
+//                                                                  //
+//////////////////////////////////////////////////////////////////////
+
+// Position in the scratch memory (see CAlsScratch::GetMark())
+struct	ALS_SCRATCHMARK {
+	size_t	m_Chunk;		// Index of the current chunk
+	size_t	m_Used;			// Bytes used in the current chunk
+};
+
+//////////////////////////////////////////////////////////////////////
+//                                                                  //
+//                         CAlsScratch class                        //
+//                                                                  //
+//////////////////////////////////////////////////////////////////////
+// Stack-like arena. Buffers taken by Get() are released all at once by Rewind(),
+// the memory itself is kept until Free(). If the arena runs short, a new chunk is
+// added, so after the first frames no more heap allocations take place.
+class	CAlsScratch {
+public:
+	CAlsScratch( void ) : m_Chunk( 0 ), m_Used( 0 ) {}
+	~CAlsScratch( void ) { Free(); }
+	void	Allocate( size_t Bytes );
+	void	Free( void );
+	void*	Alloc( size_t Bytes );
+	template<typename T> T*	Get( size_t Count ) { return static_cast<T*>( Alloc( Count * sizeof(T) ) ); }
+	ALS_SCRATCHMARK	GetMark( void ) const { ALS_SCRATCHMARK Mark = { m_Chunk, m_Used }; return Mark; }
+	void	Rewind( const ALS_SCRATCHMARK& Mark ) { m_Chunk = Mark.m_Chunk; m_Used = Mark.m_Used; }
+
+protected:
+	struct	CHUNK {
+		unsigned char*	m_pData;	// Memory block
+		size_t			m_Size;		// Size of m_pData in bytes
+	};
+	std::vector<CHUNK>	m_Chunks;	// Memory blocks in allocation order
+	size_t				m_Chunk;	// Index of the current chunk
+	size_t				m_Used;		// Bytes used in the current chunk
+
+private:
+	CAlsScratch( const CAlsScratch& );
+	CAlsScratch&	operator = ( const CAlsScratch& );
+};
+
+// Rewinds the scratch memory at the end of the scope.
+class	CAlsScratchScope {
+public:
+	CAlsScratchScope( CAlsScratch& Scratch ) : m_Scratch( Scratch ), m_Mark( Scratch.GetMark() ) {}
+	~CAlsScratchScope( void ) { m_Scratch.Rewind( m_Mark ); }
+
+private:
+	CAlsScratch&	m_Scratch;	// Scratch memory
+	ALS_SCRATCHMARK	m_Mark;		// Position at the beginning of the scope
+
+	CAlsScratchScope( const CAlsScratchScope& );
+	CAlsScratchScope&	operator = ( const CAlsScratchScope& );
+};
+
+#endif	// SCRATCH_INCLUDED
+
+// End of scratch.h
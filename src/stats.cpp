@@ -0,0 +1,327 @@
+/***************** MPEG-4 Audio Lossless Coding **************************
+
+This software module was originally developed by
+
+NTT (Nippon Telegraph and Telephone Corporation), Japan
+
+in the course of development of the MPEG-4 Audio standard ISO/IEC 14496-3
+and associated amendments. This software module is an implementation of
+a part of one or more MPEG-4 Audio lossless coding tools as specified
+by the MPEG-4 Audio standard. ISO/IEC gives users of the MPEG-4 Audio
+standards free license to this software module or modifications
+thereof for use in hardware or software products claiming conformance
+to the MPEG-4 Audio standards. Those intending to use this software
+module in hardware or software products are advised that this use may
+infringe existing patents. The original developer of this software
+module, the subsequent editors and their companies, and ISO/IEC have
+no liability for use of this software module or modifications thereof
+in an implementation. Copyright is not released for non MPEG-4 Audio
+conforming products. The original developer retains full right to use
+the code for the developer's own purpose, assign or donate the code to
+a third party and to inhibit third party from using the code for non
+MPEG-4 Audio conforming products. This copyright notice must be included
+in all copies or derivative works.
+
+Copyright (c) 2007.
+
+filename : stats.cpp
+project  : MPEG-4 Audio Lossless Coding
+contents : Per-stage timing and counters of the encoder
+
+*************************************************************************/
+
+#include	<stdarg.h>
+#include	<string.h>
+#if defined( _WIN32 )
+#include	<windows.h>
+#else
+#include	<time.h>
+#endif
+#include	"stats.h"
+
+//////////////////////////////////////////////////////////////////////
+//                                                                  //
+//                          CAlsStats class                         //
+//                                                                  //
+//////////////////////////////////////////////////////////////////////
+
+////////////////////////////////////////
+//                                    //
+//            Constructor             //
+//                                    //
+////////////////////////////////////////
+CAlsStats::CAlsStats( void ) : m_Enabled( false ), m_KeepFrames( true )
+{
+	Reset();
+}
+
+////////////////////////////////////////
+//                                    //
+//       Enable/disable measuring     //
+//                                    //
+////////////////////////////////////////
+// Enabled = true:Measure / false:Do not measure
+// KeepFrames = true:Keep per-frame results / false:Totals only
+// Return value = true:Success / false:Instrumentation is not compiled in
+bool	CAlsStats::Enable( bool Enabled, bool KeepFrames )
+{
+#if defined( ALS_NO_STATS )
+	m_Enabled = false;
+	return !Enabled;
+#else
+	m_Enabled = Enabled;
+	m_KeepFrames = KeepFrames;
+	return true;
+#endif
+}
+
+////////////////////////////////////////
+//                                    //
+//          Clear all results         //
+//                                    //
+////////////////////////////////////////
+void	CAlsStats::Reset( void )
+{
+	ClearFrame( m_Frame );
+	ClearFrame( m_Sum );
+	memset( m_Total, 0, sizeof(m_Total) );
+	m_Depth = 0;
+	m_Mark = 0;
+	m_Frames = m_Samples = m_Bytes = 0;
+	m_FrameList.clear();
+}
+
+////////////////////////////////////////
+//                                    //
+//           Start a frame            //
+//                                    //
+////////////////////////////////////////
+void	CAlsStats::BeginFrame( void )
+{
+	if ( !m_Enabled ) return;
+	ClearFrame( m_Frame );
+	m_Depth = 0;
+	m_Mark = GetTicks();
+}
+
+////////////////////////////////////////
+//                                    //
+//            End a frame             //
+//                                    //
+////////////////////////////////////////
+// Index = Frame number (0-)
+// Samples = Samples per channel in the frame
+// Bytes = Coded size of the frame
+void	CAlsStats::EndFrame( ALS_INT64 Index, long Samples, long Bytes )
+{
+	short	i;
+
+	if ( !m_Enabled ) return;
+	m_Frame.m_Self[STAGE_OTHER] += GetTicks() - m_Mark;
+	m_Depth = 0;		// Stages left open by an error are dropped.
+	m_Frame.m_Index = Index;
+	m_Frame.m_Samples = Samples;
+	m_Frame.m_Bytes = Bytes;
+
+	for( i=0; i<STAGE_COUNT; i++ ) m_Sum.m_Self[i] += m_Frame.m_Self[i];
+	for( i=0; i<COUNTER_COUNT; i++ ) m_Sum.m_Counts[i] += m_Frame.m_Counts[i];
+	m_Frames++;
+	m_Samples += Samples;
+	m_Bytes += Bytes;
+	if ( m_KeepFrames ) m_FrameList.push_back( m_Frame );
+}
+
+////////////////////////////////////////
+//                                    //
+//           Enter a stage            //
+//                                    //
+////////////////////////////////////////
+// Stage = Stage (STAGE_*)
+void	CAlsStats::Enter( short Stage )
+{
+	ALS_INT64	Now;
+
+	if ( !m_Enabled ) return;
+	if ( m_Depth >= MAX_DEPTH ) { m_Depth++; return; }
+
+	// The time so far belongs to the enclosing stage.
+	Now = GetTicks();
+	m_Frame.m_Self[( m_Depth > 0 ) ? m_Stage[m_Depth-1] : STAGE_OTHER] += Now - m_Mark;
+	m_Stage[m_Depth] = Stage;
+	m_Start[m_Depth] = Now;
+	m_Depth++;
+	m_Mark = Now;
+}
+
+////////////////////////////////////////
+//                                    //
+//           Leave a stage            //
+//                                    //
+////////////////////////////////////////
+void	CAlsStats::Leave( void )
+{
+	ALS_INT64	Now;
+	short		Stage, i;
+
+	if ( !m_Enabled || ( m_Depth == 0 ) ) return;
+	if ( m_Depth > MAX_DEPTH ) { m_Depth--; return; }
+
+	Now = GetTicks();
+	Stage = m_Stage[--m_Depth];
+	m_Frame.m_Self[Stage] += Now - m_Mark;
+	m_Mark = Now;
+
+	// Count the total time only once if the stage is entered recursively.
+	for( i=0; i<m_Depth; i++ ) if ( m_Stage[i] == Stage ) return;
+	m_Total[Stage] += Now - m_Start[m_Depth];
+}
+
+////////////////////////////////////////
+//                                    //
+//         Get results as JSON        //
+//                                    //
+////////////////////////////////////////
+// Json = Receives the results
+// * Times are in seconds. "total" of "other" equals its "self" time.
+static void	Append( std::string& Json, const char* pFormat, ... )
+{
+	char	Buffer[256];
+	va_list	Args;
+
+	va_start( Args, pFormat );
+	vsprintf( Buffer, pFormat, Args );
+	va_end( Args );
+	Json += Buffer;
+}
+
+void	CAlsStats::GetJson( std::string& Json ) const
+{
+	ALS_INT64	Sum = 0;
+	size_t		f;
+	short		i;
+
+	for( i=0; i<STAGE_COUNT; i++ ) Sum += m_Sum.m_Self[i];
+
+	Json = "{\n";
+	Append( Json, "  \"frames\": %.0f,\n  \"samples\": %.0f,\n  \"bytes\": %.0f,\n", static_cast<double>( m_Frames ), static_cast<double>( m_Samples ), static_cast<double>( m_Bytes ) );
+	Append( Json, "  \"seconds\": %.6f,\n  \"stages\": {", GetSeconds( Sum ) );
+	for( i=0; i<STAGE_COUNT; i++ ) {
+		Append( Json, "%s\n    \"%s\": {\"self\": %.6f, \"total\": %.6f, \"self_percent\": %.2f}", ( i > 0 ) ? "," : "", GetStageName( i ),
+				GetSeconds( m_Sum.m_Self[i] ), GetSeconds( ( i == STAGE_OTHER ) ? m_Sum.m_Self[i] : m_Total[i] ),
+				( Sum > 0 ) ? 100.0 * m_Sum.m_Self[i] / Sum : 0.0 );
+	}
+	Json += "\n  },\n  \"counters\": {";
+	for( i=0; i<COUNTER_COUNT; i++ ) {
+		Append( Json, "%s\"%s\": %.0f", ( i > 0 ) ? ", " : "", GetCounterName( i ), static_cast<double>( m_Sum.m_Counts[i] ) );
+	}
+	Json += "},\n  \"frame_list\": [";
+	for( f=0; f<m_FrameList.size(); f++ ) {
+		const FRAMESTATS&	Frame = m_FrameList[f];
+		ALS_INT64			FrameSum = 0;
+		for( i=0; i<STAGE_COUNT; i++ ) FrameSum += Frame.m_Self[i];
+		Append( Json, "%s\n    {\"frame\": %.0f, \"samples\": %ld, \"bytes\": %ld, \"seconds\": %.6f, \"stages\": {", ( f > 0 ) ? "," : "",
+				static_cast<double>( Frame.m_Index ), Frame.m_Samples, Frame.m_Bytes, GetSeconds( FrameSum ) );
+		for( i=0; i<STAGE_COUNT; i++ ) Append( Json, "%s\"%s\": %.6f", ( i > 0 ) ? ", " : "", GetStageName( i ), GetSeconds( Frame.m_Self[i] ) );
+		Json += "}, \"counters\": {";
+		for( i=0; i<COUNTER_COUNT; i++ ) Append( Json, "%s\"%s\": %.0f", ( i > 0 ) ? ", " : "", GetCounterName( i ), static_cast<double>( Frame.m_Counts[i] ) );
+		Json += "}}";
+	}
+	Json += m_FrameList.empty() ? "]\n}\n" : "\n  ]\n}\n";
+}
+
+////////////////////////////////////////
+//                                    //
+//        Write results as JSON       //
+//                                    //
+////////////////////////////////////////
+// fp = Output file
+// Return value = true:Success / false:Error
+bool	CAlsStats::WriteJson( FILE* fp ) const
+{
+	std::string	Json;
+
+	GetJson( Json );
+	return ( fputs( Json.c_str(), fp ) >= 0 ) && ( fflush( fp ) == 0 );
+}
+
+////////////////////////////////////////
+//                                    //
+//           Get stage name           //
+//                                    //
+////////////////////////////////////////
+// Stage = Stage (STAGE_*)
+// Return value = Name used in the JSON output
+const char*	CAlsStats::GetStageName( short Stage )
+{
+	static const char*	Names[STAGE_COUNT] = {
+		"other", "read", "crc", "cof", "residual", "block_switching", "joint_stereo",
+		"mcc", "rlslms", "float_analyze", "float_diff", "entropy", "write" };
+	return ( ( Stage >= 0 ) && ( Stage < STAGE_COUNT ) ) ? Names[Stage] : "";
+}
+
+////////////////////////////////////////
+//                                    //
+//          Get counter name          //
+//                                    //
+////////////////////////////////////////
+// Counter = Counter (COUNTER_*)
+// Return value = Name used in the JSON output
+const char*	CAlsStats::GetCounterName( short Counter )
+{
+	static const char*	Names[COUNTER_COUNT] = {
+		"blocks", "zero_blocks", "constant_blocks", "coded_blocks", "joint_trials", "joint_used" };
+	return ( ( Counter >= 0 ) && ( Counter < COUNTER_COUNT ) ) ? Names[Counter] : "";
+}
+
+////////////////////////////////////////
+//                                    //
+//          Get current time          //
+//                                    //
+////////////////////////////////////////
+// Return value = Time in ticks (see GetSeconds())
+ALS_INT64	CAlsStats::GetTicks( void )
+{
+#if defined( _WIN32 )
+	LARGE_INTEGER	Counter;
+	QueryPerformanceCounter( &Counter );
+	return Counter.QuadPart;
+#else
+	struct timespec	ts;
+	clock_gettime( CLOCK_MONOTONIC, &ts );
+	return static_cast<ALS_INT64>( ts.tv_sec ) * 1000000000 + ts.tv_nsec;
+#endif
+}
+
+////////////////////////////////////////
+//                                    //
+//       Convert ticks to seconds     //
+//                                    //
+////////////////////////////////////////
+// Ticks = Time in ticks
+// Return value = Time in seconds
+double	CAlsStats::GetSeconds( ALS_INT64 Ticks )
+{
+#if defined( _WIN32 )
+	LARGE_INTEGER	Frequency;
+	QueryPerformanceFrequency( &Frequency );
+	return static_cast<double>( Ticks ) / static_cast<double>( Frequency.QuadPart );
+#else
+	return static_cast<double>( Ticks ) * 1e-9;
+#endif
+}
+
+////////////////////////////////////////
+//                                    //
+//         Clear frame results        //
+//                                    //
+////////////////////////////////////////
+// Frame = Results to clear
+void	CAlsStats::ClearFrame( FRAMESTATS& Frame )
+{
+	Frame.m_Index = 0;
+	Frame.m_Samples = Frame.m_Bytes = 0;
+	memset( Frame.m_Self, 0, sizeof(Frame.m_Self) );
+	memset( Frame.m_Counts, 0, sizeof(Frame.m_Counts) );
+}
+
+// End of stats.cpp
@@ -0,0 +1,161 @@
+/***************** MPEG-4 Audio Lossless Coding **************************
+
+This software module was originally developed by
+
+NTT (Nippon Telegraph and Telephone Corporation), Japan
+
+in the course of development of the MPEG-4 Audio standard ISO/IEC 14496-3
+and associated amendments. This software module is an implementation of
+a part of one or more MPEG-4 Audio lossless coding tools as specified
+by the MPEG-4 Audio standard. ISO/IEC gives users of the MPEG-4 Audio
+standards free license to this software module or modifications
+thereof for use in hardware or software products claiming conformance
+to the MPEG-4 Audio standards. Those intending to use this software
+module in hardware or software products are advised that this use may
+infringe existing patents. The original developer of this software
+module, the subsequent editors and their companies, and ISO/IEC have
+no liability for use of this software module or modifications thereof
+in an implementation. Copyright is not released for non MPEG-4 Audio
+conforming products. The original developer retains full right to use
+the code for the developer's own purpose, assign or donate the code to
+a third party and to inhibit third party from using the code for non
+MPEG-4 Audio conforming products. This copyright notice must be included
+in all copies or derivative works.
+
+Copyright (c) 2007.
+
+filename : stats.h
+project  : MPEG-4 Audio Lossless Coding
+contents : Per-stage timing and counters of the encoder
+
+*************************************************************************/
+
+#if !defined( STATS_INCLUDED )
+#define	STATS_INCLUDED
+
+#include	<stdio.h>
+#include	<string>
+#include	<vector>
+#include	"stream.h"
+
+//////////////////////////////////////////////////////////////////////
+//                                                                  //
+//                         Type definition                          //
+//                                                                  //
+//////////////////////////////////////////////////////////////////////
+
+// Encoder stages
+// * Stages nest (e.g. a joint stereo trial codes a block). The self time of a stage
+//   excludes the stages inside it, the total time includes them.
+enum	ALS_STAGE {
+	STAGE_OTHER = 0,		// Everything outside the stages below
+	STAGE_READ,				// PCM read and deinterleaving
+	STAGE_CRC,				// CRC of the PCM data
+	STAGE_COF,				// GetCof()/adaptive order and coefficient quantization
+	STAGE_RESIDUAL,			// Prediction residual
+	STAGE_BLOCKSWITCH,		// Block switching search (all levels and the partition choice)
+	STAGE_JOINT,			// Joint stereo trials and independent coding check
+	STAGE_MCC,				// CheckFrameDistanceTD() and SubtractResidualTD()
+	STAGE_RLSLMS,			// RLS-LMS prediction (-z)
+	STAGE_FLOAT_ANALYZE,	// Floating-point analysis (ACF/MLZ)
+	STAGE_FLOAT_DIFF,		// Floating-point difference coding
+	STAGE_ENTROPY,			// Entropy coding (Rice/BGMC) of a block
+	STAGE_WRITE,			// Output of the frame
+	STAGE_COUNT
+};
+
+// Encoder counters
+enum	ALS_COUNTER {
+	COUNTER_BLOCKS = 0,		// Analyzed blocks (all block switching levels)
+	COUNTER_ZERO_BLOCKS,	// Zero blocks among them
+	COUNTER_CONST_BLOCKS,	// Constant blocks among them
+	COUNTER_CODED_BLOCKS,	// Entropy coder runs
+	COUNTER_JOINT_TRIALS,	// Difference signals coded
+	COUNTER_JOINT_USED,		// Difference signals which replaced a channel
+	COUNTER_COUNT
+};
+
+//////////////////////////////////////////////////////////////////////
+//                                                                  //
+//                          CAlsStats class                         //
+//                                                                  //
+//////////////////////////////////////////////////////////////////////
+class	CAlsStats {
+public:
+	CAlsStats( void );
+	bool	Enable( bool Enabled, bool KeepFrames = true );
+	bool	IsEnabled( void ) const { return m_Enabled; }
+	void	Reset( void );
+	void	BeginFrame( void );
+	void	EndFrame( ALS_INT64 Index, long Samples, long Bytes );
+	void	Enter( short Stage );
+	void	Leave( void );
+	void	Count( short Counter, long Value = 1 ) { if ( m_Enabled ) m_Frame.m_Counts[Counter] += Value; }
+	void	GetJson( std::string& Json ) const;
+	bool	WriteJson( FILE* fp ) const;
+	static const char*	GetStageName( short Stage );
+	static const char*	GetCounterName( short Counter );
+
+protected:
+	// Measurement of one frame (or of all frames)
+	struct	FRAMESTATS {
+		ALS_INT64	m_Index;					// Frame number (0-)
+		long		m_Samples;					// Samples per channel
+		long		m_Bytes;					// Coded size in bytes
+		ALS_INT64	m_Self[STAGE_COUNT];		// Self time of each stage in ticks
+		ALS_INT64	m_Counts[COUNTER_COUNT];	// Counters
+	};
+	static ALS_INT64	GetTicks( void );
+	static double		GetSeconds( ALS_INT64 Ticks );
+	static void			ClearFrame( FRAMESTATS& Frame );
+
+protected:
+	enum { MAX_DEPTH = 16 };
+	bool		m_Enabled;					// true:Measurement enabled
+	bool		m_KeepFrames;				// true:Keep per-frame results
+	short		m_Stage[MAX_DEPTH];			// Stack of entered stages
+	ALS_INT64	m_Start[MAX_DEPTH];			// Entry time of each stacked stage
+	short		m_Depth;					// Number of stacked stages
+	ALS_INT64	m_Mark;						// Time of the last stage change
+	FRAMESTATS	m_Frame;					// Current frame
+	FRAMESTATS	m_Sum;						// All frames
+	ALS_INT64	m_Total[STAGE_COUNT];		// Total (inclusive) time of each stage in ticks
+	ALS_INT64	m_Frames;					// Number of measured frames
+	ALS_INT64	m_Samples;					// Samples per channel in all frames
+	ALS_INT64	m_Bytes;					// Coded size of all frames
+	std::vector<FRAMESTATS>	m_FrameList;	// Per-frame results
+};
+
+// Scoped stage
+class	CAlsStageTimer {
+public:
+	CAlsStageTimer( CAlsStats& Stats, short Stage ) : m_Stats( Stats ) { m_Stats.Enter( Stage ); }
+	~CAlsStageTimer( void ) { m_Stats.Leave(); }
+protected:
+	CAlsStats&	m_Stats;
+private:
+	CAlsStageTimer( const CAlsStageTimer& );
+	CAlsStageTimer&	operator = ( const CAlsStageTimer& );
+};
+
+// Instrumentation macros
+// * Define ALS_NO_STATS to compile the codec without instrumentation.
+#if defined( ALS_NO_STATS )
+#define	ALS_STATS_BEGIN_FRAME( Stats )
+#define	ALS_STATS_END_FRAME( Stats, Index, Samples, Bytes )
+#define	ALS_STATS_SCOPE( Stats, Stage )
+#define	ALS_STATS_ENTER( Stats, Stage )
+#define	ALS_STATS_LEAVE( Stats )
+#define	ALS_STATS_COUNT( Stats, Counter )
+#else
+#define	ALS_STATS_BEGIN_FRAME( Stats )						(Stats).BeginFrame()
+#define	ALS_STATS_END_FRAME( Stats, Index, Samples, Bytes )	(Stats).EndFrame( Index, Samples, Bytes )
+#define	ALS_STATS_SCOPE( Stats, Stage )						CAlsStageTimer StageTimer( Stats, Stage )
+#define	ALS_STATS_ENTER( Stats, Stage )						(Stats).Enter( Stage )
+#define	ALS_STATS_LEAVE( Stats )							(Stats).Leave()
+#define	ALS_STATS_COUNT( Stats, Counter )					(Stats).Count( Counter )
+#endif
+
+#endif	// STATS_INCLUDED
+
+// End of stats.h
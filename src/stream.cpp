@@ -34,22 +34,49 @@ contents : Bridge functions to stream classes in AlsImf
 
 #include	"stream.h"
 #include	"ImfFileStream.h"
+#include	"ImfBufferedStream.h"
+#include	"ImfMemoryStream.h"
 
 using namespace NAlsImf;
 
 // Stream mode
 typedef enum tagALSSTREAM_MODE {
 	ALSSTRMODE_READER,		// File reader mode
+	ALSSTRMODE_MAPPED,		// Memory-mapped file reader mode
+	ALSSTRMODE_BUFFERED,	// Buffered reader mode over m_Reader or m_pStream
 	ALSSTRMODE_WRITER,		// File writer mode
+	ALSSTRMODE_STREAM,		// Caller's stream object
+	ALSSTRMODE_MEMORY,		// Memory reader/writer mode
 } ALSSTREAM_MODE;
 
 // Stream information
 typedef	struct tagALSSTREAM {
 	ALSSTREAM_MODE			m_Mode;		// Stream mode
 	NAlsImf::CFileReader	m_Reader;	// File reader object
+	NAlsImf::CMappedFileReader	m_MappedReader;	// Memory-mapped file reader object
+	NAlsImf::CBufferedReader	m_Buffered;		// Sliding window used in ALSSTRMODE_BUFFERED
 	NAlsImf::CFileWriter	m_Writer;	// File writer object
+	NAlsImf::CMemoryStream	m_Memory;	// Memory stream object
+	NAlsImf::CBaseStream*	m_pStream;	// Stream used in ALSSTRMODE_STREAM (not owned)
 } ALSSTREAM;
 
+// Buffering of streams opened by OpenFileReader()/OpenFileWriter()
+static ALS_UINT32	FileBufferSize = 0;		// I/O buffer size in bytes (0:stdio default)
+static bool			FileDirectIo = false;	// true:Write files with direct I/O
+
+// Select the stream object of a handle.
+static inline CBaseStream*	GetStream( ALSSTREAM* pStream )
+{
+	switch( pStream->m_Mode ) {
+	case	ALSSTRMODE_READER:	return &pStream->m_Reader;
+	case	ALSSTRMODE_MAPPED:	return &pStream->m_MappedReader;
+	case	ALSSTRMODE_BUFFERED:	return &pStream->m_Buffered;
+	case	ALSSTRMODE_WRITER:	return &pStream->m_Writer;
+	case	ALSSTRMODE_MEMORY:	return &pStream->m_Memory;
+	default:				return pStream->m_pStream;
+	}
+}
+
 ////////////////////////////////////////
 //                                    //
 //         Close file stream          //
@@ -64,8 +91,11 @@ int	fclose( HALSSTREAM fp )
 
 	// Close files.
 	ALSSTREAM*	pStream = reinterpret_cast<ALSSTREAM*>( fp );
+	pStream->m_Buffered.Close();
 	pStream->m_Reader.Close();
+	pStream->m_MappedReader.Close();
 	pStream->m_Writer.Close();
+	pStream->m_Memory.Close();
 	delete pStream;
 	return 0;
 }
@@ -82,8 +112,7 @@ ALS_INT64	ftell( HALSSTREAM fp )
 	// Check parameter.
 	if ( fp == NULL ) return -1;
 
-	ALSSTREAM*	pStream = reinterpret_cast<ALSSTREAM*>( fp );
-	return ( pStream->m_Mode == ALSSTRMODE_READER ) ? pStream->m_Reader.Tell() : pStream->m_Writer.Tell();
+	return GetStream( reinterpret_cast<ALSSTREAM*>( fp ) )->Tell();
 }
 
 ////////////////////////////////////////
@@ -97,9 +126,7 @@ void	rewind( HALSSTREAM fp )
 	// Check parameter.
 	if ( fp == NULL ) return;
 
-	ALSSTREAM*	pStream = reinterpret_cast<ALSSTREAM*>( fp );
-	if ( pStream->m_Mode == ALSSTRMODE_READER ) pStream->m_Reader.Seek( 0, CBaseStream::S_BEGIN );
-	else pStream->m_Writer.Seek( 0, CBaseStream::S_BEGIN );
+	GetStream( reinterpret_cast<ALSSTREAM*>( fp ) )->Seek( 0, CBaseStream::S_BEGIN );
 }
 
 ////////////////////////////////////////
@@ -116,12 +143,7 @@ int	fseek( HALSSTREAM fp, ALS_INT64 offset, int origin )
 	// Check parameter.
 	if ( fp == NULL ) return -1;
 
-	ALSSTREAM*	pStream = reinterpret_cast<ALSSTREAM*>( fp );
-	if ( pStream->m_Mode == ALSSTRMODE_READER ) {
-		return pStream->m_Reader.Seek( offset, static_cast<CBaseStream::SEEK_ORIGIN>( origin ) ) ? 0 : -1;
-	} else {
-		return pStream->m_Writer.Seek( offset, static_cast<CBaseStream::SEEK_ORIGIN>( origin ) ) ? 0 : -1;
-	}
+	return GetStream( reinterpret_cast<ALSSTREAM*>( fp ) )->Seek( offset, static_cast<CBaseStream::SEEK_ORIGIN>( origin ) ) ? 0 : -1;
 }
 
 ////////////////////////////////////////
@@ -140,11 +162,11 @@ ALS_UINT32	fwrite( const void* buffer, ALS_UINT32 size, ALS_UINT32 count, HALSST
 	if ( fp == NULL ) return 0;
 
 	ALSSTREAM*	pStream = reinterpret_cast<ALSSTREAM*>( fp );
-	if ( ( pStream->m_Mode != ALSSTRMODE_WRITER ) || ( size == 0 ) || ( count == 0 ) ) return 0;
+	if ( ( pStream->m_Mode == ALSSTRMODE_READER ) || ( pStream->m_Mode == ALSSTRMODE_MAPPED ) || ( pStream->m_Mode == ALSSTRMODE_BUFFERED ) || ( size == 0 ) || ( count == 0 ) ) return 0;
 
 	ALS_UINT64	TotalSize = static_cast<ALS_UINT64>( size ) * static_cast<ALS_UINT64>( count );
 	if ( TotalSize > 0xffffffff ) TotalSize = 0xffffffff;
-	return pStream->m_Writer.Write( buffer, static_cast<IMF_UINT32>( TotalSize ) ) / size;
+	return GetStream( pStream )->Write( buffer, static_cast<IMF_UINT32>( TotalSize ) ) / size;
 }
 
 ////////////////////////////////////////
@@ -163,11 +185,52 @@ ALS_UINT32	fread( void* buffer, ALS_UINT32 size, ALS_UINT32 count, HALSSTREAM fp
 	if ( fp == NULL ) return 0;
 
 	ALSSTREAM*	pStream = reinterpret_cast<ALSSTREAM*>( fp );
-	if ( ( pStream->m_Mode != ALSSTRMODE_READER ) || ( size == 0 ) || ( count == 0 ) ) return 0;
+	if ( ( pStream->m_Mode == ALSSTRMODE_WRITER ) || ( size == 0 ) || ( count == 0 ) ) return 0;
 
 	ALS_UINT64	TotalSize = static_cast<ALS_UINT64>( size ) * static_cast<ALS_UINT64>( count );
 	if ( TotalSize > 0xffffffff ) TotalSize = 0xffffffff;
-	return pStream->m_Reader.Read( buffer, static_cast<IMF_UINT32>( TotalSize ) ) / size;
+	return GetStream( pStream )->Read( buffer, static_cast<IMF_UINT32>( TotalSize ) ) / size;
+}
+
+////////////////////////////////////////
+//                                    //
+//   Get data without copying it      //
+//                                    //
+////////////////////////////////////////
+// fp = File handle
+// size = Number of bytes the caller wants to look at
+// pSize = Pointer to variable which receives the readable byte count
+// Return value = Pointer to the data at the current position / NULL:Not available
+// * The file position is not changed. Advance it with fseek( fp, n, SEEK_CUR ).
+// * *pSize is less than size only at the end of the stream.
+// * Only mapped, buffered and memory streams support this. Fall back to fread() on NULL.
+const unsigned char*	fpeek( HALSSTREAM fp, ALS_UINT32 size, ALS_UINT32* pSize )
+{
+	IMF_UINT32	Size = 0;
+
+	if ( pSize != NULL ) *pSize = 0;
+	if ( ( fp == NULL ) || ( pSize == NULL ) ) return NULL;
+
+	ALSSTREAM*	pStream = reinterpret_cast<ALSSTREAM*>( fp );
+	if ( pStream->m_Mode == ALSSTRMODE_WRITER ) return NULL;
+
+	const IMF_UINT8*	pData = GetStream( pStream )->Peek( size, Size );
+	*pSize = Size;
+	return pData;
+}
+
+////////////////////////////////////////
+//                                    //
+//       Set file I/O buffering       //
+//                                    //
+////////////////////////////////////////
+// BufferSize = I/O buffer size in bytes for files opened afterwards (0:stdio default)
+// Direct = true:Write files with direct I/O, bypassing the page cache
+// * Files written with a buffer back-patch within it instead of seeking.
+void	SetFileBuffering( ALS_UINT32 BufferSize, bool Direct )
+{
+	FileBufferSize = BufferSize;
+	FileDirectIo = Direct;
 }
 
 ////////////////////////////////////////
@@ -177,8 +240,10 @@ ALS_UINT32	fread( void* buffer, ALS_UINT32 size, ALS_UINT32 count, HALSSTREAM fp
 ////////////////////////////////////////
 // pFilename = Filename to open
 // phStream = Pointer to variable which receives stream handle
+// Mapped = true:Map the file into memory, or read it through a sliding window if it cannot be mapped / false:Use plain file I/O
 // Return value = Error code (0 means no error)
-int	OpenFileReader( const char* pFilename, HALSSTREAM* phStream )
+// * pFilename "-" reads from stdin.
+int	OpenFileReader( const char* pFilename, HALSSTREAM* phStream, bool Mapped )
 {
 	ALSSTREAM*	pStream = NULL;
 	int			RetCode = 0;
@@ -191,9 +256,19 @@ int	OpenFileReader( const char* pFilename, HALSSTREAM* phStream )
 		pStream = new ALSSTREAM;
 		if ( pStream == NULL ) throw -2;
 		pStream->m_Mode = ALSSTRMODE_READER;
-
-		// Open a file.
-		if ( !pStream->m_Reader.Open( pFilename ) ) throw -3;
+		pStream->m_pStream = NULL;
+
+		// Open a file. Files which cannot be mapped (pipes, stdin) are read through
+		// a sliding window, so that parsers can peek ahead without seeking back.
+		if ( strcmp( pFilename, "-" ) == 0 ) {
+			if ( !pStream->m_Reader.Attach( stdin ) ) throw -3;
+		} else if ( Mapped && pStream->m_MappedReader.Open( pFilename ) ) {
+			pStream->m_Mode = ALSSTRMODE_MAPPED;
+		} else if ( !pStream->m_Reader.Open( pFilename, 0, FileBufferSize ) ) throw -3;
+		if ( ( pStream->m_Mode == ALSSTRMODE_READER ) && Mapped ) {
+			if ( !pStream->m_Buffered.Open( &pStream->m_Reader ) ) throw -2;
+			pStream->m_Mode = ALSSTRMODE_BUFFERED;
+		}
 
 		// Save pStream as HALSSTREAM.
 		*phStream = reinterpret_cast<HALSSTREAM>( pStream );
@@ -229,9 +304,10 @@ int	OpenFileWriter( const char* pFilename, HALSSTREAM* phStream )
 		pStream = new ALSSTREAM;
 		if ( pStream == NULL ) throw -2;
 		pStream->m_Mode = ALSSTRMODE_WRITER;
+		pStream->m_pStream = NULL;
 
 		// Create a file.
-		if ( !pStream->m_Writer.Open( pFilename, 0, CFileWriter::FW_NO_TRUNCATE ) ) throw -3;
+		if ( !pStream->m_Writer.Open( pFilename, 0, CFileWriter::FW_NO_TRUNCATE | ( FileDirectIo ? CFileWriter::FW_DIRECT : 0 ), FileBufferSize ) ) throw -3;
 
 		// Save pStream as HALSSTREAM.
 		*phStream = reinterpret_cast<HALSSTREAM>( pStream );
@@ -246,4 +322,126 @@ int	OpenFileWriter( const char* pFilename, HALSSTREAM* phStream )
 	return RetCode;
 }
 
+////////////////////////////////////////
+//                                    //
+//     Wrap a stream object           //
+//                                    //
+////////////////////////////////////////
+// pStream = Stream object to be accessed through the handle
+// phStream = Pointer to variable which receives stream handle
+// Buffered = true:Read pStream through a sliding window (read-only) / false:Access pStream directly
+// Return value = Error code (0 means no error)
+// * pStream is not deleted by fclose(). It must outlive the handle.
+int	OpenStream( NAlsImf::CBaseStream* pStream, HALSSTREAM* phStream, bool Buffered )
+{
+	ALSSTREAM*	pAlsStream;
+
+	// Check parameters.
+	if ( ( pStream == NULL ) || ( phStream == NULL ) ) return -1;
+
+	// Create ALSSTREAM structure.
+	pAlsStream = new ALSSTREAM;
+	if ( pAlsStream == NULL ) return -2;
+	pAlsStream->m_Mode = ALSSTRMODE_STREAM;
+	pAlsStream->m_pStream = pStream;
+	if ( Buffered ) {
+		if ( !pAlsStream->m_Buffered.Open( pStream ) ) {
+			delete pAlsStream;
+			return -2;
+		}
+		pAlsStream->m_Mode = ALSSTRMODE_BUFFERED;
+	}
+
+	// Save pAlsStream as HALSSTREAM.
+	*phStream = reinterpret_cast<HALSSTREAM>( pAlsStream );
+	return 0;
+}
+
+////////////////////////////////////////
+//                                    //
+//      Open memory for reading       //
+//                                    //
+////////////////////////////////////////
+// pData = Pointer to data
+// Size = Number of bytes in pData
+// phStream = Pointer to variable which receives stream handle
+// Return value = Error code (0 means no error)
+// * pData is not copied. It must outlive the handle.
+int	OpenMemoryReader( const void* pData, ALS_UINT32 Size, HALSSTREAM* phStream )
+{
+	ALSSTREAM*	pStream;
+
+	// Check parameters.
+	if ( ( ( pData == NULL ) && ( Size > 0 ) ) || ( phStream == NULL ) ) return -1;
+
+	// Create ALSSTREAM structure.
+	pStream = new ALSSTREAM;
+	if ( pStream == NULL ) return -2;
+	pStream->m_Mode = ALSSTRMODE_MEMORY;
+	pStream->m_pStream = NULL;
+	if ( !pStream->m_Memory.Open( pData, Size ) ) {
+		delete pStream;
+		return -3;
+	}
+
+	// Save pStream as HALSSTREAM.
+	*phStream = reinterpret_cast<HALSSTREAM>( pStream );
+	return 0;
+}
+
+////////////////////////////////////////
+//                                    //
+//      Open memory for writing       //
+//                                    //
+////////////////////////////////////////
+// phStream = Pointer to variable which receives stream handle
+// pBuffer = Caller's buffer to write into (NULL:Allocate a growable buffer)
+// Capacity = Size of pBuffer in bytes, or initial size of the growable buffer
+// Return value = Error code (0 means no error)
+// * Writing beyond Capacity fails when pBuffer is given.
+// * Written data can be accessed by GetMemoryData() until fclose().
+int	OpenMemoryWriter( HALSSTREAM* phStream, void* pBuffer, ALS_UINT32 Capacity )
+{
+	ALSSTREAM*	pStream;
+	bool		Result;
+
+	// Check parameters.
+	if ( phStream == NULL ) return -1;
+
+	// Create ALSSTREAM structure.
+	pStream = new ALSSTREAM;
+	if ( pStream == NULL ) return -2;
+	pStream->m_Mode = ALSSTRMODE_MEMORY;
+	pStream->m_pStream = NULL;
+	Result = ( pBuffer != NULL ) ? pStream->m_Memory.Open( pBuffer, Capacity, 0 ) : pStream->m_Memory.Open( Capacity );
+	if ( !Result ) {
+		delete pStream;
+		return -3;
+	}
+
+	// Save pStream as HALSSTREAM.
+	*phStream = reinterpret_cast<HALSSTREAM>( pStream );
+	return 0;
+}
+
+////////////////////////////////////////
+//                                    //
+//       Get data of memory stream    //
+//                                    //
+////////////////////////////////////////
+// fp = Handle opened by OpenMemoryReader() or OpenMemoryWriter()
+// pSize = Pointer to variable which receives data size in bytes
+// Return value = Pointer to data / NULL:Error
+const void*	GetMemoryData( HALSSTREAM fp, ALS_UINT32* pSize )
+{
+	if ( pSize != NULL ) *pSize = 0;
+	if ( ( fp == NULL ) || ( pSize == NULL ) ) return NULL;
+
+	ALSSTREAM*	pStream = reinterpret_cast<ALSSTREAM*>( fp );
+	if ( pStream->m_Mode != ALSSTRMODE_MEMORY ) return NULL;
+
+	*pSize = pStream->m_Memory.GetSize();
+	return pStream->m_Memory.GetBuffer();
+}
+
 // End of stream.cpp
@@ -66,13 +66,33 @@ typedef	uint64_t	ALS_UINT64;
 // Stream handle type
 typedef	void*	HALSSTREAM;
 
+//////////////////////////////////////////////////////////////////////
+//                                                                  //
+//                        CAlsRauSink class                         //
+//                                                                  //
+//////////////////////////////////////////////////////////////////////
+// Receiver of an encoded ALS bitstream, one random access unit at a time.
+class	CAlsRauSink {
+public:
+	virtual	~CAlsRauSink( void ) {}
+	virtual	bool	BeginStream( const void* pHeader, ALS_UINT32 HeaderSize ) = 0;			// ALS header (CRC and RAU sizes not final yet)
+	virtual	bool	WriteRauPart( const void* pData, ALS_UINT32 Size ) = 0;			// Leading frames of an unfinished RAU
+	virtual	bool	WriteRau( const void* pRau, ALS_UINT32 RauSize, ALS_UINT32 Samples ) = 0;	// (Rest of) frames of one RAU (RAU size only in plain ALS streams)
+	virtual	bool	EndStream( const void* pHeader, ALS_UINT32 HeaderSize ) = 0;			// Final ALS header
+};
+
 //////////////////////////////////////////////////////////////////////
 //                                                                  //
 //                      Prototype declaration                       //
 //                                                                  //
 //////////////////////////////////////////////////////////////////////
-int	OpenFileReader( const char* pFilename, HALSSTREAM* phStream );
+void	SetFileBuffering( ALS_UINT32 BufferSize, bool Direct );
+int	OpenFileReader( const char* pFilename, HALSSTREAM* phStream, bool Mapped = true );
 int	OpenFileWriter( const char* pFilename, HALSSTREAM* phStream );
+int	OpenStream( NAlsImf::CBaseStream* pStream, HALSSTREAM* phStream, bool Buffered = false );
+int	OpenMemoryReader( const void* pData, ALS_UINT32 Size, HALSSTREAM* phStream );
+int	OpenMemoryWriter( HALSSTREAM* phStream, void* pBuffer = NULL, ALS_UINT32 Capacity = 0 );
+const void*	GetMemoryData( HALSSTREAM fp, ALS_UINT32* pSize );
 
 // Function overloads
 int			fclose( HALSSTREAM fp );
@@ -81,6 +101,7 @@ void		rewind( HALSSTREAM fp );
 int			fseek( HALSSTREAM fp, ALS_INT64 offset, int origin );
 ALS_UINT32	fwrite( const void* buffer, ALS_UINT32 size, ALS_UINT32 count, HALSSTREAM fp );
 ALS_UINT32	fread( void* buffer, ALS_UINT32 size, ALS_UINT32 count, HALSSTREAM fp );
+const unsigned char*	fpeek( HALSSTREAM fp, ALS_UINT32 size, ALS_UINT32* pSize );
 
 #endif	// STREAM_INCLUDED
 
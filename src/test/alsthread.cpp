@@ -0,0 +1,279 @@
+/***************** MPEG-4 Audio Lossless Coding **************************
+
+This software module was originally developed by
+
+NTT (Nippon Telegraph and Telephone Corporation), Japan
+
+in the course of development of the MPEG-4 Audio standard ISO/IEC 14496-3
+and associated amendments. This software module is an implementation of
+a part of one or more MPEG-4 Audio lossless coding tools as specified
+by the MPEG-4 Audio standard. ISO/IEC gives users of the MPEG-4 Audio
+standards free license to this software module or modifications
+thereof for use in hardware or software products claiming conformance
+to the MPEG-4 Audio standards. Those intending to use this software
+module in hardware or software products are advised that this use may
+infringe existing patents. The original developer of this software
+module, the subsequent editors and their companies, and ISO/IEC have
+no liability for use of this software module or modifications thereof
+in an implementation. Copyright is not released for non MPEG-4 Audio
+conforming products. The original developer retains full right to use
+the code for the developer's own purpose, assign or donate the code to
+a third party and to inhibit third party from using the code for non
+MPEG-4 Audio conforming products. This copyright notice must be included
+in all copies or derivative works.
+
+Copyright (c) 2007.
+
+filename : alsthread.cpp
+project  : MPEG-4 Audio Lossless Coding
+contents : Test of concurrent encoder and decoder instances
+
+*************************************************************************/
+
+// Usage: alsthread [rounds]
+//
+// Encodes and decodes a set of synthetic signals with different formats and
+// options, first one after another, then with one thread per signal at the same
+// time. Every stream made by the threads has to be identical to the one made
+// without threads, and every decoded signal identical to the input. Both the C
+// interface (libmp4als.h) and EncodeBuffer()/DecodeBuffer() are tested.
+// Returns 0 if all results match, 1 otherwise. POSIX threads only.
+
+#include	<cstdio>
+#include	<cstdlib>
+#include	<cstring>
+#include	<cmath>
+#include	<vector>
+#include	<pthread.h>
+#include	"alsbuffer.h"
+#include	"libmp4als.h"
+
+//////////////////////////////////////////////////////////////////////
+//                                                                  //
+//                         Type definition                          //
+//                                                                  //
+//////////////////////////////////////////////////////////////////////
+
+// Test signal and encoder options
+struct	TESTCONFIG {
+	long	Frequency;		// Sampling frequency in Hz
+	long	Channels;		// Number of channels
+	short	HEMode;			// -z: RLS-LMS mode (0:Off)
+	short	RA;				// -r: Random access distance in 1/10 sec (0:Off)
+};
+
+// Result of one test run
+struct	TESTRESULT {
+	std::vector<unsigned char>	Buffer;		// Stream from EncodeBuffer()
+	std::vector<unsigned char>	Library;	// Stream from AlsEncoderFinish()
+	bool	Decoded;						// true:Both streams decode to the input
+};
+
+// Work of one thread
+struct	TESTJOB {
+	const TESTCONFIG*					pConfig;	// Configuration
+	const std::vector<unsigned char>*	pPcm;		// Input signal
+	const TESTRESULT*					pExpected;	// Result without threads
+	int		Rounds;									// Number of runs
+	int		Failures;								// Number of runs which differ from pExpected
+};
+
+//////////////////////////////////////////////////////////////////////
+//                                                                  //
+//                          Configurations                          //
+//                                                                  //
+//////////////////////////////////////////////////////////////////////
+
+// Different sample rates select different RLS-LMS mode tables, and RA > 0
+// exercises the per-RAU size bookkeeping of the encoder.
+static const TESTCONFIG	s_Configs[] = {
+	{  44100, 2, 1, 0 },
+	{  96000, 2, 3, 0 },
+	{ 192000, 2, 2, 0 },
+	{  48000, 1, 1, 0 },
+	{  48000, 3, 3, 0 },
+	{  44100, 2, 0, 0 },
+	{  44100, 2, 0, 1 },
+	{  48000, 2, 0, 2 },
+	{  44100, 2, 1, 3 },
+	{  96000, 2, 0, 4 },
+};
+
+#define	TEST_CONFIGS	( sizeof(s_Configs) / sizeof(s_Configs[0]) )
+#define	TEST_SECONDS	0.4
+#define	TEST_STACK		( 64 * 1024 * 1024 )	// RLS-LMS keeps large arrays on the stack
+
+//////////////////////////////////////////////////////////////////////
+//                                                                  //
+//                            Functions                             //
+//                                                                  //
+//////////////////////////////////////////////////////////////////////
+
+////////////////////////////////////////
+//                                    //
+//      Generate synthetic signal     //
+//                                    //
+////////////////////////////////////////
+// Config = Audio format
+// Pcm = Receives interleaved 16-bit little-endian PCM data
+// * Channel 1 alternates between a copy of channel 0 and an independent signal,
+//   so that RLS-LMS switches between mono and joint-stereo prediction.
+static void	Synthesize( const TESTCONFIG& Config, std::vector<unsigned char>& Pcm )
+{
+	const double	Pi = 3.14159265358979;
+	long			Samples = static_cast<long>( TEST_SECONDS * Config.Frequency );
+	unsigned int	State = 0x414c5300 + static_cast<unsigned int>( Config.Frequency + Config.Channels );
+	double			t, Value;
+	long			n, c, Quant, Block;
+	unsigned char*	p;
+
+	Pcm.resize( Samples * Config.Channels * 2 );
+	p = &Pcm[0];
+	Block = Config.Frequency / 20;
+
+	for( n=0; n<Samples; n++ ) {
+		t = static_cast<double>( n ) / Config.Frequency;
+		for( c=0; c<Config.Channels; c++ ) {
+			State = State * 1664525 + 1013904223;
+			if ( ( c == 1 ) && ( ( n / Block ) & 1 ) ) {
+				Quant = static_cast<short>( p[-2] | ( p[-1] << 8 ) );		// Same as channel 0
+			} else {
+				Value = 0.5 * sin( 2.0 * Pi * ( 220.0 + 110.0 * c ) * t ) + 0.2 * sin( 2.0 * Pi * 1870.0 * t ) + ( static_cast<double>( State >> 8 ) / 8388608.0 - 1.0 ) * 0.01;
+				Quant = static_cast<long>( floor( Value * 32767.0 + 0.5 ) );
+			}
+			*p++ = static_cast<unsigned char>( Quant );
+			*p++ = static_cast<unsigned char>( Quant >> 8 );
+		}
+	}
+}
+
+////////////////////////////////////////
+//                                    //
+//     Encode and decode one signal   //
+//                                    //
+////////////////////////////////////////
+// Config = Configuration
+// Pcm = Input signal
+// Result = Receives the streams and the decoding result
+static void	RunTest( const TESTCONFIG& Config, const std::vector<unsigned char>& Pcm, TESTRESULT& Result )
+{
+	ALS_ENCPARAMS		Params;
+	HALSENCODER			hEncoder;
+	HALSDECODER			hDecoder;
+	const void*			pData;
+	unsigned int		Size, Samples;
+	std::vector<unsigned char>	Output;
+	long				FrameBytes;
+	int					r;
+
+	Result.Buffer.clear();
+	Result.Library.clear();
+	Result.Decoded = false;
+
+	AlsInitParams( &Params );
+	Params.Format.Channels = Config.Channels;
+	Params.Format.Frequency = Config.Frequency;
+	Params.Format.Wordlength = 16;
+	Params.Options.HEMode = Config.HEMode;
+	Params.Options.RA = Config.RA;
+	Params.Options.RAmode = 0;
+	Params.Threads = 1;
+	FrameBytes = Config.Channels * 2;
+
+	// EncodeBuffer() and DecodeBuffer()
+	if ( EncodeBuffer( &Pcm[0], static_cast<ALS_UINT32>( Pcm.size() ), &Params.Format, &Params.Options, Result.Buffer ) != 0 ) return;
+	if ( DecodeBuffer( &Result.Buffer[0], static_cast<ALS_UINT32>( Result.Buffer.size() ), Output ) != 0 ) return;
+	if ( Output != Pcm ) return;
+
+	// C interface
+	hEncoder = AlsEncoderOpen( &Params, NULL, NULL );
+	if ( hEncoder == NULL ) return;
+	r = AlsEncoderPush( hEncoder, &Pcm[0], static_cast<unsigned int>( Pcm.size() / FrameBytes ) );
+	if ( ( r >= 0 ) && ( AlsEncoderFinish( hEncoder, &pData, &Size ) == 0 ) ) {
+		Result.Library.assign( static_cast<const unsigned char*>( pData ), static_cast<const unsigned char*>( pData ) + Size );
+	}
+	AlsEncoderClose( hEncoder );
+	if ( Result.Library.empty() ) return;
+
+	hDecoder = AlsDecoderOpen( &Result.Library[0], static_cast<unsigned int>( Result.Library.size() ), 1 );
+	if ( hDecoder == NULL ) return;
+	Output.clear();
+	while( ( r = AlsDecoderPull( hDecoder, &pData, &Samples, NULL ) ) > 0 ) {
+		Output.insert( Output.end(), static_cast<const unsigned char*>( pData ), static_cast<const unsigned char*>( pData ) + Samples * FrameBytes );
+	}
+	AlsDecoderClose( hDecoder );
+	Result.Decoded = ( r == 0 ) && ( Output == Pcm );
+}
+
+////////////////////////////////////////
+//                                    //
+//           Thread procedure         //
+//                                    //
+////////////////////////////////////////
+// pParam = Pointer to TESTJOB
+// Return value = NULL
+static void*	ThreadProc( void* pParam )
+{
+	TESTJOB*	pJob = static_cast<TESTJOB*>( pParam );
+	TESTRESULT	Result;
+	int			i;
+
+	for( i=0; i<pJob->Rounds; i++ ) {
+		RunTest( *pJob->pConfig, *pJob->pPcm, Result );
+		if ( !Result.Decoded || ( Result.Buffer != pJob->pExpected->Buffer ) || ( Result.Library != pJob->pExpected->Library ) ) pJob->Failures++;
+	}
+	return NULL;
+}
+
+////////////////////////////////////////
+//                                    //
+//            Main function           //
+//                                    //
+////////////////////////////////////////
+int	main( int argc, char** argv )
+{
+	std::vector<unsigned char>	Pcm[TEST_CONFIGS];
+	TESTRESULT		Expected[TEST_CONFIGS];
+	TESTJOB			Jobs[TEST_CONFIGS];
+	pthread_t		Threads[TEST_CONFIGS];
+	pthread_attr_t	Attr;
+	size_t			i;
+	int				Rounds = ( argc > 1 ) ? atoi( argv[1] ) : 2;
+	int				Failures = 0;
+
+	// Results without threads
+	for( i=0; i<TEST_CONFIGS; i++ ) {
+		Synthesize( s_Configs[i], Pcm[i] );
+		RunTest( s_Configs[i], Pcm[i], Expected[i] );
+		if ( !Expected[i].Decoded ) {
+			printf( "%ld Hz, %ld ch, -z%d -r%d: Round trip failed without threads\n", s_Configs[i].Frequency, s_Configs[i].Channels, s_Configs[i].HEMode, s_Configs[i].RA );
+			Failures++;
+		}
+	}
+
+	// All configurations at the same time
+	pthread_attr_init( &Attr );
+	pthread_attr_setstacksize( &Attr, TEST_STACK );
+	for( i=0; i<TEST_CONFIGS; i++ ) {
+		Jobs[i].pConfig = &s_Configs[i];
+		Jobs[i].pPcm = &Pcm[i];
+		Jobs[i].pExpected = &Expected[i];
+		Jobs[i].Rounds = Rounds;
+		Jobs[i].Failures = 0;
+		if ( pthread_create( &Threads[i], &Attr, ThreadProc, &Jobs[i] ) != 0 ) {
+			fprintf( stderr, "Cannot create a thread.\n" );
+			return 1;
+		}
+	}
+	for( i=0; i<TEST_CONFIGS; i++ ) {
+		pthread_join( Threads[i], NULL );
+		printf( "%ld Hz, %ld ch, -z%d -r%d: %d of %d concurrent runs differ\n", s_Configs[i].Frequency, s_Configs[i].Channels, s_Configs[i].HEMode, s_Configs[i].RA, Jobs[i].Failures, Rounds );
+		Failures += Jobs[i].Failures;
+	}
+	pthread_attr_destroy( &Attr );
+
+	printf( Failures ? "FAILED\n" : "OK\n" );
+	return Failures ? 1 : 0;
+}
+
+// End of alsthread.cpp
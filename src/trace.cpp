@@ -0,0 +1,232 @@
+/***************** MPEG-4 Audio Lossless Coding **************************
+
+This software module was originally developed by
+
+NTT (Nippon Telegraph and Telephone Corporation), Japan
+
+in the course of development of the MPEG-4 Audio standard ISO/IEC 14496-3
+and associated amendments. This software module is an implementation of
+a part of one or more MPEG-4 Audio lossless coding tools as specified
+by the MPEG-4 Audio standard. ISO/IEC gives users of the MPEG-4 Audio
+standards free license to this software module or modifications
+thereof for use in hardware or software products claiming conformance
+to the MPEG-4 Audio standards. Those intending to use this software
+module in hardware or software products are advised that this use may
+infringe existing patents. The original developer of this software
+module, the subsequent editors and their companies, and ISO/IEC have
+no liability for use of this software module or modifications thereof
+in an implementation. Copyright is not released for non MPEG-4 Audio
+conforming products. The original developer retains full right to use
+the code for the developer's own purpose, assign or donate the code to
+a third party and to inhibit third party from using the code for non
+MPEG-4 Audio conforming products. This copyright notice must be included
+in all copies or derivative works.
+
+Copyright (c) 2007.
+
+filename : trace.cpp
+project  : MPEG-4 Audio Lossless Coding
+contents : Per-block trace of the coding decisions
+
+*************************************************************************/
+
+#include	<stdarg.h>
+#include	<string.h>
+#include	<algorithm>
+#include	"trace.h"
+
+//////////////////////////////////////////////////////////////////////
+//                                                                  //
+//                          CAlsTrace class                         //
+//                                                                  //
+//////////////////////////////////////////////////////////////////////
+
+////////////////////////////////////////
+//                                    //
+//            Begin a frame           //
+//                                    //
+////////////////////////////////////////
+// Index = Frame number (0-)
+// Samples = Samples per channel
+// Chan = Number of channels
+void	CAlsTrace::BeginFrame( ALS_INT64 Index, long Samples, long Chan )
+{
+	m_Frame.m_Index = Index;
+	m_Frame.m_Samples = Samples;
+	m_Frame.m_Bytes = m_Frame.m_FloatBytes = 0;
+	m_Frame.m_Mcc = 0;
+	m_Frame.m_BsFlags.resize( Chan );
+	m_Frame.m_Next.resize( Chan );
+	ClearBlocks();
+}
+
+////////////////////////////////////////
+//                                    //
+//      Drop the blocks of a frame    //
+//                                    //
+////////////////////////////////////////
+// * Used when the encoder discards a coded frame for a better one.
+void	CAlsTrace::ClearBlocks( void )
+{
+	std::fill( m_Frame.m_BsFlags.begin(), m_Frame.m_BsFlags.end(), 0 );
+	std::fill( m_Frame.m_Next.begin(), m_Frame.m_Next.end(), 0 );
+	m_Frame.m_Blocks.clear();
+}
+
+////////////////////////////////////////
+//                                    //
+//            Add a block             //
+//                                    //
+////////////////////////////////////////
+// Block = Decisions of the block (m_Length must be set)
+// Channel = Channel of the block
+// * The blocks of a channel must be added in time order.
+void	CAlsTrace::AddBlock( const ALS_TRACEBLOCK& Block, long Channel )
+{
+	m_Frame.m_Blocks.push_back( Block );
+	ALS_TRACEBLOCK&	Added = m_Frame.m_Blocks.back();
+	Added.m_Channel = Channel;
+	Added.m_Start = m_Frame.m_Next[Channel];
+	m_Frame.m_Next[Channel] += Block.m_Length;
+}
+
+////////////////////////////////////////
+//                                    //
+//            End a frame             //
+//                                    //
+////////////////////////////////////////
+// Bytes = Coded size of the frame in bytes (without RAU size)
+// FloatBytes = Floating-point difference data in Bytes
+// Mcc = true:Multi-channel correlation used
+// Return value = true:Success / false:Output error
+static bool	BlockOrder( const ALS_TRACEBLOCK& a, const ALS_TRACEBLOCK& b )
+{
+	return ( a.m_Channel < b.m_Channel ) || ( ( a.m_Channel == b.m_Channel ) && ( a.m_Start < b.m_Start ) );
+}
+
+bool	CAlsTrace::EndFrame( long Bytes, long FloatBytes, bool Mcc )
+{
+	m_Frame.m_Bytes = Bytes;
+	m_Frame.m_FloatBytes = FloatBytes;
+	m_Frame.m_Mcc = Mcc ? 1 : 0;
+
+	// Encoder and decoder visit the blocks in different order.
+	std::stable_sort( m_Frame.m_Blocks.begin(), m_Frame.m_Blocks.end(), BlockOrder );
+	return m_pSink->WriteFrame( m_Frame );
+}
+
+////////////////////////////////////////
+//                                    //
+//          Clear block record        //
+//                                    //
+////////////////////////////////////////
+// Block = Record to clear
+// Length = Number of samples in the block
+// Ra = true:Progressive prediction
+void	CAlsTrace::ClearBlock( ALS_TRACEBLOCK& Block, long Length, bool Ra )
+{
+	memset( &Block, 0, sizeof(Block) );
+	Block.m_Length = Length;
+	Block.m_Ra = Ra ? 1 : 0;
+	Block.m_MonoFrame = Block.m_RlsExt = -1;
+}
+
+////////////////////////////////////////
+//                                    //
+//          Count bits of a part      //
+//                                    //
+////////////////////////////////////////
+// Block = Block record
+// Part = Part which ends at the current bit position (TRACE_PART_*)
+// p = Bit stream
+void	CAlsTrace::Mark( ALS_TRACEBLOCK& Block, short Part, const BITIO* p )
+{
+	long	Pos = static_cast<long>( p->pbs - p->start_pbs ) * 8 + p->bit_offset;
+
+	Block.m_Bits[Part] += Pos - Block.m_Mark;
+	Block.m_Mark = Pos;
+}
+
+//////////////////////////////////////////////////////////////////////
+//                                                                  //
+//                     CAlsTraceJsonSink class                      //
+//                                                                  //
+//////////////////////////////////////////////////////////////////////
+
+////////////////////////////////////////
+//                                    //
+//            Write a frame           //
+//                                    //
+////////////////////////////////////////
+// Frame = Frame record
+// Return value = true:Success / false:Error
+bool	CAlsTraceJsonSink::WriteFrame( const ALS_TRACEFRAME& Frame )
+{
+	std::string	Json;
+
+	GetJson( Frame, Json );
+	return fputs( Json.c_str(), m_fp ) >= 0;
+}
+
+////////////////////////////////////////
+//                                    //
+//          Get frame as JSON         //
+//                                    //
+////////////////////////////////////////
+// Frame = Frame record
+// Json = Receives one line of JSON
+static void	Append( std::string& Json, const char* pFormat, ... )
+{
+	char	Buffer[256];
+	va_list	Args;
+
+	va_start( Args, pFormat );
+	vsprintf( Buffer, pFormat, Args );
+	va_end( Args );
+	Json += Buffer;
+}
+
+void	CAlsTraceJsonSink::GetJson( const ALS_TRACEFRAME& Frame, std::string& Json )
+{
+	static const char*	TypeNames[3] = { "zero", "constant", "normal" };
+	static const char*	PartNames[TRACE_PART_COUNT] = { "header", "coef", "ltp", "residual", "rlslms", "mcc" };
+	size_t	b, c;
+	short	i;
+
+	Json.clear();
+	Append( Json, "{\"frame\": %.0f, \"samples\": %ld, \"bytes\": %ld, \"float_bytes\": %ld, \"mcc\": %d, \"bs_flags\": [",
+			static_cast<double>( Frame.m_Index ), Frame.m_Samples, Frame.m_Bytes, Frame.m_FloatBytes, Frame.m_Mcc );
+	for( c=0; c<Frame.m_BsFlags.size(); c++ ) Append( Json, "%s\"%08lx\"", ( c > 0 ) ? ", " : "", Frame.m_BsFlags[c] );
+	Json += "], \"blocks\": [";
+	for( b=0; b<Frame.m_Blocks.size(); b++ ) {
+		const ALS_TRACEBLOCK&	Block = Frame.m_Blocks[b];
+		Append( Json, "%s{\"ch\": %ld, \"start\": %ld, \"length\": %ld, \"type\": \"%s\", \"diff\": %d, \"ra\": %d",
+				( b > 0 ) ? ", " : "", Block.m_Channel, Block.m_Start, Block.m_Length, TypeNames[Block.m_Type], Block.m_Diff, Block.m_Ra );
+		if ( Block.m_Type == TRACE_BLOCK_NORMAL ) {
+			Append( Json, ", \"order\": %d, \"shift\": %d, \"coder\": \"%s\", \"sub\": %d, \"s\": [",
+					Block.m_OptP, Block.m_Shift, Block.m_Bgmc ? "bgmc" : "rice", Block.m_Sub );
+			for( i=0; i<Block.m_Sub; i++ ) Append( Json, "%s%d", ( i > 0 ) ? ", " : "", Block.m_S[i] );
+			if ( Block.m_Bgmc ) {
+				Json += "], \"sx\": [";
+				for( i=0; i<Block.m_Sub; i++ ) Append( Json, "%s%d", ( i > 0 ) ? ", " : "", Block.m_Sx[i] );
+			}
+			Append( Json, "], \"ltp\": %d", Block.m_Ltp );
+			if ( Block.m_Ltp ) Append( Json, ", \"lag\": %d", Block.m_Lag );
+		}
+		if ( Block.m_RlsExt >= 0 ) Append( Json, ", \"mono\": %d, \"rlslms_ext\": %d", Block.m_MonoFrame, Block.m_RlsExt );
+		if ( Block.m_MccStages > 0 ) {
+			Json += ", \"mcc\": [";
+			for( i=0; i<Block.m_MccStages; i++ ) {
+				Append( Json, "%s{\"ref\": %d, \"mode\": %d, \"tau\": %d}", ( i > 0 ) ? ", " : "",
+						Block.m_MccRef[i], Block.m_MccMode[i], Block.m_MccTau[i] );
+			}
+			Json += "]";
+		}
+		Json += ", \"bits\": {";
+		for( i=0; i<TRACE_PART_COUNT; i++ ) Append( Json, "%s\"%s\": %ld", ( i > 0 ) ? ", " : "", PartNames[i], Block.m_Bits[i] );
+		Append( Json, "}, \"bytes\": %ld}", Block.m_Bytes );
+	}
+	Json += "]}\n";
+}
+
+// End of trace.cpp
@@ -0,0 +1,154 @@
+/***************** MPEG-4 Audio Lossless Coding **************************
+
+This software module was originally developed by
+
+NTT (Nippon Telegraph and Telephone Corporation), Japan
+
+in the course of development of the MPEG-4 Audio standard ISO/IEC 14496-3
+and associated amendments. This software module is an implementation of
+a part of one or more MPEG-4 Audio lossless coding tools as specified
+by the MPEG-4 Audio standard. ISO/IEC gives users of the MPEG-4 Audio
+standards free license to this software module or modifications
+thereof for use in hardware or software products claiming conformance
+to the MPEG-4 Audio standards. Those intending to use this software
+module in hardware or software products are advised that this use may
+infringe existing patents. The original developer of this software
+module, the subsequent editors and their companies, and ISO/IEC have
+no liability for use of this software module or modifications thereof
+in an implementation. Copyright is not released for non MPEG-4 Audio
+conforming products. The original developer retains full right to use
+the code for the developer's own purpose, assign or donate the code to
+a third party and to inhibit third party from using the code for non
+MPEG-4 Audio conforming products. This copyright notice must be included
+in all copies or derivative works.
+
+Copyright (c) 2007.
+
+filename : trace.h
+project  : MPEG-4 Audio Lossless Coding
+contents : Per-block trace of the coding decisions
+
+*************************************************************************/
+
+#if !defined( TRACE_INCLUDED )
+#define	TRACE_INCLUDED
+
+#include	<stdio.h>
+#include	<string>
+#include	<vector>
+#include	"stream.h"
+#include	"rn_bitio.h"
+
+//////////////////////////////////////////////////////////////////////
+//                                                                  //
+//                         Type definition                          //
+//                                                                  //
+//////////////////////////////////////////////////////////////////////
+
+// Block types
+enum	ALS_TRACE_BLOCKTYPE {
+	TRACE_BLOCK_ZERO = 0,	// Zero block
+	TRACE_BLOCK_CONST,		// Constant block
+	TRACE_BLOCK_NORMAL		// Predicted block
+};
+
+// Parts of a coded block
+enum	ALS_TRACE_PART {
+	TRACE_PART_HEADER = 0,	// Block header, code parameters, LSB shift, predictor order (whole zero/constant block)
+	TRACE_PART_COEF,		// Quantized PARCOR coefficients
+	TRACE_PART_LTP,			// Long-term prediction
+	TRACE_PART_RESIDUAL,	// Residual (Rice/BGMC)
+	TRACE_PART_RLSLMS,		// RLS-LMS parameters
+	TRACE_PART_MCC,			// MCC stages
+	TRACE_PART_COUNT
+};
+
+#define	TRACE_MAX_SUB	8	// Max. number of entropy coding sub-blocks
+#define	TRACE_MAX_MCC	6	// Max. number of MCC stages
+
+// Decisions and coded size of one block
+struct	ALS_TRACEBLOCK {
+	long	m_Channel;					// Channel (coded order)
+	long	m_Start;					// First sample in the frame
+	long	m_Length;					// Number of samples
+	short	m_Type;						// TRACE_BLOCK_*
+	short	m_Diff;						// 1:Difference signal of a channel pair
+	short	m_Ra;						// 1:Progressive prediction (random access block)
+	short	m_Bgmc;						// 1:BGMC / 0:Rice codes
+	short	m_OptP;						// Predictor order
+	short	m_Shift;					// LSB shift
+	short	m_Sub;						// Number of entropy coding sub-blocks
+	short	m_S[TRACE_MAX_SUB];			// Rice parameters
+	short	m_Sx[TRACE_MAX_SUB];		// BGMC extensions of the Rice parameters
+	short	m_Ltp;						// 1:Long-term prediction used
+	short	m_Lag;						// Coded LTP lag
+	short	m_MccStages;				// Number of MCC stages
+	short	m_MccRef[TRACE_MAX_MCC];	// Reference channel of each stage
+	short	m_MccMode[TRACE_MAX_MCC];	// 0:Reference itself / 1:3-tap / 2:6-tap with time lag
+	short	m_MccTau[TRACE_MAX_MCC];	// Time lag of each stage
+	short	m_MonoFrame;				// RLS-LMS mono flag (-1:No RLS-LMS)
+	short	m_RlsExt;					// RLS-LMS parameter update flags (-1:No RLS-LMS)
+	long	m_Bits[TRACE_PART_COUNT];	// Bits of each part
+	long	m_Bytes;					// Coded size in bytes (including the byte alignment)
+	long	m_Mark;						// Bit position of the last part boundary (see Mark())
+};
+
+// Decisions and coded size of one frame
+struct	ALS_TRACEFRAME {
+	ALS_INT64	m_Index;					// Frame number (0-)
+	long		m_Samples;					// Samples per channel
+	long		m_Bytes;					// Coded size in bytes (without RAU size)
+	long		m_FloatBytes;				// Floating-point difference data in m_Bytes
+	short		m_Mcc;						// 1:Multi-channel correlation used
+	std::vector<unsigned long>	m_BsFlags;	// Block switching flags of each channel
+	std::vector<long>			m_Next;		// Start of the next block of each channel
+	std::vector<ALS_TRACEBLOCK>	m_Blocks;	// Blocks of all channels
+};
+
+//////////////////////////////////////////////////////////////////////
+//                                                                  //
+//                        CAlsTraceSink class                       //
+//                                                                  //
+//////////////////////////////////////////////////////////////////////
+class	CAlsTraceSink {
+public:
+	virtual	~CAlsTraceSink( void ) {}
+	virtual	bool	WriteFrame( const ALS_TRACEFRAME& Frame ) = 0;
+};
+
+// Trace as JSON lines (one frame per line)
+class	CAlsTraceJsonSink : public CAlsTraceSink {
+public:
+	CAlsTraceJsonSink( FILE* fp ) : m_fp( fp ) {}
+	bool	WriteFrame( const ALS_TRACEFRAME& Frame );
+	static void	GetJson( const ALS_TRACEFRAME& Frame, std::string& Json );
+protected:
+	FILE*	m_fp;
+};
+
+//////////////////////////////////////////////////////////////////////
+//                                                                  //
+//                          CAlsTrace class                         //
+//                                                                  //
+//////////////////////////////////////////////////////////////////////
+class	CAlsTrace {
+public:
+	CAlsTrace( void ) : m_pSink( NULL ) {}
+	void	SetSink( CAlsTraceSink* pSink ) { m_pSink = pSink; }
+	bool	IsEnabled( void ) const { return m_pSink != NULL; }
+	void	BeginFrame( ALS_INT64 Index, long Samples, long Chan );
+	void	ClearBlocks( void );
+	void	SetBlockSwitching( long Channel, unsigned long BsFlags ) { m_Frame.m_BsFlags[Channel] = BsFlags; }
+	void	AddBlock( const ALS_TRACEBLOCK& Block, long Channel );
+	bool	EndFrame( long Bytes, long FloatBytes, bool Mcc );
+	static void	ClearBlock( ALS_TRACEBLOCK& Block, long Length, bool Ra );
+	static void	Mark( ALS_TRACEBLOCK& Block, short Part, const BITIO* p );
+
+protected:
+	CAlsTraceSink*	m_pSink;		// Output of the trace (NULL:Disabled)
+	ALS_TRACEFRAME	m_Frame;		// Current frame
+};
+
+#endif	// TRACE_INCLUDED
+
+// End of trace.h